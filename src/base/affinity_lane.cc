@@ -0,0 +1,93 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "base/affinity_lane.h"
+
+#include <exception>
+#include <iostream>
+#include <utility>
+
+#include "base/profiler.h"
+
+namespace base {
+
+AffinityLane::AffinityLane(Task on_start, Task on_stop)
+    : terminate_(false) {
+  thread_ = std::thread(&AffinityLane::Run, this, std::move(on_start),
+                        std::move(on_stop));
+}
+
+AffinityLane::~AffinityLane() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    terminate_ = true;
+  }
+  condition_variable_.notify_all();
+  thread_.join();
+}
+
+void AffinityLane::Post(Task&& task) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_.emplace(std::move(task));
+  condition_variable_.notify_all();
+}
+
+void AffinityLane::Run(const Task& on_start, const Task& on_stop) {
+  on_start();
+
+  while (true) {
+    // Wait for a task.
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (queue_.empty() && !terminate_) {
+      condition_variable_.wait(lock);
+    }
+
+    // Were we requested to terminate?
+    if (terminate_) {
+      break;
+    }
+
+    // Pop the task from the queue, and run it with the mutex unlocked.
+    auto task = std::move(queue_.front());
+    queue_.pop();
+    lock.unlock();
+    ProfileScope scope("LaneTask");
+    try {
+      task();
+    } catch (std::exception& e) {
+      std::cerr << "Error: Unhandled exception in a lane task: " << e.what()
+                << std::endl;
+    } catch (...) {
+      std::cerr << "Error: Unhandled exception in a lane task." << std::endl;
+    }
+  }
+
+  on_stop();
+}
+
+}  // namespace base
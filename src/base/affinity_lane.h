@@ -0,0 +1,90 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef BASE_AFFINITY_LANE_H_
+#define BASE_AFFINITY_LANE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+namespace base {
+
+/// @brief A dedicated thread for tasks that must run on a specific thread.
+///
+/// Some resources, such as OpenGL contexts, can only be used by the thread
+/// that they are bound to, so tasks that use them can not be run by the
+/// work-stealing TaskScheduler. An affinity lane is a thread of its own that
+/// runs the tasks that are posted to it, in order.
+///
+/// Lane tasks may spawn tasks on a TaskScheduler and wait for them, in which
+/// case the lane thread helps out with the scheduler work while waiting.
+///
+/// Lane tasks should handle their own errors. An exception that escapes a
+/// task is logged and dropped (there is nobody to rethrow it to), so that it
+/// does not terminate the process.
+class AffinityLane {
+ public:
+  using Task = std::function<void()>;
+
+  /// @brief Start the lane thread.
+  /// @param on_start Called by the lane thread before running any tasks (e.g.
+  /// to bind a context to the thread).
+  /// @param on_stop Called by the lane thread before it exits.
+  AffinityLane(Task on_start, Task on_stop);
+
+  /// @brief Stop the lane thread.
+  ///
+  /// The task that is currently running (if any) is finished, but any tasks
+  /// that have not yet been started are discarded.
+  ~AffinityLane();
+
+  /// @brief Post a task to the lane.
+  void Post(Task&& task);
+
+ private:
+  void Run(const Task& on_start, const Task& on_stop);
+
+  std::atomic_bool terminate_;
+  std::condition_variable condition_variable_;
+  std::mutex mutex_;
+  std::queue<Task> queue_;
+  std::thread thread_;
+
+  // Disable copy/move.
+  AffinityLane(const AffinityLane&) = delete;
+  AffinityLane(AffinityLane&&) = delete;
+  AffinityLane& operator=(const AffinityLane&) = delete;
+};
+
+}  // namespace base
+
+#endif  // BASE_AFFINITY_LANE_H_
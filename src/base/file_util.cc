@@ -0,0 +1,147 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "base/file_util.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#else
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const char kApplicationName[] = "viewer";
+
+bool MakeDirectory(const std::string& path) {
+#ifdef _WIN32
+  return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+  return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+}  // namespace
+
+#ifdef _WIN32
+
+bool GetFileStatus(const std::string& path, FileStatus* status) {
+  struct __stat64 file_stat;
+  if (_stat64(path.c_str(), &file_stat) != 0) {
+    return false;
+  }
+  status->size = static_cast<uint64_t>(file_stat.st_size);
+  status->modification_time = static_cast<int64_t>(file_stat.st_mtime);
+  return true;
+}
+
+std::string GetAbsolutePath(const std::string& path) {
+  char buffer[MAX_PATH];
+  if (_fullpath(buffer, path.c_str(), MAX_PATH) == nullptr) {
+    return path;
+  }
+  return std::string(buffer);
+}
+
+std::string GetCacheDirectory() {
+  const char* local_app_data = std::getenv("LOCALAPPDATA");
+  if (local_app_data == nullptr) {
+    return std::string();
+  }
+  std::string path = std::string(local_app_data) + "\\" + kApplicationName;
+  if (!MakeDirectory(path) || !MakeDirectory(path + "\\cache")) {
+    return std::string();
+  }
+  return path + "\\cache\\";
+}
+
+bool RenameFile(const std::string& from, const std::string& to) {
+  return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+#else
+
+bool GetFileStatus(const std::string& path, FileStatus* status) {
+  struct stat file_stat;
+  if (stat(path.c_str(), &file_stat) != 0) {
+    return false;
+  }
+  status->size = static_cast<uint64_t>(file_stat.st_size);
+  status->modification_time = static_cast<int64_t>(file_stat.st_mtime);
+  return true;
+}
+
+std::string GetAbsolutePath(const std::string& path) {
+  std::vector<char> buffer(PATH_MAX + 1);
+  if (realpath(path.c_str(), buffer.data()) == nullptr) {
+    return path;
+  }
+  return std::string(buffer.data());
+}
+
+std::string GetCacheDirectory() {
+  // Follow the XDG base directory specification.
+  std::string path;
+  const char* xdg_cache_home = std::getenv("XDG_CACHE_HOME");
+  if (xdg_cache_home != nullptr && xdg_cache_home[0] == '/') {
+    path = xdg_cache_home;
+  } else {
+    const char* home = std::getenv("HOME");
+    if (home == nullptr) {
+      return std::string();
+    }
+    path = std::string(home) + "/.cache";
+  }
+  if (!MakeDirectory(path)) {
+    return std::string();
+  }
+  path += std::string("/") + kApplicationName;
+  if (!MakeDirectory(path)) {
+    return std::string();
+  }
+  return path + "/";
+}
+
+bool RenameFile(const std::string& from, const std::string& to) {
+  // rename() atomically replaces the destination on POSIX systems.
+  return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+#endif
+
+}  // namespace base
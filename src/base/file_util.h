@@ -0,0 +1,68 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef BASE_FILE_UTIL_H_
+#define BASE_FILE_UTIL_H_
+
+#include <cstdint>
+#include <string>
+
+namespace base {
+
+/// @brief Basic information about a file.
+struct FileStatus {
+  uint64_t size = 0;
+
+  /// Last modification time, in seconds since the epoch.
+  int64_t modification_time = 0;
+};
+
+/// @brief Get the status of a file.
+/// @param path The path to the file.
+/// @param[out] status The file status.
+/// @returns false if the file does not exist or is not accessible.
+bool GetFileStatus(const std::string& path, FileStatus* status);
+
+/// @returns the absolute path for the given path, or the path itself if it
+/// could not be resolved.
+std::string GetAbsolutePath(const std::string& path);
+
+/// @brief Get the per-user cache directory for the application.
+///
+/// The directory is created if it does not exist.
+/// @returns the directory path (including a trailing path separator), or an
+/// empty string if there is no usable cache directory.
+std::string GetCacheDirectory();
+
+/// @brief Rename a file, replacing the destination file if it exists.
+/// @returns true on success.
+bool RenameFile(const std::string& from, const std::string& to);
+
+}  // namespace base
+
+#endif  // BASE_FILE_UTIL_H_
@@ -0,0 +1,95 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "base/hash.h"
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+const uint64_t kPrime1 = UINT64_C(0x9e3779b185ebca87);
+const uint64_t kPrime2 = UINT64_C(0xc2b2ae3d27d4eb4f);
+
+inline uint64_t Rotate(uint64_t x, int bits) {
+  return (x << bits) | (x >> (64 - bits));
+}
+
+inline uint64_t Load64(const uint8_t* p) {
+  uint64_t x;
+  std::memcpy(&x, p, sizeof(x));
+  return x;
+}
+
+inline uint64_t Round(uint64_t lane, uint64_t word) {
+  return Rotate(lane + word * kPrime2, 31) * kPrime1;
+}
+
+// The final avalanche (from MurmurHash3).
+inline uint64_t Mix(uint64_t x) {
+  x ^= x >> 33;
+  x *= UINT64_C(0xff51afd7ed558ccd);
+  x ^= x >> 33;
+  x *= UINT64_C(0xc4ceb9fe1a85ec53);
+  x ^= x >> 33;
+  return x;
+}
+
+}  // namespace
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed) {
+  const auto* p = static_cast<const uint8_t*>(data);
+  const uint8_t* end = p + size;
+
+  // Four lanes of 64-bit words.
+  uint64_t lanes[4] = {seed + kPrime1 + kPrime2, seed + kPrime2, seed,
+                       seed - kPrime1};
+  while (end - p >= 32) {
+    for (int i = 0; i < 4; ++i) {
+      lanes[i] = Round(lanes[i], Load64(p + 8 * i));
+    }
+    p += 32;
+  }
+  uint64_t hash = Rotate(lanes[0], 1) + Rotate(lanes[1], 7) +
+                  Rotate(lanes[2], 12) + Rotate(lanes[3], 18);
+  hash += static_cast<uint64_t>(size);
+
+  // The remaining words and bytes.
+  while (end - p >= 8) {
+    hash = Rotate(hash ^ Round(0, Load64(p)), 27) * kPrime1 + kPrime2;
+    p += 8;
+  }
+  while (p < end) {
+    hash = Rotate(hash ^ (*p * kPrime1), 11) * kPrime2;
+    ++p;
+  }
+  return Mix(hash);
+}
+
+}  // namespace base
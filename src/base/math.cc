@@ -0,0 +1,574 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "base/math.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define BASE_MATH_AVX
+#define BASE_MATH_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BASE_MATH_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BASE_MATH_NEON
+#endif
+
+namespace base {
+
+namespace {
+
+Visibility ToVisibility(bool outside, bool inside) {
+  return outside ? kOutside : (inside ? kInside : kIntersecting);
+}
+
+}  // namespace
+
+Mat4 Mat4::Identity() {
+  return Mat4{{1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+               1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f}};
+}
+
+Mat4 Mat4::FromArray(const float* elements) {
+  Mat4 result;
+  for (int i = 0; i < 16; ++i) {
+    result.m[i] = elements[i];
+  }
+  return result;
+}
+
+Mat4 Mat4::Translation(const Vec3& t) {
+  Mat4 result = Identity();
+  result.m[12] = t.x;
+  result.m[13] = t.y;
+  result.m[14] = t.z;
+  return result;
+}
+
+Mat4 Mat4::Scale(const Vec3& s) {
+  Mat4 result = Identity();
+  result.m[0] = s.x;
+  result.m[5] = s.y;
+  result.m[10] = s.z;
+  return result;
+}
+
+Mat4 Mat4::Rotation(const Quat& r) {
+  return Trs(Vec3{0.0f, 0.0f, 0.0f}, r, Vec3{1.0f, 1.0f, 1.0f});
+}
+
+Mat4 Mat4::Trs(const Vec3& t, const Quat& r, const Vec3& s) {
+  const float x = r.x;
+  const float y = r.y;
+  const float z = r.z;
+  const float w = r.w;
+
+  // Rotation matrix columns, scaled.
+  Mat4 result;
+  result.m[0] = (1.0f - 2.0f * (y * y + z * z)) * s.x;
+  result.m[1] = (2.0f * (x * y + z * w)) * s.x;
+  result.m[2] = (2.0f * (x * z - y * w)) * s.x;
+  result.m[3] = 0.0f;
+  result.m[4] = (2.0f * (x * y - z * w)) * s.y;
+  result.m[5] = (1.0f - 2.0f * (x * x + z * z)) * s.y;
+  result.m[6] = (2.0f * (y * z + x * w)) * s.y;
+  result.m[7] = 0.0f;
+  result.m[8] = (2.0f * (x * z + y * w)) * s.z;
+  result.m[9] = (2.0f * (y * z - x * w)) * s.z;
+  result.m[10] = (1.0f - 2.0f * (x * x + y * y)) * s.z;
+  result.m[11] = 0.0f;
+  result.m[12] = t.x;
+  result.m[13] = t.y;
+  result.m[14] = t.z;
+  result.m[15] = 1.0f;
+  return result;
+}
+
+Mat4 Mat4::Perspective(float fov, float aspect, float z_near, float z_far) {
+  const float f = 1.0f / std::tan(fov * 0.5f);
+  Mat4 result = {};
+  result.m[0] = f / aspect;
+  result.m[5] = f;
+  result.m[10] = (z_far + z_near) / (z_near - z_far);
+  result.m[11] = -1.0f;
+  result.m[14] = 2.0f * z_far * z_near / (z_near - z_far);
+  return result;
+}
+
+Mat4 Mat4::Orthographic(float left,
+                        float right,
+                        float bottom,
+                        float top,
+                        float z_near,
+                        float z_far) {
+  Mat4 result = Identity();
+  result.m[0] = 2.0f / (right - left);
+  result.m[5] = 2.0f / (top - bottom);
+  result.m[10] = -2.0f / (z_far - z_near);
+  result.m[12] = -(right + left) / (right - left);
+  result.m[13] = -(top + bottom) / (top - bottom);
+  result.m[14] = -(z_far + z_near) / (z_far - z_near);
+  return result;
+}
+
+Mat4 Mat4::LookAt(const Vec3& eye, const Vec3& target, const Vec3& up) {
+  const Vec3 back = Normalize(eye - target);
+  const Vec3 right = Normalize(Cross(up, back));
+  const Vec3 true_up = Cross(back, right);
+  Mat4 result = Identity();
+  for (int i = 0; i < 3; ++i) {
+    result.m[i * 4 + 0] = right[i];
+    result.m[i * 4 + 1] = true_up[i];
+    result.m[i * 4 + 2] = back[i];
+  }
+  result.m[12] = -Dot(right, eye);
+  result.m[13] = -Dot(true_up, eye);
+  result.m[14] = -Dot(back, eye);
+  return result;
+}
+
+bool Mat4::InvertAffine(Mat4* result) const {
+  const float a = m[0], b = m[4], c = m[8];
+  const float d = m[1], e = m[5], f = m[9];
+  const float g = m[2], h = m[6], i = m[10];
+  const float co0 = e * i - f * h;
+  const float co1 = f * g - d * i;
+  const float co2 = d * h - e * g;
+  const float det = a * co0 + b * co1 + c * co2;
+  if (std::fabs(det) < 1e-30f) {
+    return false;
+  }
+  const float s = 1.0f / det;
+  Mat4& r = *result;
+  r.m[0] = co0 * s;
+  r.m[1] = co1 * s;
+  r.m[2] = co2 * s;
+  r.m[3] = 0.0f;
+  r.m[4] = (c * h - b * i) * s;
+  r.m[5] = (a * i - c * g) * s;
+  r.m[6] = (b * g - a * h) * s;
+  r.m[7] = 0.0f;
+  r.m[8] = (b * f - c * e) * s;
+  r.m[9] = (c * d - a * f) * s;
+  r.m[10] = (a * e - b * d) * s;
+  r.m[11] = 0.0f;
+  const Vec3 t = r.TransformVector(Vec3{m[12], m[13], m[14]});
+  r.m[12] = -t.x;
+  r.m[13] = -t.y;
+  r.m[14] = -t.z;
+  r.m[15] = 1.0f;
+  return true;
+}
+
+Mat4 operator*(const Mat4& a, const Mat4& b) {
+  Mat4 result;
+  for (int col = 0; col < 4; ++col) {
+    for (int row = 0; row < 4; ++row) {
+      float sum = 0.0f;
+      for (int k = 0; k < 4; ++k) {
+        sum += a.m[k * 4 + row] * b.m[col * 4 + k];
+      }
+      result.m[col * 4 + row] = sum;
+    }
+  }
+  return result;
+}
+
+Aabb Aabb::Transformed(const Mat4& m) const {
+  // Arvo's method: transform the center, and project the extent onto the
+  // axes using the absolute values of the matrix.
+  const Vec3 c = m.TransformPoint(center());
+  const Vec3 e = extent();
+  const Vec3 r{
+      std::fabs(m.m[0]) * e.x + std::fabs(m.m[4]) * e.y +
+          std::fabs(m.m[8]) * e.z,
+      std::fabs(m.m[1]) * e.x + std::fabs(m.m[5]) * e.y +
+          std::fabs(m.m[9]) * e.z,
+      std::fabs(m.m[2]) * e.x + std::fabs(m.m[6]) * e.y +
+          std::fabs(m.m[10]) * e.z};
+  return Aabb{c - r, c + r};
+}
+
+Frustum Frustum::FromMatrix(const Mat4& view_proj) {
+  // Gribb & Hartmann: the planes are sums and differences of the rows of the
+  // matrix.
+  const float* m = view_proj.m;
+  Frustum frustum;
+  for (int i = 0; i < 3; ++i) {
+    for (int sign = 0; sign < 2; ++sign) {
+      const float s = sign == 0 ? 1.0f : -1.0f;
+      Plane& plane = frustum.planes[2 * i + sign];
+      plane.normal = Vec3{m[3] + s * m[i], m[7] + s * m[4 + i],
+                          m[11] + s * m[8 + i]};
+      plane.d = m[15] + s * m[12 + i];
+      const float length = Length(plane.normal);
+      if (length > 0.0f) {
+        plane.normal = plane.normal * (1.0f / length);
+        plane.d /= length;
+      }
+    }
+  }
+  return frustum;
+}
+
+Visibility Frustum::Classify(const Aabb& box) const {
+  // A box is outside if it is entirely behind any plane, and inside if it is
+  // entirely in front of all the planes.
+  const Vec3 c = box.center();
+  const Vec3 e = box.extent();
+  bool inside = true;
+  for (const auto& plane : planes) {
+    const float d = plane.Distance(c);
+    const float r = Dot(Abs(plane.normal), e);
+    if (d + r < 0.0f) {
+      return kOutside;
+    }
+    inside = inside && d - r >= 0.0f;
+  }
+  return inside ? kInside : kIntersecting;
+}
+
+const char* GetSimdBackend() {
+#if defined(BASE_MATH_AVX)
+  return "AVX";
+#elif defined(BASE_MATH_SSE2)
+  return "SSE2";
+#elif defined(BASE_MATH_NEON)
+  return "NEON";
+#else
+  return "scalar";
+#endif
+}
+
+void TransformPoints(const Mat4& m,
+                     const Vec3* points,
+                     size_t count,
+                     Vec3* result) {
+#if defined(BASE_MATH_SSE2)
+  // result = col0 * x + col1 * y + col2 * z + col3.
+  const __m128 col0 = _mm_loadu_ps(&m.m[0]);
+  const __m128 col1 = _mm_loadu_ps(&m.m[4]);
+  const __m128 col2 = _mm_loadu_ps(&m.m[8]);
+  const __m128 col3 = _mm_loadu_ps(&m.m[12]);
+  for (size_t i = 0; i < count; ++i) {
+    const Vec3& p = points[i];
+    const __m128 r = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(p.x)),
+                   _mm_mul_ps(col1, _mm_set1_ps(p.y))),
+        _mm_add_ps(_mm_mul_ps(col2, _mm_set1_ps(p.z)), col3));
+    _mm_storel_pi(reinterpret_cast<__m64*>(&result[i].x), r);
+    _mm_store_ss(&result[i].z, _mm_movehl_ps(r, r));
+  }
+#elif defined(BASE_MATH_NEON)
+  const float32x4_t col0 = vld1q_f32(&m.m[0]);
+  const float32x4_t col1 = vld1q_f32(&m.m[4]);
+  const float32x4_t col2 = vld1q_f32(&m.m[8]);
+  const float32x4_t col3 = vld1q_f32(&m.m[12]);
+  for (size_t i = 0; i < count; ++i) {
+    const Vec3& p = points[i];
+    const float32x4_t r = vmlaq_n_f32(
+        vmlaq_n_f32(vmlaq_n_f32(col3, col0, p.x), col1, p.y), col2, p.z);
+    vst1_f32(&result[i].x, vget_low_f32(r));
+    result[i].z = vgetq_lane_f32(r, 2);
+  }
+#else
+  for (size_t i = 0; i < count; ++i) {
+    result[i] = m.TransformPoint(points[i]);
+  }
+#endif
+}
+
+void TransformAabbs(const Mat4& m,
+                    const Aabb* boxes,
+                    size_t count,
+                    Aabb* result) {
+#if defined(BASE_MATH_SSE2)
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 col0 = _mm_loadu_ps(&m.m[0]);
+  const __m128 col1 = _mm_loadu_ps(&m.m[4]);
+  const __m128 col2 = _mm_loadu_ps(&m.m[8]);
+  const __m128 col3 = _mm_loadu_ps(&m.m[12]);
+  const __m128 abs_col0 = _mm_and_ps(col0, abs_mask);
+  const __m128 abs_col1 = _mm_and_ps(col1, abs_mask);
+  const __m128 abs_col2 = _mm_and_ps(col2, abs_mask);
+  for (size_t i = 0; i < count; ++i) {
+    const Vec3 c = boxes[i].center();
+    const Vec3 e = boxes[i].extent();
+    const __m128 center = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(c.x)),
+                   _mm_mul_ps(col1, _mm_set1_ps(c.y))),
+        _mm_add_ps(_mm_mul_ps(col2, _mm_set1_ps(c.z)), col3));
+    const __m128 extent = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(abs_col0, _mm_set1_ps(e.x)),
+                   _mm_mul_ps(abs_col1, _mm_set1_ps(e.y))),
+        _mm_mul_ps(abs_col2, _mm_set1_ps(e.z)));
+    const __m128 box_min = _mm_sub_ps(center, extent);
+    const __m128 box_max = _mm_add_ps(center, extent);
+    _mm_storel_pi(reinterpret_cast<__m64*>(&result[i].min.x), box_min);
+    _mm_store_ss(&result[i].min.z, _mm_movehl_ps(box_min, box_min));
+    _mm_storel_pi(reinterpret_cast<__m64*>(&result[i].max.x), box_max);
+    _mm_store_ss(&result[i].max.z, _mm_movehl_ps(box_max, box_max));
+  }
+#elif defined(BASE_MATH_NEON)
+  const float32x4_t col0 = vld1q_f32(&m.m[0]);
+  const float32x4_t col1 = vld1q_f32(&m.m[4]);
+  const float32x4_t col2 = vld1q_f32(&m.m[8]);
+  const float32x4_t col3 = vld1q_f32(&m.m[12]);
+  const float32x4_t abs_col0 = vabsq_f32(col0);
+  const float32x4_t abs_col1 = vabsq_f32(col1);
+  const float32x4_t abs_col2 = vabsq_f32(col2);
+  for (size_t i = 0; i < count; ++i) {
+    const Vec3 c = boxes[i].center();
+    const Vec3 e = boxes[i].extent();
+    const float32x4_t center = vmlaq_n_f32(
+        vmlaq_n_f32(vmlaq_n_f32(col3, col0, c.x), col1, c.y), col2, c.z);
+    const float32x4_t extent =
+        vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(abs_col0, e.x), abs_col1, e.y),
+                    abs_col2, e.z);
+    const float32x4_t box_min = vsubq_f32(center, extent);
+    const float32x4_t box_max = vaddq_f32(center, extent);
+    vst1_f32(&result[i].min.x, vget_low_f32(box_min));
+    result[i].min.z = vgetq_lane_f32(box_min, 2);
+    vst1_f32(&result[i].max.x, vget_low_f32(box_max));
+    result[i].max.z = vgetq_lane_f32(box_max, 2);
+  }
+#else
+  for (size_t i = 0; i < count; ++i) {
+    result[i] = boxes[i].Transformed(m);
+  }
+#endif
+}
+
+void ClassifyAabbs(const Frustum& frustum,
+                   const float* const* center,
+                   const float* const* extent,
+                   size_t count,
+                   Visibility* result) {
+  // The distance from the center of a box to a plane is d = n . c + w, and
+  // the projected radius of the box is r = |n| . e.
+#if defined(BASE_MATH_AVX)
+  __m256 n[6][3];
+  __m256 abs_n[6][3];
+  __m256 w[6];
+  for (int p = 0; p < 6; ++p) {
+    const Plane& plane = frustum.planes[p];
+    for (int k = 0; k < 3; ++k) {
+      n[p][k] = _mm256_set1_ps(plane.normal[k]);
+      abs_n[p][k] = _mm256_set1_ps(std::fabs(plane.normal[k]));
+    }
+    w[p] = _mm256_set1_ps(plane.d);
+  }
+  const __m256 zero = _mm256_setzero_ps();
+  for (size_t i = 0; i < count; i += 8) {
+    const __m256 cx = _mm256_loadu_ps(&center[0][i]);
+    const __m256 cy = _mm256_loadu_ps(&center[1][i]);
+    const __m256 cz = _mm256_loadu_ps(&center[2][i]);
+    const __m256 ex = _mm256_loadu_ps(&extent[0][i]);
+    const __m256 ey = _mm256_loadu_ps(&extent[1][i]);
+    const __m256 ez = _mm256_loadu_ps(&extent[2][i]);
+    __m256 outside = zero;
+    __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+    for (int p = 0; p < 6; ++p) {
+      const __m256 d = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(n[p][0], cx), _mm256_mul_ps(n[p][1], cy)),
+          _mm256_add_ps(_mm256_mul_ps(n[p][2], cz), w[p]));
+      const __m256 r = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(abs_n[p][0], ex),
+                        _mm256_mul_ps(abs_n[p][1], ey)),
+          _mm256_mul_ps(abs_n[p][2], ez));
+      outside = _mm256_or_ps(
+          outside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_LT_OQ));
+      inside = _mm256_and_ps(
+          inside, _mm256_cmp_ps(_mm256_sub_ps(d, r), zero, _CMP_GE_OQ));
+    }
+    const int outside_mask = _mm256_movemask_ps(outside);
+    const int inside_mask = _mm256_movemask_ps(inside);
+    for (size_t lane = 0; lane < 8 && i + lane < count; ++lane) {
+      result[i + lane] = ToVisibility((outside_mask >> lane) & 1,
+                                      (inside_mask >> lane) & 1);
+    }
+  }
+#elif defined(BASE_MATH_SSE2)
+  __m128 n[6][3];
+  __m128 abs_n[6][3];
+  __m128 w[6];
+  for (int p = 0; p < 6; ++p) {
+    const Plane& plane = frustum.planes[p];
+    for (int k = 0; k < 3; ++k) {
+      n[p][k] = _mm_set1_ps(plane.normal[k]);
+      abs_n[p][k] = _mm_set1_ps(std::fabs(plane.normal[k]));
+    }
+    w[p] = _mm_set1_ps(plane.d);
+  }
+  const __m128 zero = _mm_setzero_ps();
+  for (size_t i = 0; i < count; i += 4) {
+    const __m128 cx = _mm_loadu_ps(&center[0][i]);
+    const __m128 cy = _mm_loadu_ps(&center[1][i]);
+    const __m128 cz = _mm_loadu_ps(&center[2][i]);
+    const __m128 ex = _mm_loadu_ps(&extent[0][i]);
+    const __m128 ey = _mm_loadu_ps(&extent[1][i]);
+    const __m128 ez = _mm_loadu_ps(&extent[2][i]);
+    __m128 outside = zero;
+    __m128 inside = _mm_cmpeq_ps(zero, zero);
+    for (int p = 0; p < 6; ++p) {
+      const __m128 d = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(n[p][0], cx), _mm_mul_ps(n[p][1], cy)),
+          _mm_add_ps(_mm_mul_ps(n[p][2], cz), w[p]));
+      const __m128 r = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(abs_n[p][0], ex), _mm_mul_ps(abs_n[p][1], ey)),
+          _mm_mul_ps(abs_n[p][2], ez));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_sub_ps(d, r), zero));
+    }
+    const int outside_mask = _mm_movemask_ps(outside);
+    const int inside_mask = _mm_movemask_ps(inside);
+    for (size_t lane = 0; lane < 4 && i + lane < count; ++lane) {
+      result[i + lane] = ToVisibility((outside_mask >> lane) & 1,
+                                      (inside_mask >> lane) & 1);
+    }
+  }
+#elif defined(BASE_MATH_NEON)
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  for (size_t i = 0; i < count; i += 4) {
+    const float32x4_t cx = vld1q_f32(&center[0][i]);
+    const float32x4_t cy = vld1q_f32(&center[1][i]);
+    const float32x4_t cz = vld1q_f32(&center[2][i]);
+    const float32x4_t ex = vld1q_f32(&extent[0][i]);
+    const float32x4_t ey = vld1q_f32(&extent[1][i]);
+    const float32x4_t ez = vld1q_f32(&extent[2][i]);
+    uint32x4_t outside = vdupq_n_u32(0);
+    uint32x4_t inside = vdupq_n_u32(0xffffffffu);
+    for (const auto& plane : frustum.planes) {
+      const float32x4_t d = vmlaq_n_f32(
+          vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(plane.d), cx, plane.normal.x),
+                      cy, plane.normal.y),
+          cz, plane.normal.z);
+      const float32x4_t r = vmlaq_n_f32(
+          vmlaq_n_f32(vmulq_n_f32(ex, std::fabs(plane.normal.x)), ey,
+                      std::fabs(plane.normal.y)),
+          ez, std::fabs(plane.normal.z));
+      outside = vorrq_u32(outside, vcltq_f32(vaddq_f32(d, r), zero));
+      inside = vandq_u32(inside, vcgeq_f32(vsubq_f32(d, r), zero));
+    }
+    uint32_t outside_lanes[4];
+    uint32_t inside_lanes[4];
+    vst1q_u32(outside_lanes, outside);
+    vst1q_u32(inside_lanes, inside);
+    for (size_t lane = 0; lane < 4 && i + lane < count; ++lane) {
+      result[i + lane] =
+          ToVisibility(outside_lanes[lane] != 0, inside_lanes[lane] != 0);
+    }
+  }
+#else
+  for (size_t i = 0; i < count; ++i) {
+    bool outside = false;
+    bool inside = true;
+    for (const auto& plane : frustum.planes) {
+      const float d = plane.normal.x * center[0][i] +
+                      plane.normal.y * center[1][i] +
+                      plane.normal.z * center[2][i] + plane.d;
+      const float r = std::fabs(plane.normal.x) * extent[0][i] +
+                      std::fabs(plane.normal.y) * extent[1][i] +
+                      std::fabs(plane.normal.z) * extent[2][i];
+      outside = outside || d + r < 0.0f;
+      inside = inside && d - r >= 0.0f;
+    }
+    result[i] = ToVisibility(outside, inside);
+  }
+#endif
+}
+
+void FindBackfacingCones(const Vec3& eye,
+                         const float* const* center,
+                         const float* radius,
+                         const float* const* axis,
+                         const float* cutoff,
+                         size_t count,
+                         uint8_t* result) {
+#if defined(BASE_MATH_SSE2)
+  const __m128 eye_x = _mm_set1_ps(eye.x);
+  const __m128 eye_y = _mm_set1_ps(eye.y);
+  const __m128 eye_z = _mm_set1_ps(eye.z);
+  for (size_t i = 0; i < count; i += 4) {
+    const __m128 vx = _mm_sub_ps(_mm_loadu_ps(&center[0][i]), eye_x);
+    const __m128 vy = _mm_sub_ps(_mm_loadu_ps(&center[1][i]), eye_y);
+    const __m128 vz = _mm_sub_ps(_mm_loadu_ps(&center[2][i]), eye_z);
+    const __m128 d = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&axis[0][i])),
+                   _mm_mul_ps(vy, _mm_loadu_ps(&axis[1][i]))),
+        _mm_mul_ps(vz, _mm_loadu_ps(&axis[2][i])));
+    const __m128 length = _mm_sqrt_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)),
+                   _mm_mul_ps(vz, vz)));
+    const __m128 limit = _mm_add_ps(
+        _mm_mul_ps(_mm_loadu_ps(&cutoff[i]), length), _mm_loadu_ps(&radius[i]));
+    const int mask = _mm_movemask_ps(_mm_cmpge_ps(d, limit));
+    for (size_t lane = 0; lane < 4 && i + lane < count; ++lane) {
+      result[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+    }
+  }
+#elif defined(BASE_MATH_NEON)
+  for (size_t i = 0; i < count; i += 4) {
+    const float32x4_t vx = vsubq_f32(vld1q_f32(&center[0][i]),
+                                     vdupq_n_f32(eye.x));
+    const float32x4_t vy = vsubq_f32(vld1q_f32(&center[1][i]),
+                                     vdupq_n_f32(eye.y));
+    const float32x4_t vz = vsubq_f32(vld1q_f32(&center[2][i]),
+                                     vdupq_n_f32(eye.z));
+    const float32x4_t d =
+        vmlaq_f32(vmlaq_f32(vmulq_f32(vx, vld1q_f32(&axis[0][i])), vy,
+                            vld1q_f32(&axis[1][i])),
+                  vz, vld1q_f32(&axis[2][i]));
+    float lengths[4];
+    vst1q_f32(lengths,
+              vmlaq_f32(vmlaq_f32(vmulq_f32(vx, vx), vy, vy), vz, vz));
+    for (float& length : lengths) {
+      length = std::sqrt(length);
+    }
+    const float32x4_t limit = vmlaq_f32(vld1q_f32(&radius[i]),
+                                        vld1q_f32(&cutoff[i]),
+                                        vld1q_f32(lengths));
+    uint32_t lanes[4];
+    vst1q_u32(lanes, vcgeq_f32(d, limit));
+    for (size_t lane = 0; lane < 4 && i + lane < count; ++lane) {
+      result[i + lane] = lanes[lane] != 0 ? 1 : 0;
+    }
+  }
+#else
+  for (size_t i = 0; i < count; ++i) {
+    const Vec3 c = {center[0][i], center[1][i], center[2][i]};
+    const Vec3 v = c - eye;
+    const float d = v.x * axis[0][i] + v.y * axis[1][i] + v.z * axis[2][i];
+    result[i] = d >= cutoff[i] * Length(v) + radius[i] ? 1 : 0;
+  }
+#endif
+}
+
+}  // namespace base
@@ -0,0 +1,385 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef BASE_MATH_H_
+#define BASE_MATH_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace base {
+
+// The math types are plain structs of floats, so that arrays of them can be
+// passed directly to OpenGL and to the batch kernels. Matrices are column
+// major (OpenGL conventions).
+
+/// @brief A three component vector.
+struct Vec3 {
+  float x;
+  float y;
+  float z;
+
+  float& operator[](int i) { return (&x)[i]; }
+  float operator[](int i) const { return (&x)[i]; }
+};
+
+static_assert(sizeof(Vec3) == 12, "Vec3 must be tightly packed.");
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) {
+  return Vec3{a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+inline Vec3 operator-(const Vec3& a, const Vec3& b) {
+  return Vec3{a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+inline Vec3 operator-(const Vec3& a) {
+  return Vec3{-a.x, -a.y, -a.z};
+}
+
+inline Vec3 operator*(const Vec3& a, float s) {
+  return Vec3{a.x * s, a.y * s, a.z * s};
+}
+
+inline Vec3 operator*(float s, const Vec3& a) {
+  return a * s;
+}
+
+inline float Dot(const Vec3& a, const Vec3& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vec3 Cross(const Vec3& a, const Vec3& b) {
+  return Vec3{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+              a.x * b.y - a.y * b.x};
+}
+
+inline float Length(const Vec3& a) {
+  return std::sqrt(Dot(a, a));
+}
+
+/// @returns the normalized vector, or the vector itself if it has zero length.
+inline Vec3 Normalize(const Vec3& a) {
+  const float length = Length(a);
+  return length > 0.0f ? a * (1.0f / length) : a;
+}
+
+inline Vec3 Min(const Vec3& a, const Vec3& b) {
+  return Vec3{a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y,
+              a.z < b.z ? a.z : b.z};
+}
+
+inline Vec3 Max(const Vec3& a, const Vec3& b) {
+  return Vec3{a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y,
+              a.z > b.z ? a.z : b.z};
+}
+
+inline Vec3 Abs(const Vec3& a) {
+  return Vec3{std::fabs(a.x), std::fabs(a.y), std::fabs(a.z)};
+}
+
+/// @brief A four component vector.
+struct Vec4 {
+  float x;
+  float y;
+  float z;
+  float w;
+
+  float& operator[](int i) { return (&x)[i]; }
+  float operator[](int i) const { return (&x)[i]; }
+};
+
+static_assert(sizeof(Vec4) == 16, "Vec4 must be tightly packed.");
+
+inline float Dot(const Vec4& a, const Vec4& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+/// @brief A rotation quaternion (x, y, z, w), as used by glTF.
+struct Quat {
+  float x;
+  float y;
+  float z;
+  float w;
+
+  static Quat Identity() { return Quat{0.0f, 0.0f, 0.0f, 1.0f}; }
+
+  /// @brief A rotation around an axis.
+  /// @param axis The rotation axis (must be normalized).
+  /// @param angle The rotation angle, in radians.
+  static Quat FromAxisAngle(const Vec3& axis, float angle) {
+    const float s = std::sin(angle * 0.5f);
+    return Quat{axis.x * s, axis.y * s, axis.z * s, std::cos(angle * 0.5f)};
+  }
+
+  /// @returns the vector rotated by this quaternion.
+  Vec3 Rotate(const Vec3& v) const {
+    // v' = v + 2 * cross(q, cross(q, v) + w * v).
+    const Vec3 q{x, y, z};
+    const Vec3 t = Cross(q, v) + w * v;
+    return v + 2.0f * Cross(q, t);
+  }
+};
+
+/// @returns the combined rotation, where rotating by a * b is the same as
+/// rotating by b and then by a.
+inline Quat operator*(const Quat& a, const Quat& b) {
+  return Quat{a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+              a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+              a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+              a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+
+inline Quat Normalize(const Quat& q) {
+  const float length =
+      std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+  if (length <= 0.0f) {
+    return Quat::Identity();
+  }
+  const float s = 1.0f / length;
+  return Quat{q.x * s, q.y * s, q.z * s, q.w * s};
+}
+
+/// @brief A column major 4x4 matrix.
+struct Mat4 {
+  /// The elements, where m[col * 4 + row] is the element at (row, col).
+  float m[16];
+
+  static Mat4 Identity();
+
+  /// @brief Create a matrix from 16 floats in column major order.
+  static Mat4 FromArray(const float* elements);
+
+  static Mat4 Translation(const Vec3& t);
+  static Mat4 Scale(const Vec3& s);
+  static Mat4 Rotation(const Quat& r);
+
+  /// @brief A translation * rotation * scale matrix (as used by glTF nodes).
+  static Mat4 Trs(const Vec3& t, const Quat& r, const Vec3& s);
+
+  /// @brief A perspective projection (like gluPerspective()).
+  /// @param fov The vertical field of view, in radians.
+  /// @param aspect The aspect ratio (width / height).
+  /// @param z_near The distance to the near plane.
+  /// @param z_far The distance to the far plane.
+  static Mat4 Perspective(float fov, float aspect, float z_near, float z_far);
+
+  /// @brief An orthographic projection (like glOrtho()).
+  static Mat4 Orthographic(float left,
+                           float right,
+                           float bottom,
+                           float top,
+                           float z_near,
+                           float z_far);
+
+  /// @brief A view matrix (like gluLookAt()).
+  static Mat4 LookAt(const Vec3& eye, const Vec3& target, const Vec3& up);
+
+  const float* data() const { return m; }
+
+  /// @returns m * (p, 1), ignoring the bottom row.
+  Vec3 TransformPoint(const Vec3& p) const {
+    return Vec3{m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12],
+                m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13],
+                m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14]};
+  }
+
+  /// @returns m * (v, 0), ignoring the bottom row.
+  Vec3 TransformVector(const Vec3& v) const {
+    return Vec3{m[0] * v.x + m[4] * v.y + m[8] * v.z,
+                m[1] * v.x + m[5] * v.y + m[9] * v.z,
+                m[2] * v.x + m[6] * v.y + m[10] * v.z};
+  }
+
+  Vec4 Transform(const Vec4& v) const {
+    return Vec4{m[0] * v.x + m[4] * v.y + m[8] * v.z + m[12] * v.w,
+                m[1] * v.x + m[5] * v.y + m[9] * v.z + m[13] * v.w,
+                m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14] * v.w,
+                m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15] * v.w};
+  }
+
+  /// @brief Invert an affine matrix (i.e. one with the bottom row 0, 0, 0, 1).
+  /// @param[out] result The inverse.
+  /// @returns false if the matrix is singular.
+  bool InvertAffine(Mat4* result) const;
+};
+
+Mat4 operator*(const Mat4& a, const Mat4& b);
+
+/// @brief An axis aligned bounding box.
+struct Aabb {
+  Vec3 min;
+  Vec3 max;
+
+  /// @returns a box that contains nothing (min > max), which can be grown.
+  static Aabb Empty() {
+    const float inf = std::numeric_limits<float>::infinity();
+    return Aabb{Vec3{inf, inf, inf}, Vec3{-inf, -inf, -inf}};
+  }
+
+  bool empty() const { return min.x > max.x; }
+
+  void Grow(const Vec3& p) {
+    min = Min(min, p);
+    max = Max(max, p);
+  }
+
+  void Grow(const Aabb& other) {
+    min = Min(min, other.min);
+    max = Max(max, other.max);
+  }
+
+  Vec3 center() const { return (min + max) * 0.5f; }
+  Vec3 extent() const { return (max - min) * 0.5f; }
+
+  /// @returns half of the surface area (zero for empty boxes).
+  float HalfArea() const {
+    if (empty()) {
+      return 0.0f;
+    }
+    const Vec3 d = max - min;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+  }
+
+  /// @returns the bounding box of this box transformed by an affine matrix.
+  Aabb Transformed(const Mat4& m) const;
+};
+
+static_assert(sizeof(Aabb) == 24, "Aabb must be tightly packed.");
+
+/// @brief A plane, where Dot(normal, p) + d = 0 for points on the plane.
+struct Plane {
+  Vec3 normal;
+  float d;
+
+  /// @returns the signed distance from the plane to a point (in units of the
+  /// normal length).
+  float Distance(const Vec3& p) const { return Dot(normal, p) + d; }
+};
+
+/// @brief The visibility of a box relative to a frustum.
+enum Visibility : uint8_t {
+  kOutside = 0,
+  kIntersecting = 1,
+  kInside = 2
+};
+
+/// @brief A view frustum, described by six inward facing planes.
+struct Frustum {
+  Plane planes[6];
+
+  /// @brief Extract the (normalized) planes from a view projection matrix,
+  /// using OpenGL clip space conventions.
+  static Frustum FromMatrix(const Mat4& view_proj);
+
+  /// @brief Classify a box against the frustum.
+  Visibility Classify(const Aabb& box) const;
+};
+
+//------------------------------------------------------------------------------
+// Batch kernels.
+//
+// The kernels are vectorized with AVX, SSE2 or NEON, depending on what the
+// compiler targets, and fall back to scalar code otherwise. The backend is
+// chosen at compile time.
+//------------------------------------------------------------------------------
+
+/// The number of elements that ClassifyAabbs() processes at a time. Arrays
+/// that are passed to it must be padded to a multiple of this.
+const size_t kAabbBatchSize = 8;
+
+/// @returns the name of the SIMD backend ("AVX", "SSE2", "NEON" or "scalar").
+const char* GetSimdBackend();
+
+/// @brief Transform points by an affine matrix.
+/// @param m The matrix.
+/// @param points The points.
+/// @param count The number of points.
+/// @param[out] result The transformed points (may be the same as points).
+void TransformPoints(const Mat4& m,
+                     const Vec3* points,
+                     size_t count,
+                     Vec3* result);
+
+/// @brief Transform boxes by an affine matrix.
+/// @param m The matrix.
+/// @param boxes The boxes.
+/// @param count The number of boxes.
+/// @param[out] result The bounding boxes of the transformed boxes (may be the
+/// same as boxes).
+void TransformAabbs(const Mat4& m,
+                    const Aabb* boxes,
+                    size_t count,
+                    Aabb* result);
+
+/// @brief Classify boxes against a frustum.
+///
+/// The boxes are given as separate arrays of center and extent (half size)
+/// components, e.g. center[0] holds the x coordinates of the centers.
+/// @param frustum The frustum.
+/// @param center The box center component arrays.
+/// @param extent The box extent component arrays.
+/// @param count The number of boxes.
+/// @param[out] result The visibility of each box.
+/// @note The arrays must be readable up to count rounded up to a multiple of
+/// kAabbBatchSize.
+void ClassifyAabbs(const Frustum& frustum,
+                   const float* const* center,
+                   const float* const* extent,
+                   size_t count,
+                   Visibility* result);
+
+/// @brief Find the clusters of triangles that face away from a point.
+///
+/// Each cluster is bounded by a sphere, and the normals of its triangles lie
+/// within a cone around an axis. The cone cutoff is the sine of the half
+/// angle of the cone (values of one or more disable the test). A cluster faces
+/// away from the eye if dot(c - eye, axis) >= cutoff * |c - eye| + radius,
+/// which is conservative.
+/// @param eye The point.
+/// @param center The sphere center component arrays.
+/// @param radius The sphere radii.
+/// @param axis The normalized cone axis component arrays.
+/// @param cutoff The cone cutoffs.
+/// @param count The number of clusters.
+/// @param[out] result One for each cluster that faces away, zero otherwise.
+/// @note The arrays must be readable up to count rounded up to a multiple of
+/// kAabbBatchSize.
+void FindBackfacingCones(const Vec3& eye,
+                         const float* const* center,
+                         const float* radius,
+                         const float* const* axis,
+                         const float* cutoff,
+                         size_t count,
+                         uint8_t* result);
+
+}  // namespace base
+
+#endif  // BASE_MATH_H_
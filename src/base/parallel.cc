@@ -0,0 +1,57 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "base/parallel.h"
+
+#include "base/task_scheduler.h"
+
+namespace base {
+
+void ParallelFor(size_t count, const std::function<void(size_t)>& fun) {
+  if (count <= 1 || GetParallelism() <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      fun(i);
+    }
+    return;
+  }
+
+  // Spawn one task per index, and let the calling thread do its share of the
+  // work while waiting. The scheduler balances the load by work stealing.
+  auto& scheduler = TaskScheduler::GetDefault();
+  TaskGroup group;
+  for (size_t i = 0; i < count; ++i) {
+    scheduler.Spawn(&group, [&fun, i]() { fun(i); });
+  }
+  scheduler.Wait(&group);
+}
+
+int GetParallelism() {
+  return TaskScheduler::GetDefault().thread_count();
+}
+
+}  // namespace base
@@ -0,0 +1,235 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "base/profiler.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX  // windows.h would hide std::min() and std::max().
+#endif
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+namespace base {
+
+namespace {
+
+// The number of events in each thread buffer (a power of two).
+const uint64_t kBufferSize = 1u << 14;
+
+// A recorded event. The fields are atomic since the collector may read a slot
+// while its thread overwrites it (such reads are detected and discarded).
+struct Slot {
+  std::atomic<const char*> name;
+  std::atomic<int64_t> start;
+  std::atomic<int64_t> end;
+  std::atomic<int> depth;
+};
+
+}  // namespace
+
+// The event ring buffer of a thread.
+class ProfileBuffer {
+ public:
+  explicit ProfileBuffer(std::string thread_name)
+      : name(std::move(thread_name)), slots(new Slot[kBufferSize]) {}
+
+  void Push(const char* event_name, int64_t start, int64_t end, int depth) {
+    // Announce the write before touching the slot, so that a collector that
+    // reads the old slot contents can tell that they may have been replaced
+    // (this is a seqlock with a single writer).
+    const uint64_t index = write_index.load(std::memory_order_relaxed);
+    claim_index.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Slot& slot = slots[index & (kBufferSize - 1)];
+    slot.name.store(event_name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.depth.store(depth, std::memory_order_relaxed);
+    write_index.store(index + 1, std::memory_order_release);
+  }
+
+  // Guarded by Profiler::mutex_.
+  std::string name;
+  uint64_t read_index = 0;
+
+  // Only used by the owning thread.
+  int depth = 0;
+
+  std::atomic<uint64_t> claim_index{0};
+  std::atomic<uint64_t> write_index{0};
+  std::unique_ptr<Slot[]> slots;
+};
+
+namespace {
+
+thread_local ProfileBuffer* t_buffer = nullptr;
+
+}  // namespace
+
+std::atomic<bool> Profiler::s_enabled_(true);
+
+Profiler::Profiler()
+    : epoch_(std::chrono::steady_clock::now()), dropped_events_(0) {}
+
+Profiler::~Profiler() {}
+
+Profiler& Profiler::GetDefault() {
+  // The profiler is never destroyed, since threads may record scopes while
+  // static objects are being destroyed.
+  static Profiler* s_profiler = new Profiler();
+  return *s_profiler;
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+  ProfileBuffer* buffer = GetThreadBuffer();
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffer->name = name;
+}
+
+int Profiler::GetThreadIndex() {
+  ProfileBuffer* buffer = GetThreadBuffer();
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    if (buffers_[i].get() == buffer) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void Profiler::Collect(std::vector<ProfileThread>* threads) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  threads->resize(std::max(threads->size(), buffers_.size()));
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    ProfileBuffer& buffer = *buffers_[i];
+    ProfileThread& thread = (*threads)[i];
+    thread.name = buffer.name;
+    thread.events.clear();
+
+    // Copy the events that have been published since the last collection.
+    const uint64_t end = buffer.write_index.load(std::memory_order_acquire);
+    uint64_t begin = buffer.read_index;
+    if (end - begin > kBufferSize) {
+      begin = end - kBufferSize;
+    }
+    thread.events.reserve(static_cast<size_t>(end - begin));
+    for (uint64_t index = begin; index < end; ++index) {
+      const Slot& slot = buffer.slots[index & (kBufferSize - 1)];
+      ProfileEvent event;
+      event.name = slot.name.load(std::memory_order_relaxed);
+      event.start = slot.start.load(std::memory_order_relaxed);
+      event.end = slot.end.load(std::memory_order_relaxed);
+      event.depth = slot.depth.load(std::memory_order_relaxed);
+      thread.events.push_back(event);
+    }
+
+    // Discard the events that the thread may have overwritten while they were
+    // being copied.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t claimed = buffer.claim_index.load(std::memory_order_relaxed);
+    uint64_t valid_begin = begin;
+    if (claimed > kBufferSize && claimed - kBufferSize > begin) {
+      valid_begin = std::min(claimed - kBufferSize, end);
+      thread.events.erase(
+          thread.events.begin(),
+          thread.events.begin() + static_cast<ptrdiff_t>(valid_begin - begin));
+    }
+    dropped_events_.fetch_add(valid_begin - buffer.read_index,
+                              std::memory_order_relaxed);
+    buffer.read_index = end;
+  }
+}
+
+ProfileBuffer* Profiler::GetThreadBuffer() {
+  if (t_buffer == nullptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.emplace_back(new ProfileBuffer(
+        "Thread " + std::to_string(buffers_.size())));
+    t_buffer = buffers_.back().get();
+  }
+  return t_buffer;
+}
+
+void ProfileScope::Begin(const char* name) {
+  auto& profiler = Profiler::GetDefault();
+  buffer_ = profiler.GetThreadBuffer();
+  name_ = name;
+  depth_ = buffer_->depth++;
+  start_ = profiler.Now();
+}
+
+void ProfileScope::End() {
+  const int64_t end = Profiler::GetDefault().Now();
+  --buffer_->depth;
+  buffer_->Push(name_, start_, end, depth_);
+}
+
+#ifdef _WIN32
+
+double GetProcessCpuSeconds() {
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time,
+                       &kernel_time, &user_time)) {
+    return 0.0;
+  }
+
+  // The times are in units of 100 ns.
+  const auto to_seconds = [](const FILETIME& time) {
+    const uint64_t ticks =
+        (static_cast<uint64_t>(time.dwHighDateTime) << 32) |
+        static_cast<uint64_t>(time.dwLowDateTime);
+    return static_cast<double>(ticks) * 1e-7;
+  };
+  return to_seconds(kernel_time) + to_seconds(user_time);
+}
+
+#else
+
+double GetProcessCpuSeconds() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0.0;
+  }
+  const auto to_seconds = [](const struct timeval& time) {
+    return static_cast<double>(time.tv_sec) +
+           static_cast<double>(time.tv_usec) * 1e-6;
+  };
+  return to_seconds(usage.ru_utime) + to_seconds(usage.ru_stime);
+}
+
+#endif  // _WIN32
+
+}  // namespace base
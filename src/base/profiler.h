@@ -0,0 +1,186 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef BASE_PROFILER_H_
+#define BASE_PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace base {
+
+class ProfileBuffer;
+
+/// @brief A completed profiling scope.
+struct ProfileEvent {
+  /// The name of the scope (a string with static storage duration).
+  const char* name;
+
+  /// The start and end times, in nanoseconds (see Profiler::Now()).
+  int64_t start;
+  int64_t end;
+
+  /// The nesting depth of the scope on its thread (zero for the outermost).
+  int depth;
+};
+
+/// @brief The profiling events of one thread.
+struct ProfileThread {
+  std::string name;
+
+  /// The events, in the order that the scopes ended (children before their
+  /// parents).
+  std::vector<ProfileEvent> events;
+};
+
+/// @brief A low overhead CPU profiler for hierarchical scopes.
+///
+/// Each thread records its scopes (see ProfileScope) into a ring buffer of its
+/// own, without taking any locks. The events are drained by a single collector
+/// (usually the UI thread) through Collect(). If the collector falls behind,
+/// the oldest events are dropped.
+class Profiler {
+ public:
+  /// @returns the process wide profiler.
+  static Profiler& GetDefault();
+
+  /// @returns true if new scopes are recorded.
+  bool enabled() const { return s_enabled_.load(std::memory_order_relaxed); }
+
+  /// @brief Enable or disable recording (scopes that have already started are
+  /// still recorded).
+  void set_enabled(bool enabled) {
+    s_enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  /// @brief Set the name of the calling thread (e.g. "Main").
+  void SetThreadName(const std::string& name);
+
+  /// @returns the index of the calling thread in the collected threads.
+  int GetThreadIndex();
+
+  /// @returns the current time in nanoseconds, relative to the creation of
+  /// the profiler.
+  int64_t Now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - epoch_)
+        .count();
+  }
+
+  /// @brief Take the events that have been recorded since the last call.
+  /// @param[out] threads The new events of each thread. The vector is indexed
+  /// by thread (see GetThreadIndex()), and is grown as new threads record
+  /// events.
+  void Collect(std::vector<ProfileThread>* threads);
+
+  /// @returns the number of events that were dropped since the collector fell
+  /// behind.
+  uint64_t dropped_events() const {
+    return dropped_events_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class ProfileScope;
+
+  Profiler();
+  ~Profiler();
+
+  // Get the buffer of the calling thread, registering it on first use.
+  ProfileBuffer* GetThreadBuffer();
+
+  // Static, so that a disabled scope costs a single branch (no access to the
+  // default instance).
+  static std::atomic<bool> s_enabled_;
+
+  const std::chrono::steady_clock::time_point epoch_;
+  std::atomic<uint64_t> dropped_events_;
+
+  // Guards the buffer list, the thread names and the collector state.
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<ProfileBuffer>> buffers_;
+
+  // Disable copy/move.
+  Profiler(const Profiler&) = delete;
+  Profiler(Profiler&&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+};
+
+/// @brief Record the lifetime of a scope with the default profiler.
+///
+/// When the profiler is disabled, a scope costs a single branch.
+///
+/// Usage:
+/// @code
+///   {
+///     base::ProfileScope scope("PaintScene");
+///     ...
+///   }
+/// @endcode
+class ProfileScope {
+ public:
+  /// @param name The scope name. It must have static storage duration (e.g. a
+  /// string literal), since only the pointer is recorded.
+  explicit ProfileScope(const char* name) : buffer_(nullptr) {
+    if (Profiler::s_enabled_.load(std::memory_order_relaxed)) {
+      Begin(name);
+    }
+  }
+
+  ~ProfileScope() {
+    if (buffer_ != nullptr) {
+      End();
+    }
+  }
+
+ private:
+  void Begin(const char* name);
+  void End();
+
+  ProfileBuffer* buffer_;
+  const char* name_;
+  int64_t start_;
+  int depth_;
+
+  // Disable copy/move.
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope(ProfileScope&&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+/// @returns the CPU time that the process (all of its threads) has used so
+/// far, in seconds (user and system time).
+double GetProcessCpuSeconds();
+
+}  // namespace base
+
+#endif  // BASE_PROFILER_H_
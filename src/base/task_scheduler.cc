@@ -0,0 +1,240 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "base/task_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+
+#include "base/profiler.h"
+
+namespace base {
+
+namespace {
+
+// The scheduler and worker index of the current thread (if it is a worker).
+thread_local TaskScheduler* t_scheduler = nullptr;
+thread_local int t_worker_index = -1;
+
+// The number of times that a waiting thread looks for work before it blocks.
+const int kWaitSpinCount = 64;
+
+}  // namespace
+
+TaskScheduler::TaskScheduler(int thread_count)
+    : queued_(0),
+      next_queue_(0),
+      sleeping_(0),
+      terminate_(false) {
+  if (thread_count <= 0) {
+    thread_count = static_cast<int>(std::thread::hardware_concurrency());
+    if (thread_count <= 0) {
+      thread_count = 1;
+    }
+  }
+
+  // Create all the queues before starting any threads, since the threads
+  // access each other's queues.
+  for (int i = 0; i < thread_count; ++i) {
+    workers_.emplace_back(new Worker());
+  }
+  for (int i = 0; i < thread_count; ++i) {
+    workers_[static_cast<size_t>(i)]->thread =
+        std::thread(&TaskScheduler::Run, this, i);
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    terminate_ = true;
+  }
+  sleep_condition_.notify_all();
+  for (auto& worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+TaskScheduler& TaskScheduler::GetDefault() {
+  static TaskScheduler s_scheduler(0);
+  return s_scheduler;
+}
+
+void TaskScheduler::Spawn(TaskGroup* group, Task task) {
+  ++group->pending_;
+
+  // Tasks that are spawned by a worker go to the worker's own queue.
+  size_t queue_index;
+  if (t_scheduler == this) {
+    queue_index = static_cast<size_t>(t_worker_index);
+  } else {
+    queue_index = next_queue_++ % workers_.size();
+  }
+  {
+    Worker& worker = *workers_[queue_index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.queue.push_back(Item{std::move(task), group});
+  }
+  ++queued_;
+
+  // Wake up a sleeping worker, if any.
+  if (sleeping_ > 0) {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    sleep_condition_.notify_one();
+  }
+}
+
+void TaskScheduler::Wait(TaskGroup* group) {
+  const int index = t_scheduler == this ? t_worker_index : -1;
+  int spin_count = 0;
+  while (group->pending_ > 0) {
+    if (RunOneTask(index)) {
+      spin_count = 0;
+      continue;
+    }
+
+    // There is nothing to help out with, so block until the group is done (but
+    // wake up now and then to see if new tasks have been spawned).
+    if (++spin_count < kWaitSpinCount) {
+      std::this_thread::yield();
+    } else {
+      std::unique_lock<std::mutex> lock(group->mutex_);
+      group->done_condition_.wait_for(
+          lock, std::chrono::milliseconds(1),
+          [group] { return group->pending_ == 0; });
+    }
+  }
+
+  // Rethrow any exception from the tasks.
+  std::exception_ptr exception;
+  {
+    std::lock_guard<std::mutex> lock(group->mutex_);
+    std::swap(exception, group->exception_);
+  }
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+void TaskScheduler::Run(int index) {
+  t_scheduler = this;
+  t_worker_index = index;
+  Profiler::GetDefault().SetThreadName("Worker " + std::to_string(index));
+
+  while (true) {
+    if (RunOneTask(index)) {
+      continue;
+    }
+
+    // Sleep until there are more tasks.
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    ++sleeping_;
+    sleep_condition_.wait(lock, [this] { return terminate_ || queued_ > 0; });
+    --sleeping_;
+    if (terminate_) {
+      break;
+    }
+  }
+}
+
+bool TaskScheduler::RunOneTask(int index) {
+  Item item;
+  if (!PopOrSteal(index, &item)) {
+    return false;
+  }
+  Execute(&item);
+  return true;
+}
+
+bool TaskScheduler::PopOrSteal(int index, Item* item) {
+  if (queued_ <= 0) {
+    return false;
+  }
+
+  // Pop from the back of our own queue.
+  if (index >= 0) {
+    Worker& worker = *workers_[static_cast<size_t>(index)];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (!worker.queue.empty()) {
+      *item = std::move(worker.queue.back());
+      worker.queue.pop_back();
+      --queued_;
+      return true;
+    }
+  }
+
+  // Steal from the front of another queue.
+  const size_t count = workers_.size();
+  const size_t start = static_cast<size_t>(index + 1);
+  for (size_t i = 0; i < count; ++i) {
+    Worker& victim = *workers_[(start + i) % count];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.queue.empty()) {
+      *item = std::move(victim.queue.front());
+      victim.queue.pop_front();
+      --queued_;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void TaskScheduler::Execute(Item* item) {
+  TaskGroup* group = item->group;
+  try {
+    item->task();
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(group->mutex_);
+    if (!group->exception_) {
+      group->exception_ = std::current_exception();
+    }
+  }
+
+  // Release the task (and anything that it captured) before signaling the
+  // group, since the waiter may destroy the captured objects.
+  item->task = nullptr;
+
+  // The waiter may destroy the group as soon as it sees that the group is
+  // done, so the final decrement must be done while holding the group mutex
+  // (which the waiter acquires before returning).
+  int pending = group->pending_;
+  while (pending > 1) {
+    if (group->pending_.compare_exchange_weak(pending, pending - 1)) {
+      return;
+    }
+  }
+  std::lock_guard<std::mutex> lock(group->mutex_);
+  if (--group->pending_ == 0) {
+    group->done_condition_.notify_all();
+  }
+}
+
+}  // namespace base
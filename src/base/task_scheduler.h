@@ -0,0 +1,148 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef BASE_TASK_SCHEDULER_H_
+#define BASE_TASK_SCHEDULER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+/// @brief A group of tasks that can be waited for.
+///
+/// A task may spawn child tasks into a group of its own and wait for them,
+/// which makes nested parallelism (e.g. recursive BVH builds) possible without
+/// blocking any worker threads.
+class TaskGroup {
+ public:
+  TaskGroup() : pending_(0) {}
+
+  /// @returns true if all the tasks in the group have finished.
+  bool done() const { return pending_ == 0; }
+
+ private:
+  friend class TaskScheduler;
+
+  std::atomic<int> pending_;
+  std::mutex mutex_;
+  std::condition_variable done_condition_;
+  std::exception_ptr exception_;
+
+  // Disable copy/move.
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup(TaskGroup&&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+};
+
+/// @brief A work-stealing task scheduler.
+///
+/// Each worker thread has a double ended queue of its own. Tasks that are
+/// spawned from a worker thread are pushed to the back of that worker's queue,
+/// and the worker pops tasks from the back (LIFO, for cache locality). Idle
+/// workers steal tasks from the front of other workers' queues (FIFO, which
+/// tends to steal the largest pieces of work). Tasks that are spawned from
+/// other threads are distributed over the worker queues in a round robin
+/// fashion.
+///
+/// Threads that wait for a task group help out by running queued tasks, so
+/// waiting from within a task never deadlocks.
+class TaskScheduler {
+ public:
+  using Task = std::function<void()>;
+
+  /// @brief Start the worker threads.
+  /// @param thread_count The number of worker threads, or zero to use one
+  /// thread per hardware thread.
+  explicit TaskScheduler(int thread_count);
+
+  /// @brief Stop the worker threads.
+  /// @note All task groups must have been waited for.
+  ~TaskScheduler();
+
+  /// @returns the shared scheduler, which has one thread per hardware thread.
+  static TaskScheduler& GetDefault();
+
+  /// @brief Spawn a task.
+  /// @param group The group that the task belongs to.
+  /// @param task The task.
+  void Spawn(TaskGroup* group, Task task);
+
+  /// @brief Wait for all the tasks in a group to finish.
+  ///
+  /// The calling thread runs queued tasks while waiting.
+  /// @throws the first exception that was thrown by any of the tasks in the
+  /// group.
+  void Wait(TaskGroup* group);
+
+  int thread_count() const { return static_cast<int>(workers_.size()); }
+
+ private:
+  struct Item {
+    Task task;
+    TaskGroup* group;
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Item> queue;
+    std::thread thread;
+  };
+
+  void Run(int index);
+  bool RunOneTask(int index);
+  bool PopOrSteal(int index, Item* item);
+  void Execute(Item* item);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  // The number of tasks that are queued (but not started).
+  std::atomic<int> queued_;
+
+  std::atomic<unsigned> next_queue_;
+  std::atomic<int> sleeping_;
+  std::atomic<bool> terminate_;
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_condition_;
+
+  // Disable copy/move.
+  TaskScheduler(const TaskScheduler&) = delete;
+  TaskScheduler(TaskScheduler&&) = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+};
+
+}  // namespace base
+
+#endif  // BASE_TASK_SCHEDULER_H_
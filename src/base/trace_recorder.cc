@@ -0,0 +1,147 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "base/trace_recorder.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+
+#include "base/error.h"
+
+namespace base {
+
+namespace {
+
+// Write a JSON string (with quotes).
+void WriteString(std::ofstream* out, const char* str) {
+  *out << '"';
+  for (const char* c = str; *c != 0; ++c) {
+    if (*c == '"' || *c == '\\') {
+      *out << '\\' << *c;
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x",
+                    static_cast<unsigned int>(*c));
+      *out << escaped;
+    } else {
+      *out << *c;
+    }
+  }
+  *out << '"';
+}
+
+// Write a time in microseconds (the unit of trace events), with nanosecond
+// precision.
+void WriteMicroseconds(std::ofstream* out, int64_t nanoseconds) {
+  char str[32];
+  std::snprintf(str, sizeof(str), "%" PRId64 ".%03" PRId64,
+                nanoseconds / 1000, nanoseconds % 1000);
+  *out << str;
+}
+
+}  // namespace
+
+TraceRecorder::TraceRecorder(double window_seconds)
+    : window_(static_cast<int64_t>(std::max(window_seconds, 0.0) * 1e9)) {}
+
+void TraceRecorder::Add(const std::vector<ProfileThread>& threads) {
+  thread_names_.resize(std::max(thread_names_.size(), threads.size()));
+  events_.resize(thread_names_.size());
+  int64_t latest = 0;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    thread_names_[i] = threads[i].name;
+    for (const auto& event : threads[i].events) {
+      events_[i].push_back(event);
+      latest = std::max(latest, event.end);
+    }
+  }
+
+  // Forget the events that ended before the window (the events of each
+  // thread are in the order that they ended).
+  if (window_ > 0) {
+    for (auto& events : events_) {
+      while (!events.empty() && events.front().end < latest - window_) {
+        events.pop_front();
+      }
+    }
+  }
+}
+
+void TraceRecorder::Clear() {
+  for (auto& events : events_) {
+    events.clear();
+  }
+}
+
+size_t TraceRecorder::event_count() const {
+  size_t count = 0;
+  for (const auto& events : events_) {
+    count += events.size();
+  }
+  return count;
+}
+
+void TraceRecorder::Write(const std::string& path) const {
+  std::ofstream out(path);
+  if (!out.good()) {
+    throw Error("Unable to create " + path);
+  }
+
+  // Scopes are written as complete ("X") events, preceded by the thread names
+  // as metadata ("M") events.
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first = true;
+  for (size_t thread = 0; thread < thread_names_.size(); ++thread) {
+    out << (first ? "" : ",\n")
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+        << ",\"args\":{\"name\":";
+    WriteString(&out, thread_names_[thread].c_str());
+    out << "}}";
+    first = false;
+  }
+  for (size_t thread = 0; thread < events_.size(); ++thread) {
+    for (const auto& event : events_[thread]) {
+      out << ",\n{\"name\":";
+      WriteString(&out, event.name);
+      out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread << ",\"ts\":";
+      WriteMicroseconds(&out, event.start);
+      out << ",\"dur\":";
+      WriteMicroseconds(&out, event.end - event.start);
+      out << "}";
+    }
+  }
+  out << "\n]}\n";
+
+  if (!out.good()) {
+    throw Error("Unable to write " + path);
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,75 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef BASE_TRACE_RECORDER_H_
+#define BASE_TRACE_RECORDER_H_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "base/profiler.h"
+
+namespace base {
+
+/// @brief Keeps recent profiling events, for export as a Chrome trace.
+///
+/// The recorder is fed with the events that are collected from the profiler
+/// (see Profiler::Collect()), and keeps the events of the last few seconds
+/// (or all events). The trace can be opened in chrome://tracing or Perfetto.
+class TraceRecorder {
+ public:
+  /// @param window_seconds The time span of the events to keep, or zero to
+  /// keep all events.
+  explicit TraceRecorder(double window_seconds);
+
+  /// @brief Add collected events.
+  /// @param threads The events of each thread, indexed by thread.
+  void Add(const std::vector<ProfileThread>& threads);
+
+  /// @brief Forget all events.
+  void Clear();
+
+  /// @returns the number of events that are kept.
+  size_t event_count() const;
+
+  /// @brief Write the events in the Chrome trace event (JSON) format.
+  /// @param path The file to write.
+  /// @throws base::Error if the file can not be written.
+  void Write(const std::string& path) const;
+
+ private:
+  const int64_t window_;
+  std::vector<std::string> thread_names_;
+  std::vector<std::deque<ProfileEvent>> events_;
+};
+
+}  // namespace base
+
+#endif  // BASE_TRACE_RECORDER_H_
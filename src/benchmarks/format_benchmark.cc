@@ -0,0 +1,236 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+// This benchmark generates a grid mesh, writes it to disk in all the supported
+// file formats, and measures the import throughput for each format.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base/error.h"
+#include "gfx/mesh.h"
+#include "model/binary_reader.h"
+#include "model/importer.h"
+
+namespace {
+
+const int kDefaultGridSize = 1000;
+const int kIterations = 3;
+
+// Write a binary value in the given byte order.
+template <typename T>
+void WriteValue(std::ofstream* out, T value, bool big_endian) {
+  char bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  if (big_endian == model::IsLittleEndianHost()) {
+    std::reverse(bytes, bytes + sizeof(T));
+  }
+  out->write(bytes, sizeof(T));
+}
+
+gfx::Mesh MakeGrid(int size) {
+  gfx::Mesh mesh;
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      gfx::Vertex v = {{static_cast<float>(x) * 0.125f,
+                        static_cast<float>(y) * 0.125f,
+                        static_cast<float>((x * 7 + y * 3) % 11) * 0.0625f},
+                       {0.0f, 0.0f, 1.0f},
+                       {0.0f, 0.0f}};
+      mesh.vertices.push_back(v);
+    }
+  }
+  for (int y = 0; y + 1 < size; ++y) {
+    for (int x = 0; x + 1 < size; ++x) {
+      const auto i = static_cast<uint32_t>(y * size + x);
+      const auto s = static_cast<uint32_t>(size);
+      const uint32_t quad[6] = {i, i + 1, i + s + 1, i, i + s + 1, i + s};
+      mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+    }
+  }
+  return mesh;
+}
+
+void WriteObj(const gfx::Mesh& mesh, const std::string& path) {
+  std::ofstream out(path);
+  for (const auto& v : mesh.vertices) {
+    out << "v " << v.position[0] << " " << v.position[1] << " "
+        << v.position[2] << "\n";
+  }
+  for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+    out << "f " << mesh.indices[i] + 1 << " " << mesh.indices[i + 1] + 1 << " "
+        << mesh.indices[i + 2] + 1 << "\n";
+  }
+}
+
+void WriteStl(const gfx::Mesh& mesh, const std::string& path, bool binary) {
+  if (binary) {
+    std::ofstream out(path, std::ios::binary);
+    const std::string header(80, ' ');
+    out.write(header.data(), 80);
+    WriteValue(&out, static_cast<uint32_t>(mesh.triangle_count()), false);
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+      for (int k = 0; k < 3; ++k) {
+        WriteValue(&out, 0.0f, false);
+      }
+      for (int c = 0; c < 3; ++c) {
+        const auto& v = mesh.vertices[mesh.indices[i + c]];
+        for (int k = 0; k < 3; ++k) {
+          WriteValue(&out, v.position[k], false);
+        }
+      }
+      WriteValue(&out, static_cast<uint16_t>(0), false);
+    }
+  } else {
+    std::ofstream out(path);
+    out << "solid benchmark\n";
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+      out << "  facet normal 0 0 1\n    outer loop\n";
+      for (int c = 0; c < 3; ++c) {
+        const auto& v = mesh.vertices[mesh.indices[i + c]];
+        out << "      vertex " << v.position[0] << " " << v.position[1] << " "
+            << v.position[2] << "\n";
+      }
+      out << "    endloop\n  endfacet\n";
+    }
+    out << "endsolid benchmark\n";
+  }
+}
+
+void WritePly(const gfx::Mesh& mesh,
+              const std::string& path,
+              const char* format) {
+  std::ofstream out(path, std::ios::binary);
+  out << "ply\nformat " << format << " 1.0\n"
+      << "element vertex " << mesh.vertices.size() << "\n"
+      << "property float x\nproperty float y\nproperty float z\n"
+      << "property float nx\nproperty float ny\nproperty float nz\n"
+      << "element face " << mesh.triangle_count() << "\n"
+      << "property list uchar int vertex_indices\nend_header\n";
+  const std::string fmt(format);
+  if (fmt == "ascii") {
+    for (const auto& v : mesh.vertices) {
+      out << v.position[0] << " " << v.position[1] << " " << v.position[2]
+          << " " << v.normal[0] << " " << v.normal[1] << " " << v.normal[2]
+          << "\n";
+    }
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+      out << "3 " << mesh.indices[i] << " " << mesh.indices[i + 1] << " "
+          << mesh.indices[i + 2] << "\n";
+    }
+  } else {
+    const bool big_endian = fmt == "binary_big_endian";
+    for (const auto& v : mesh.vertices) {
+      for (int k = 0; k < 3; ++k) {
+        WriteValue(&out, v.position[k], big_endian);
+      }
+      for (int k = 0; k < 3; ++k) {
+        WriteValue(&out, v.normal[k], big_endian);
+      }
+    }
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+      WriteValue(&out, static_cast<uint8_t>(3), big_endian);
+      for (int k = 0; k < 3; ++k) {
+        WriteValue(&out, static_cast<int32_t>(mesh.indices[i + k]), big_endian);
+      }
+    }
+  }
+}
+
+void Benchmark(const std::string& name, const std::string& path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  const double size_mb = static_cast<double>(file.tellg()) / (1024.0 * 1024.0);
+
+  double best_time = 1e30;
+  size_t num_triangles = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto mesh = model::ImportMesh(path);
+    const auto stop = std::chrono::steady_clock::now();
+    best_time = std::min(best_time,
+                         std::chrono::duration<double>(stop - start).count());
+    num_triangles = mesh.triangle_count();
+  }
+
+  std::printf("%-22s %9.1f MB %10zu tris %9.1f ms %9.1f MB/s\n", name.c_str(),
+              size_mb, num_triangles, best_time * 1000.0, size_mb / best_time);
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  const int grid_size = argc > 1 ? std::atoi(argv[1]) : kDefaultGridSize;
+  if (grid_size < 2) {
+    std::cerr << "Usage: " << argv[0] << " [grid size]\n";
+    return 1;
+  }
+
+  struct Format {
+    const char* name;
+    const char* path;
+  };
+  const Format formats[] = {
+      {"OBJ", "format_benchmark.obj"},
+      {"STL (binary)", "format_benchmark_binary.stl"},
+      {"STL (ASCII)", "format_benchmark_ascii.stl"},
+      {"PLY (binary LE)", "format_benchmark_le.ply"},
+      {"PLY (binary BE)", "format_benchmark_be.ply"},
+      {"PLY (ASCII)", "format_benchmark_ascii.ply"}};
+
+  int result = 0;
+  try {
+    std::cout << "Generating " << grid_size << "x" << grid_size
+              << " grid test files...\n";
+    const auto mesh = MakeGrid(grid_size);
+    WriteObj(mesh, formats[0].path);
+    WriteStl(mesh, formats[1].path, true);
+    WriteStl(mesh, formats[2].path, false);
+    WritePly(mesh, formats[3].path, "binary_little_endian");
+    WritePly(mesh, formats[4].path, "binary_big_endian");
+    WritePly(mesh, formats[5].path, "ascii");
+
+    for (const auto& format : formats) {
+      Benchmark(format.name, format.path);
+    }
+  } catch (base::Error& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    result = 1;
+  }
+
+  for (const auto& format : formats) {
+    std::remove(format.path);
+  }
+  return result;
+}
@@ -0,0 +1,172 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "base/error.h"
+#include "base/mapped_file.h"
+#include "model/importer.h"
+#include "model/scene_cache.h"
+
+namespace {
+
+const int kDefaultIterations = 3;
+
+void PrintUsage(const char* program) {
+  std::cerr << "Usage: " << program
+            << " [-n iterations] [-c] file [file ...]\n"
+            << "  -c  Also benchmark loading from the scene cache\n";
+}
+
+double GetFileSizeMB(const std::string& path) {
+  base::MappedFile file(path);
+  return static_cast<double>(file.size()) / (1024.0 * 1024.0);
+}
+
+size_t CountVertices(const model::Scene& scene) {
+  size_t count = 0;
+  for (const auto& mesh : scene.meshes()) {
+    for (const auto& primitive : mesh.primitives) {
+      count += primitive.vertex_count();
+    }
+  }
+  return count;
+}
+
+// Read one byte per page of all the buffers, to include the cost of paging in
+// memory mapped data (as a GPU upload would).
+unsigned TouchBuffers(const model::Scene& scene) {
+  const size_t kPageSize = 4096;
+  unsigned sum = 0;
+  for (const auto& buffer : scene.buffers()) {
+    for (size_t i = 0; i < buffer.size; i += kPageSize) {
+      sum += static_cast<unsigned char>(buffer.data[i]);
+    }
+  }
+  return sum;
+}
+
+void PrintTimes(const char* label,
+                double size_mb,
+                double best_time,
+                double total_time,
+                int iterations) {
+  std::cout << "  " << label << " best:    " << best_time * 1000.0 << " ms ("
+            << size_mb / best_time << " MB/s)\n"
+            << "  " << label << " average: "
+            << total_time * 1000.0 / iterations << " ms\n";
+}
+
+void BenchmarkFile(const std::string& path, int iterations, bool use_cache) {
+  const double size_mb = GetFileSizeMB(path);
+  double best_time = 1e30;
+  double total_time = 0.0;
+  model::Scene scene;
+  for (int i = 0; i < iterations; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    scene = model::ImportScene(path);
+    const auto stop = std::chrono::steady_clock::now();
+    const double t = std::chrono::duration<double>(stop - start).count();
+    best_time = std::min(best_time, t);
+    total_time += t;
+  }
+
+  std::cout << path << ":\n"
+            << "  size:      " << size_mb << " MB\n"
+            << "  vertices:  " << CountVertices(scene) << "\n"
+            << "  triangles: " << scene.triangle_count() << "\n";
+  PrintTimes("import", size_mb, best_time, total_time, iterations);
+
+  if (use_cache) {
+    const auto cache_path = model::GetSceneCachePath(path);
+    if (cache_path.empty()) {
+      throw base::Error("No cache directory");
+    }
+    model::WriteSceneCache(cache_path, path, scene);
+    const double cache_size_mb = GetFileSizeMB(cache_path);
+
+    best_time = 1e30;
+    total_time = 0.0;
+    unsigned checksum = 0;
+    for (int i = 0; i < iterations; ++i) {
+      const auto start = std::chrono::steady_clock::now();
+      model::Scene cached_scene;
+      if (!model::ReadSceneCache(cache_path, path, &cached_scene)) {
+        throw base::Error("Unable to read the cache file " + cache_path);
+      }
+      checksum += TouchBuffers(cached_scene);
+      const auto stop = std::chrono::steady_clock::now();
+      const double t = std::chrono::duration<double>(stop - start).count();
+      best_time = std::min(best_time, t);
+      total_time += t;
+    }
+
+    std::cout << "  cache size: " << cache_size_mb << " MB (checksum "
+              << checksum << ")\n";
+    PrintTimes("cached", cache_size_mb, best_time, total_time, iterations);
+  }
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  int iterations = kDefaultIterations;
+  bool use_cache = false;
+  int first_file = 1;
+  while (first_file < argc) {
+    const std::string arg = argv[first_file];
+    if (arg == "-n" && first_file + 1 < argc) {
+      iterations = std::max(1, std::atoi(argv[first_file + 1]));
+      first_file += 2;
+    } else if (arg == "-c") {
+      use_cache = true;
+      ++first_file;
+    } else {
+      break;
+    }
+  }
+  if (first_file >= argc) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  int result = 0;
+  for (int i = first_file; i < argc; ++i) {
+    try {
+      BenchmarkFile(argv[i], iterations, use_cache);
+    } catch (base::Error& e) {
+      std::cerr << "Error: " << e.what() << "\n";
+      result = 1;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,184 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+// This benchmark compares the batch kernels of base/math.h (which use the SIMD
+// backend that was selected at compile time) with the equivalent loops over
+// the scalar functions.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "base/math.h"
+
+namespace {
+
+const int kDefaultCount = 1000000;
+const int kIterations = 5;
+
+// Accumulated results, which keep the compiler from removing the work.
+float g_sink = 0.0f;
+
+struct Data {
+  base::Mat4 transform;
+  base::Frustum frustum;
+  std::vector<base::Vec3> points;
+  std::vector<base::Aabb> boxes;
+  std::vector<float> center[3];
+  std::vector<float> extent[3];
+
+  std::vector<base::Vec3> point_result;
+  std::vector<base::Aabb> box_result;
+  std::vector<base::Visibility> visibility;
+};
+
+void CreateData(size_t count, Data* data) {
+  std::mt19937 generator(1234);
+  std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+  std::uniform_real_distribution<float> size(0.1f, 5.0f);
+
+  data->transform = base::Mat4::Trs(
+      base::Vec3{1.0f, 2.0f, 3.0f},
+      base::Quat::FromAxisAngle(base::Vec3{0.0f, 1.0f, 0.0f}, 0.5f),
+      base::Vec3{2.0f, 2.0f, 2.0f});
+  const auto view_proj =
+      base::Mat4::Perspective(1.0f, 1.5f, 0.1f, 1000.0f) *
+      base::Mat4::LookAt(base::Vec3{0.0f, 0.0f, 150.0f},
+                         base::Vec3{0.0f, 0.0f, 0.0f},
+                         base::Vec3{0.0f, 1.0f, 0.0f});
+  data->frustum = base::Frustum::FromMatrix(view_proj);
+
+  // The SoA arrays are padded to a multiple of the batch size.
+  const size_t padded =
+      (count + base::kAabbBatchSize - 1) / base::kAabbBatchSize *
+      base::kAabbBatchSize;
+  for (int k = 0; k < 3; ++k) {
+    data->center[k].resize(padded);
+    data->extent[k].resize(padded);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    const base::Vec3 p = {position(generator), position(generator),
+                          position(generator)};
+    const base::Vec3 e = {size(generator), size(generator), size(generator)};
+    data->points.push_back(p);
+    data->boxes.push_back(base::Aabb{p - e, p + e});
+    for (int k = 0; k < 3; ++k) {
+      data->center[k][i] = p[k];
+      data->extent[k][i] = e[k];
+    }
+  }
+  data->point_result.resize(count);
+  data->box_result.resize(count);
+  data->visibility.resize(count);
+}
+
+void ScalarTransformPoints(Data* data) {
+  for (size_t i = 0; i < data->points.size(); ++i) {
+    data->point_result[i] = data->transform.TransformPoint(data->points[i]);
+  }
+  g_sink += data->point_result.back().x;
+}
+
+void BatchTransformPoints(Data* data) {
+  base::TransformPoints(data->transform, data->points.data(),
+                        data->points.size(), data->point_result.data());
+  g_sink += data->point_result.back().x;
+}
+
+void ScalarTransformAabbs(Data* data) {
+  for (size_t i = 0; i < data->boxes.size(); ++i) {
+    data->box_result[i] = data->boxes[i].Transformed(data->transform);
+  }
+  g_sink += data->box_result.back().min.x;
+}
+
+void BatchTransformAabbs(Data* data) {
+  base::TransformAabbs(data->transform, data->boxes.data(),
+                       data->boxes.size(), data->box_result.data());
+  g_sink += data->box_result.back().min.x;
+}
+
+void ScalarClassifyAabbs(Data* data) {
+  for (size_t i = 0; i < data->boxes.size(); ++i) {
+    data->visibility[i] = data->frustum.Classify(data->boxes[i]);
+  }
+  g_sink += static_cast<float>(data->visibility.back());
+}
+
+void BatchClassifyAabbs(Data* data) {
+  const float* center[3] = {data->center[0].data(), data->center[1].data(),
+                            data->center[2].data()};
+  const float* extent[3] = {data->extent[0].data(), data->extent[1].data(),
+                            data->extent[2].data()};
+  base::ClassifyAabbs(data->frustum, center, extent, data->boxes.size(),
+                      data->visibility.data());
+  g_sink += static_cast<float>(data->visibility.back());
+}
+
+void Benchmark(const char* name, void (*fun)(Data*), Data* data) {
+  double best_time = 1e30;
+  for (int i = 0; i < kIterations; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    fun(data);
+    const auto stop = std::chrono::steady_clock::now();
+    best_time = std::min(
+        best_time, std::chrono::duration<double>(stop - start).count());
+  }
+
+  const double count = static_cast<double>(data->points.size());
+  std::cout << "  " << name << ": " << best_time * 1e9 / count
+            << " ns/item (" << count / best_time * 1e-6 << " Mitems/s)\n";
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  int count = kDefaultCount;
+  if (argc >= 2) {
+    count = std::max(1, std::atoi(argv[1]));
+  }
+
+  Data data;
+  CreateData(static_cast<size_t>(count), &data);
+
+  std::cout << "Processing " << count << " items (SIMD backend: "
+            << base::GetSimdBackend() << "):\n";
+  Benchmark("transform points, scalar  ", ScalarTransformPoints, &data);
+  Benchmark("transform points, batch   ", BatchTransformPoints, &data);
+  Benchmark("transform boxes, scalar   ", ScalarTransformAabbs, &data);
+  Benchmark("transform boxes, batch    ", BatchTransformAabbs, &data);
+  Benchmark("classify boxes, scalar    ", ScalarClassifyAabbs, &data);
+  Benchmark("classify boxes, batch     ", BatchClassifyAabbs, &data);
+
+  // Print the sink so that the work can not be optimized away.
+  std::cout << "(checksum: " << g_sink << ")\n";
+  return 0;
+}
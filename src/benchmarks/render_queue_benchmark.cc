@@ -0,0 +1,135 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+// This benchmark compares the radix sort of gfx::RenderQueue with
+// std::stable_sort(), for the sort keys of a frame with many draws.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "gfx/render_queue.h"
+
+namespace {
+
+const int kDefaultCount = 100000;
+const int kIterations = 5;
+
+// Accumulated results, which keep the compiler from removing the work.
+uint64_t g_sink = 0;
+
+// Make the keys of a frame: a few materials and vertex arrays, with random
+// depths, and one instance per draw.
+std::vector<uint64_t> CreateKeys(size_t count) {
+  std::mt19937 generator(1234);
+  std::uniform_int_distribution<uint32_t> material(0, 5);
+  std::uniform_int_distribution<uint32_t> vertex_array(0, 63);
+  std::uniform_real_distribution<float> depth(0.1f, 1000.0f);
+  std::vector<uint64_t> keys;
+  for (size_t i = 0; i < count; ++i) {
+    keys.push_back(gfx::SortKey::Make(0, 0, material(generator),
+                                      vertex_array(generator),
+                                      depth(generator),
+                                      static_cast<uint32_t>(i)));
+  }
+  return keys;
+}
+
+void RadixSort(const std::vector<uint64_t>& keys, gfx::RenderQueue* queue) {
+  queue->Clear();
+  for (size_t i = 0; i < keys.size(); ++i) {
+    queue->Add(keys[i], static_cast<uint32_t>(i));
+  }
+  queue->Sort();
+  g_sink += queue->items().front().index;
+}
+
+void StdSort(const std::vector<uint64_t>& keys,
+             std::vector<gfx::RenderQueue::Item>* items) {
+  items->clear();
+  for (size_t i = 0; i < keys.size(); ++i) {
+    items->push_back(
+        gfx::RenderQueue::Item{keys[i], static_cast<uint32_t>(i)});
+  }
+  std::stable_sort(items->begin(), items->end(),
+                   [](const gfx::RenderQueue::Item& a,
+                      const gfx::RenderQueue::Item& b) {
+                     return a.key < b.key;
+                   });
+  g_sink += items->front().index;
+}
+
+template <typename Fun>
+void Benchmark(const char* name, size_t count, const Fun& fun) {
+  double best_time = 1e30;
+  for (int i = 0; i < kIterations; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    fun();
+    const auto stop = std::chrono::steady_clock::now();
+    best_time = std::min(
+        best_time, std::chrono::duration<double>(stop - start).count());
+  }
+
+  std::cout << "  " << name << ": " << best_time * 1e3 << " ms ("
+            << best_time * 1e9 / static_cast<double>(count) << " ns/draw)\n";
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  int count = kDefaultCount;
+  if (argc >= 2) {
+    count = std::max(1, std::atoi(argv[1]));
+  }
+
+  const auto keys = CreateKeys(static_cast<size_t>(count));
+  gfx::RenderQueue queue;
+  std::vector<gfx::RenderQueue::Item> items;
+
+  std::cout << "Sorting " << count << " draws:\n";
+  Benchmark("radix sort      ", keys.size(),
+            [&keys, &queue]() { RadixSort(keys, &queue); });
+  Benchmark("std::stable_sort", keys.size(),
+            [&keys, &items]() { StdSort(keys, &items); });
+
+  // Check that the sorts agree.
+  bool equal = queue.items().size() == items.size();
+  for (size_t i = 0; equal && i < items.size(); ++i) {
+    equal = queue.items()[i].index == items[i].index;
+  }
+  std::cout << (equal ? "The results are equal.\n"
+                      : "ERROR: The results differ!\n");
+
+  // Print the sink so that the work can not be optimized away.
+  std::cout << "(checksum: " << g_sink << ")\n";
+  return equal ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+// This benchmark measures the cost of dispatching small tasks with the
+// work-stealing task scheduler, compared to a single consumer thread that is
+// fed through a mutex protected queue (the design of the original main window
+// worker, which is still used by base::AffinityLane).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+
+#include "base/parallel.h"
+#include "base/task_scheduler.h"
+
+namespace {
+
+const int kDefaultTaskCount = 1000000;
+const int kIterations = 3;
+
+// A tiny amount of work per task, so that the dispatch cost dominates.
+std::atomic<int> g_counter(0);
+void SmallTask() {
+  g_counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+// A single worker thread that drains a std::function queue, guarded by one
+// mutex and one condition variable.
+class QueueThread {
+ public:
+  QueueThread() : terminate_(false), thread_(&QueueThread::Run, this) {}
+
+  ~QueueThread() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      terminate_ = true;
+    }
+    condition_variable_.notify_all();
+    thread_.join();
+  }
+
+  void Post(std::function<void()>&& fun) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.emplace(std::move(fun));
+    condition_variable_.notify_all();
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (queue_.empty() && !terminate_) {
+        condition_variable_.wait(lock);
+      }
+      if (queue_.empty()) {
+        break;
+      }
+      auto fun = std::move(queue_.front());
+      queue_.pop();
+      lock.unlock();
+      fun();
+    }
+  }
+
+  bool terminate_;
+  std::condition_variable condition_variable_;
+  std::mutex mutex_;
+  std::queue<std::function<void()>> queue_;
+  std::thread thread_;
+};
+
+void RunQueue(int count) {
+  // The destructor drains the queue before joining the thread.
+  QueueThread queue_thread;
+  for (int i = 0; i < count; ++i) {
+    queue_thread.Post(SmallTask);
+  }
+}
+
+void RunSchedulerExternal(int count) {
+  auto& scheduler = base::TaskScheduler::GetDefault();
+  base::TaskGroup group;
+  for (int i = 0; i < count; ++i) {
+    scheduler.Spawn(&group, SmallTask);
+  }
+  scheduler.Wait(&group);
+}
+
+void RunSchedulerNested(int count) {
+  // Spawn the tasks from within a task, so that they go to the worker's own
+  // queue and get stolen by the other workers.
+  auto& scheduler = base::TaskScheduler::GetDefault();
+  base::TaskGroup group;
+  scheduler.Spawn(&group, [&scheduler, count]() {
+    base::TaskGroup children;
+    for (int i = 0; i < count; ++i) {
+      scheduler.Spawn(&children, SmallTask);
+    }
+    scheduler.Wait(&children);
+  });
+  scheduler.Wait(&group);
+}
+
+void RunParallelFor(int count) {
+  base::ParallelFor(static_cast<size_t>(count), [](size_t) { SmallTask(); });
+}
+
+void Benchmark(const char* name, void (*fun)(int), int count) {
+  double best_time = 1e30;
+  for (int i = 0; i < kIterations; ++i) {
+    g_counter = 0;
+    const auto start = std::chrono::steady_clock::now();
+    fun(count);
+    const auto stop = std::chrono::steady_clock::now();
+    best_time = std::min(
+        best_time, std::chrono::duration<double>(stop - start).count());
+    if (g_counter != count) {
+      std::cerr << name << ": Only " << g_counter << " of " << count
+                << " tasks were run!\n";
+    }
+  }
+
+  std::cout << "  " << name << ": " << best_time * 1e9 / count
+            << " ns/task (" << count / best_time * 1e-6 << " Mtasks/s)\n";
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  int count = kDefaultTaskCount;
+  if (argc >= 2) {
+    count = std::max(1, std::atoi(argv[1]));
+  }
+
+  std::cout << "Dispatching " << count << " tasks ("
+            << base::TaskScheduler::GetDefault().thread_count()
+            << " scheduler threads):\n";
+  Benchmark("mutex queue, single thread ", RunQueue, count);
+  Benchmark("scheduler, external spawn ", RunSchedulerExternal, count);
+  Benchmark("scheduler, nested spawn   ", RunSchedulerNested, count);
+  Benchmark("ParallelFor               ", RunParallelFor, count);
+  return 0;
+}
@@ -0,0 +1,313 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+// This benchmark measures the cost of submitting the UI geometry of a frame
+// with many ImGui windows, with one draw per draw command compared to the
+// merged draws of ui::DrawBatcher. If a headless OpenGL context is available,
+// the draws are submitted to it, so that the driver overhead per draw call is
+// included.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "GL/gl3w.h"
+#include "imgui/imgui.h"
+
+#include "base/error.h"
+#include "base/make_unique.h"
+#include "gfx/framebuffer.h"
+#include "gfx/gl_state.h"
+#include "gfx/shader.h"
+#include "ui/draw_batcher.h"
+#include "ui/headless_context.h"
+
+namespace {
+
+const int kDefaultWindowCount = 300;
+const int kFrameCount = 100;
+const int kDisplayWidth = 1920;
+const int kDisplayHeight = 1080;
+const float kWindowWidth = 220.0f;
+const float kWindowHeight = 130.0f;
+
+const char* const kVertexShader =
+    "#version 150\n"
+    "uniform mat4 ProjMtx;\n"
+    "in vec2 Position;\n"
+    "in vec2 UV;\n"
+    "in vec4 Color;\n"
+    "out vec2 Frag_UV;\n"
+    "out vec4 Frag_Color;\n"
+    "void main() {\n"
+    "  Frag_UV = UV;\n"
+    "  Frag_Color = Color;\n"
+    "  gl_Position = ProjMtx * vec4(Position.xy, 0, 1);\n"
+    "}\n";
+
+const char* const kFragmentShader =
+    "#version 150\n"
+    "uniform sampler2D Texture;\n"
+    "in vec2 Frag_UV;\n"
+    "in vec4 Frag_Color;\n"
+    "out vec4 Out_Color;\n"
+    "void main() {\n"
+    "  Out_Color = Frag_Color * texture(Texture, Frag_UV.st);\n"
+    "}\n";
+
+const char* const kAttributes[] = {"Position", "UV", "Color", nullptr};
+
+// Submits the draws of a frame to a headless context, like ui::UiWindow.
+class GlSubmitter {
+ public:
+  GlSubmitter()
+      : framebuffer_(&state_, kDisplayWidth, kDisplayHeight, 1) {
+    shader_.Compile(kVertexShader, kFragmentShader, kAttributes);
+    state_.UseProgram(shader_.handle());
+    const float projection[16] = {2.0f / kDisplayWidth, 0.0f, 0.0f, 0.0f,
+                                  0.0f, -2.0f / kDisplayHeight, 0.0f, 0.0f,
+                                  0.0f, 0.0f, -1.0f, 0.0f,
+                                  -1.0f, 1.0f, 0.0f, 1.0f};
+    glUniformMatrix4fv(shader_.GetUniformLocation("ProjMtx"), 1, GL_FALSE,
+                       projection);
+    glUniform1i(shader_.GetUniformLocation("Texture"), 0);
+
+    glGenBuffers(2, buffers_);
+    glGenVertexArrays(1, &vertex_array_);
+    state_.BindVertexArray(vertex_array_);
+    state_.BindArrayBuffer(buffers_[0]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers_[1]);
+    for (GLuint i = 0; i < 3; ++i) {
+      glEnableVertexAttribArray(i);
+    }
+    const auto stride = static_cast<GLsizei>(sizeof(ImDrawVert));
+    glVertexAttribPointer(
+        0, 2, GL_FLOAT, GL_FALSE, stride,
+        reinterpret_cast<GLvoid*>(offsetof(ImDrawVert, pos)));
+    glVertexAttribPointer(
+        1, 2, GL_FLOAT, GL_FALSE, stride,
+        reinterpret_cast<GLvoid*>(offsetof(ImDrawVert, uv)));
+    glVertexAttribPointer(
+        2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+        reinterpret_cast<GLvoid*>(offsetof(ImDrawVert, col)));
+
+    // Upload the font atlas.
+    unsigned char* pixels;
+    int width, height;
+    ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    glGenTextures(1, &font_texture_);
+    state_.BindTexture2D(0, font_texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, pixels);
+    ImGui::GetIO().Fonts->TexID =
+        reinterpret_cast<void*>(static_cast<uintptr_t>(font_texture_));
+
+    framebuffer_.Bind(&state_);
+    state_.SetViewport(0, 0, kDisplayWidth, kDisplayHeight);
+    state_.SetBlend(true);
+    state_.SetBlendEquation(GL_FUNC_ADD);
+    state_.SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    state_.SetScissorTest(true);
+  }
+
+  ~GlSubmitter() {
+    glDeleteTextures(1, &font_texture_);
+    state_.DeleteVertexArray(vertex_array_);
+    glDeleteBuffers(2, buffers_);
+    shader_.Delete();
+    framebuffer_.Delete(&state_);
+  }
+
+  // Upload the geometry, and submit the draws.
+  void Submit(const ui::DrawBatcher& batcher,
+              const std::vector<ImDrawVert>& vertices,
+              const std::vector<ImDrawIdx>& indices) {
+    glBufferData(GL_ARRAY_BUFFER,
+                 static_cast<GLsizeiptr>(vertices.size() * sizeof(ImDrawVert)),
+                 vertices.data(), GL_STREAM_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 static_cast<GLsizeiptr>(indices.size() * sizeof(ImDrawIdx)),
+                 indices.data(), GL_STREAM_DRAW);
+    for (const auto& draw : batcher.draws()) {
+      state_.BindTexture2D(
+          0, static_cast<GLuint>(reinterpret_cast<intptr_t>(draw.texture)));
+      state_.SetScissor(
+          static_cast<int>(draw.clip_rect.x),
+          static_cast<int>(kDisplayHeight - draw.clip_rect.w),
+          static_cast<int>(draw.clip_rect.z - draw.clip_rect.x),
+          static_cast<int>(draw.clip_rect.w - draw.clip_rect.y));
+      glDrawElementsBaseVertex(
+          GL_TRIANGLES, static_cast<GLsizei>(draw.index_count),
+          sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+          reinterpret_cast<const GLvoid*>(
+              static_cast<uintptr_t>(draw.first_index * sizeof(ImDrawIdx))),
+          static_cast<GLint>(draw.base_vertex));
+    }
+  }
+
+  // Wait for the GPU (outside of the timed region).
+  void Finish() { glFinish(); }
+
+ private:
+  ui::HeadlessContext context_;
+  gfx::GlState state_;
+  gfx::Framebuffer framebuffer_;
+  gfx::Shader shader_;
+  GLuint buffers_[2] = {0, 0};
+  GLuint vertex_array_ = 0;
+  GLuint font_texture_ = 0;
+};
+
+// Define a grid of (overlapping) windows with a few widgets each.
+void DefineWindows(int count, int frame, std::vector<float>* values) {
+  const int columns = static_cast<int>(kDisplayWidth / kWindowWidth);
+  char name[32];
+  for (int i = 0; i < count; ++i) {
+    const float x = static_cast<float>(i % columns) * kWindowWidth;
+    const float y = static_cast<float>((i / columns) % 8) * kWindowHeight +
+                    static_cast<float>(i / (8 * columns)) * 10.0f;
+    ImGui::SetNextWindowPos(ImVec2(x, y), ImGuiSetCond_Always);
+    ImGui::SetNextWindowSize(ImVec2(kWindowWidth, kWindowHeight),
+                             ImGuiSetCond_Always);
+    std::snprintf(name, sizeof(name), "Window %d", i);
+    ImGui::Begin(name, nullptr, ImGuiWindowFlags_NoSavedSettings);
+    ImGui::Text("Frame %d", frame);
+    ImGui::SliderFloat("Value", &(*values)[static_cast<size_t>(i)], 0.0f,
+                       1.0f);
+    ImGui::Button("Apply");
+    ImGui::SameLine();
+    ImGui::Button("Reset");
+    ImGui::ProgressBar(static_cast<float>((frame + i) % 100) / 100.0f);
+    ImGui::End();
+  }
+}
+
+struct Result {
+  size_t draws = 0;
+  double batch_seconds = 0.0;
+  double submit_seconds = 0.0;
+};
+
+void Report(const char* name, const Result& result) {
+  std::printf("  %s: %d draws/frame, %.3f ms/frame (batch %.3f, submit %.3f)\n",
+              name, static_cast<int>(result.draws / kFrameCount),
+              (result.batch_seconds + result.submit_seconds) * 1e3 /
+                  kFrameCount,
+              result.batch_seconds * 1e3 / kFrameCount,
+              result.submit_seconds * 1e3 / kFrameCount);
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  int window_count = kDefaultWindowCount;
+  if (argc >= 2) {
+    window_count = std::max(1, std::atoi(argv[1]));
+  }
+
+  ImGuiIO& io = ImGui::GetIO();
+  io.IniFilename = nullptr;
+  io.LogFilename = nullptr;
+  io.RenderDrawListsFn = nullptr;
+  io.DisplaySize = ImVec2(static_cast<float>(kDisplayWidth),
+                          static_cast<float>(kDisplayHeight));
+  io.DeltaTime = 1.0f / 60.0f;
+  unsigned char* pixels;
+  int width, height;
+  io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+  std::unique_ptr<GlSubmitter> submitter;
+  try {
+    submitter = base::make_unique<GlSubmitter>();
+  } catch (const base::Error& e) {
+    std::cout << "No headless OpenGL context (" << e.what()
+              << "), measuring the batching only.\n";
+  }
+
+  std::cout << "Painting " << window_count << " windows for " << kFrameCount
+            << " frames:\n";
+  std::vector<float> values(static_cast<size_t>(window_count), 0.5f);
+  std::vector<ImDrawVert> vertices;
+  std::vector<ImDrawIdx> indices;
+  ui::DrawBatcher batcher;
+  Result results[2];
+  double imgui_seconds = 0.0;
+  size_t commands = 0;
+  for (int frame = 0; frame < kFrameCount; ++frame) {
+    auto start = std::chrono::steady_clock::now();
+    ImGui::NewFrame();
+    DefineWindows(window_count, frame, &values);
+    ImGui::Render();
+    const ImDrawData& draw_data = *ImGui::GetDrawData();
+    imgui_seconds += std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    vertices.resize(static_cast<size_t>(draw_data.TotalVtxCount));
+    indices.resize(static_cast<size_t>(draw_data.TotalIdxCount));
+
+    // Without merging (one draw per command), and with merging.
+    for (int merge = 0; merge < 2; ++merge) {
+      auto& result = results[merge];
+      start = std::chrono::steady_clock::now();
+      batcher.set_merge(merge != 0);
+      batcher.Build(draw_data, vertices.data(), indices.data());
+      const auto batched = std::chrono::steady_clock::now();
+      if (submitter) {
+        submitter->Submit(batcher, vertices, indices);
+      }
+      const auto stop = std::chrono::steady_clock::now();
+      result.draws += batcher.draws().size();
+      result.batch_seconds +=
+          std::chrono::duration<double>(batched - start).count();
+      result.submit_seconds +=
+          std::chrono::duration<double>(stop - batched).count();
+      if (submitter) {
+        submitter->Finish();
+      }
+    }
+    commands += batcher.command_count();
+  }
+
+  std::printf("  ImGui: %d commands/frame, %.3f ms/frame\n",
+              static_cast<int>(commands / kFrameCount),
+              imgui_seconds * 1e3 / kFrameCount);
+  Report("one draw per command", results[0]);
+  Report("merged draws        ", results[1]);
+
+  submitter.reset();
+  ImGui::Shutdown();
+  return 0;
+}
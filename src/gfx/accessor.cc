@@ -0,0 +1,117 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "gfx/accessor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace gfx {
+
+namespace {
+
+float HalfToFloat(uint16_t h) {
+  const int exponent = (h >> 10) & 0x1f;
+  const int mantissa = h & 0x3ff;
+  float value;
+  if (exponent == 0) {
+    value = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+  } else if (exponent == 31) {
+    value = mantissa == 0 ? std::numeric_limits<float>::infinity()
+                          : std::numeric_limits<float>::quiet_NaN();
+  } else {
+    value = static_cast<float>(mantissa | 0x400) *
+            std::ldexp(1.0f, exponent - 25);
+  }
+  return (h & 0x8000) != 0 ? -value : value;
+}
+
+template <typename T>
+float ReadComponent(const char* p, bool normalized, float scale) {
+  T value;
+  std::memcpy(&value, p, sizeof(value));
+  const float x = static_cast<float>(value);
+  return normalized ? std::max(x * scale, -1.0f) : x;
+}
+
+}  // namespace
+
+void Accessor::ReadFloats(const BufferData& buffer_data,
+                          size_t index,
+                          float* result) const {
+  const char* p = buffer_data.data + offset + index * byte_stride();
+  if (type == DataType::kInt10_10_10_2) {
+    uint32_t packed;
+    std::memcpy(&packed, p, sizeof(packed));
+    for (int k = 0; k < components; ++k) {
+      const int bits = k < 3 ? 10 : 2;
+      const int shift = 32 - bits - 10 * k;
+      const auto x = static_cast<float>(
+          static_cast<int32_t>(packed << shift) >> (32 - bits));
+      const float max = static_cast<float>((1 << (bits - 1)) - 1);
+      result[k] = normalized ? std::max(x / max, -1.0f) : x;
+    }
+    return;
+  }
+
+  const size_t size = SizeOf(type);
+  for (int k = 0; k < components; ++k, p += size) {
+    switch (type) {
+      case DataType::kInt8:
+        result[k] = ReadComponent<int8_t>(p, normalized, 1.0f / 127.0f);
+        break;
+      case DataType::kUInt8:
+        result[k] = ReadComponent<uint8_t>(p, normalized, 1.0f / 255.0f);
+        break;
+      case DataType::kInt16:
+        result[k] = ReadComponent<int16_t>(p, normalized, 1.0f / 32767.0f);
+        break;
+      case DataType::kUInt16:
+        result[k] = ReadComponent<uint16_t>(p, normalized, 1.0f / 65535.0f);
+        break;
+      case DataType::kUInt32:
+        result[k] =
+            ReadComponent<uint32_t>(p, normalized, 1.0f / 4294967295.0f);
+        break;
+      case DataType::kFloat32:
+        std::memcpy(&result[k], p, sizeof(float));
+        break;
+      case DataType::kFloat16: {
+        uint16_t half;
+        std::memcpy(&half, p, sizeof(half));
+        result[k] = HalfToFloat(half);
+        break;
+      }
+      case DataType::kInt10_10_10_2:
+        break;
+    }
+  }
+}
+
+}  // namespace gfx
@@ -0,0 +1,162 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef GFX_ACCESSOR_H_
+#define GFX_ACCESSOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace gfx {
+
+/// @brief Data types for vertex attributes and indices.
+///
+/// kInt10_10_10_2 is a packed type that holds four signed components (x, y
+/// and z in ten bits each, and w in two bits) in 32 bits, and is only valid
+/// for four component attributes (it requires OpenGL 3.3).
+enum class DataType {
+  kInt8,
+  kUInt8,
+  kInt16,
+  kUInt16,
+  kUInt32,
+  kFloat32,
+  kFloat16,
+  kInt10_10_10_2
+};
+
+/// @returns the size of a single component of the given type, in bytes (the
+/// packed types count as one byte per component).
+inline size_t SizeOf(DataType type) {
+  switch (type) {
+    case DataType::kInt8:
+    case DataType::kUInt8:
+    case DataType::kInt10_10_10_2:
+      return 1;
+    case DataType::kInt16:
+    case DataType::kUInt16:
+    case DataType::kFloat16:
+      return 2;
+    case DataType::kUInt32:
+    case DataType::kFloat32:
+      return 4;
+  }
+  return 0;
+}
+
+/// @brief A raw block of memory (e.g. a part of a memory mapped file).
+///
+/// A buffer maps to a single OpenGL buffer object when uploaded to the GPU.
+struct BufferData {
+  const char* data = nullptr;
+  size_t size = 0;
+};
+
+/// @brief A typed view of an array of elements in a buffer.
+///
+/// This is modeled after glTF accessors, and describes the data in a way that
+/// maps directly to glVertexAttribPointer() and glDrawElements().
+struct Accessor {
+  /// Buffer index, or -1 if the accessor is unused.
+  int buffer = -1;
+
+  /// Offset to the first element, in bytes.
+  size_t offset = 0;
+
+  /// Distance between consecutive elements in bytes (0 = tightly packed).
+  size_t stride = 0;
+
+  /// Number of elements.
+  size_t count = 0;
+
+  /// Number of components per element (1 for indices, 3 for positions, ...).
+  int components = 1;
+
+  DataType type = DataType::kFloat32;
+  bool normalized = false;
+
+  bool valid() const { return buffer >= 0; }
+
+  /// @returns the size of a single element, in bytes.
+  size_t element_size() const {
+    return SizeOf(type) * static_cast<size_t>(components);
+  }
+
+  /// @returns the actual distance between consecutive elements, in bytes.
+  size_t byte_stride() const { return stride != 0 ? stride : element_size(); }
+
+  /// @returns the number of bytes that the accessor spans in its buffer.
+  size_t byte_length() const {
+    return count > 0 ? (count - 1) * byte_stride() + element_size() : 0;
+  }
+
+  /// @brief Read a float vector element.
+  /// @note Only valid for kFloat32 accessors.
+  void GetFloats(const BufferData& buffer_data,
+                 size_t index,
+                 float* result) const {
+    std::memcpy(result, buffer_data.data + offset + index * byte_stride(),
+                element_size());
+  }
+
+  /// @brief Read a vector element of any type as floats.
+  ///
+  /// Normalized integers are converted to the range [0, 1] (unsigned) or
+  /// [-1, 1] (signed), as OpenGL does.
+  /// @param buffer_data The buffer.
+  /// @param index The element index.
+  /// @param[out] result The components.
+  void ReadFloats(const BufferData& buffer_data,
+                  size_t index,
+                  float* result) const;
+
+  /// @brief Read an index element.
+  /// @note Only valid for kUInt8, kUInt16 and kUInt32 scalar accessors.
+  uint32_t GetIndex(const BufferData& buffer_data, size_t index) const {
+    const char* p = buffer_data.data + offset + index * byte_stride();
+    switch (type) {
+      case DataType::kUInt8:
+        return static_cast<uint8_t>(*p);
+      case DataType::kUInt16: {
+        uint16_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+      }
+      default: {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+      }
+    }
+  }
+};
+
+}  // namespace gfx
+
+#endif  // GFX_ACCESSOR_H_
@@ -0,0 +1,94 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "gfx/box_set.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gfx {
+
+namespace {
+
+// Padding boxes have a huge negative extent, which puts them outside of every
+// plane.
+const float kPaddingExtent = -1e30f;
+
+}  // namespace
+
+void BoxSet::Add(const base::Aabb& box) {
+  if (size_ == center_[0].size()) {
+    for (int k = 0; k < 3; ++k) {
+      center_[k].resize(size_ + base::kAabbBatchSize, 0.0f);
+      extent_[k].resize(size_ + base::kAabbBatchSize, kPaddingExtent);
+    }
+  }
+  const base::Vec3 center = box.center();
+  const base::Vec3 extent = box.extent();
+  for (int k = 0; k < 3; ++k) {
+    center_[k][size_] = center[k];
+    extent_[k][size_] = extent[k];
+  }
+  ++size_;
+}
+
+void BoxSet::Clear() {
+  for (int k = 0; k < 3; ++k) {
+    center_[k].clear();
+    extent_[k].clear();
+  }
+  size_ = 0;
+}
+
+float BoxSet::Distance(size_t index, const base::Vec3& p) const {
+  float squared_distance = 0.0f;
+  for (int k = 0; k < 3; ++k) {
+    const float d =
+        std::max(std::abs(p[k] - center_[k][index]) - extent_[k][index], 0.0f);
+    squared_distance += d * d;
+  }
+  return std::sqrt(squared_distance);
+}
+
+void BoxSet::Cull(const base::Frustum& frustum,
+                  size_t begin,
+                  size_t end,
+                  base::Visibility* visibility) const {
+  if (begin >= end) {
+    return;
+  }
+  const float* center[3];
+  const float* extent[3];
+  for (int k = 0; k < 3; ++k) {
+    center[k] = &center_[k][begin];
+    extent[k] = &extent_[k][begin];
+  }
+  base::ClassifyAabbs(frustum, center, extent, end - begin, visibility);
+}
+
+}  // namespace gfx
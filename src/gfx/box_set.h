@@ -0,0 +1,78 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef GFX_BOX_SET_H_
+#define GFX_BOX_SET_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "base/math.h"
+
+namespace gfx {
+
+/// @brief A set of axis aligned boxes, stored in a SIMD friendly layout.
+///
+/// The boxes are stored as separate arrays of center and extent (half size)
+/// components, padded to a multiple of base::kAabbBatchSize boxes, so that
+/// several boxes can be tested against a frustum at a time.
+class BoxSet {
+ public:
+  /// @brief Add a box.
+  void Add(const base::Aabb& box);
+
+  /// @brief Remove all boxes.
+  void Clear();
+
+  size_t size() const { return size_; }
+
+  /// @returns the distance from a point to a box (zero inside the box).
+  float Distance(size_t index, const base::Vec3& p) const;
+
+  /// @brief Classify a range of boxes against a frustum.
+  /// @param frustum The frustum.
+  /// @param begin The first box to test. Must be a multiple of
+  /// base::kAabbBatchSize.
+  /// @param end One past the last box to test.
+  /// @param[out] visibility The visibility of each box in the range (indexed
+  /// from zero).
+  void Cull(const base::Frustum& frustum,
+            size_t begin,
+            size_t end,
+            base::Visibility* visibility) const;
+
+ private:
+  // center_[k][i] and extent_[k][i] for component k of box i.
+  std::vector<float> center_[3];
+  std::vector<float> extent_[3];
+  size_t size_ = 0;
+};
+
+}  // namespace gfx
+
+#endif  // GFX_BOX_SET_H_
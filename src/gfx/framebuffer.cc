@@ -0,0 +1,140 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "gfx/framebuffer.h"
+
+#include <algorithm>
+
+#include "GL/gl3w.h"
+
+#include "base/error.h"
+
+namespace gfx {
+
+Framebuffer::Framebuffer(GlState* state, int width, int height, int samples)
+    : state_(state), width_(width), height_(height) {
+  GLint max_samples = 1;
+  glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+  samples_ = std::max(1, std::min(samples, static_cast<int>(max_samples)));
+
+  framebuffer_ = Create(state, samples_, true);
+  if (samples_ > 1) {
+    resolve_framebuffer_ = Create(state, 1, false);
+  }
+}
+
+Framebuffer::~Framebuffer() {
+  Delete(state_);
+}
+
+void Framebuffer::Bind(GlState* state) {
+  state->BindFramebuffer(framebuffer_);
+}
+
+void Framebuffer::Resolve(GlState* state) {
+  // The scissor test applies to blits.
+  if (resolve_framebuffer_ != 0) {
+    state->SetScissorTest(false);
+    state->BindFramebuffer(resolve_framebuffer_);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
+    glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, resolve_framebuffer_);
+    state->CountCalls(3);
+  } else {
+    state->BindFramebuffer(framebuffer_);
+  }
+}
+
+void Framebuffer::BlitTo(GlState* state, unsigned int target) {
+  Resolve(state);
+  const GLuint source =
+      resolve_framebuffer_ != 0 ? resolve_framebuffer_ : framebuffer_;
+  state->SetScissorTest(false);
+  state->BindFramebuffer(target);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+  glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_,
+                    GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, target);
+  state->CountCalls(3);
+}
+
+void Framebuffer::ReadPixels(GlState* state, Image* image) {
+  Resolve(state);
+  image->Resize(width_, height_);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE,
+               image->data());
+  state->CountCalls(2);
+  image->FlipVertically();
+}
+
+void Framebuffer::Delete(GlState* state) {
+  if (framebuffer_ != 0) {
+    state->DeleteFramebuffer(framebuffer_);
+    framebuffer_ = 0;
+  }
+  if (resolve_framebuffer_ != 0) {
+    state->DeleteFramebuffer(resolve_framebuffer_);
+    resolve_framebuffer_ = 0;
+  }
+  if (renderbuffer_count_ > 0) {
+    glDeleteRenderbuffers(renderbuffer_count_, renderbuffers_);
+    state->CountCalls(1);
+    renderbuffer_count_ = 0;
+  }
+}
+
+unsigned int Framebuffer::Create(GlState* state, int samples, bool with_depth) {
+  GLuint framebuffer = 0;
+  glGenFramebuffers(1, &framebuffer);
+  state->BindFramebuffer(framebuffer);
+  AddRenderbuffer(samples, GL_RGBA8, GL_COLOR_ATTACHMENT0);
+  if (with_depth) {
+    AddRenderbuffer(samples, GL_DEPTH_COMPONENT24, GL_DEPTH_ATTACHMENT);
+  }
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    throw base::Error("Unable to create a complete framebuffer.");
+  }
+  return framebuffer;
+}
+
+void Framebuffer::AddRenderbuffer(int samples,
+                                  unsigned int format,
+                                  unsigned int attachment) {
+  GLuint renderbuffer = 0;
+  glGenRenderbuffers(1, &renderbuffer);
+  renderbuffers_[renderbuffer_count_++] = renderbuffer;
+  glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+  glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples > 1 ? samples : 0,
+                                   format, width_, height_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER,
+                            renderbuffer);
+}
+
+}  // namespace gfx
@@ -0,0 +1,118 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef GFX_FRAMEBUFFER_H_
+#define GFX_FRAMEBUFFER_H_
+
+#include "gfx/gl_state.h"
+#include "gfx/image.h"
+
+namespace gfx {
+
+/// @brief An offscreen render target with a color and a depth buffer.
+///
+/// Multisampled framebuffers are resolved to a single sampled framebuffer
+/// when the pixels are read.
+class Framebuffer {
+ public:
+  /// @brief Create the framebuffer.
+  /// @param state The state of the current context, which must outlive the
+  /// framebuffer (the destructor deletes the objects through it).
+  /// @param width The width in pixels.
+  /// @param height The height in pixels.
+  /// @param samples The number of samples per pixel (1 for no multisampling).
+  /// It is limited to what the implementation supports.
+  /// @throws base::Error if the framebuffer is not supported.
+  /// @note The OpenGL context that will use the framebuffer must be current.
+  Framebuffer(GlState* state, int width, int height, int samples);
+
+  /// @brief Delete the OpenGL objects, unless Delete() has been called.
+  ///
+  /// The objects are deleted through the state that was given to the
+  /// constructor, so that it does not keep a deleted framebuffer bound.
+  /// @note The OpenGL context that used the framebuffer must be current.
+  ~Framebuffer();
+
+  /// @brief Bind the framebuffer for drawing.
+  /// @param state The state of the current context.
+  void Bind(GlState* state);
+
+  /// @brief Resolve the samples, and bind the single sampled framebuffer.
+  ///
+  /// Use this to read the pixels with other means than ReadPixels() (e.g. a
+  /// gfx::ReadbackRing).
+  /// @param state The state of the current context.
+  void Resolve(GlState* state);
+
+  /// @brief Copy the color buffer to another framebuffer of the same size.
+  /// @param state The state of the current context.
+  /// @param target The target framebuffer (zero for the window), which is
+  /// left bound.
+  void BlitTo(GlState* state, unsigned int target);
+
+  /// @brief Read the color buffer.
+  /// @param state The state of the current context.
+  /// @param[out] image The pixels (resized to the framebuffer size).
+  /// @note This leaves the framebuffer (or its resolve framebuffer) bound.
+  void ReadPixels(GlState* state, Image* image);
+
+  /// @brief Delete the OpenGL objects.
+  /// @param state The state of the current context (which forgets the
+  /// framebuffer if it is bound).
+  void Delete(GlState* state);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+ private:
+  // Create a framebuffer with a color and (optionally) a depth renderbuffer.
+  unsigned int Create(GlState* state, int samples, bool with_depth);
+
+  // Create a renderbuffer and attach it to the bound framebuffer.
+  void AddRenderbuffer(int samples,
+                       unsigned int format,
+                       unsigned int attachment);
+
+  GlState* state_;
+  int width_;
+  int height_;
+  int samples_;
+  unsigned int framebuffer_ = 0;
+  unsigned int resolve_framebuffer_ = 0;
+  unsigned int renderbuffers_[3] = {0, 0, 0};
+  int renderbuffer_count_ = 0;
+
+  // Disable copy/move.
+  Framebuffer(const Framebuffer&) = delete;
+  Framebuffer(Framebuffer&&) = delete;
+  Framebuffer& operator=(const Framebuffer&) = delete;
+};
+
+}  // namespace gfx
+
+#endif  // GFX_FRAMEBUFFER_H_
@@ -0,0 +1,294 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "gfx/gl_state.h"
+
+#include <limits>
+
+#include "GL/gl3w.h"
+
+namespace gfx {
+
+namespace {
+
+// The cached value of object bindings and enums that are not known yet.
+const unsigned int kUnknown = std::numeric_limits<unsigned int>::max();
+
+bool SameRect(const int* rect, int x, int y, int width, int height) {
+  return rect[0] == x && rect[1] == y && rect[2] == width && rect[3] == height;
+}
+
+void SetRect(int* rect, int x, int y, int width, int height) {
+  rect[0] = x;
+  rect[1] = y;
+  rect[2] = width;
+  rect[3] = height;
+}
+
+}  // namespace
+
+GlState::GlState() {
+  Invalidate();
+}
+
+void GlState::Invalidate() {
+  framebuffer_ = kUnknown;
+  program_ = kUnknown;
+  vertex_array_ = kUnknown;
+  array_buffer_ = kUnknown;
+  active_texture_unit_ = -1;
+  for (auto& texture : textures_) {
+    texture = kUnknown;
+  }
+  for (auto& texture : buffer_textures_) {
+    texture = kUnknown;
+  }
+
+  blend_ = Toggle::kUnknown;
+  cull_face_ = Toggle::kUnknown;
+  depth_test_ = Toggle::kUnknown;
+  scissor_test_ = Toggle::kUnknown;
+  blend_src_ = kUnknown;
+  blend_dst_ = kUnknown;
+  blend_src_alpha_ = kUnknown;
+  blend_dst_alpha_ = kUnknown;
+  blend_equation_ = kUnknown;
+  depth_func_ = kUnknown;
+
+  // Negative sizes are invalid, so they never match a requested rectangle.
+  SetRect(scissor_, 0, 0, -1, -1);
+  SetRect(viewport_, 0, 0, -1, -1);
+
+  // NaN never compares equal, so the first clear color is always set.
+  for (auto& component : clear_color_) {
+    component = std::numeric_limits<float>::quiet_NaN();
+  }
+}
+
+void GlState::BeginFrame() {
+  last_frame_stats_ = stats_;
+  stats_ = Stats();
+}
+
+void GlState::BindFramebuffer(unsigned int framebuffer) {
+  if (Changed(framebuffer != framebuffer_)) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    framebuffer_ = framebuffer;
+  }
+}
+
+void GlState::UseProgram(unsigned int program) {
+  if (Changed(program != program_)) {
+    glUseProgram(program);
+    program_ = program;
+  }
+}
+
+void GlState::BindVertexArray(unsigned int vertex_array) {
+  if (Changed(vertex_array != vertex_array_)) {
+    glBindVertexArray(vertex_array);
+    vertex_array_ = vertex_array;
+  }
+}
+
+void GlState::BindArrayBuffer(unsigned int buffer) {
+  if (Changed(buffer != array_buffer_)) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    array_buffer_ = buffer;
+  }
+}
+
+void GlState::BindTexture2D(int unit, unsigned int texture) {
+  if (Changed(unit != active_texture_unit_)) {
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+    active_texture_unit_ = unit;
+  }
+
+  // Bindings of units beyond the cached ones are always issued.
+  const bool cached = unit < kTextureUnitCount;
+  if (Changed(!cached || texture != textures_[unit])) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (cached) {
+      textures_[unit] = texture;
+    }
+  }
+}
+
+void GlState::BindTextureBuffer(int unit, unsigned int texture) {
+  if (Changed(unit != active_texture_unit_)) {
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+    active_texture_unit_ = unit;
+  }
+
+  const bool cached = unit < kTextureUnitCount;
+  if (Changed(!cached || texture != buffer_textures_[unit])) {
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    if (cached) {
+      buffer_textures_[unit] = texture;
+    }
+  }
+}
+
+void GlState::SetBlend(bool enable) {
+  SetCapability(GL_BLEND, enable, &blend_);
+}
+
+void GlState::SetBlendFunc(unsigned int src_factor, unsigned int dst_factor) {
+  SetBlendFuncSeparate(src_factor, dst_factor, src_factor, dst_factor);
+}
+
+void GlState::SetBlendFuncSeparate(unsigned int src_rgb,
+                                   unsigned int dst_rgb,
+                                   unsigned int src_alpha,
+                                   unsigned int dst_alpha) {
+  if (Changed(src_rgb != blend_src_ || dst_rgb != blend_dst_ ||
+              src_alpha != blend_src_alpha_ || dst_alpha != blend_dst_alpha_)) {
+    glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+    blend_src_ = src_rgb;
+    blend_dst_ = dst_rgb;
+    blend_src_alpha_ = src_alpha;
+    blend_dst_alpha_ = dst_alpha;
+  }
+}
+
+void GlState::SetBlendEquation(unsigned int mode) {
+  if (Changed(mode != blend_equation_)) {
+    glBlendEquation(mode);
+    blend_equation_ = mode;
+  }
+}
+
+void GlState::SetCullFace(bool enable) {
+  SetCapability(GL_CULL_FACE, enable, &cull_face_);
+}
+
+void GlState::SetDepthTest(bool enable) {
+  SetCapability(GL_DEPTH_TEST, enable, &depth_test_);
+}
+
+void GlState::SetDepthFunc(unsigned int func) {
+  if (Changed(func != depth_func_)) {
+    glDepthFunc(func);
+    depth_func_ = func;
+  }
+}
+
+void GlState::SetScissorTest(bool enable) {
+  SetCapability(GL_SCISSOR_TEST, enable, &scissor_test_);
+}
+
+void GlState::SetScissor(int x, int y, int width, int height) {
+  if (Changed(!SameRect(scissor_, x, y, width, height))) {
+    glScissor(x, y, width, height);
+    SetRect(scissor_, x, y, width, height);
+  }
+}
+
+void GlState::SetViewport(int x, int y, int width, int height) {
+  if (Changed(!SameRect(viewport_, x, y, width, height))) {
+    glViewport(x, y, width, height);
+    SetRect(viewport_, x, y, width, height);
+  }
+}
+
+void GlState::SetClearColor(float r, float g, float b, float a) {
+  if (Changed(!(r == clear_color_[0] && g == clear_color_[1] &&
+                b == clear_color_[2] && a == clear_color_[3]))) {
+    glClearColor(r, g, b, a);
+    clear_color_[0] = r;
+    clear_color_[1] = g;
+    clear_color_[2] = b;
+    clear_color_[3] = a;
+  }
+}
+
+void GlState::Clear(unsigned int mask) {
+  glClear(mask);
+  ++stats_.calls;
+}
+
+void GlState::DeleteVertexArray(unsigned int vertex_array) {
+  glDeleteVertexArrays(1, &vertex_array);
+  ++stats_.calls;
+
+  // Deleting a bound vertex array object reverts the binding to zero.
+  if (vertex_array == vertex_array_) {
+    vertex_array_ = 0;
+  }
+}
+
+void GlState::DeleteFramebuffer(unsigned int framebuffer) {
+  glDeleteFramebuffers(1, &framebuffer);
+  ++stats_.calls;
+
+  // Deleting a bound framebuffer reverts the binding to the default one.
+  if (framebuffer == framebuffer_) {
+    framebuffer_ = 0;
+  }
+}
+
+void GlState::DeleteBuffer(unsigned int buffer) {
+  glDeleteBuffers(1, &buffer);
+  ++stats_.calls;
+
+  // Deleting a bound buffer reverts the binding to zero.
+  if (buffer == array_buffer_) {
+    array_buffer_ = 0;
+  }
+}
+
+void GlState::DeleteTexture(unsigned int texture) {
+  glDeleteTextures(1, &texture);
+  ++stats_.calls;
+
+  // Deleting a bound texture reverts the binding to zero.
+  for (int unit = 0; unit < kTextureUnitCount; ++unit) {
+    if (textures_[unit] == texture) {
+      textures_[unit] = 0;
+    }
+    if (buffer_textures_[unit] == texture) {
+      buffer_textures_[unit] = 0;
+    }
+  }
+}
+
+void GlState::SetCapability(unsigned int capability,
+                            bool enable,
+                            Toggle* current) {
+  const Toggle wanted = enable ? Toggle::kEnabled : Toggle::kDisabled;
+  if (Changed(wanted != *current)) {
+    if (enable) {
+      glEnable(capability);
+    } else {
+      glDisable(capability);
+    }
+    *current = wanted;
+  }
+}
+
+}  // namespace gfx
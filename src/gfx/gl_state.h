@@ -0,0 +1,189 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef GFX_GL_STATE_H_
+#define GFX_GL_STATE_H_
+
+#include <cstddef>
+
+namespace gfx {
+
+/// @brief A shadow copy of the OpenGL state of a context.
+///
+/// All state changes of a context should go through its GlState object, which
+/// only issues the GL calls that actually change something. Since the state is
+/// never queried (glGet* calls can stall the pipeline), renderers set all the
+/// state that they depend on before drawing, instead of saving and restoring
+/// the state around their passes.
+///
+/// The state starts out as unknown, so the first change of every piece of
+/// state is always issued. Code that changes the state behind the back of the
+/// cache (e.g. third party code) must call Invalidate() afterwards.
+///
+/// The element array buffer binding is not tracked, since it is part of the
+/// vertex array object state.
+class GlState {
+ public:
+  /// @brief GL call counters.
+  struct Stats {
+    /// The number of GL calls that were issued.
+    size_t calls = 0;
+
+    /// The number of redundant state changes that were filtered out.
+    size_t filtered = 0;
+
+    /// The number of draw calls (included in calls).
+    size_t draws = 0;
+  };
+
+  GlState();
+
+  /// @brief Forget the cached state, so that all state is set again.
+  void Invalidate();
+
+  /// @brief Start a new frame.
+  ///
+  /// The counters of the current frame are moved to last_frame_stats().
+  void BeginFrame();
+
+  /// @brief Bind a framebuffer for both drawing and reading.
+  void BindFramebuffer(unsigned int framebuffer);
+
+  void UseProgram(unsigned int program);
+  void BindVertexArray(unsigned int vertex_array);
+  void BindArrayBuffer(unsigned int buffer);
+
+  /// @brief Bind a 2D texture to a texture unit.
+  ///
+  /// This also makes the unit the active texture unit.
+  void BindTexture2D(int unit, unsigned int texture);
+
+  /// @brief Bind a buffer texture to a texture unit.
+  ///
+  /// This also makes the unit the active texture unit.
+  void BindTextureBuffer(int unit, unsigned int texture);
+
+  void SetBlend(bool enable);
+  void SetBlendFunc(unsigned int src_factor, unsigned int dst_factor);
+  void SetBlendFuncSeparate(unsigned int src_rgb,
+                            unsigned int dst_rgb,
+                            unsigned int src_alpha,
+                            unsigned int dst_alpha);
+  void SetBlendEquation(unsigned int mode);
+  void SetCullFace(bool enable);
+  void SetDepthTest(bool enable);
+  void SetDepthFunc(unsigned int func);
+  void SetScissorTest(bool enable);
+  void SetScissor(int x, int y, int width, int height);
+  void SetViewport(int x, int y, int width, int height);
+  void SetClearColor(float r, float g, float b, float a);
+
+  /// @brief Clear buffers of the current framebuffer.
+  /// @note The scissor test applies to the clear.
+  void Clear(unsigned int mask);
+
+  /// @brief Delete a vertex array object, and forget it if it is bound.
+  void DeleteVertexArray(unsigned int vertex_array);
+
+  /// @brief Delete a framebuffer object, and forget it if it is bound.
+  void DeleteFramebuffer(unsigned int framebuffer);
+
+  /// @brief Delete a buffer object, and forget it if it is bound.
+  void DeleteBuffer(unsigned int buffer);
+
+  /// @brief Delete a texture, and forget it if it is bound.
+  void DeleteTexture(unsigned int texture);
+
+  /// @brief Count GL calls that are issued directly (e.g. uniform updates and
+  /// buffer uploads).
+  void CountCalls(size_t count) { stats_.calls += count; }
+
+  /// @brief Count a draw call that is issued directly.
+  void CountDraw() {
+    ++stats_.calls;
+    ++stats_.draws;
+  }
+
+  /// @returns the counters of the current frame (so far).
+  const Stats& stats() const { return stats_; }
+
+  /// @returns the counters of the previous frame.
+  const Stats& last_frame_stats() const { return last_frame_stats_; }
+
+ private:
+  static const int kTextureUnitCount = 8;
+
+  // Enable states are tri-state, since they start out as unknown.
+  enum class Toggle { kUnknown, kDisabled, kEnabled };
+
+  void SetCapability(unsigned int capability, bool enable, Toggle* current);
+
+  // Count a state change. Returns true if the change must be issued.
+  bool Changed(bool changed) {
+    if (changed) {
+      ++stats_.calls;
+    } else {
+      ++stats_.filtered;
+    }
+    return changed;
+  }
+
+  unsigned int framebuffer_;
+  unsigned int program_;
+  unsigned int vertex_array_;
+  unsigned int array_buffer_;
+  int active_texture_unit_;
+  unsigned int textures_[kTextureUnitCount];
+  unsigned int buffer_textures_[kTextureUnitCount];
+
+  Toggle blend_;
+  Toggle cull_face_;
+  Toggle depth_test_;
+  Toggle scissor_test_;
+  unsigned int blend_src_;
+  unsigned int blend_dst_;
+  unsigned int blend_src_alpha_;
+  unsigned int blend_dst_alpha_;
+  unsigned int blend_equation_;
+  unsigned int depth_func_;
+  int scissor_[4];
+  int viewport_[4];
+  float clear_color_[4];
+
+  Stats stats_;
+  Stats last_frame_stats_;
+
+  // Disable copy/move.
+  GlState(const GlState&) = delete;
+  GlState(GlState&&) = delete;
+  GlState& operator=(const GlState&) = delete;
+};
+
+}  // namespace gfx
+
+#endif  // GFX_GL_STATE_H_
@@ -0,0 +1,298 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "gfx/gpu_mesh.h"
+
+#include <cstdint>
+
+#include "GL/gl3w.h"
+
+#include "base/hash.h"
+
+namespace gfx {
+
+namespace {
+
+GLenum ToGlType(DataType type) {
+  switch (type) {
+    case DataType::kInt8:
+      return GL_BYTE;
+    case DataType::kUInt8:
+      return GL_UNSIGNED_BYTE;
+    case DataType::kInt16:
+      return GL_SHORT;
+    case DataType::kUInt16:
+      return GL_UNSIGNED_SHORT;
+    case DataType::kUInt32:
+      return GL_UNSIGNED_INT;
+    case DataType::kFloat32:
+      return GL_FLOAT;
+    case DataType::kFloat16:
+      return GL_HALF_FLOAT;
+    case DataType::kInt10_10_10_2:
+      return GL_INT_2_10_10_10_REV;
+  }
+  return GL_FLOAT;
+}
+
+const void* ToOffset(size_t offset) {
+  return reinterpret_cast<const void*>(static_cast<uintptr_t>(offset));
+}
+
+}  // namespace
+
+void DrawBatch::Add(size_t count, size_t offset, int base_vertex) {
+  counts_.push_back(static_cast<int>(count));
+  offsets_.push_back(ToOffset(offset));
+  base_vertices_.push_back(base_vertex);
+}
+
+void DrawBatch::Clear() {
+  counts_.clear();
+  offsets_.clear();
+  base_vertices_.clear();
+}
+
+GpuMesh::GpuMesh(const std::vector<unsigned int>& buffers,
+                 const Accessor& positions,
+                 const Accessor& normals,
+                 const Accessor& tex_coords,
+                 const Accessor& indices)
+    : vertex_array_(std::make_shared<unsigned int>(0)) {
+  const Accessor* accessors[3];
+  accessors[kPositionLocation] = &positions;
+  accessors[kNormalLocation] = &normals;
+  accessors[kTexCoordLocation] = &tex_coords;
+  for (int i = 0; i < 3; ++i) {
+    attributes_[i].accessor = *accessors[i];
+    if (accessors[i]->valid()) {
+      attributes_[i].buffer =
+          buffers[static_cast<size_t>(accessors[i]->buffer)];
+    }
+  }
+
+  // Rebase the attributes on the vertex that the positions start at, unless
+  // an attribute starts before that vertex (e.g. for separate attribute
+  // arrays in a single buffer).
+  size_t base_vertex = positions.offset / positions.byte_stride();
+  for (const auto& attribute : attributes_) {
+    const Accessor& accessor = attribute.accessor;
+    if (accessor.valid() &&
+        accessor.offset < base_vertex * accessor.byte_stride()) {
+      base_vertex = 0;
+    }
+  }
+  for (auto& attribute : attributes_) {
+    if (attribute.accessor.valid()) {
+      attribute.accessor.offset -=
+          base_vertex * attribute.accessor.byte_stride();
+    }
+  }
+  base_vertex_ = static_cast<int>(base_vertex);
+
+  if (indices.valid()) {
+    index_buffer_ = buffers[static_cast<size_t>(indices.buffer)];
+    index_type_ = ToGlType(indices.type);
+    index_size_ = indices.element_size();
+    lods_.push_back(Lod{indices.offset, indices.count, 0.0f});
+  } else {
+    lods_.push_back(Lod{0, positions.count, 0.0f});
+  }
+}
+
+void GpuMesh::AddLod(const Accessor& indices, float error) {
+  lods_.push_back(Lod{indices.offset, indices.count, error});
+}
+
+void GpuMesh::SetMeshlets(const std::vector<Meshlet>& meshlets) {
+  for (const auto& meshlet : meshlets) {
+    meshlets_.Add(meshlet);
+  }
+}
+
+uint64_t GpuMesh::GetLayoutHash() const {
+  uint64_t hash = base::HashCombine(index_buffer_, index_type_);
+  for (const auto& attribute : attributes_) {
+    const Accessor& accessor = attribute.accessor;
+    hash = base::HashCombine(hash, attribute.buffer);
+    hash = base::HashCombine(hash, accessor.offset);
+    hash = base::HashCombine(hash, accessor.byte_stride());
+    hash = base::HashCombine(hash, static_cast<uint64_t>(accessor.type));
+  }
+  return hash;
+}
+
+bool GpuMesh::HasSameLayout(const GpuMesh& other) const {
+  if (index_buffer_ != other.index_buffer_ ||
+      index_type_ != other.index_type_) {
+    return false;
+  }
+  for (int i = 0; i < 3; ++i) {
+    const Accessor& a = attributes_[i].accessor;
+    const Accessor& b = other.attributes_[i].accessor;
+    if (a.valid() != b.valid()) {
+      return false;
+    }
+    if (a.valid() &&
+        (attributes_[i].buffer != other.attributes_[i].buffer ||
+         a.offset != b.offset || a.byte_stride() != b.byte_stride() ||
+         a.components != b.components || a.type != b.type ||
+         a.normalized != b.normalized)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void GpuMesh::ShareVertexArray(const GpuMesh& other) {
+  vertex_array_ = other.vertex_array_;
+}
+
+void GpuMesh::AddToBatch(size_t lod, DrawBatch* batch) const {
+  const Lod& range = lods_[lod];
+  batch->Add(range.element_count, range.index_offset, base_vertex_);
+}
+
+size_t GpuMesh::AddMeshletsToBatch(const uint8_t* visible,
+                                   DrawBatch* batch) const {
+  const size_t base_offset = lods_[0].index_offset;
+  size_t element_count = 0;
+  bool extend = false;
+  for (size_t i = 0; i < meshlets_.size(); ++i) {
+    if (!visible[i]) {
+      extend = false;
+      continue;
+    }
+    const size_t count = meshlets_.index_count(i);
+    if (extend) {
+      batch->counts_.back() += static_cast<int>(count);
+    } else {
+      batch->Add(count, base_offset + meshlets_.first_index(i) * index_size_,
+                 base_vertex_);
+    }
+    element_count += count;
+    extend = true;
+  }
+  return element_count / 3;
+}
+
+void GpuMesh::SubmitBatch(GlState* state, DrawBatch* batch) {
+  if (batch->empty()) {
+    return;
+  }
+  BindVertexArray(state);
+  if (batch->size() == 1) {
+    glDrawElementsBaseVertex(GL_TRIANGLES, batch->counts_[0], index_type_,
+                             batch->offsets_[0], batch->base_vertices_[0]);
+  } else {
+    glMultiDrawElementsBaseVertex(
+        GL_TRIANGLES, batch->counts_.data(), index_type_,
+        batch->offsets_.data(), static_cast<GLsizei>(batch->size()),
+        batch->base_vertices_.data());
+  }
+  state->CountDraw();
+  batch->Clear();
+}
+
+void GpuMesh::Draw(GlState* state, size_t lod) {
+  BindVertexArray(state);
+  const Lod& range = lods_[lod];
+  if (index_buffer_ != 0) {
+    glDrawElementsBaseVertex(
+        GL_TRIANGLES, static_cast<GLsizei>(range.element_count), index_type_,
+        ToOffset(range.index_offset), base_vertex_);
+  } else {
+    glDrawArrays(GL_TRIANGLES, base_vertex_,
+                 static_cast<GLsizei>(range.element_count));
+  }
+  state->CountDraw();
+}
+
+void GpuMesh::DrawInstanced(GlState* state,
+                            size_t lod,
+                            size_t instance_count) {
+  BindVertexArray(state);
+  const Lod& range = lods_[lod];
+  const auto count = static_cast<GLsizei>(instance_count);
+  if (index_buffer_ != 0) {
+    glDrawElementsInstancedBaseVertex(
+        GL_TRIANGLES, static_cast<GLsizei>(range.element_count), index_type_,
+        ToOffset(range.index_offset), count, base_vertex_);
+  } else {
+    glDrawArraysInstanced(GL_TRIANGLES, base_vertex_,
+                          static_cast<GLsizei>(range.element_count), count);
+  }
+  state->CountDraw();
+}
+
+void GpuMesh::Delete(GlState* state) {
+  if (*vertex_array_ != 0) {
+    state->DeleteVertexArray(*vertex_array_);
+    *vertex_array_ = 0;
+  }
+}
+
+void GpuMesh::BindVertexArray(GlState* state) {
+  if (*vertex_array_ == 0) {
+    CreateVertexArray(state);
+  } else {
+    state->BindVertexArray(*vertex_array_);
+  }
+}
+
+void GpuMesh::CreateVertexArray(GlState* state) {
+  glGenVertexArrays(1, vertex_array_.get());
+  state->BindVertexArray(*vertex_array_);
+
+  for (int i = 0; i < 3; ++i) {
+    const auto location = static_cast<GLuint>(i);
+    const Accessor& accessor = attributes_[i].accessor;
+    if (!accessor.valid()) {
+      glDisableVertexAttribArray(location);
+      continue;
+    }
+    state->BindArrayBuffer(attributes_[i].buffer);
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, accessor.components,
+                          ToGlType(accessor.type),
+                          accessor.normalized ? GL_TRUE : GL_FALSE,
+                          static_cast<GLsizei>(accessor.stride),
+                          ToOffset(accessor.offset));
+  }
+
+  // The element array buffer binding is part of the vertex array state.
+  if (index_buffer_ != 0) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+  }
+
+  // Do not leave a scene buffer bound, since the buffers are deleted from
+  // another context.
+  state->BindArrayBuffer(0);
+}
+
+}  // namespace gfx
@@ -0,0 +1,228 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef GFX_GPU_MESH_H_
+#define GFX_GPU_MESH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "gfx/accessor.h"
+#include "gfx/gl_state.h"
+#include "gfx/meshlet.h"
+
+namespace gfx {
+
+/// @brief Vertex attribute locations used by GpuMesh.
+///
+/// Shaders that draw meshes must bind their attributes to these locations
+/// (e.g. with layout qualifiers or glBindAttribLocation()).
+enum AttributeLocation {
+  kPositionLocation = 0,
+  kNormalLocation = 1,
+  kTexCoordLocation = 2
+};
+
+/// @brief A list of index ranges that are drawn with a single
+/// glMultiDrawElementsBaseVertex() call (see GpuMesh::SubmitBatch()).
+class DrawBatch {
+ public:
+  DrawBatch() = default;
+
+  /// @brief Add an index range.
+  /// @param count The number of indices.
+  /// @param offset The byte offset of the first index in the index buffer.
+  /// @param base_vertex The value that is added to each index.
+  void Add(size_t count, size_t offset, int base_vertex);
+
+  bool empty() const { return counts_.empty(); }
+  size_t size() const { return counts_.size(); }
+
+  /// @brief Remove all ranges.
+  void Clear();
+
+ private:
+  friend class GpuMesh;
+
+  std::vector<int> counts_;
+  std::vector<const void*> offsets_;
+  std::vector<int> base_vertices_;
+
+  // Disable copy/move.
+  DrawBatch(const DrawBatch&) = delete;
+  DrawBatch(DrawBatch&&) = delete;
+  DrawBatch& operator=(const DrawBatch&) = delete;
+};
+
+/// @brief A drawable mesh that refers to vertex data in OpenGL buffers.
+///
+/// The mesh does not own any buffers. Several meshes may share the same
+/// buffers, e.g. when the vertex data of a whole scene is stored in a few large
+/// buffers.
+///
+/// Buffers are shared between OpenGL contexts, but vertex array objects are
+/// not. Thus the vertex array object is created lazily the first time the mesh
+/// is drawn, so that the buffers can be uploaded from a different context than
+/// the one that draws the mesh.
+///
+/// The vertex array object refers to the vertex data relative to a base
+/// vertex, which is passed to the draw calls instead. Meshes whose vertices
+/// have the same format and are stored in the same buffers thus have the same
+/// vertex array state, and can share a vertex array object (see
+/// ShareVertexArray()) and be drawn together (see SubmitBatch()).
+class GpuMesh {
+ public:
+  /// @brief Constructor.
+  /// @param buffers The OpenGL buffer names, indexed by accessor buffer index.
+  /// @param positions The vertex positions.
+  /// @param normals The vertex normals (may be invalid).
+  /// @param tex_coords The texture coordinates (may be invalid).
+  /// @param indices The triangle indices (invalid for non-indexed meshes).
+  GpuMesh(const std::vector<unsigned int>& buffers,
+          const Accessor& positions,
+          const Accessor& normals,
+          const Accessor& tex_coords,
+          const Accessor& indices);
+
+  /// @brief Add a level of detail.
+  /// @param indices The triangle indices of the level. They must be stored in
+  /// the same buffer, and with the same type, as the indices of the mesh.
+  /// @param error The geometric error of the level.
+  void AddLod(const Accessor& indices, float error);
+
+  /// @brief Set the meshlets of the full detail mesh.
+  /// @param meshlets The meshlets (see BuildMeshlets()).
+  void SetMeshlets(const std::vector<Meshlet>& meshlets);
+
+  /// @returns a hash of the vertex array state (equal for meshes with the
+  /// same layout).
+  uint64_t GetLayoutHash() const;
+
+  /// @returns true if this mesh has the same vertex array state as another
+  /// mesh, i.e. if they can share a vertex array object.
+  bool HasSameLayout(const GpuMesh& other) const;
+
+  /// @brief Use the vertex array object of another mesh.
+  /// @param other A mesh with the same layout (see HasSameLayout()).
+  /// @note Call this before either mesh is drawn.
+  void ShareVertexArray(const GpuMesh& other);
+
+  /// @brief Add the index range of a level of detail to a draw batch.
+  /// @param lod The level of detail (0 is the full mesh, see AddLod()).
+  /// @param batch The batch.
+  /// @note Only for indexed meshes.
+  void AddToBatch(size_t lod, DrawBatch* batch) const;
+
+  /// @brief Add the visible meshlets of the full detail mesh to a draw batch.
+  ///
+  /// Consecutive visible meshlets are merged into a single range.
+  /// @param visible One for each visible meshlet (see MeshletSet::Cull()).
+  /// @param batch The batch.
+  /// @returns the number of triangles added.
+  size_t AddMeshletsToBatch(const uint8_t* visible, DrawBatch* batch) const;
+
+  /// @brief Draw and clear a batch of index ranges.
+  ///
+  /// This binds the vertex array object of the mesh (leaving it bound). The
+  /// ranges may come from any mesh with the same layout as this one.
+  /// @param state The state of the current context.
+  /// @param batch The batch.
+  void SubmitBatch(GlState* state, DrawBatch* batch);
+
+  /// @brief Draw the mesh.
+  ///
+  /// This binds the vertex array object of the mesh (leaving it bound).
+  /// @param state The state of the current context.
+  /// @param lod The level of detail (0 is the full mesh, see AddLod()).
+  void Draw(GlState* state, size_t lod = 0);
+
+  /// @brief Draw several instances of the mesh with one draw call.
+  ///
+  /// The shader tells the instances apart by gl_InstanceID. This binds the
+  /// vertex array object of the mesh (leaving it bound).
+  /// @param state The state of the current context.
+  /// @param lod The level of detail (0 is the full mesh, see AddLod()).
+  /// @param instance_count The number of instances.
+  void DrawInstanced(GlState* state, size_t lod, size_t instance_count);
+
+  /// @brief Delete the vertex array object.
+  /// @param state The state of the context that drew the mesh.
+  /// @note This must be called with the context that drew the mesh current.
+  /// A shared vertex array object is deleted once.
+  void Delete(GlState* state);
+
+  bool indexed() const { return index_buffer_ != 0; }
+
+  size_t triangle_count(size_t lod = 0) const {
+    return lods_[lod].element_count / 3;
+  }
+
+  /// The number of levels of detail, including the full mesh.
+  size_t lod_count() const { return lods_.size(); }
+
+  float lod_error(size_t lod) const { return lods_[lod].error; }
+
+  const MeshletSet& meshlets() const { return meshlets_; }
+
+ private:
+  struct Attribute {
+    Accessor accessor;
+    unsigned int buffer = 0;
+  };
+
+  struct Lod {
+    size_t index_offset;
+    size_t element_count;
+    float error;
+  };
+
+  void CreateVertexArray(GlState* state);
+  void BindVertexArray(GlState* state);
+
+  // The attribute offsets are relative to the base vertex.
+  Attribute attributes_[3];
+  int base_vertex_ = 0;
+  unsigned int index_buffer_ = 0;
+  unsigned int index_type_ = 0;
+  size_t index_size_ = 0;
+
+  // The index ranges of the levels of detail (the first is the full mesh).
+  std::vector<Lod> lods_;
+
+  MeshletSet meshlets_;
+
+  // The vertex array object name (zero until it is created), which is shared
+  // by the meshes that share the vertex array object.
+  std::shared_ptr<unsigned int> vertex_array_;
+};
+
+}  // namespace gfx
+
+#endif  // GFX_GPU_MESH_H_
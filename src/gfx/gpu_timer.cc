@@ -0,0 +1,242 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "gfx/gpu_timer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "GL/gl3w.h"
+
+#include "base/error.h"
+
+namespace gfx {
+
+namespace {
+
+// The number of frames that may be in flight before their results are read.
+const size_t kQuerySetCount = 4;
+
+// The number of measured frames to keep (for CSV output), and the number of
+// recent frames that the statistics are based on.
+const size_t kHistorySize = 1000;
+const size_t kStatsFrameCount = 120;
+
+bool IsTimerQuerySupported() {
+  if (glQueryCounter == nullptr || glGetQueryObjectui64v == nullptr) {
+    return false;
+  }
+  if (gl3wIsSupported(3, 3) != 0) {
+    return true;
+  }
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    const auto* extension = reinterpret_cast<const char*>(
+        glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+    if (extension != nullptr &&
+        std::strcmp(extension, "GL_ARB_timer_query") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+GpuTimer::GpuTimer() : supported_(IsTimerQuerySupported()) {
+  sets_.resize(kQuerySetCount);
+}
+
+GpuTimer::~GpuTimer() {
+  for (auto& set : sets_) {
+    if (!set.pool.empty()) {
+      glDeleteQueries(static_cast<GLsizei>(set.pool.size()), set.pool.data());
+    }
+  }
+}
+
+void GpuTimer::BeginFrame() {
+  if (!supported_) {
+    return;
+  }
+
+  // Passes that are still open are never ended.
+  open_passes_.clear();
+  sets_[current_set_].pending = !sets_[current_set_].passes.empty();
+
+  // Read back the finished frames, oldest first. The GPU finishes the frames
+  // in order, so there is no point in looking further than the first frame
+  // that is not finished.
+  for (size_t i = 1; i <= sets_.size(); ++i) {
+    auto& set = sets_[(current_set_ + i) % sets_.size()];
+    if (set.pending && !ReadResults(&set)) {
+      break;
+    }
+  }
+
+  // Reuse the oldest query set. If the GPU is still not done with it, its
+  // results are dropped rather than waited for.
+  current_set_ = (current_set_ + 1) % sets_.size();
+  auto& set = sets_[current_set_];
+  if (set.pending) {
+    ++dropped_frames_;
+    set.pending = false;
+  }
+  set.frame = ++frame_;
+  set.passes.clear();
+  set.used_queries = 0;
+}
+
+void GpuTimer::BeginPass(const char* name) {
+  if (!supported_) {
+    return;
+  }
+
+  size_t pass = 0;
+  while (pass < pass_names_.size() &&
+         std::strcmp(pass_names_[pass], name) != 0) {
+    ++pass;
+  }
+  if (pass == pass_names_.size()) {
+    pass_names_.push_back(name);
+  }
+
+  const unsigned int query = NewQuery();
+  glQueryCounter(query, GL_TIMESTAMP);
+  auto& passes = sets_[current_set_].passes;
+  passes.push_back(Pass{pass, query, 0});
+  open_passes_.push_back(passes.size() - 1);
+}
+
+void GpuTimer::EndPass() {
+  if (!supported_ || open_passes_.empty()) {
+    return;
+  }
+  const unsigned int query = NewQuery();
+  glQueryCounter(query, GL_TIMESTAMP);
+  sets_[current_set_].passes[open_passes_.back()].end_query = query;
+  open_passes_.pop_back();
+}
+
+void GpuTimer::WriteCsv(const std::string& path) const {
+  std::ofstream out(path);
+  if (!out.good()) {
+    throw base::Error("Unable to create " + path);
+  }
+  out << "frame";
+  for (const auto* name : pass_names_) {
+    out << "," << name;
+  }
+  out << "\n";
+  for (const auto& times : history_) {
+    out << times.frame;
+    for (size_t pass = 0; pass < pass_names_.size(); ++pass) {
+      out << ",";
+      if (pass < times.pass_ms.size() && times.pass_ms[pass] >= 0.0f) {
+        out << times.pass_ms[pass];
+      }
+    }
+    out << "\n";
+  }
+  if (!out.good()) {
+    throw base::Error("Unable to write " + path);
+  }
+}
+
+bool GpuTimer::ReadResults(QuerySet* set) {
+  // The queries complete in the order that they were issued.
+  GLint available = 0;
+  glGetQueryObjectiv(set->pool[set->used_queries - 1],
+                     GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available == 0) {
+    return false;
+  }
+
+  FrameTimes times;
+  times.frame = set->frame;
+  times.pass_ms.assign(pass_names_.size(), -1.0f);
+  for (const auto& pass : set->passes) {
+    if (pass.end_query == 0) {
+      continue;
+    }
+    GLuint64 begin = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v(pass.begin_query, GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(pass.end_query, GL_QUERY_RESULT, &end);
+    float& ms = times.pass_ms[pass.pass];
+    ms = std::max(ms, 0.0f) + static_cast<float>(end - begin) * 1e-6f;
+  }
+  history_.push_back(std::move(times));
+  while (history_.size() > kHistorySize) {
+    history_.pop_front();
+  }
+  set->pending = false;
+
+  UpdateStats();
+  return true;
+}
+
+unsigned int GpuTimer::NewQuery() {
+  auto& set = sets_[current_set_];
+  if (set.used_queries == set.pool.size()) {
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    set.pool.push_back(query);
+  }
+  return set.pool[set.used_queries++];
+}
+
+void GpuTimer::UpdateStats() {
+  stats_.resize(pass_names_.size());
+  const size_t first =
+      history_.size() - std::min(history_.size(), kStatsFrameCount);
+  for (size_t pass = 0; pass < pass_names_.size(); ++pass) {
+    PassStats& stats = stats_[pass];
+    stats.name = pass_names_[pass];
+    stats.last_ms = 0.0f;
+    stats.average_ms = 0.0f;
+    stats.max_ms = 0.0f;
+    int count = 0;
+    for (size_t i = first; i < history_.size(); ++i) {
+      const auto& pass_ms = history_[i].pass_ms;
+      if (pass < pass_ms.size() && pass_ms[pass] >= 0.0f) {
+        stats.last_ms = pass_ms[pass];
+        stats.average_ms += pass_ms[pass];
+        stats.max_ms = std::max(stats.max_ms, pass_ms[pass]);
+        ++count;
+      }
+    }
+    if (count > 0) {
+      stats.average_ms /= static_cast<float>(count);
+    }
+  }
+}
+
+}  // namespace gfx
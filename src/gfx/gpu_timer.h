@@ -0,0 +1,172 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef GFX_GPU_TIMER_H_
+#define GFX_GPU_TIMER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace gfx {
+
+/// @brief Measures the GPU time of render passes with timestamp queries.
+///
+/// Each pass is bracketed by two GL_TIMESTAMP queries (so passes may nest).
+/// The queries of a frame are read back a few frames later, from a ring of
+/// query sets, and only once the GPU reports that they are available, so the
+/// timer never stalls the pipeline. Frames whose results are still not
+/// available when their query set is needed again are dropped.
+///
+/// Timer queries need OpenGL 3.3 or ARB_timer_query. On other contexts the
+/// timer does nothing.
+class GpuTimer {
+ public:
+  /// @brief Rolling statistics for a pass.
+  struct PassStats {
+    const char* name;
+
+    /// The GPU time of the most recent measured frame, in milliseconds.
+    float last_ms;
+
+    /// The average and maximum GPU time over the recent frames.
+    float average_ms;
+    float max_ms;
+  };
+
+  /// @brief Records the time of a pass during the lifetime of the scope.
+  class Scope {
+   public:
+    Scope(GpuTimer* timer, const char* name) : timer_(timer) {
+      timer_->BeginPass(name);
+    }
+    ~Scope() { timer_->EndPass(); }
+
+   private:
+    GpuTimer* timer_;
+
+    // Disable copy/move.
+    Scope(const Scope&) = delete;
+    Scope(Scope&&) = delete;
+    Scope& operator=(const Scope&) = delete;
+  };
+
+  /// @brief Create the timer.
+  /// @note The OpenGL context that will be timed must be current.
+  GpuTimer();
+
+  /// @brief Delete the queries.
+  /// @note The OpenGL context that was timed must be current.
+  ~GpuTimer();
+
+  /// @returns true if the context supports timer queries.
+  bool supported() const { return supported_; }
+
+  /// @brief Start a new frame.
+  ///
+  /// This reads back the results of earlier frames that the GPU has finished.
+  void BeginFrame();
+
+  /// @brief Begin a pass.
+  /// @param name The pass name. It must have static storage duration (e.g. a
+  /// string literal).
+  void BeginPass(const char* name);
+
+  /// @brief End the most recently begun pass.
+  void EndPass();
+
+  /// @returns the statistics of each pass that has been measured.
+  const std::vector<PassStats>& stats() const { return stats_; }
+
+  /// @returns the number of frames that were dropped since their results were
+  /// not available in time.
+  uint64_t dropped_frames() const { return dropped_frames_; }
+
+  /// @brief Write the measured frames as CSV.
+  ///
+  /// The first column is the frame number, followed by the GPU time of each
+  /// pass in milliseconds (empty if the pass was not drawn in the frame).
+  /// @param path The file to write.
+  /// @throws base::Error if the file can not be written.
+  void WriteCsv(const std::string& path) const;
+
+ private:
+  struct Pass {
+    size_t pass;
+    unsigned int begin_query;
+    unsigned int end_query;
+  };
+
+  struct QuerySet {
+    uint64_t frame = 0;
+    std::vector<Pass> passes;
+    std::vector<unsigned int> pool;
+    size_t used_queries = 0;
+    bool pending = false;
+  };
+
+  struct FrameTimes {
+    uint64_t frame;
+
+    // Indexed by pass, negative for passes that were not drawn.
+    std::vector<float> pass_ms;
+  };
+
+  // Read back the results of a pending query set, if they are available.
+  // @returns false if the GPU has not finished the frame yet.
+  bool ReadResults(QuerySet* set);
+
+  // Get an unused query from the current set.
+  unsigned int NewQuery();
+
+  void UpdateStats();
+
+  bool supported_ = false;
+  std::vector<QuerySet> sets_;
+  size_t current_set_ = 0;
+  uint64_t frame_ = 0;
+  uint64_t dropped_frames_ = 0;
+
+  // The open passes (indices into the current set's passes).
+  std::vector<size_t> open_passes_;
+
+  std::vector<const char*> pass_names_;
+  std::deque<FrameTimes> history_;
+  std::vector<PassStats> stats_;
+
+  // Disable copy/move.
+  GpuTimer(const GpuTimer&) = delete;
+  GpuTimer(GpuTimer&&) = delete;
+  GpuTimer& operator=(const GpuTimer&) = delete;
+};
+
+}  // namespace gfx
+
+#endif  // GFX_GPU_TIMER_H_
@@ -0,0 +1,227 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "gfx/image.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "base/error.h"
+
+namespace gfx {
+
+namespace {
+
+// The largest block of uncompressed deflate data.
+const size_t kMaxStoredBlockSize = 65535;
+
+// The largest number of bytes that can be added to the Adler-32 sums before
+// they must be reduced modulo 65521 (to not overflow 32 bits).
+const size_t kAdlerBlockSize = 5552;
+
+// CRC-32 with "slicing by 8" tables, which process eight bytes per step.
+class Crc32 {
+ public:
+  Crc32() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) != 0 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      }
+      table_[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+      for (int t = 1; t < 8; ++t) {
+        const uint32_t c = table_[t - 1][i];
+        table_[t][i] = table_[0][c & 0xff] ^ (c >> 8);
+      }
+    }
+  }
+
+  uint32_t Update(uint32_t crc, const uint8_t* data, size_t size) const {
+    crc = ~crc;
+    for (; size >= 8; size -= 8, data += 8) {
+      const uint32_t lo = crc ^ (static_cast<uint32_t>(data[0]) |
+                                 static_cast<uint32_t>(data[1]) << 8 |
+                                 static_cast<uint32_t>(data[2]) << 16 |
+                                 static_cast<uint32_t>(data[3]) << 24);
+      crc = table_[7][lo & 0xff] ^ table_[6][(lo >> 8) & 0xff] ^
+            table_[5][(lo >> 16) & 0xff] ^ table_[4][lo >> 24] ^
+            table_[3][data[4]] ^ table_[2][data[5]] ^ table_[1][data[6]] ^
+            table_[0][data[7]];
+    }
+    for (size_t i = 0; i < size; ++i) {
+      crc = table_[0][(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+  }
+
+ private:
+  uint32_t table_[8][256];
+};
+
+const Crc32& GetCrc32() {
+  static const Crc32 crc32;
+  return crc32;
+}
+
+uint32_t UpdateAdler32(uint32_t adler, const uint8_t* data, size_t size) {
+  uint32_t a = adler & 0xffff;
+  uint32_t b = adler >> 16;
+  while (size > 0) {
+    const size_t n = std::min(size, kAdlerBlockSize);
+    for (size_t i = 0; i < n; ++i) {
+      a += data[i];
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+    data += n;
+    size -= n;
+  }
+  return (b << 16) | a;
+}
+
+void AppendUint32(uint32_t x, std::vector<uint8_t>* out) {
+  out->push_back(static_cast<uint8_t>(x >> 24));
+  out->push_back(static_cast<uint8_t>(x >> 16));
+  out->push_back(static_cast<uint8_t>(x >> 8));
+  out->push_back(static_cast<uint8_t>(x));
+}
+
+// Write a PNG chunk (length, type, data and CRC).
+void WriteChunk(const char* type,
+                const std::vector<uint8_t>& data,
+                std::ofstream* file) {
+  std::vector<uint8_t> header;
+  AppendUint32(static_cast<uint32_t>(data.size()), &header);
+  header.insert(header.end(), type, type + 4);
+  uint32_t crc = GetCrc32().Update(0, header.data() + 4, 4);
+  crc = GetCrc32().Update(crc, data.data(), data.size());
+  std::vector<uint8_t> trailer;
+  AppendUint32(crc, &trailer);
+
+  file->write(reinterpret_cast<const char*>(header.data()),
+              static_cast<std::streamsize>(header.size()));
+  file->write(reinterpret_cast<const char*>(data.data()),
+              static_cast<std::streamsize>(data.size()));
+  file->write(reinterpret_cast<const char*>(trailer.data()),
+              static_cast<std::streamsize>(trailer.size()));
+}
+
+}  // namespace
+
+void Image::Resize(int width, int height) {
+  width_ = width;
+  height_ = height;
+  pixels_.resize(row_size() * static_cast<size_t>(height));
+}
+
+void Image::FlipVertically() {
+  for (int y = 0; y < height_ / 2; ++y) {
+    std::swap_ranges(row(y), row(y) + row_size(), row(height_ - 1 - y));
+  }
+}
+
+void Image::WritePng(const std::string& path) const {
+  std::ofstream file(path, std::ios::binary);
+  static const uint8_t kSignature[] = {0x89, 'P',  'N',  'G',
+                                       '\r', '\n', 0x1a, '\n'};
+  file.write(reinterpret_cast<const char*>(kSignature), sizeof(kSignature));
+
+  // Image header: size, 8 bits per channel, RGBA, no interlacing.
+  std::vector<uint8_t> ihdr;
+  AppendUint32(static_cast<uint32_t>(width_), &ihdr);
+  AppendUint32(static_cast<uint32_t>(height_), &ihdr);
+  ihdr.push_back(8);
+  ihdr.push_back(6);
+  ihdr.push_back(0);
+  ihdr.push_back(0);
+  ihdr.push_back(0);
+  WriteChunk("IHDR", ihdr, &file);
+
+  // The image data is a zlib stream of stored deflate blocks, holding the
+  // scanlines, each prefixed by its filter type (none). It is written in one
+  // chunk per block, so that only one block is buffered at a time.
+  const size_t total_size = (row_size() + 1) * static_cast<size_t>(height_);
+  std::vector<uint8_t> chunk;
+  chunk.reserve(kMaxStoredBlockSize + 16);
+  chunk.push_back(0x78);
+  chunk.push_back(0x01);
+  uint32_t adler = 1;
+  size_t offset = 0;
+  do {
+    const size_t size = std::min(kMaxStoredBlockSize, total_size - offset);
+    const bool last = offset + size == total_size;
+    chunk.push_back(last ? 1 : 0);
+    chunk.push_back(static_cast<uint8_t>(size));
+    chunk.push_back(static_cast<uint8_t>(size >> 8));
+    chunk.push_back(static_cast<uint8_t>(~size));
+    chunk.push_back(static_cast<uint8_t>(~size >> 8));
+
+    // Copy the part of the scanlines that the block covers.
+    const size_t data_start = chunk.size();
+    const size_t end = offset + size;
+    while (offset < end) {
+      const size_t y = offset / (row_size() + 1);
+      const size_t x = offset % (row_size() + 1);
+      if (x == 0) {
+        chunk.push_back(0);
+        ++offset;
+      } else {
+        const size_t n = std::min(end - offset, row_size() + 1 - x);
+        const uint8_t* src = row(static_cast<int>(y)) + (x - 1);
+        chunk.insert(chunk.end(), src, src + n);
+        offset += n;
+      }
+    }
+    adler = UpdateAdler32(adler, chunk.data() + data_start,
+                          chunk.size() - data_start);
+    if (last) {
+      AppendUint32(adler, &chunk);
+    }
+    WriteChunk("IDAT", chunk, &file);
+    chunk.clear();
+  } while (offset < total_size);
+
+  WriteChunk("IEND", std::vector<uint8_t>(), &file);
+  if (!file) {
+    throw base::Error("Unable to write " + path);
+  }
+}
+
+void Image::WriteRaw(const std::string& path) const {
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(pixels_.data()),
+             static_cast<std::streamsize>(pixels_.size()));
+  if (!file) {
+    throw base::Error("Unable to write " + path);
+  }
+}
+
+}  // namespace gfx
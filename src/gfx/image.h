@@ -0,0 +1,85 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef GFX_IMAGE_H_
+#define GFX_IMAGE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gfx {
+
+/// @brief An 8-bit RGBA image, stored top row first.
+class Image {
+ public:
+  Image() = default;
+
+  /// @brief Create an image with undefined contents.
+  Image(int width, int height) { Resize(width, height); }
+
+  /// @brief Change the size of the image. The contents become undefined.
+  void Resize(int width, int height);
+
+  /// @brief Reverse the row order (e.g. for pixels read from OpenGL, which
+  /// stores the bottom row first).
+  void FlipVertically();
+
+  /// @brief Write the image as a PNG file.
+  ///
+  /// The image data is not compressed (it is stored in uncompressed deflate
+  /// blocks), which makes writing fast at the cost of larger files.
+  /// @param path The file to write.
+  /// @throws base::Error if the file can not be written.
+  void WritePng(const std::string& path) const;
+
+  /// @brief Write the raw pixels (RGBA, top row first, no header).
+  /// @param path The file to write.
+  /// @throws base::Error if the file can not be written.
+  void WriteRaw(const std::string& path) const;
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  uint8_t* data() { return pixels_.data(); }
+  const uint8_t* data() const { return pixels_.data(); }
+
+  /// @returns the pixels of a row (four bytes per pixel).
+  uint8_t* row(int y) { return pixels_.data() + row_size() * y; }
+  const uint8_t* row(int y) const { return pixels_.data() + row_size() * y; }
+
+ private:
+  size_t row_size() const { return static_cast<size_t>(width_) * 4; }
+
+  int width_ = 0;
+  int height_ = 0;
+  std::vector<uint8_t> pixels_;
+};
+
+}  // namespace gfx
+
+#endif  // GFX_IMAGE_H_
@@ -0,0 +1,281 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "gfx/mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace gfx {
+
+namespace {
+
+const uint32_t kNoVertex = 0xffffffffu;
+
+uint32_t HashVertex(const Vertex& vertex) {
+  // FNV-1a over the 32-bit words of the vertex.
+  uint32_t words[sizeof(Vertex) / 4];
+  std::memcpy(words, &vertex, sizeof(words));
+  uint32_t hash = 2166136261u;
+  for (auto word : words) {
+    hash = (hash ^ word) * 16777619u;
+  }
+  return hash ^ (hash >> 15);
+}
+
+// The triangles that use each vertex, as offsets into a shared array.
+struct Adjacency {
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+
+  Adjacency(const std::vector<uint32_t>& indices, size_t vertex_count)
+      : offsets(vertex_count + 1, 0), triangles(indices.size()) {
+    for (auto index : indices) {
+      ++offsets[index + 1];
+    }
+    for (size_t v = 0; v < vertex_count; ++v) {
+      offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i) {
+      triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+  }
+};
+
+}  // namespace
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices,
+                                    size_t index_count,
+                                    size_t vertex_count) {
+  // A vertex is in the cache if it was added within the last
+  // kVertexCacheSize additions.
+  VertexCacheStats stats;
+  std::vector<size_t> added(vertex_count, 0);
+  std::vector<bool> referenced(vertex_count, false);
+  size_t time = kVertexCacheSize + 1;
+  size_t referenced_count = 0;
+  for (size_t i = 0; i < index_count; ++i) {
+    const uint32_t v = indices[i];
+    if (time - added[v] > static_cast<size_t>(kVertexCacheSize)) {
+      added[v] = time++;
+      ++stats.transformed;
+    }
+    if (!referenced[v]) {
+      referenced[v] = true;
+      ++referenced_count;
+    }
+  }
+  if (index_count >= 3) {
+    stats.acmr = static_cast<float>(stats.transformed) /
+                 static_cast<float>(index_count / 3);
+  }
+  if (referenced_count > 0) {
+    stats.atvr = static_cast<float>(stats.transformed) /
+                 static_cast<float>(referenced_count);
+  }
+  return stats;
+}
+
+void WeldVertices(Mesh* mesh) {
+  const auto& vertices = mesh->vertices;
+  size_t table_size = 16;
+  while (table_size < mesh->indices.size() * 2) {
+    table_size *= 2;
+  }
+  const size_t mask = table_size - 1;
+
+  // The table holds indices into the welded vertices (linear probing).
+  std::vector<uint32_t> table(table_size, kNoVertex);
+  std::vector<uint32_t> remap(vertices.size(), kNoVertex);
+  std::vector<Vertex> welded;
+  welded.reserve(vertices.size());
+  for (auto& index : mesh->indices) {
+    if (remap[index] == kNoVertex) {
+      const Vertex& vertex = vertices[index];
+      size_t slot = HashVertex(vertex) & mask;
+      while (table[slot] != kNoVertex &&
+             std::memcmp(&welded[table[slot]], &vertex, sizeof(Vertex)) != 0) {
+        slot = (slot + 1) & mask;
+      }
+      if (table[slot] == kNoVertex) {
+        table[slot] = static_cast<uint32_t>(welded.size());
+        welded.push_back(vertex);
+      }
+      remap[index] = table[slot];
+    }
+    index = remap[index];
+  }
+  welded.shrink_to_fit();
+  mesh->vertices.swap(welded);
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>* indices, size_t vertex_count) {
+  const size_t triangle_count = indices->size() / 3;
+  if (triangle_count == 0) {
+    return;
+  }
+  const Adjacency adjacency(*indices, vertex_count);
+
+  // The number of triangles of each vertex that have not been emitted yet,
+  // and the time that each vertex entered the (simulated) cache.
+  std::vector<uint32_t> live(vertex_count);
+  for (size_t v = 0; v < vertex_count; ++v) {
+    live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+  }
+  std::vector<size_t> cache_time(vertex_count, 0);
+  std::vector<bool> emitted(triangle_count, false);
+
+  // Vertices of the recently emitted triangles, to restart from when the
+  // fanning vertex has no good successor.
+  std::vector<uint32_t> dead_end;
+  std::vector<uint32_t> candidates;
+
+  std::vector<uint32_t> result;
+  result.reserve(indices->size());
+  size_t time = kVertexCacheSize + 1;
+  size_t cursor = 0;
+  auto fanning = static_cast<int64_t>((*indices)[0]);
+  while (fanning >= 0) {
+    // Emit all the remaining triangles around the fanning vertex.
+    const auto f = static_cast<uint32_t>(fanning);
+    candidates.clear();
+    for (uint32_t i = adjacency.offsets[f]; i < adjacency.offsets[f + 1];
+         ++i) {
+      const uint32_t triangle = adjacency.triangles[i];
+      if (emitted[triangle]) {
+        continue;
+      }
+      emitted[triangle] = true;
+      for (size_t k = 0; k < 3; ++k) {
+        const uint32_t v = (*indices)[3 * triangle + k];
+        result.push_back(v);
+        dead_end.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if (time - cache_time[v] > static_cast<size_t>(kVertexCacheSize)) {
+          cache_time[v] = time++;
+        }
+      }
+    }
+
+    // Continue with the candidate that stays in the cache the longest, as
+    // long as all its triangles can be emitted before it is evicted.
+    fanning = -1;
+    size_t best_priority = 0;
+    for (auto v : candidates) {
+      if (live[v] == 0) {
+        continue;
+      }
+      size_t priority = 1;
+      const size_t age = time - cache_time[v];
+      if (age + 2 * live[v] <= static_cast<size_t>(kVertexCacheSize)) {
+        priority = age + 1;
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        fanning = v;
+      }
+    }
+
+    // Otherwise restart from a recently used vertex, or from the next vertex
+    // (in index order) that has triangles left.
+    while (fanning < 0 && !dead_end.empty()) {
+      const uint32_t v = dead_end.back();
+      dead_end.pop_back();
+      if (live[v] > 0) {
+        fanning = v;
+      }
+    }
+    while (fanning < 0 && cursor < indices->size()) {
+      const uint32_t v = (*indices)[cursor++];
+      if (live[v] > 0) {
+        fanning = v;
+      }
+    }
+  }
+  indices->swap(result);
+}
+
+void OptimizeVertexFetch(Mesh* mesh) {
+  std::vector<uint32_t> remap(mesh->vertices.size(), kNoVertex);
+  std::vector<Vertex> vertices;
+  vertices.reserve(mesh->vertices.size());
+  for (auto& index : mesh->indices) {
+    if (remap[index] == kNoVertex) {
+      remap[index] = static_cast<uint32_t>(vertices.size());
+      vertices.push_back(mesh->vertices[index]);
+    }
+    index = remap[index];
+  }
+  mesh->vertices.swap(vertices);
+}
+
+int16_t QuantizeSnorm16(float x) {
+  const float clamped = std::min(std::max(x, -1.0f), 1.0f);
+  return static_cast<int16_t>(std::lround(clamped * 32767.0f));
+}
+
+uint32_t PackSnorm10(const float* v) {
+  uint32_t packed = 0;
+  for (int k = 0; k < 3; ++k) {
+    const float clamped = std::min(std::max(v[k], -1.0f), 1.0f);
+    const auto x = static_cast<int32_t>(std::lround(clamped * 511.0f));
+    packed |= (static_cast<uint32_t>(x) & 0x3ffu) << (10 * k);
+  }
+  return packed;
+}
+
+uint16_t FloatToHalf(float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+  const uint32_t magnitude = bits & 0x7fffffffu;
+  if (magnitude >= 0x7f800000u) {
+    // Infinity or NaN.
+    return static_cast<uint16_t>(sign | 0x7c00u |
+                                 (magnitude > 0x7f800000u ? 0x200u : 0u));
+  }
+  if (magnitude >= 0x477ff000u) {
+    // Too large: round to infinity.
+    return static_cast<uint16_t>(sign | 0x7c00u);
+  }
+  if (magnitude < 0x38800000u) {
+    // Subnormal (or zero): scale to units of 2^-24, rounding to nearest.
+    float a;
+    std::memcpy(&a, &magnitude, sizeof(a));
+    return static_cast<uint16_t>(sign | std::lround(a * 16777216.0f));
+  }
+  // Normal: rebias the exponent, and round the mantissa to nearest even.
+  const uint32_t rounded =
+      magnitude + 0xfffu + ((magnitude >> 13) & 1u) - (112u << 23);
+  return static_cast<uint16_t>(sign | (rounded >> 13));
+}
+
+}  // namespace gfx
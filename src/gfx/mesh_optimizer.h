@@ -0,0 +1,108 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef GFX_MESH_OPTIMIZER_H_
+#define GFX_MESH_OPTIMIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gfx/mesh.h"
+
+namespace gfx {
+
+/// @brief The simulated post-transform vertex cache size (in vertices).
+///
+/// This is the cache size that OptimizeVertexCache() optimizes for, and that
+/// AnalyzeVertexCache() simulates. Sixteen entries is a conservative estimate
+/// for current GPUs, and orders that are good for small caches are good for
+/// larger caches too.
+const int kVertexCacheSize = 16;
+
+/// @brief Post-transform vertex cache statistics for an index buffer.
+struct VertexCacheStats {
+  /// The number of vertices that were transformed (cache misses).
+  size_t transformed = 0;
+
+  /// Average cache miss ratio: transformed vertices per triangle. It is 3
+  /// without any reuse, and approaches 0.5 for ideal orders of large meshes.
+  float acmr = 0.0f;
+
+  /// Average transform to vertex ratio: transformed vertices per referenced
+  /// vertex. It is 1 for ideal orders.
+  float atvr = 0.0f;
+};
+
+/// @brief Simulate a FIFO post-transform vertex cache of kVertexCacheSize
+/// entries.
+/// @param indices The triangle indices.
+/// @param index_count The number of indices.
+/// @param vertex_count The number of vertices (all indices must be smaller).
+/// @returns the cache statistics.
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices,
+                                    size_t index_count,
+                                    size_t vertex_count);
+
+/// @brief Merge vertices with identical attributes.
+///
+/// Vertices are compared bit by bit, using a hash table, and vertices that are
+/// not referenced by any triangle are removed. The remaining vertices are
+/// ordered by first use.
+/// @param[in,out] mesh The mesh.
+void WeldVertices(Mesh* mesh);
+
+/// @brief Reorder the triangles for the post-transform vertex cache.
+///
+/// This is the Tipsify algorithm (Sander, Nehab and Barczak, "Fast Triangle
+/// Reordering for Vertex Locality and Reduced Overdraw", 2007), which runs in
+/// linear time.
+/// @param[in,out] indices The triangle indices.
+/// @param vertex_count The number of vertices (all indices must be smaller).
+void OptimizeVertexCache(std::vector<uint32_t>* indices, size_t vertex_count);
+
+/// @brief Reorder the vertices by first use in the index buffer.
+///
+/// This makes the vertex fetches of consecutive triangles local in memory.
+/// Vertices that are not referenced are removed.
+/// @param[in,out] mesh The mesh.
+void OptimizeVertexFetch(Mesh* mesh);
+
+/// @brief Convert a float in [-1, 1] to a normalized signed 16-bit integer.
+int16_t QuantizeSnorm16(float x);
+
+/// @brief Pack a unit vector to a normalized signed 10-10-10-2 integer (with
+/// zero in the two bit w component).
+uint32_t PackSnorm10(const float* v);
+
+/// @brief Convert a float to a half precision float (rounding to nearest).
+uint16_t FloatToHalf(float x);
+
+}  // namespace gfx
+
+#endif  // GFX_MESH_OPTIMIZER_H_
@@ -0,0 +1,358 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "gfx/mesh_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace gfx {
+
+namespace {
+
+enum VertexKind : uint8_t {
+  // An interior vertex, which can collapse into any neighbor.
+  kManifold,
+
+  // A vertex on an open border, which can only collapse along the border.
+  kBorder,
+
+  // A vertex that is never removed (seams and non-manifold edges).
+  kLocked
+};
+
+// The weight of the planes that keep open borders in place, relative to the
+// area weight of the triangles.
+const float kBorderWeight = 10.0f;
+
+// The same positions (bit by bit) sort next to each other.
+bool PositionLess(const base::Vec3& a, const base::Vec3& b) {
+  uint32_t ua[3];
+  uint32_t ub[3];
+  std::memcpy(ua, &a, sizeof(ua));
+  std::memcpy(ub, &b, sizeof(ub));
+  return std::lexicographical_compare(ua, ua + 3, ub, ub + 3);
+}
+
+}  // namespace
+
+void MeshSimplifier::Quadric::AddPlane(const base::Vec3& normal,
+                                       float distance,
+                                       float w) {
+  const double x = normal.x;
+  const double y = normal.y;
+  const double z = normal.z;
+  const double d = distance;
+  m[0] += w * x * x;
+  m[1] += w * x * y;
+  m[2] += w * x * z;
+  m[3] += w * y * y;
+  m[4] += w * y * z;
+  m[5] += w * z * z;
+  m[6] += w * x * d;
+  m[7] += w * y * d;
+  m[8] += w * z * d;
+  m[9] += w * d * d;
+  weight += w;
+}
+
+void MeshSimplifier::Quadric::Add(const Quadric& other) {
+  for (int i = 0; i < 10; ++i) {
+    m[i] += other.m[i];
+  }
+  weight += other.weight;
+}
+
+double MeshSimplifier::Quadric::Evaluate(const base::Vec3& p) const {
+  const double x = p.x;
+  const double y = p.y;
+  const double z = p.z;
+  return m[0] * x * x + m[3] * y * y + m[5] * z * z +
+         2.0 * (m[1] * x * y + m[2] * x * z + m[4] * y * z) +
+         2.0 * (m[6] * x + m[7] * y + m[8] * z) + m[9];
+}
+
+MeshSimplifier::MeshSimplifier(const Mesh& mesh) : indices_(mesh.indices) {
+  const size_t vertex_count = mesh.vertices.size();
+  positions_.resize(vertex_count);
+  for (size_t i = 0; i < vertex_count; ++i) {
+    std::memcpy(&positions_[i], mesh.vertices[i].position,
+                sizeof(base::Vec3));
+  }
+  kinds_.assign(vertex_count, kManifold);
+  quadrics_.resize(vertex_count);
+  touched_.resize(vertex_count);
+  remap_.resize(vertex_count);
+  for (size_t i = 0; i < vertex_count; ++i) {
+    remap_[i] = static_cast<uint32_t>(i);
+  }
+
+  // Lock the vertices that share their position with other vertices (i.e.
+  // attribute seams).
+  std::vector<uint32_t> order(remap_);
+  std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return PositionLess(positions_[a], positions_[b]);
+  });
+  for (size_t i = 1; i < order.size(); ++i) {
+    if (!PositionLess(positions_[order[i - 1]], positions_[order[i]])) {
+      kinds_[order[i - 1]] = kLocked;
+      kinds_[order[i]] = kLocked;
+    }
+  }
+
+  // Find the open borders and the non-manifold edges.
+  BuildAdjacency();
+  for (size_t t = 0; t < triangle_count(); ++t) {
+    for (size_t k = 0; k < 3; ++k) {
+      const uint32_t a = indices_[3 * t + k];
+      const uint32_t b = indices_[3 * t + (k + 1) % 3];
+      size_t count = 0;
+      for (uint32_t i = adjacency_offsets_[a]; i < adjacency_offsets_[a + 1];
+           ++i) {
+        const uint32_t* triangle = &indices_[3 * adjacency_[i]];
+        for (size_t j = 0; j < 3; ++j) {
+          count += triangle[j] == a && triangle[(j + 1) % 3] == b ? 1 : 0;
+        }
+      }
+      if (count > 1) {
+        kinds_[a] = kLocked;
+        kinds_[b] = kLocked;
+      } else if (!HasHalfEdge(b, a)) {
+        for (auto v : {a, b}) {
+          if (kinds_[v] == kManifold) {
+            kinds_[v] = kBorder;
+          }
+        }
+      }
+    }
+  }
+
+  // Accumulate the area weighted plane of each triangle in its vertices, and
+  // a perpendicular plane through each border edge in its two vertices.
+  for (size_t t = 0; t < triangle_count(); ++t) {
+    const uint32_t* triangle = &indices_[3 * t];
+    const base::Vec3& p0 = positions_[triangle[0]];
+    const base::Vec3 cross = base::Cross(positions_[triangle[1]] - p0,
+                                         positions_[triangle[2]] - p0);
+    const float length = base::Length(cross);
+    if (length <= 0.0f) {
+      continue;
+    }
+    const base::Vec3 normal = cross * (1.0f / length);
+    const float area = 0.5f * length;
+    Quadric plane;
+    plane.AddPlane(normal, -base::Dot(normal, p0), area);
+    for (size_t k = 0; k < 3; ++k) {
+      quadrics_[triangle[k]].Add(plane);
+    }
+
+    for (size_t k = 0; k < 3; ++k) {
+      const uint32_t a = triangle[k];
+      const uint32_t b = triangle[(k + 1) % 3];
+      if (HasHalfEdge(b, a)) {
+        continue;
+      }
+      const base::Vec3 edge = positions_[b] - positions_[a];
+      const float edge_length = base::Length(edge);
+      if (edge_length <= 0.0f) {
+        continue;
+      }
+      const base::Vec3 border_normal =
+          base::Normalize(base::Cross(edge, normal));
+      Quadric border;
+      border.AddPlane(border_normal,
+                      -base::Dot(border_normal, positions_[a]),
+                      kBorderWeight * edge_length * edge_length);
+      quadrics_[a].Add(border);
+      quadrics_[b].Add(border);
+    }
+  }
+}
+
+size_t MeshSimplifier::Simplify(size_t target_triangles, float max_error) {
+  while (triangle_count() > target_triangles) {
+    BuildAdjacency();
+
+    // Find the cheapest allowed collapse of each vertex.
+    const size_t vertex_count = positions_.size();
+    const float no_error = std::numeric_limits<float>::infinity();
+    collapses_.clear();
+    for (uint32_t v = 0; v < vertex_count; ++v) {
+      if (kinds_[v] == kLocked ||
+          adjacency_offsets_[v] == adjacency_offsets_[v + 1]) {
+        continue;
+      }
+      Collapse best = {v, v, no_error};
+      for (uint32_t i = adjacency_offsets_[v]; i < adjacency_offsets_[v + 1];
+           ++i) {
+        const uint32_t* triangle = &indices_[3 * adjacency_[i]];
+        for (size_t k = 0; k < 3; ++k) {
+          const uint32_t target = triangle[k];
+          if (target == v) {
+            continue;
+          }
+          // Border vertices must stay on the border.
+          if (kinds_[v] == kBorder && HasHalfEdge(v, target) &&
+              HasHalfEdge(target, v)) {
+            continue;
+          }
+          const float error = GetError(v, target);
+          if (error < best.error) {
+            best.target = target;
+            best.error = error;
+          }
+        }
+      }
+      if (best.error <= max_error) {
+        collapses_.push_back(best);
+      }
+    }
+    std::sort(collapses_.begin(), collapses_.end(),
+              [](const Collapse& a, const Collapse& b) {
+                return a.error < b.error;
+              });
+
+    // Collapse the cheapest edges whose neighborhoods do not overlap. An
+    // interior collapse removes two triangles.
+    const size_t budget =
+        std::max<size_t>((triangle_count() - target_triangles) / 2, 1);
+    size_t collapsed = 0;
+    std::fill(touched_.begin(), touched_.end(), 0);
+    for (const auto& collapse : collapses_) {
+      if (collapsed >= budget) {
+        break;
+      }
+      if (touched_[collapse.source] || touched_[collapse.target] ||
+          Flips(collapse.source, collapse.target)) {
+        continue;
+      }
+      remap_[collapse.source] = collapse.target;
+      quadrics_[collapse.target].Add(quadrics_[collapse.source]);
+      error_ = std::max(error_, collapse.error);
+      for (auto v : {collapse.source, collapse.target}) {
+        for (uint32_t i = adjacency_offsets_[v]; i < adjacency_offsets_[v + 1];
+             ++i) {
+          const uint32_t* triangle = &indices_[3 * adjacency_[i]];
+          touched_[triangle[0]] = 1;
+          touched_[triangle[1]] = 1;
+          touched_[triangle[2]] = 1;
+        }
+      }
+      ++collapsed;
+    }
+    if (collapsed == 0) {
+      break;
+    }
+
+    // Apply the collapses, and remove the degenerate triangles.
+    size_t write = 0;
+    for (size_t t = 0; t < triangle_count(); ++t) {
+      const uint32_t a = remap_[indices_[3 * t]];
+      const uint32_t b = remap_[indices_[3 * t + 1]];
+      const uint32_t c = remap_[indices_[3 * t + 2]];
+      if (a != b && b != c && c != a) {
+        indices_[write++] = a;
+        indices_[write++] = b;
+        indices_[write++] = c;
+      }
+    }
+    indices_.resize(write);
+  }
+  return triangle_count();
+}
+
+void MeshSimplifier::BuildAdjacency() {
+  const size_t vertex_count = positions_.size();
+  adjacency_offsets_.assign(vertex_count + 1, 0);
+  for (auto index : indices_) {
+    ++adjacency_offsets_[index + 1];
+  }
+  for (size_t v = 0; v < vertex_count; ++v) {
+    adjacency_offsets_[v + 1] += adjacency_offsets_[v];
+  }
+  adjacency_.resize(indices_.size());
+  std::vector<uint32_t> fill(adjacency_offsets_.begin(),
+                             adjacency_offsets_.end() - 1);
+  for (size_t i = 0; i < indices_.size(); ++i) {
+    adjacency_[fill[indices_[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+}
+
+bool MeshSimplifier::HasHalfEdge(uint32_t a, uint32_t b) const {
+  for (uint32_t i = adjacency_offsets_[a]; i < adjacency_offsets_[a + 1];
+       ++i) {
+    const uint32_t* triangle = &indices_[3 * adjacency_[i]];
+    for (size_t k = 0; k < 3; ++k) {
+      if (triangle[k] == a && triangle[(k + 1) % 3] == b) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+float MeshSimplifier::GetError(uint32_t source, uint32_t target) const {
+  Quadric quadric = quadrics_[source];
+  quadric.Add(quadrics_[target]);
+  const double error = quadric.Evaluate(positions_[target]) /
+                       std::max(quadric.weight, 1e-30);
+  return static_cast<float>(std::sqrt(std::max(error, 0.0)));
+}
+
+bool MeshSimplifier::Flips(uint32_t source, uint32_t target) const {
+  for (uint32_t i = adjacency_offsets_[source];
+       i < adjacency_offsets_[source + 1]; ++i) {
+    const uint32_t* triangle = &indices_[3 * adjacency_[i]];
+    if (triangle[0] == target || triangle[1] == target ||
+        triangle[2] == target) {
+      continue;  // The triangle collapses.
+    }
+    base::Vec3 p[3];
+    for (size_t k = 0; k < 3; ++k) {
+      p[k] = positions_[triangle[k]];
+    }
+    const base::Vec3 before = base::Cross(p[1] - p[0], p[2] - p[0]);
+    for (size_t k = 0; k < 3; ++k) {
+      if (triangle[k] == source) {
+        p[k] = positions_[target];
+      }
+    }
+    const base::Vec3 after = base::Cross(p[1] - p[0], p[2] - p[0]);
+    // Reject flipped triangles, and triangles that become (nearly)
+    // degenerate.
+    if (base::Dot(before, after) <=
+        0.25f * base::Length(before) * base::Length(after)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace gfx
@@ -0,0 +1,139 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef GFX_MESH_SIMPLIFIER_H_
+#define GFX_MESH_SIMPLIFIER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "base/math.h"
+#include "gfx/mesh.h"
+
+namespace gfx {
+
+/// @brief Simplifies a triangle mesh by collapsing edges in the order of a
+/// quadric error metric.
+///
+/// This follows Garland and Heckbert, "Surface Simplification Using Quadric
+/// Error Metrics" (1997), but with half edge collapses (an edge collapses into
+/// one of its vertices), so that the simplified triangles refer to a subset of
+/// the original vertices and can share their vertex buffer.
+///
+/// The quadrics are weighted by triangle area, and the error of a collapse is
+/// the weighted root mean square distance from the remaining vertex to the
+/// planes of the original triangles that were merged into it. The error is
+/// thus in the units of the vertex positions.
+///
+/// Open borders only collapse along themselves. Vertices on attribute seams
+/// (where vertices with different normals or texture coordinates share a
+/// position) and on non-manifold edges are never removed, so that the
+/// simplified mesh has no cracks. Collapses that would flip a triangle are
+/// rejected.
+///
+/// The simplifier is incremental: call Simplify() with decreasing targets to
+/// produce a chain of levels of detail.
+class MeshSimplifier {
+ public:
+  /// @brief Prepare a mesh for simplification.
+  /// @param mesh The mesh (the simplifier keeps a copy of what it needs).
+  explicit MeshSimplifier(const Mesh& mesh);
+
+  /// @brief Collapse edges until there are at most target_triangles left.
+  /// @param target_triangles The target number of triangles.
+  /// @param max_error The largest allowed error of a collapse.
+  /// @returns the number of triangles left, which exceeds the target if no
+  /// more edges could be collapsed.
+  size_t Simplify(size_t target_triangles, float max_error);
+
+  /// The current triangle indices.
+  const std::vector<uint32_t>& indices() const { return indices_; }
+
+  /// The largest error of all the collapses so far.
+  float error() const { return error_; }
+
+  size_t triangle_count() const { return indices_.size() / 3; }
+
+ private:
+  // A symmetric 4x4 matrix that measures the (weighted) sum of the squared
+  // distances from a point to a set of planes.
+  struct Quadric {
+    // The upper triangle of the 3x3 part (xx, xy, xz, yy, yz, zz), the
+    // linear part (x, y, z) and the constant.
+    double m[10] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    double weight = 0.0;
+
+    void AddPlane(const base::Vec3& normal, float distance, float w);
+    void Add(const Quadric& other);
+    double Evaluate(const base::Vec3& p) const;
+  };
+
+  struct Collapse {
+    uint32_t source;
+    uint32_t target;
+    float error;
+  };
+
+  // Find the triangles around each vertex (into adjacency_).
+  void BuildAdjacency();
+
+  // @returns true if there is a triangle with the edge from a to b.
+  bool HasHalfEdge(uint32_t a, uint32_t b) const;
+
+  // @returns the error of collapsing source into target.
+  float GetError(uint32_t source, uint32_t target) const;
+
+  // @returns true if collapsing source into target would flip or degenerate
+  // any of the remaining triangles.
+  bool Flips(uint32_t source, uint32_t target) const;
+
+  std::vector<base::Vec3> positions_;
+  std::vector<uint8_t> kinds_;
+  std::vector<Quadric> quadrics_;
+  std::vector<uint32_t> indices_;
+  float error_ = 0.0f;
+
+  // The triangles around each vertex, indexed by adjacency_offsets_.
+  std::vector<uint32_t> adjacency_offsets_;
+  std::vector<uint32_t> adjacency_;
+
+  // Scratch buffers.
+  std::vector<Collapse> collapses_;
+  std::vector<uint32_t> remap_;
+  std::vector<uint8_t> touched_;
+
+  // Disable copy/move.
+  MeshSimplifier(const MeshSimplifier&) = delete;
+  MeshSimplifier(MeshSimplifier&&) = delete;
+  MeshSimplifier& operator=(const MeshSimplifier&) = delete;
+};
+
+}  // namespace gfx
+
+#endif  // GFX_MESH_SIMPLIFIER_H_
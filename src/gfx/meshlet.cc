@@ -0,0 +1,202 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "gfx/meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace gfx {
+
+namespace {
+
+// Values for the padding after the last meshlet, which is never visible.
+const float kPaddingExtent = -1e30f;
+const float kNoCone = 2.0f;
+
+// Compute the bounds and the normal cone of a meshlet.
+void FinishMeshlet(const Mesh& mesh, Meshlet* meshlet) {
+  const uint32_t* indices = &mesh.indices[meshlet->first_index];
+  meshlet->bounds = base::Aabb::Empty();
+  base::Vec3 normal_sum = {0.0f, 0.0f, 0.0f};
+  for (uint32_t i = 0; i < meshlet->index_count; i += 3) {
+    base::Vec3 p[3];
+    for (int k = 0; k < 3; ++k) {
+      const float* position = mesh.vertices[indices[i + k]].position;
+      p[k] = base::Vec3{position[0], position[1], position[2]};
+      meshlet->bounds.Grow(p[k]);
+    }
+    // The cross product is twice the area weighted normal.
+    normal_sum = normal_sum + base::Cross(p[1] - p[0], p[2] - p[0]);
+  }
+
+  meshlet->cone_axis = {0.0f, 0.0f, 0.0f};
+  meshlet->cone_cutoff = kNoCone;
+  const float length = base::Length(normal_sum);
+  if (length <= 0.0f) {
+    return;
+  }
+  const base::Vec3 axis = normal_sum * (1.0f / length);
+
+  // Find the widest angle between the axis and a triangle normal.
+  float min_dot = 1.0f;
+  for (uint32_t i = 0; i < meshlet->index_count; i += 3) {
+    base::Vec3 p[3];
+    for (int k = 0; k < 3; ++k) {
+      const float* position = mesh.vertices[indices[i + k]].position;
+      p[k] = base::Vec3{position[0], position[1], position[2]};
+    }
+    const base::Vec3 normal = base::Cross(p[1] - p[0], p[2] - p[0]);
+    const float normal_length = base::Length(normal);
+    if (normal_length > 0.0f) {
+      min_dot = std::min(min_dot, base::Dot(normal, axis) / normal_length);
+    }
+  }
+  meshlet->cone_axis = axis;
+  if (min_dot > 0.0f) {
+    // sin(acos(x)), with a little slack for rounding.
+    meshlet->cone_cutoff =
+        std::min(std::sqrt(1.0f - min_dot * min_dot) + 1e-3f, kNoCone);
+  }
+}
+
+}  // namespace
+
+std::vector<Meshlet> BuildMeshlets(const Mesh& mesh) {
+  std::vector<Meshlet> meshlets;
+  std::vector<uint32_t> last_meshlet(mesh.vertices.size(),
+                                     std::numeric_limits<uint32_t>::max());
+  Meshlet meshlet = {};
+  size_t vertex_count = 0;
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+    // Start a new meshlet if the triangle does not fit.
+    auto current = static_cast<uint32_t>(meshlets.size());
+    size_t new_vertices = 0;
+    for (size_t k = 0; k < 3; ++k) {
+      new_vertices += last_meshlet[mesh.indices[i + k]] != current ? 1 : 0;
+    }
+    if (vertex_count + new_vertices > kMaxMeshletVertices ||
+        meshlet.index_count / 3 + 1 > kMaxMeshletTriangles) {
+      FinishMeshlet(mesh, &meshlet);
+      meshlets.push_back(meshlet);
+      meshlet.first_index = static_cast<uint32_t>(i);
+      meshlet.index_count = 0;
+      vertex_count = 0;
+      ++current;
+    }
+
+    for (size_t k = 0; k < 3; ++k) {
+      uint32_t& last = last_meshlet[mesh.indices[i + k]];
+      if (last != current) {
+        last = current;
+        ++vertex_count;
+      }
+    }
+    meshlet.index_count += 3;
+  }
+  if (meshlet.index_count > 0) {
+    FinishMeshlet(mesh, &meshlet);
+    meshlets.push_back(meshlet);
+  }
+  return meshlets;
+}
+
+void MeshletSet::Add(const Meshlet& meshlet) {
+  if (size_ == radius_.size()) {
+    const size_t size = size_ + base::kAabbBatchSize;
+    for (int k = 0; k < 3; ++k) {
+      center_[k].resize(size, 0.0f);
+      extent_[k].resize(size, kPaddingExtent);
+      cone_axis_[k].resize(size, 0.0f);
+    }
+    radius_.resize(size, 0.0f);
+    cone_cutoff_.resize(size, kNoCone);
+  }
+  const base::Vec3 center = meshlet.bounds.center();
+  const base::Vec3 extent = meshlet.bounds.extent();
+  for (int k = 0; k < 3; ++k) {
+    center_[k][size_] = center[k];
+    extent_[k][size_] = extent[k];
+    cone_axis_[k][size_] = meshlet.cone_axis[k];
+  }
+  radius_[size_] = base::Length(extent);
+  cone_cutoff_[size_] = meshlet.cone_cutoff;
+  first_index_.push_back(meshlet.first_index);
+  index_count_.push_back(meshlet.index_count);
+  ++size_;
+}
+
+void MeshletSet::Cull(const base::Frustum& frustum,
+                      const base::Vec3* eye,
+                      size_t begin,
+                      size_t end,
+                      uint8_t* visible) const {
+  if (begin >= end) {
+    return;
+  }
+  const size_t count = end - begin;
+  const float* center[3];
+  const float* extent[3];
+  const float* cone_axis[3];
+  for (int k = 0; k < 3; ++k) {
+    center[k] = &center_[k][begin];
+    extent[k] = &extent_[k][begin];
+    cone_axis[k] = &cone_axis_[k][begin];
+  }
+
+  // Classify in batches, to keep the scratch space on the stack.
+  const size_t kBatch = 256;
+  base::Visibility visibility[kBatch];
+  uint8_t backfacing[kBatch];
+  for (size_t first = 0; first < count; first += kBatch) {
+    const size_t n = std::min(kBatch, count - first);
+    const float* batch_center[3];
+    const float* batch_extent[3];
+    const float* batch_axis[3];
+    for (int k = 0; k < 3; ++k) {
+      batch_center[k] = center[k] + first;
+      batch_extent[k] = extent[k] + first;
+      batch_axis[k] = cone_axis[k] + first;
+    }
+    base::ClassifyAabbs(frustum, batch_center, batch_extent, n, visibility);
+    if (eye != nullptr) {
+      base::FindBackfacingCones(*eye, batch_center, &radius_[begin + first],
+                                batch_axis, &cone_cutoff_[begin + first], n,
+                                backfacing);
+    } else {
+      std::fill(backfacing, backfacing + n, 0);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      visible[first + i] =
+          visibility[i] != base::kOutside && backfacing[i] == 0 ? 1 : 0;
+    }
+  }
+}
+
+}  // namespace gfx
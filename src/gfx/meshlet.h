@@ -0,0 +1,122 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef GFX_MESHLET_H_
+#define GFX_MESHLET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "base/math.h"
+#include "gfx/mesh.h"
+
+namespace gfx {
+
+/// The largest number of vertices and triangles per meshlet.
+const size_t kMaxMeshletVertices = 64;
+const size_t kMaxMeshletTriangles = 124;
+
+/// @brief A cluster of neighboring triangles, which is culled as a unit.
+///
+/// A meshlet is a contiguous range of the index buffer of its mesh.
+struct Meshlet {
+  /// The first index and the number of indices, relative to the indices of
+  /// the mesh.
+  uint32_t first_index;
+  uint32_t index_count;
+
+  /// The bounding box of the triangles.
+  base::Aabb bounds;
+
+  /// The normals of the triangles lie within a cone around this axis. The
+  /// cutoff is the sine of the half angle of the cone, or two if the cone is
+  /// too wide for the meshlet to ever face away from the viewer (see
+  /// base::FindBackfacingCones()).
+  base::Vec3 cone_axis;
+  float cone_cutoff;
+};
+
+static_assert(sizeof(Meshlet) == 48, "Meshlet must be tightly packed.");
+
+/// @brief Partition a mesh into meshlets.
+///
+/// The triangles are scanned in index buffer order, and a new meshlet starts
+/// whenever the current one would exceed kMaxMeshletVertices or
+/// kMaxMeshletTriangles. The order is not changed, so the index buffer should
+/// already be optimized for locality (see OptimizeVertexCache()).
+/// @param mesh The mesh.
+/// @returns the meshlets, in index buffer order.
+std::vector<Meshlet> BuildMeshlets(const Mesh& mesh);
+
+/// @brief The meshlets of a mesh, stored in a SIMD friendly layout for
+/// culling (like BoxSet).
+class MeshletSet {
+ public:
+  /// @brief Add a meshlet.
+  void Add(const Meshlet& meshlet);
+
+  size_t size() const { return size_; }
+  uint32_t first_index(size_t i) const { return first_index_[i]; }
+  uint32_t index_count(size_t i) const { return index_count_[i]; }
+
+  /// @brief Find the meshlets in a range that are potentially visible.
+  ///
+  /// Meshlets outside the frustum, and meshlets that face away from the eye
+  /// (if it is given), are culled.
+  /// @param frustum The view frustum, in the coordinate system of the mesh.
+  /// @param eye The camera position in the coordinate system of the mesh, or
+  /// nullptr to keep the meshlets that face away.
+  /// @param begin The first meshlet to test. Must be a multiple of
+  /// base::kAabbBatchSize.
+  /// @param end One past the last meshlet to test.
+  /// @param[out] visible One for each visible meshlet in the range, zero
+  /// otherwise (indexed from zero).
+  void Cull(const base::Frustum& frustum,
+            const base::Vec3* eye,
+            size_t begin,
+            size_t end,
+            uint8_t* visible) const;
+
+ private:
+  // The bounding boxes, and the bounding spheres (the box centers and the
+  // radii) and the normal cones that the back face test uses.
+  std::vector<float> center_[3];
+  std::vector<float> extent_[3];
+  std::vector<float> radius_;
+  std::vector<float> cone_axis_[3];
+  std::vector<float> cone_cutoff_;
+
+  std::vector<uint32_t> first_index_;
+  std::vector<uint32_t> index_count_;
+  size_t size_ = 0;
+};
+
+}  // namespace gfx
+
+#endif  // GFX_MESHLET_H_
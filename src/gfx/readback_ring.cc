@@ -0,0 +1,157 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "gfx/readback_ring.h"
+
+#include <cstring>
+
+#include "GL/gl3w.h"
+
+#include "base/error.h"
+#include "base/parallel.h"
+
+namespace gfx {
+
+namespace {
+
+// The number of rows that each task copies out of a mapped buffer.
+const int kCopyRows = 64;
+
+}  // namespace
+
+ReadbackRing::ReadbackRing(int slot_count)
+    : slots_(static_cast<size_t>(slot_count > 0 ? slot_count : 1)) {}
+
+ReadbackRing::~ReadbackRing() {
+  for (auto& slot : slots_) {
+    if (slot.fence != nullptr) {
+      glDeleteSync(static_cast<GLsync>(slot.fence));
+    }
+    if (slot.buffer != 0) {
+      glDeleteBuffers(1, &slot.buffer);
+    }
+  }
+}
+
+bool ReadbackRing::Read(GlState* state, int width, int height, uint64_t tag) {
+  if (full() || width <= 0 || height <= 0) {
+    return false;
+  }
+  auto& slot = slots_[static_cast<size_t>(first_ + pending_) % slots_.size()];
+  ++pending_;
+
+  // The pixel pack buffer is only bound during the read, since it would
+  // redirect every other glReadPixels() call too.
+  const size_t size =
+      static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+  if (slot.buffer == 0) {
+    glGenBuffers(1, &slot.buffer);
+    state->CountCalls(1);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  if (slot.capacity < size) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr,
+                 GL_STREAM_READ);
+    slot.capacity = size;
+    state->CountCalls(1);
+  }
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  state->CountCalls(4);
+
+  slot.width = width;
+  slot.height = height;
+  slot.tag = tag;
+  return true;
+}
+
+bool ReadbackRing::Collect(GlState* state,
+                           bool wait,
+                           Image* image,
+                           uint64_t* tag) {
+  if (pending_ == 0) {
+    return false;
+  }
+  auto& slot = slots_[static_cast<size_t>(first_)];
+  const auto fence = static_cast<GLsync>(slot.fence);
+  GLenum result;
+  if (wait) {
+    do {
+      result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                1000000000u);
+    } while (result == GL_TIMEOUT_EXPIRED);
+  } else {
+    result = glClientWaitSync(fence, 0, 0);
+  }
+  state->CountCalls(1);
+  if (result == GL_TIMEOUT_EXPIRED) {
+    return false;
+  }
+  glDeleteSync(fence);
+  slot.fence = nullptr;
+  first_ = (first_ + 1) % static_cast<int>(slots_.size());
+  --pending_;
+
+  // Map the buffer through GL_COPY_READ_BUFFER, which no other code binds.
+  const size_t size = static_cast<size_t>(slot.width) *
+                      static_cast<size_t>(slot.height) * 4;
+  glBindBuffer(GL_COPY_READ_BUFFER, slot.buffer);
+  const auto* pixels = static_cast<const uint8_t*>(
+      glMapBufferRange(GL_COPY_READ_BUFFER, 0, static_cast<GLsizeiptr>(size),
+                       GL_MAP_READ_BIT));
+  state->CountCalls(3);
+  if (pixels == nullptr) {
+    throw base::Error("Unable to map the readback buffer.");
+  }
+
+  // Copy the rows in parallel, bottom row first (as OpenGL stores them).
+  // Reading from a mapped buffer is often slower than from ordinary memory,
+  // so the copy benefits from more threads than the memory bandwidth
+  // suggests.
+  image->Resize(slot.width, slot.height);
+  const int height = slot.height;
+  const size_t row_size = static_cast<size_t>(slot.width) * 4;
+  const size_t bands =
+      static_cast<size_t>((height + kCopyRows - 1) / kCopyRows);
+  base::ParallelFor(bands, [image, pixels, height, row_size](size_t band) {
+    const int begin = static_cast<int>(band) * kCopyRows;
+    const int end = begin + kCopyRows < height ? begin + kCopyRows : height;
+    for (int y = begin; y < end; ++y) {
+      std::memcpy(image->row(height - 1 - y),
+                  pixels + row_size * static_cast<size_t>(y), row_size);
+    }
+  });
+  glUnmapBuffer(GL_COPY_READ_BUFFER);
+  state->CountCalls(1);
+
+  *tag = slot.tag;
+  return true;
+}
+
+}  // namespace gfx
@@ -0,0 +1,104 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef GFX_READBACK_RING_H_
+#define GFX_READBACK_RING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gfx/gl_state.h"
+#include "gfx/image.h"
+
+namespace gfx {
+
+/// @brief Reads framebuffer pixels without stalling the pipeline.
+///
+/// glReadPixels() into client memory waits until the GPU has finished
+/// rendering the frame. Here the pixels are read into one of a ring of
+/// pixel pack buffers instead, which returns immediately, and the buffer is
+/// mapped a few frames later, once a fence says that the copy has completed.
+class ReadbackRing {
+ public:
+  /// @brief Create the ring.
+  /// @param slot_count The number of reads that may be in flight.
+  explicit ReadbackRing(int slot_count);
+
+  /// @brief Delete the buffers and the fences.
+  /// @note The OpenGL context that read the pixels must be current.
+  ~ReadbackRing();
+
+  /// @brief Start reading the color buffer of the bound read framebuffer.
+  /// @param state The state of the current context.
+  /// @param width The width of the region (from the lower left corner).
+  /// @param height The height of the region.
+  /// @param tag A value that is returned with the pixels.
+  /// @returns false if all the slots are in flight.
+  bool Read(GlState* state, int width, int height, uint64_t tag);
+
+  /// @brief Get the pixels of the oldest read, if it has completed.
+  /// @param state The state of the current context.
+  /// @param wait true to wait for the read to complete.
+  /// @param[out] image The pixels (resized to the read region, top row first).
+  /// @param[out] tag The tag that was passed to Read().
+  /// @returns false if there is no completed read.
+  /// @throws base::Error if the buffer can not be mapped.
+  bool Collect(GlState* state, bool wait, Image* image, uint64_t* tag);
+
+  /// @returns the number of reads that are in flight.
+  int pending() const { return pending_; }
+
+  /// @returns true if all the slots are in flight.
+  bool full() const { return pending_ == static_cast<int>(slots_.size()); }
+
+ private:
+  struct Slot {
+    unsigned int buffer = 0;
+    size_t capacity = 0;
+    void* fence = nullptr;
+    int width = 0;
+    int height = 0;
+    uint64_t tag = 0;
+  };
+
+  std::vector<Slot> slots_;
+
+  // The oldest slot that is in flight, and the number of slots in flight.
+  int first_ = 0;
+  int pending_ = 0;
+
+  // Disable copy/move.
+  ReadbackRing(const ReadbackRing&) = delete;
+  ReadbackRing(ReadbackRing&&) = delete;
+  ReadbackRing& operator=(const ReadbackRing&) = delete;
+};
+
+}  // namespace gfx
+
+#endif  // GFX_READBACK_RING_H_
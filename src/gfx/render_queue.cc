@@ -0,0 +1,156 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+#include "gfx/render_queue.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/parallel.h"
+
+namespace gfx {
+
+namespace {
+
+// The smallest number of items per parallel chunk. Smaller queues are sorted
+// on the calling thread.
+const size_t kMinChunkSize = 16384;
+
+uint64_t Field(uint32_t value, int bits, int shift) {
+  return (static_cast<uint64_t>(value) & ((UINT64_C(1) << bits) - 1u))
+         << shift;
+}
+
+// @returns the most significant bits of a non-negative float, which order
+// like the float.
+uint32_t DepthBits(float depth) {
+  uint32_t bits;
+  depth = std::max(depth, 0.0f);
+  std::memcpy(&bits, &depth, sizeof(bits));
+  return bits >> (32 - SortKey::kDepthBits);
+}
+
+}  // namespace
+
+uint64_t SortKey::Make(uint32_t pass,
+                       uint32_t shader,
+                       uint32_t material,
+                       uint32_t vertex_array,
+                       float depth,
+                       uint32_t instance) {
+  int shift = kInstanceBits;
+  uint64_t key = Field(instance, kInstanceBits, 0);
+  key |= Field(DepthBits(depth), kDepthBits, shift);
+  shift += kDepthBits;
+  key |= Field(vertex_array, kVertexArrayBits, shift);
+  shift += kVertexArrayBits;
+  key |= Field(material, kMaterialBits, shift);
+  shift += kMaterialBits;
+  key |= Field(shader, kShaderBits, shift);
+  shift += kShaderBits;
+  key |= Field(pass, kPassBits, shift);
+  return key;
+}
+
+void RenderQueue::Sort() {
+  if (items_.size() < 2) {
+    return;
+  }
+
+  // Find the bits that differ between the keys.
+  uint64_t all_ones = ~UINT64_C(0);
+  uint64_t any_ones = 0;
+  for (const auto& item : items_) {
+    all_ones &= item.key;
+    any_ones |= item.key;
+  }
+  const uint64_t varying = all_ones ^ any_ones;
+
+  const size_t chunk_count = std::max<size_t>(
+      std::min<size_t>(items_.size() / kMinChunkSize,
+                       static_cast<size_t>(base::GetParallelism())),
+      1);
+  scratch_.resize(items_.size());
+  counts_.resize(chunk_count * 256);
+  for (int shift = 0; shift < 64; shift += 8) {
+    if (((varying >> shift) & 0xffu) != 0) {
+      SortByByte(shift, chunk_count);
+      items_.swap(scratch_);
+    }
+  }
+}
+
+void RenderQueue::SortByByte(int shift, size_t chunk_count) {
+  const size_t size = items_.size();
+  const auto chunk_begin = [size, chunk_count](size_t chunk) {
+    return size * chunk / chunk_count;
+  };
+
+  // Count the digits of each chunk.
+  const auto count = [this, shift, &chunk_begin](size_t chunk) {
+    size_t* counts = &counts_[chunk * 256];
+    std::fill(counts, counts + 256, 0);
+    const size_t end = chunk_begin(chunk + 1);
+    for (size_t i = chunk_begin(chunk); i < end; ++i) {
+      ++counts[(items_[i].key >> shift) & 0xffu];
+    }
+  };
+
+  // Turn the counts into output offsets. Within a digit, the items of earlier
+  // chunks go first, which keeps the sort stable.
+  const auto prefix_sum = [this, chunk_count]() {
+    size_t offset = 0;
+    for (size_t digit = 0; digit < 256; ++digit) {
+      for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        const size_t n = counts_[chunk * 256 + digit];
+        counts_[chunk * 256 + digit] = offset;
+        offset += n;
+      }
+    }
+  };
+
+  // Scatter the items of each chunk.
+  const auto scatter = [this, shift, &chunk_begin](size_t chunk) {
+    size_t* offsets = &counts_[chunk * 256];
+    const size_t end = chunk_begin(chunk + 1);
+    for (size_t i = chunk_begin(chunk); i < end; ++i) {
+      scratch_[offsets[(items_[i].key >> shift) & 0xffu]++] = items_[i];
+    }
+  };
+
+  if (chunk_count > 1) {
+    base::ParallelFor(chunk_count, count);
+    prefix_sum();
+    base::ParallelFor(chunk_count, scatter);
+  } else {
+    count(0);
+    prefix_sum();
+    scatter(0);
+  }
+}
+
+}  // namespace gfx
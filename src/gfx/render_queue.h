@@ -0,0 +1,123 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+#ifndef GFX_RENDER_QUEUE_H_
+#define GFX_RENDER_QUEUE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gfx {
+
+/// @brief A 64-bit render queue sort key.
+///
+/// The fields are ordered by the cost of changing the corresponding state,
+/// from the most significant bits to the least significant bits: the render
+/// pass, the shader program, the material, the vertex array object, the depth
+/// and the instance. Sorting by key thus groups draws that share state, and
+/// within a group orders them front to back.
+///
+/// Values that are too large for their field are truncated, which only makes
+/// the grouping less effective.
+struct SortKey {
+  static const int kPassBits = 2;
+  static const int kShaderBits = 6;
+  static const int kMaterialBits = 8;
+  static const int kVertexArrayBits = 12;
+  static const int kDepthBits = 16;
+  static const int kInstanceBits = 20;
+
+  /// @brief Make a sort key.
+  /// @param pass The render pass.
+  /// @param shader The shader program (an index, not a GL name).
+  /// @param material The material.
+  /// @param vertex_array The vertex array object (an index, not a GL name).
+  /// @param depth The distance from the camera (non-negative).
+  /// @param instance The instance, which keeps draws of the same instance
+  /// together.
+  /// @returns the key.
+  static uint64_t Make(uint32_t pass,
+                       uint32_t shader,
+                       uint32_t material,
+                       uint32_t vertex_array,
+                       float depth,
+                       uint32_t instance);
+};
+
+/// @brief A list of draws, sorted by their sort keys.
+///
+/// The draws are sorted with a parallel, stable LSD radix sort. Bytes that are
+/// equal in all the keys (e.g. the render pass and the shader in most frames)
+/// are skipped.
+class RenderQueue {
+ public:
+  /// @brief A queued draw.
+  struct Item {
+    uint64_t key;
+
+    /// The index of the draw, as passed to Add().
+    uint32_t index;
+  };
+
+  RenderQueue() = default;
+
+  /// @brief Remove all draws.
+  void Clear() { items_.clear(); }
+
+  /// @brief Add a draw.
+  /// @param key The sort key of the draw (see SortKey).
+  /// @param index An index that identifies the draw to the caller.
+  void Add(uint64_t key, uint32_t index) { items_.push_back(Item{key, index}); }
+
+  /// @brief Sort the draws by key (draws with equal keys keep their order).
+  void Sort();
+
+  const std::vector<Item>& items() const { return items_; }
+  size_t size() const { return items_.size(); }
+
+ private:
+  // Sort the items by the byte of the keys at a bit shift, into scratch_,
+  // with one task per chunk of items.
+  void SortByByte(int shift, size_t chunk_count);
+
+  std::vector<Item> items_;
+  std::vector<Item> scratch_;
+
+  // The digit counts (and then the output offsets) of the chunks, with 256
+  // entries per chunk.
+  std::vector<size_t> counts_;
+
+  // Disable copy/move.
+  RenderQueue(const RenderQueue&) = delete;
+  RenderQueue(RenderQueue&&) = delete;
+  RenderQueue& operator=(const RenderQueue&) = delete;
+};
+
+}  // namespace gfx
+
+#endif  // GFX_RENDER_QUEUE_H_
@@ -33,6 +33,8 @@
 
 #include "GL/gl3w.h"
 
+#include "gfx/shader_cache.h"
+
 namespace gfx {
 
 namespace {
@@ -67,33 +69,49 @@ bool CheckProgramStatus(GLuint handle) {
 
 }  // namespace
 
-void Shader::Compile(const char* vert_src, const char* frag_src) {
+void Shader::Compile(const char* vert_src,
+                     const char* frag_src,
+                     const char* const* attributes,
+                     ShaderCache* cache) {
   linked_ = false;
+  cached_ = false;
+  cache_ = nullptr;
 
   handle_ = glCreateProgram();
-  vert_handle_ = glCreateShader(GL_VERTEX_SHADER);
-  frag_handle_ = glCreateShader(GL_FRAGMENT_SHADER);
 
+  // A cached binary is already linked.
+  if (cache != nullptr && cache->enabled()) {
+    const auto key = cache->GetKey(vert_src, frag_src, attributes);
+    if (cache->Load(key, handle_)) {
+      linked_ = true;
+      cached_ = true;
+      status_checked_ = true;
+      return;
+    }
+    glProgramParameteri(handle_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    cache_ = cache;
+    cache_key_ = key;
+  }
+
+  // The status is checked on first use, so that the driver does not have to
+  // finish the compilation here.
+  vert_handle_ = glCreateShader(GL_VERTEX_SHADER);
   glShaderSource(vert_handle_, 1, &vert_src, nullptr);
   glCompileShader(vert_handle_);
-  if (!CheckShaderStatus(vert_handle_)) {
-    return;
-  }
 
+  frag_handle_ = glCreateShader(GL_FRAGMENT_SHADER);
   glShaderSource(frag_handle_, 1, &frag_src, nullptr);
   glCompileShader(frag_handle_);
-  if (!CheckShaderStatus(frag_handle_)) {
-    return;
-  }
 
   glAttachShader(handle_, vert_handle_);
   glAttachShader(handle_, frag_handle_);
-  glLinkProgram(handle_);
-  if (!CheckProgramStatus(handle_)) {
-    return;
+  if (attributes != nullptr) {
+    for (GLuint i = 0; attributes[i] != nullptr; ++i) {
+      glBindAttribLocation(handle_, i, attributes[i]);
+    }
   }
-
-  linked_ = true;
+  glLinkProgram(handle_);
+  status_checked_ = false;
 }
 
 void Shader::Delete() {
@@ -115,20 +133,44 @@ void Shader::Delete() {
   }
 
   linked_ = false;
+  status_checked_ = true;
+  cached_ = false;
+  cache_ = nullptr;
+}
+
+bool Shader::linked() {
+  CheckStatus();
+  return linked_;
 }
 
 int Shader::GetAttribLocation(const char* name) {
+  CheckStatus();
   return linked_ ? glGetAttribLocation(handle_, name) : -1;
 }
 
 int Shader::GetUniformLocation(const char* name) {
+  CheckStatus();
   return linked_ ? glGetUniformLocation(handle_, name) : -1;
 }
 
 void Shader::UseProgram() {
+  CheckStatus();
   if (linked_) {
     glUseProgram(handle_);
   }
 }
 
+void Shader::CheckStatus() {
+  if (status_checked_) {
+    return;
+  }
+  status_checked_ = true;
+  linked_ = CheckShaderStatus(vert_handle_) &&
+            CheckShaderStatus(frag_handle_) && CheckProgramStatus(handle_);
+  if (linked_ && cache_ != nullptr) {
+    cache_->Store(cache_key_, handle_);
+  }
+  cache_ = nullptr;
+}
+
 }  // namespace gfx
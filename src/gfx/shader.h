@@ -29,12 +29,33 @@
 #ifndef GFX_SHADER_H_
 #define GFX_SHADER_H_
 
+#include <cstdint>
+
 namespace gfx {
 
+class ShaderCache;
+
 /// @brief An OpenGL shader program.
+///
+/// The compile and link status is not queried until the program is first used
+/// (by linked(), GetAttribLocation(), GetUniformLocation() or UseProgram()),
+/// since the query waits for the compilation to finish. Compile several
+/// programs before using any of them, and drivers with background compiler
+/// threads compile them in parallel.
 class Shader {
  public:
-  void Compile(const char* vert_src, const char* frag_src);
+  /// @brief Compile and link the shader program.
+  /// @param vert_src The vertex shader source.
+  /// @param frag_src The fragment shader source.
+  /// @param attributes An optional nullptr terminated list of vertex attribute
+  /// names, that are bound to the locations 0, 1, 2, ... in order.
+  /// @param cache An optional program binary cache. The program is loaded
+  /// from the cache if possible, and is otherwise stored in the cache once it
+  /// has been linked.
+  void Compile(const char* vert_src,
+               const char* frag_src,
+               const char* const* attributes = nullptr,
+               ShaderCache* cache = nullptr);
   void Delete();
 
   int GetAttribLocation(const char* name);
@@ -42,13 +63,29 @@ class Shader {
   void UseProgram();
 
   unsigned int handle() const { return handle_; }
-  bool linked() const { return linked_; }
+
+  /// @returns true if the program was linked successfully.
+  /// @note The first call waits for the compilation to finish.
+  bool linked();
+
+  /// @returns true if the program was loaded from a program binary cache.
+  bool cached() const { return cached_; }
 
  private:
+  // Query the compile and link status (once), and store the program in the
+  // cache if it was linked.
+  void CheckStatus();
+
   unsigned int handle_ = 0;
   unsigned int vert_handle_ = 0;
   unsigned int frag_handle_ = 0;
   bool linked_ = false;
+  bool status_checked_ = true;
+  bool cached_ = false;
+
+  // The cache to store the program in, once it has been linked.
+  ShaderCache* cache_ = nullptr;
+  uint64_t cache_key_ = 0;
 };
 
 }  // namespace gfx
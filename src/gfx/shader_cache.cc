@@ -0,0 +1,182 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+#include "gfx/shader_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "GL/gl3w.h"
+
+#include "base/file_util.h"
+#include "base/hash.h"
+
+namespace gfx {
+
+namespace {
+
+// Bump the version whenever the file format changes.
+const uint32_t kMagic = 0x00435356u;  // "VSC\0"
+const uint32_t kVersion = 1;
+
+struct FileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t binary_format;
+  uint32_t reserved;
+  uint64_t key;
+  uint64_t size;
+};
+
+uint64_t HashString(const char* str, uint64_t seed) {
+  return base::HashBytes(str, std::strlen(str) + 1, seed);
+}
+
+}  // namespace
+
+ShaderCache::ShaderCache(const std::string& directory)
+    : directory_(directory) {
+  GLint format_count = 0;
+  if (glGetProgramBinary != nullptr && glProgramBinary != nullptr &&
+      glProgramParameteri != nullptr) {
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+  }
+  enabled_ = !directory_.empty() && format_count > 0;
+
+  // The binaries are only valid for the same driver.
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    const auto* str = reinterpret_cast<const char*>(glGetString(name));
+    driver_hash_ = HashString(str != nullptr ? str : "", driver_hash_);
+  }
+}
+
+uint64_t ShaderCache::GetKey(const char* vert_src,
+                             const char* frag_src,
+                             const char* const* attributes) const {
+  uint64_t key = HashString(vert_src, driver_hash_);
+  key = HashString(frag_src, key);
+  if (attributes != nullptr) {
+    for (size_t i = 0; attributes[i] != nullptr; ++i) {
+      key = HashString(attributes[i], key);
+    }
+  }
+  return key;
+}
+
+bool ShaderCache::Load(uint64_t key, unsigned int program) {
+  if (!enabled_) {
+    return false;
+  }
+  const auto path = GetPath(key);
+  std::vector<char> binary;
+  FileHeader header;
+  {
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in.good() ||
+        !in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != kMagic || header.version != kVersion ||
+        header.key != key || header.size == 0 ||
+        header.size > static_cast<uint64_t>(INT32_MAX)) {
+      ++misses_;
+      return false;
+    }
+    binary.resize(static_cast<size_t>(header.size));
+    if (!in.read(binary.data(), static_cast<std::streamsize>(binary.size()))) {
+      ++misses_;
+      return false;
+    }
+  }
+
+  // The driver rejects binaries that it can not use (the link status tells).
+  glProgramBinary(program, header.binary_format, binary.data(),
+                  static_cast<GLsizei>(binary.size()));
+  GLint status = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) {
+    std::remove(path.c_str());
+    ++misses_;
+    return false;
+  }
+  ++hits_;
+  return true;
+}
+
+bool ShaderCache::Store(uint64_t key, unsigned int program) {
+  if (!enabled_) {
+    return false;
+  }
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return false;
+  }
+  std::vector<char> binary(static_cast<size_t>(length));
+  GLenum binary_format = 0;
+  GLsizei size = 0;
+  glGetProgramBinary(program, length, &size, &binary_format, binary.data());
+  if (size <= 0) {
+    return false;
+  }
+
+  FileHeader header;
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.binary_format = binary_format;
+  header.reserved = 0;
+  header.key = key;
+  header.size = static_cast<uint64_t>(size);
+
+  // Write to a temporary file, and replace the cache file when done.
+  const auto path = GetPath(key);
+  const auto temp_path = path + ".tmp";
+  {
+    std::ofstream out(temp_path, std::ios::out | std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(binary.data(), size);
+    if (!out.good()) {
+      out.close();
+      std::remove(temp_path.c_str());
+      return false;
+    }
+  }
+  if (!base::RenameFile(temp_path, path)) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::string ShaderCache::GetPath(uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.vsc",
+                static_cast<unsigned long long>(key));  // NOLINT(runtime/int)
+  return directory_ + name;
+}
+
+}  // namespace gfx
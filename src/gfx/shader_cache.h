@@ -0,0 +1,104 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+#ifndef GFX_SHADER_CACHE_H_
+#define GFX_SHADER_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gfx {
+
+/// @brief A disk cache of linked shader program binaries.
+///
+/// Programs are stored with glGetProgramBinary() and loaded with
+/// glProgramBinary(), which skips compiling and linking. The cache key is a
+/// hash of the shader sources and of the driver (vendor, renderer and version
+/// strings), and a driver may still reject a binary (e.g. after an update), in
+/// which case the program is compiled from source again.
+///
+/// The cache is disabled if the driver does not support any program binary
+/// format, or if there is no cache directory.
+/// @note The cache is not thread safe. Use it from one OpenGL context (whose
+/// programs may be shared with other contexts).
+class ShaderCache {
+ public:
+  /// @brief Create the cache.
+  /// @param directory The directory of the cache files (including a trailing
+  /// path separator, see base::GetCacheDirectory()), or an empty string to
+  /// disable the cache.
+  /// @note The OpenGL context that will use the cache must be current.
+  explicit ShaderCache(const std::string& directory);
+
+  bool enabled() const { return enabled_; }
+
+  /// @brief Calculate the cache key of a program.
+  /// @param vert_src The vertex shader source.
+  /// @param frag_src The fragment shader source.
+  /// @param attributes The attribute names (see Shader::Compile()).
+  /// @returns the key.
+  uint64_t GetKey(const char* vert_src,
+                  const char* frag_src,
+                  const char* const* attributes) const;
+
+  /// @brief Load a cached program binary.
+  /// @param key The cache key.
+  /// @param program The program object to load the binary into.
+  /// @returns true if the program was loaded and linked successfully.
+  bool Load(uint64_t key, unsigned int program);
+
+  /// @brief Store the binary of a linked program.
+  /// @param key The cache key.
+  /// @param program The linked program, which should have been linked with
+  /// GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+  /// @returns true if the binary was stored.
+  bool Store(uint64_t key, unsigned int program);
+
+  /// The number of programs that were loaded from the cache, and that were
+  /// not found (or were rejected by the driver).
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+ private:
+  std::string GetPath(uint64_t key) const;
+
+  std::string directory_;
+  uint64_t driver_hash_ = 0;
+  bool enabled_ = false;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+
+  // Disable copy/move.
+  ShaderCache(const ShaderCache&) = delete;
+  ShaderCache(ShaderCache&&) = delete;
+  ShaderCache& operator=(const ShaderCache&) = delete;
+};
+
+}  // namespace gfx
+
+#endif  // GFX_SHADER_CACHE_H_
@@ -0,0 +1,246 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "gfx/stream_buffer.h"
+
+#include <cstring>
+
+#include "GL/gl3w.h"
+
+#include "base/error.h"
+
+namespace gfx {
+
+namespace {
+
+// The number of frames of data that the buffer should hold, so that the CPU
+// can write a frame while the GPU reads the previous ones.
+const size_t kFramesInFlight = 3;
+
+// How long to wait for the GPU in each call when a frame must be retired.
+const GLuint64 kWaitTimeoutNs = 1000000000;
+
+const GLbitfield kPersistentFlags =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+bool IsBufferStorageSupported() {
+  if (glBufferStorage == nullptr) {
+    return false;
+  }
+  if (gl3wIsSupported(4, 4) != 0) {
+    return true;
+  }
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    const auto* extension = reinterpret_cast<const char*>(
+        glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+    if (extension != nullptr &&
+        std::strcmp(extension, "GL_ARB_buffer_storage") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t RoundUp(size_t offset, size_t alignment) {
+  return ((offset + alignment - 1) / alignment) * alignment;
+}
+
+}  // namespace
+
+StreamBuffer::StreamBuffer(size_t size, GlState* state)
+    : state_(state), persistent_(IsBufferStorageSupported()) {
+  Allocate(size);
+}
+
+StreamBuffer::~StreamBuffer() {
+  DeleteFences();
+  if (mapped_ != nullptr) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, handle_);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  }
+  state_->DeleteBuffer(handle_);
+}
+
+void* StreamBuffer::Map(size_t size, size_t alignment, size_t* offset) {
+  if (alignment == 0) {
+    alignment = 1;
+  }
+  RetireFrames(false);
+
+  // Grow the buffer so that it holds a few frames like the current one. The
+  // regions that were written earlier in the frame are still read from the
+  // old storage, which OpenGL keeps alive until the GPU is done with it.
+  const size_t frame_size = frame_bytes_ + size + alignment;
+  if (frame_size * kFramesInFlight > size_) {
+    size_t new_size = size_ * 2;
+    while (new_size < frame_size * kFramesInFlight) {
+      new_size *= 2;
+    }
+    Allocate(new_size);
+  }
+
+  // Find room after the head, or at the start of the buffer.
+  size_t start;
+  for (;;) {
+    start = RoundUp(head_, alignment);
+    size_t padding = start - head_;
+    if (start + size > size_) {
+      start = 0;
+      padding = size_ - head_;
+    }
+    if (used_ + padding + size <= size_) {
+      head_ = start + size;
+      used_ += padding + size;
+      frame_bytes_ += padding + size;
+      break;
+    }
+
+    if (persistent_ && !frames_.empty()) {
+      // Wait until the GPU has finished reading the oldest frame.
+      RetireFrames(true);
+    } else {
+      // Orphan the storage rather than waiting for the GPU.
+      Allocate(size_);
+    }
+  }
+
+  *offset = start;
+  if (persistent_) {
+    return mapped_ + start;
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, handle_);
+  void* data = glMapBufferRange(
+      GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(start),
+      static_cast<GLsizeiptr>(size),
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+          GL_MAP_UNSYNCHRONIZED_BIT);
+  state_->CountCalls(2);
+  if (data == nullptr) {
+    throw base::Error("Unable to map the stream buffer.");
+  }
+  return data;
+}
+
+void StreamBuffer::Unmap() {
+  // Persistent mappings are coherent, so there is nothing to flush.
+  if (!persistent_) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, handle_);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    state_->CountCalls(2);
+  }
+}
+
+void StreamBuffer::EndFrame() {
+  if (frame_bytes_ == 0) {
+    return;
+  }
+  Frame frame;
+  frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  frame.bytes = frame_bytes_;
+  frames_.push_back(frame);
+  frame_bytes_ = 0;
+  state_->CountCalls(1);
+}
+
+void StreamBuffer::Allocate(size_t size) {
+  DeleteFences();
+  head_ = 0;
+  used_ = 0;
+  frame_bytes_ = 0;
+  size_ = size;
+  ++generation_;
+
+  if (persistent_) {
+    // Buffer storage is immutable, so a new buffer is needed.
+    if (handle_ != 0) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, handle_);
+      glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+      state_->DeleteBuffer(handle_);
+      mapped_ = nullptr;
+    }
+    glGenBuffers(1, &handle_);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, handle_);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size),
+                    nullptr, kPersistentFlags);
+    mapped_ = static_cast<char*>(
+        glMapBufferRange(GL_COPY_WRITE_BUFFER, 0,
+                         static_cast<GLsizeiptr>(size), kPersistentFlags));
+    state_->CountCalls(4);
+    if (mapped_ == nullptr) {
+      throw base::Error("Unable to map the stream buffer.");
+    }
+  } else {
+    // Orphan the old storage (if any). The handle stays the same.
+    if (handle_ == 0) {
+      glGenBuffers(1, &handle_);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, handle_);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size), nullptr,
+                 GL_STREAM_DRAW);
+    state_->CountCalls(2);
+  }
+}
+
+void StreamBuffer::RetireFrames(bool wait_for_oldest) {
+  while (!frames_.empty()) {
+    const auto fence = static_cast<GLsync>(frames_.front().fence);
+    GLenum result;
+    if (wait_for_oldest) {
+      do {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                  kWaitTimeoutNs);
+      } while (result == GL_TIMEOUT_EXPIRED);
+      if (result == GL_WAIT_FAILED) {
+        throw base::Error("Unable to wait for the stream buffer fence.");
+      }
+      wait_for_oldest = false;
+    } else {
+      result = glClientWaitSync(fence, 0, 0);
+    }
+    state_->CountCalls(1);
+    if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+      break;
+    }
+
+    glDeleteSync(fence);
+    used_ -= frames_.front().bytes;
+    frames_.pop_front();
+  }
+}
+
+void StreamBuffer::DeleteFences() {
+  for (const auto& frame : frames_) {
+    glDeleteSync(static_cast<GLsync>(frame.fence));
+  }
+  frames_.clear();
+}
+
+}  // namespace gfx
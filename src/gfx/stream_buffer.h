@@ -0,0 +1,143 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef GFX_STREAM_BUFFER_H_
+#define GFX_STREAM_BUFFER_H_
+
+#include <cstddef>
+#include <deque>
+
+#include "gfx/gl_state.h"
+
+namespace gfx {
+
+/// @brief A ring buffer for data that is rewritten every frame.
+///
+/// Data is written to consecutive regions of a single OpenGL buffer, and each
+/// frame is protected by a fence, so the CPU never writes to a region that the
+/// GPU may still read from, and the driver never needs to synchronize
+/// implicitly (as it may do for glBufferData() or glBufferSubData() on a
+/// buffer that is in use).
+///
+/// When ARB_buffer_storage is available (OpenGL 4.4), the buffer is mapped
+/// persistently, and writing is a plain memory copy. Otherwise each region is
+/// mapped unsynchronized, and the buffer is orphaned instead of waiting for
+/// the GPU when the ring wraps around onto a region that is still in use.
+///
+/// The buffer grows so that it holds a few frames of data, so the storage (and
+/// the handle) may change in Map(). Any vertex array or texture state that
+/// refers to the buffer must be updated when generation() changes. Comparing
+/// handles is not enough, since OpenGL may reuse the name of the deleted
+/// buffer for the new one.
+///
+/// Both vertex and index data (e.g. for UI or other dynamic geometry) may be
+/// streamed, since the buffer is only bound to GL_COPY_WRITE_BUFFER while it
+/// is written.
+class StreamBuffer {
+ public:
+  /// @brief Create the buffer.
+  /// @param size The initial size in bytes.
+  /// @param state The state of the current context, whose GL call counters
+  /// include the calls of the buffer.
+  /// @note The OpenGL context that will use the buffer must be current.
+  StreamBuffer(size_t size, GlState* state);
+
+  /// @brief Delete the buffer and the fences.
+  /// @note The OpenGL context that used the buffer must be current.
+  ~StreamBuffer();
+
+  /// @returns true if the buffer is persistently mapped.
+  bool persistent() const { return persistent_; }
+
+  unsigned int handle() const { return handle_; }
+  size_t size() const { return size_; }
+
+  /// @returns a number that changes whenever the buffer storage is replaced.
+  unsigned int generation() const { return generation_; }
+
+  /// @brief Map a region for writing.
+  /// @param size The size of the region in bytes.
+  /// @param alignment The alignment of the region offset (e.g. the vertex
+  /// size, for drawing with a base vertex). Need not be a power of two.
+  /// @param[out] offset The offset of the region in the buffer.
+  /// @returns a pointer to the region. It is valid until Unmap() is called.
+  /// @throws base::Error if the region can not be mapped.
+  void* Map(size_t size, size_t alignment, size_t* offset);
+
+  /// @brief Unmap the most recently mapped region.
+  void Unmap();
+
+  /// @brief Protect the regions of the current frame with a fence.
+  /// @note Call this after the draw calls that use the regions.
+  void EndFrame();
+
+ private:
+  struct Frame {
+    void* fence;
+
+    // The number of bytes that the frame used (including alignment padding).
+    size_t bytes;
+  };
+
+  // (Re)create the buffer storage with a new size. The contents are lost.
+  void Allocate(size_t size);
+
+  // Release the regions of all frames that the GPU has finished, optionally
+  // waiting for the oldest frame.
+  void RetireFrames(bool wait_for_oldest);
+
+  void DeleteFences();
+
+  GlState* state_;
+  bool persistent_;
+  unsigned int handle_ = 0;
+  unsigned int generation_ = 0;
+  size_t size_ = 0;
+  char* mapped_ = nullptr;
+
+  // The next free offset, and the number of bytes in use (by the current
+  // frame and by the frames that the GPU may not have finished). The used
+  // bytes end at head_, and wrap around at the end of the buffer.
+  size_t head_ = 0;
+  size_t used_ = 0;
+  size_t frame_bytes_ = 0;
+  std::deque<Frame> frames_;
+
+  // The offset and size of the region that is mapped (non-persistent mode).
+  size_t map_offset_ = 0;
+  size_t map_size_ = 0;
+
+  // Disable copy/move.
+  StreamBuffer(const StreamBuffer&) = delete;
+  StreamBuffer(StreamBuffer&&) = delete;
+  StreamBuffer& operator=(const StreamBuffer&) = delete;
+};
+
+}  // namespace gfx
+
+#endif  // GFX_STREAM_BUFFER_H_
@@ -0,0 +1,72 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef MODEL_BINARY_READER_H_
+#define MODEL_BINARY_READER_H_
+
+#include <cstdint>
+#include <cstring>
+
+namespace model {
+
+/// @returns true if the host CPU is little endian.
+inline bool IsLittleEndianHost() {
+  const uint16_t x = 1;
+  uint8_t first_byte;
+  std::memcpy(&first_byte, &x, 1);
+  return first_byte == 1;
+}
+
+/// @brief Read a value from an unaligned memory location.
+/// @param p The memory location.
+/// @param swap True if the bytes should be swapped (i.e. if the endianity of
+/// the data differs from the endianity of the host).
+template <typename T>
+inline T ReadValue(const char* p, bool swap) {
+  T result;
+  if (swap) {
+    char bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      bytes[i] = p[sizeof(T) - 1 - i];
+    }
+    std::memcpy(&result, bytes, sizeof(T));
+  } else {
+    std::memcpy(&result, p, sizeof(T));
+  }
+  return result;
+}
+
+/// @brief Read a little endian value from an unaligned memory location.
+template <typename T>
+inline T ReadLittleEndian(const char* p) {
+  return ReadValue<T>(p, !IsLittleEndianHost());
+}
+
+}  // namespace model
+
+#endif  // MODEL_BINARY_READER_H_
@@ -0,0 +1,614 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "model/bvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <utility>
+
+#include "base/make_unique.h"
+#include "base/parallel.h"
+#include "base/profiler.h"
+#include "base/task_scheduler.h"
+
+namespace model {
+
+namespace {
+
+const int kBinCount = 16;
+
+// The cost of traversing a node, relative to the cost of intersecting an item.
+const float kTraversalCost = 1.0f;
+
+// Subtrees with more items than this are built in parallel.
+const uint32_t kParallelBuildThreshold = 4096;
+
+// Nodes with more items than this have their items binned in parallel, in
+// chunks of kChunkSize items. This is also the chunk size that is used when
+// computing triangle bounds.
+const uint32_t kParallelBinThreshold = 1u << 18;
+const uint32_t kChunkSize = 1u << 16;
+
+// Below this depth, nodes are split by the SAH. Deeper nodes (which are very
+// rare) are split in half, which bounds the depth of the tree to
+// kMaxSahDepth + 32, well within kStackSize.
+const int kMaxSahDepth = 64;
+const int kStackSize = 128;
+
+const int kMaxTriangleLeafSize = 4;
+const int kMaxInstanceLeafSize = 1;
+
+const float kInfinity = std::numeric_limits<float>::infinity();
+
+struct Bin {
+  base::Aabb bounds = base::Aabb::Empty();
+  uint32_t count = 0;
+};
+
+struct Bins {
+  Bin bins[3][kBinCount];
+};
+
+// The number of chunks that a range of items is split into.
+uint32_t ChunkCount(uint32_t count) {
+  return (count + kChunkSize - 1) / kChunkSize;
+}
+
+// Builds a BVH into a preallocated node array. Nodes are allocated in pairs
+// with an atomic counter, so that subtrees can be built by concurrent tasks.
+class Builder {
+ public:
+  Builder(const base::Aabb* boxes,
+          int max_leaf_size,
+          BvhNode* nodes,
+          uint32_t* items)
+      : boxes_(boxes),
+        max_leaf_size_(static_cast<uint32_t>(std::max(max_leaf_size, 1))),
+        nodes_(nodes),
+        items_(items),
+        node_count_(1) {}
+
+  void BuildNode(uint32_t node_index, uint32_t begin, uint32_t end, int depth);
+
+  uint32_t node_count() const { return node_count_; }
+
+ private:
+  // Twice the centroid of an item (the factor two does not matter).
+  base::Vec3 GetCentroid(uint32_t item) const {
+    const base::Aabb& box = boxes_[item];
+    return box.min + box.max;
+  }
+
+  void ComputeBounds(uint32_t begin,
+                     uint32_t end,
+                     base::Aabb* bounds,
+                     base::Aabb* centroid_bounds) const;
+  void BinItems(uint32_t begin,
+                uint32_t end,
+                const float* bin_offset,
+                const float* bin_scale,
+                Bins* bins) const;
+
+  const base::Aabb* boxes_;
+  const uint32_t max_leaf_size_;
+  BvhNode* nodes_;
+  uint32_t* items_;
+  std::atomic<uint32_t> node_count_;
+};
+
+void Builder::ComputeBounds(uint32_t begin,
+                            uint32_t end,
+                            base::Aabb* bounds,
+                            base::Aabb* centroid_bounds) const {
+  const uint32_t count = end - begin;
+  if (count > kParallelBinThreshold) {
+    std::vector<base::Aabb> chunk_bounds(ChunkCount(count),
+                                         base::Aabb::Empty());
+    std::vector<base::Aabb> chunk_centroid_bounds(chunk_bounds.size(),
+                                                  base::Aabb::Empty());
+    base::ParallelFor(chunk_bounds.size(), [&](size_t i) {
+      const uint32_t chunk_begin =
+          begin + static_cast<uint32_t>(i) * kChunkSize;
+      const uint32_t chunk_end = std::min(chunk_begin + kChunkSize, end);
+      ComputeBounds(chunk_begin, chunk_end, &chunk_bounds[i],
+                    &chunk_centroid_bounds[i]);
+    });
+    for (size_t i = 0; i < chunk_bounds.size(); ++i) {
+      bounds->Grow(chunk_bounds[i]);
+      centroid_bounds->Grow(chunk_centroid_bounds[i]);
+    }
+    return;
+  }
+
+  for (uint32_t i = begin; i < end; ++i) {
+    const uint32_t item = items_[i];
+    bounds->Grow(boxes_[item]);
+    centroid_bounds->Grow(GetCentroid(item));
+  }
+}
+
+void Builder::BinItems(uint32_t begin,
+                       uint32_t end,
+                       const float* bin_offset,
+                       const float* bin_scale,
+                       Bins* bins) const {
+  const uint32_t count = end - begin;
+  if (count > kParallelBinThreshold) {
+    std::vector<Bins> chunk_bins(ChunkCount(count));
+    base::ParallelFor(chunk_bins.size(), [&](size_t i) {
+      const uint32_t chunk_begin =
+          begin + static_cast<uint32_t>(i) * kChunkSize;
+      const uint32_t chunk_end = std::min(chunk_begin + kChunkSize, end);
+      BinItems(chunk_begin, chunk_end, bin_offset, bin_scale, &chunk_bins[i]);
+    });
+    for (const auto& chunk : chunk_bins) {
+      for (int axis = 0; axis < 3; ++axis) {
+        for (int b = 0; b < kBinCount; ++b) {
+          bins->bins[axis][b].bounds.Grow(chunk.bins[axis][b].bounds);
+          bins->bins[axis][b].count += chunk.bins[axis][b].count;
+        }
+      }
+    }
+    return;
+  }
+
+  for (uint32_t i = begin; i < end; ++i) {
+    const uint32_t item = items_[i];
+    const base::Vec3 centroid = GetCentroid(item);
+    for (int axis = 0; axis < 3; ++axis) {
+      const int b = std::min(
+          static_cast<int>((centroid[axis] - bin_offset[axis]) *
+                           bin_scale[axis]),
+          kBinCount - 1);
+      Bin& bin = bins->bins[axis][b];
+      bin.bounds.Grow(boxes_[item]);
+      ++bin.count;
+    }
+  }
+}
+
+void Builder::BuildNode(uint32_t node_index,
+                        uint32_t begin,
+                        uint32_t end,
+                        int depth) {
+  base::Aabb bounds = base::Aabb::Empty();
+  base::Aabb centroid_bounds = base::Aabb::Empty();
+  ComputeBounds(begin, end, &bounds, &centroid_bounds);
+
+  BvhNode& node = nodes_[node_index];
+  for (int k = 0; k < 3; ++k) {
+    node.bounds_min[k] = bounds.min[k];
+    node.bounds_max[k] = bounds.max[k];
+  }
+
+  const uint32_t count = end - begin;
+  if (count <= 1) {
+    node.first = begin;
+    node.count = count;
+    return;
+  }
+
+  // Find the best binned SAH split. Axes where all the centroids coincide can
+  // not be split.
+  float bin_offset[3];
+  float bin_scale[3];
+  for (int axis = 0; axis < 3; ++axis) {
+    const float extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+    bin_offset[axis] = centroid_bounds.min[axis];
+    bin_scale[axis] = extent > 0.0f ? kBinCount * 0.9999f / extent : 0.0f;
+  }
+  int best_axis = -1;
+  int best_split = 0;
+  float best_cost = kInfinity;
+  if (depth < kMaxSahDepth) {
+    Bins bins;
+    BinItems(begin, end, bin_offset, bin_scale, &bins);
+    for (int axis = 0; axis < 3; ++axis) {
+      if (bin_scale[axis] == 0.0f) {
+        continue;
+      }
+
+      // Sweep from the right, storing the cost of the right side of each
+      // split, and then sweep from the left.
+      float right_cost[kBinCount];
+      base::Aabb right_bounds = base::Aabb::Empty();
+      uint32_t right_count = 0;
+      for (int b = kBinCount - 1; b > 0; --b) {
+        right_bounds.Grow(bins.bins[axis][b].bounds);
+        right_count += bins.bins[axis][b].count;
+        right_cost[b] = right_bounds.HalfArea() * right_count;
+      }
+      base::Aabb left_bounds = base::Aabb::Empty();
+      uint32_t left_count = 0;
+      for (int b = 1; b < kBinCount; ++b) {
+        left_bounds.Grow(bins.bins[axis][b - 1].bounds);
+        left_count += bins.bins[axis][b - 1].count;
+        const float cost = left_bounds.HalfArea() * left_count + right_cost[b];
+        if (left_count > 0 && left_count < count && cost < best_cost) {
+          best_axis = axis;
+          best_split = b;
+          best_cost = cost;
+        }
+      }
+    }
+
+    // Make a leaf if that is cheaper than splitting (costs are relative to the
+    // half area of the node).
+    const float leaf_cost = bounds.HalfArea() * (count - kTraversalCost);
+    if (count <= max_leaf_size_ && !(best_cost < leaf_cost)) {
+      node.first = begin;
+      node.count = count;
+      return;
+    }
+  }
+
+  // Partition the items.
+  uint32_t middle = begin + count / 2;
+  if (best_axis >= 0) {
+    const float offset = bin_offset[best_axis];
+    const float scale = bin_scale[best_axis];
+    uint32_t* split = std::partition(
+        items_ + begin, items_ + end, [this, best_axis, best_split, offset,
+                                       scale](uint32_t item) {
+          const base::Vec3 centroid = GetCentroid(item);
+          return static_cast<int>((centroid[best_axis] - offset) * scale) <
+                 best_split;
+        });
+    middle = static_cast<uint32_t>(split - items_);
+    if (middle == begin || middle == end) {
+      middle = begin + count / 2;
+    }
+  } else if (count <= max_leaf_size_) {
+    node.first = begin;
+    node.count = count;
+    return;
+  }
+
+  // Build the children, in parallel if the subtrees are large.
+  const uint32_t children = node_count_.fetch_add(2);
+  node.first = children;
+  node.count = 0;
+  if (count > kParallelBuildThreshold) {
+    auto& scheduler = base::TaskScheduler::GetDefault();
+    base::TaskGroup group;
+    scheduler.Spawn(&group, [this, children, begin, middle, depth]() {
+      BuildNode(children, begin, middle, depth + 1);
+    });
+    BuildNode(children + 1, middle, end, depth + 1);
+    scheduler.Wait(&group);
+  } else {
+    BuildNode(children, begin, middle, depth + 1);
+    BuildNode(children + 1, middle, end, depth + 1);
+  }
+}
+
+// Intersect a ray with the box of a node.
+// @returns true if the box is hit closer than max_distance. The entry distance
+// is written to *distance.
+bool IntersectBox(const BvhNode& node,
+                  const base::Vec3& origin,
+                  const base::Vec3& inv_direction,
+                  float max_distance,
+                  float* distance) {
+  float t0 = 0.0f;
+  float t1 = max_distance;
+  for (int k = 0; k < 3; ++k) {
+    float t_near = (node.bounds_min[k] - origin[k]) * inv_direction[k];
+    float t_far = (node.bounds_max[k] - origin[k]) * inv_direction[k];
+    if (t_near > t_far) {
+      std::swap(t_near, t_far);
+    }
+    t0 = std::max(t0, t_near);
+    t1 = std::min(t1, t_far);
+  }
+  *distance = t0;
+  return t0 <= t1;
+}
+
+// Traverse the nodes that a ray hits, closest child first. The leaf function
+// is called for each item in the leaves that are hit, and is responsible for
+// updating hit->distance (which is used for culling the remaining nodes).
+template <typename LeafFunction>
+void Traverse(const Bvh& bvh,
+              const base::Vec3& origin,
+              const base::Vec3& direction,
+              const RayHit* hit,
+              LeafFunction leaf_function) {
+  if (bvh.empty()) {
+    return;
+  }
+  const BvhNode* nodes = bvh.nodes().data();
+  const uint32_t* items = bvh.items().data();
+  const base::Vec3 inv_direction = {1.0f / direction.x, 1.0f / direction.y,
+                                    1.0f / direction.z};
+
+  struct StackEntry {
+    uint32_t node;
+    float distance;
+  };
+  StackEntry stack[kStackSize];
+  int stack_size = 0;
+
+  float distance;
+  if (!IntersectBox(nodes[0], origin, inv_direction, hit->distance,
+                    &distance)) {
+    return;
+  }
+  stack[stack_size++] = {0, distance};
+
+  while (stack_size > 0) {
+    const StackEntry entry = stack[--stack_size];
+    if (entry.distance > hit->distance) {
+      continue;
+    }
+    const BvhNode* node = &nodes[entry.node];
+    while (!node->is_leaf()) {
+      const uint32_t child = node->first;
+      float distance0;
+      float distance1;
+      const bool hit0 = IntersectBox(nodes[child], origin, inv_direction,
+                                     hit->distance, &distance0);
+      const bool hit1 = IntersectBox(nodes[child + 1], origin, inv_direction,
+                                     hit->distance, &distance1);
+      if (hit0 && hit1) {
+        // Continue with the closest child, and visit the other one later.
+        if (distance1 < distance0) {
+          stack[stack_size++] = {child, distance0};
+          node = &nodes[child + 1];
+        } else {
+          stack[stack_size++] = {child + 1, distance1};
+          node = &nodes[child];
+        }
+      } else if (hit0) {
+        node = &nodes[child];
+      } else if (hit1) {
+        node = &nodes[child + 1];
+      } else {
+        node = nullptr;
+        break;
+      }
+    }
+    if (node != nullptr) {
+      for (uint32_t i = 0; i < node->count; ++i) {
+        leaf_function(items[node->first + i]);
+      }
+    }
+  }
+}
+
+bool HasPositions(const Primitive& primitive) {
+  const auto& positions = primitive.positions;
+  return positions.components == 3 &&
+         (positions.type == gfx::DataType::kFloat32 ||
+          (positions.type == gfx::DataType::kInt16 && positions.normalized));
+}
+
+// Get the three vertices of a triangle, in mesh space.
+// @returns false if the triangle has an out of range index.
+bool GetTriangle(const Scene& scene,
+                 const Mesh& mesh,
+                 const Primitive& primitive,
+                 size_t triangle,
+                 base::Vec3* vertices) {
+  const auto& buffers = scene.buffers();
+  const auto& positions = primitive.positions;
+  const auto& indices = primitive.indices;
+  for (size_t k = 0; k < 3; ++k) {
+    size_t index = 3 * triangle + k;
+    if (indices.valid()) {
+      index = indices.GetIndex(buffers[static_cast<size_t>(indices.buffer)],
+                               index);
+    }
+    if (index >= positions.count) {
+      return false;
+    }
+    const auto& buffer = buffers[static_cast<size_t>(positions.buffer)];
+    if (positions.type == gfx::DataType::kFloat32) {
+      positions.GetFloats(buffer, index, &vertices[k].x);
+    } else {
+      positions.ReadFloats(buffer, index, &vertices[k].x);
+      vertices[k] = mesh.position_decode.TransformPoint(vertices[k]);
+    }
+  }
+  return true;
+}
+
+// Moller-Trumbore ray/triangle intersection (double sided).
+// @returns true if the triangle is hit closer than *distance, in which case
+// *distance is updated.
+bool IntersectTriangle(const base::Vec3& origin,
+                       const base::Vec3& direction,
+                       const base::Vec3* v,
+                       float* distance) {
+  const base::Vec3 e1 = v[1] - v[0];
+  const base::Vec3 e2 = v[2] - v[0];
+  const base::Vec3 p = base::Cross(direction, e2);
+  const float det = base::Dot(e1, p);
+  if (det == 0.0f) {
+    return false;
+  }
+  const float inv_det = 1.0f / det;
+  const base::Vec3 s = origin - v[0];
+  const float u = base::Dot(s, p) * inv_det;
+  if (u < 0.0f || u > 1.0f) {
+    return false;
+  }
+  const base::Vec3 q = base::Cross(s, e1);
+  const float w = base::Dot(direction, q) * inv_det;
+  if (w < 0.0f || u + w > 1.0f) {
+    return false;
+  }
+  const float t = base::Dot(e2, q) * inv_det;
+  if (t <= 0.0f || t >= *distance) {
+    return false;
+  }
+  *distance = t;
+  return true;
+}
+
+}  // namespace
+
+void Bvh::Build(const base::Aabb* boxes, size_t count, int max_leaf_size) {
+  base::ProfileScope scope("Bvh::Build");
+  nodes_.clear();
+  items_.resize(count);
+  if (count == 0) {
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    items_[i] = static_cast<uint32_t>(i);
+  }
+
+  // A tree has at most 2 * count - 1 nodes, but usually far fewer. The array
+  // is left uninitialized, so that the unused part is never touched.
+  std::unique_ptr<BvhNode[]> nodes(new BvhNode[2 * count - 1]);
+  Builder builder(boxes, max_leaf_size, nodes.get(), items_.data());
+  builder.BuildNode(0, 0, static_cast<uint32_t>(count), 0);
+  nodes_.assign(nodes.get(), nodes.get() + builder.node_count());
+}
+
+MeshBvh::MeshBvh(const Scene& scene, const Mesh& mesh) {
+  size_t triangle_count = 0;
+  for (const auto& primitive : mesh.primitives) {
+    primitive_offsets_.push_back(triangle_count);
+    if (HasPositions(primitive)) {
+      triangle_count += primitive.triangle_count();
+    }
+  }
+  primitive_offsets_.push_back(triangle_count);
+
+  // Compute the triangle bounds in parallel. Triangles with invalid indices
+  // get an empty box at the origin, and are never hit.
+  std::vector<base::Aabb> boxes(triangle_count);
+  for (size_t p = 0; p < mesh.primitives.size(); ++p) {
+    const auto& primitive = mesh.primitives[p];
+    const size_t first = primitive_offsets_[p];
+    const size_t count = primitive_offsets_[p + 1] - first;
+    base::ParallelFor((count + kChunkSize - 1) / kChunkSize, [&](size_t i) {
+      const size_t begin = i * kChunkSize;
+      const size_t end = std::min<size_t>(begin + kChunkSize, count);
+      for (size_t t = begin; t < end; ++t) {
+        base::Aabb& box = boxes[first + t];
+        base::Vec3 v[3];
+        if (GetTriangle(scene, mesh, primitive, t, v)) {
+          box.min = base::Min(v[0], base::Min(v[1], v[2]));
+          box.max = base::Max(v[0], base::Max(v[1], v[2]));
+        } else {
+          box = base::Aabb{{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+        }
+      }
+    });
+  }
+
+  bvh_.Build(boxes.data(), triangle_count, kMaxTriangleLeafSize);
+}
+
+bool MeshBvh::Intersect(const Scene& scene,
+                        const Mesh& mesh,
+                        const base::Vec3& origin,
+                        const base::Vec3& direction,
+                        RayHit* hit) const {
+  bool found = false;
+  Traverse(bvh_, origin, direction, hit, [&](uint32_t item) {
+    // Find the primitive that the triangle belongs to.
+    const auto it = std::upper_bound(primitive_offsets_.begin(),
+                                     primitive_offsets_.end(), item) -
+                    1;
+    const auto p = static_cast<size_t>(it - primitive_offsets_.begin());
+    const size_t triangle = item - *it;
+    base::Vec3 v[3];
+    if (GetTriangle(scene, mesh, mesh.primitives[p], triangle, v) &&
+        IntersectTriangle(origin, direction, v, &hit->distance)) {
+      hit->primitive = static_cast<int>(p);
+      hit->triangle = triangle;
+      found = true;
+    }
+  });
+  return found;
+}
+
+SceneBvh::SceneBvh(const Scene& scene) : instances_(scene.GetInstances()) {
+  // Build the mesh hierarchies in parallel (each build is parallel too).
+  const auto& meshes = scene.meshes();
+  std::vector<std::unique_ptr<MeshBvh>> mesh_bvhs(meshes.size());
+  base::ParallelFor(meshes.size(), [&](size_t i) {
+    mesh_bvhs[i] = base::make_unique<MeshBvh>(scene, meshes[i]);
+  });
+  meshes_.reserve(mesh_bvhs.size());
+  for (auto& mesh_bvh : mesh_bvhs) {
+    meshes_.push_back(std::move(*mesh_bvh));
+  }
+
+  // Build the top level hierarchy over the world space bounds of the
+  // instances.
+  std::vector<base::Aabb> boxes;
+  inverse_transforms_.resize(instances_.size());
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    const auto& instance = instances_[i];
+    const auto& bvh = meshes_[static_cast<size_t>(instance.mesh)].bvh();
+    if (bvh.empty() ||
+        !instance.transform.InvertAffine(&inverse_transforms_[i])) {
+      continue;
+    }
+    const auto& root = bvh.nodes()[0];
+    const base::Aabb local_bounds = {
+        {root.bounds_min[0], root.bounds_min[1], root.bounds_min[2]},
+        {root.bounds_max[0], root.bounds_max[1], root.bounds_max[2]}};
+    boxes.push_back(local_bounds.Transformed(instance.transform));
+    top_level_instances_.push_back(static_cast<uint32_t>(i));
+  }
+  top_level_.Build(boxes.data(), top_level_instances_.size(),
+                   kMaxInstanceLeafSize);
+}
+
+bool SceneBvh::Intersect(const Scene& scene,
+                         const base::Vec3& origin,
+                         const base::Vec3& direction,
+                         RayHit* hit) const {
+  bool found = false;
+  Traverse(top_level_, origin, direction, hit, [&](uint32_t item) {
+    // Transform the ray into the local space of the instance. The distances
+    // along the ray are the same in both spaces.
+    const uint32_t index = top_level_instances_[item];
+    const base::Mat4& m = inverse_transforms_[index];
+    const base::Vec3 local_origin = m.TransformPoint(origin);
+    const base::Vec3 local_direction = m.TransformVector(direction);
+    const auto mesh = static_cast<size_t>(instances_[index].mesh);
+    if (meshes_[mesh].Intersect(scene, scene.meshes()[mesh], local_origin,
+                                local_direction, hit)) {
+      hit->instance = static_cast<int>(index);
+      found = true;
+    }
+  });
+  return found;
+}
+
+}  // namespace model
@@ -0,0 +1,196 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef MODEL_BVH_H_
+#define MODEL_BVH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "base/math.h"
+#include "model/scene.h"
+
+namespace model {
+
+/// @brief A node in a bounding volume hierarchy.
+///
+/// Nodes are 32 bytes, so that two nodes fit in a cache line. The two children
+/// of an interior node are stored next to each other in the node array.
+struct BvhNode {
+  float bounds_min[3];
+
+  /// For leaves: the index of the first item (in Bvh::items()). For interior
+  /// nodes: the index of the first child node (the second child follows).
+  uint32_t first;
+
+  float bounds_max[3];
+
+  /// The number of items in a leaf, or zero for interior nodes.
+  uint32_t count;
+
+  bool is_leaf() const { return count != 0; }
+};
+
+static_assert(sizeof(BvhNode) == 32, "BvhNode must be 32 bytes.");
+
+/// @brief A bounding volume hierarchy over a set of axis aligned boxes.
+///
+/// The tree is built top down using binned SAH (surface area heuristic)
+/// splits, and large subtrees are built in parallel on the default task
+/// scheduler.
+class Bvh {
+ public:
+  /// @brief Build the hierarchy.
+  /// @param boxes The item boxes.
+  /// @param count The number of items.
+  /// @param max_leaf_size The maximum number of items in a leaf.
+  void Build(const base::Aabb* boxes, size_t count, int max_leaf_size);
+
+  /// @returns true if the hierarchy has no items.
+  bool empty() const { return nodes_.empty(); }
+
+  /// The nodes, with the root node first.
+  const std::vector<BvhNode>& nodes() const { return nodes_; }
+
+  /// The item indices, in leaf order.
+  const std::vector<uint32_t>& items() const { return items_; }
+
+ private:
+  std::vector<BvhNode> nodes_;
+  std::vector<uint32_t> items_;
+};
+
+/// @brief The closest intersection along a ray.
+struct RayHit {
+  /// The distance along the ray (in units of the ray direction).
+  float distance;
+
+  /// The index of the hit instance (in SceneBvh::instances()), or -1.
+  int instance = -1;
+
+  /// The index of the hit primitive within the mesh of the instance.
+  int primitive = -1;
+
+  /// The index of the hit triangle within the primitive.
+  size_t triangle = 0;
+
+  /// @brief Construct a hit that does not hit anything.
+  /// @param max_distance The maximum distance to search for hits.
+  explicit RayHit(float max_distance) : distance(max_distance) {}
+};
+
+/// @brief A bounding volume hierarchy over the triangles of a mesh.
+class MeshBvh {
+ public:
+  /// @brief Build the hierarchy.
+  /// @param scene The scene that holds the mesh buffers.
+  /// @param mesh The mesh.
+  /// @note Primitives that do not have three component float (or normalized
+  /// 16-bit integer) positions are ignored.
+  MeshBvh(const Scene& scene, const Mesh& mesh);
+
+  /// @brief Find the closest intersection between a ray and the mesh.
+  /// @param scene The scene that the hierarchy was built for.
+  /// @param mesh The mesh that the hierarchy was built for.
+  /// @param origin The ray origin.
+  /// @param direction The ray direction (need not be normalized).
+  /// @param[in,out] hit The closest hit. It is updated if a closer hit is
+  /// found (the instance is left untouched).
+  /// @returns true if a closer hit was found.
+  bool Intersect(const Scene& scene,
+                 const Mesh& mesh,
+                 const base::Vec3& origin,
+                 const base::Vec3& direction,
+                 RayHit* hit) const;
+
+  const Bvh& bvh() const { return bvh_; }
+
+ private:
+  Bvh bvh_;
+
+  // The first triangle of each primitive (triangles are numbered over all the
+  // primitives of the mesh), plus the total triangle count.
+  std::vector<size_t> primitive_offsets_;
+};
+
+/// @brief A two level bounding volume hierarchy for a scene.
+///
+/// Each mesh has a hierarchy of its own (the bottom level), and the top level
+/// hierarchy is built over the world space bounds of the mesh instances. Rays
+/// are transformed into the local space of each instance that they hit, so
+/// instanced meshes are only stored once.
+class SceneBvh {
+ public:
+  /// @brief Build the hierarchy.
+  ///
+  /// The mesh hierarchies are built in parallel.
+  /// @param scene The scene.
+  explicit SceneBvh(const Scene& scene);
+
+  /// @brief Find the closest intersection between a ray and the scene.
+  /// @param scene The scene that the hierarchy was built for.
+  /// @param origin The ray origin (in world space).
+  /// @param direction The ray direction (in world space).
+  /// @param[in,out] hit The closest hit. It is updated if a closer hit is
+  /// found.
+  /// @returns true if a closer hit was found.
+  bool Intersect(const Scene& scene,
+                 const base::Vec3& origin,
+                 const base::Vec3& direction,
+                 RayHit* hit) const;
+
+  /// The mesh instances, as returned by Scene::GetInstances().
+  const std::vector<Instance>& instances() const { return instances_; }
+
+  /// The hierarchy of each mesh in the scene.
+  const std::vector<MeshBvh>& meshes() const { return meshes_; }
+
+  /// The top level hierarchy. The items are indices into
+  /// top_level_instances().
+  const Bvh& top_level() const { return top_level_; }
+
+  /// The indices of the instances that are part of the top level hierarchy.
+  /// Instances with an empty mesh or a singular transform are left out.
+  const std::vector<uint32_t>& top_level_instances() const {
+    return top_level_instances_;
+  }
+
+ private:
+  std::vector<Instance> instances_;
+  std::vector<MeshBvh> meshes_;
+  Bvh top_level_;
+  std::vector<uint32_t> top_level_instances_;
+
+  // World to local transforms of the instances.
+  std::vector<base::Mat4> inverse_transforms_;
+};
+
+}  // namespace model
+
+#endif  // MODEL_BVH_H_
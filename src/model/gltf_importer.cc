@@ -0,0 +1,585 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "model/gltf_importer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/error.h"
+#include "base/mapped_file.h"
+#include "model/binary_reader.h"
+#include "model/json.h"
+
+namespace model {
+
+namespace {
+
+const uint32_t kGlbMagic = 0x46546c67u;      // "glTF"
+const uint32_t kGlbChunkJson = 0x4e4f534au;  // "JSON"
+const uint32_t kGlbChunkBin = 0x004e4942u;   // "BIN\0"
+
+// glTF component types (same as the OpenGL enums).
+const int kComponentByte = 5120;
+const int kComponentUnsignedByte = 5121;
+const int kComponentShort = 5122;
+const int kComponentUnsignedShort = 5123;
+const int kComponentUnsignedInt = 5125;
+const int kComponentFloat = 5126;
+
+const int kModeTriangles = 4;
+
+struct View {
+  const char* data;
+  size_t size;
+  size_t stride;
+
+  // Index of the corresponding scene buffer, created on first use.
+  int scene_buffer = -1;
+};
+
+class Importer {
+ public:
+  Importer(const std::string& path, Scene* scene)
+      : path_(path), scene_(scene) {}
+
+  void Import();
+
+ private:
+  void Fail(const std::string& message) {
+    throw base::Error("glTF: " + message + " (" + path_ + ")");
+  }
+
+  const JsonValue& GetArray(const char* name);
+  void LoadContainer();
+  void LoadBuffers();
+  void LoadViews();
+  void LoadMeshes();
+  void LoadNodes();
+  gfx::Accessor LoadAccessor(size_t index);
+  void LoadBounds(size_t accessor_index, Primitive* primitive);
+
+  const std::string path_;
+  Scene* const scene_;
+
+  JsonValue root_;
+  std::shared_ptr<base::MappedFile> file_;
+  const char* glb_bin_ = nullptr;
+  size_t glb_bin_size_ = 0;
+
+  std::vector<gfx::BufferData> buffers_;
+  std::vector<View> views_;
+};
+
+std::string GetDirectory(const std::string& path) {
+  const auto pos = path.find_last_of("/\\");
+  return pos == std::string::npos ? std::string() : path.substr(0, pos + 1);
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// URIs in glTF files may contain percent encoded characters (e.g. "%20").
+std::string DecodeUri(const std::string& uri) {
+  std::string result;
+  for (size_t i = 0; i < uri.size(); ++i) {
+    if (uri[i] == '%' && i + 2 < uri.size() && HexValue(uri[i + 1]) >= 0 &&
+        HexValue(uri[i + 2]) >= 0) {
+      result.push_back(
+          static_cast<char>(HexValue(uri[i + 1]) * 16 + HexValue(uri[i + 2])));
+      i += 2;
+    } else {
+      result.push_back(uri[i]);
+    }
+  }
+  return result;
+}
+
+int Base64Value(char c) {
+  if (c >= 'A' && c <= 'Z') {
+    return c - 'A';
+  } else if (c >= 'a' && c <= 'z') {
+    return c - 'a' + 26;
+  } else if (c >= '0' && c <= '9') {
+    return c - '0' + 52;
+  } else if (c == '+' || c == '-') {
+    return 62;
+  } else if (c == '/' || c == '_') {
+    return 63;
+  }
+  return -1;
+}
+
+bool DecodeBase64(const char* p, const char* end, std::vector<char>* result) {
+  result->reserve(static_cast<size_t>(end - p) / 4 * 3);
+  uint32_t bits = 0;
+  int bit_count = 0;
+  for (; p < end && *p != '='; ++p) {
+    const int value = Base64Value(*p);
+    if (value < 0) {
+      return false;
+    }
+    bits = (bits << 6) | static_cast<uint32_t>(value);
+    bit_count += 6;
+    if (bit_count >= 8) {
+      bit_count -= 8;
+      result->push_back(static_cast<char>((bits >> bit_count) & 0xff));
+    }
+  }
+  return true;
+}
+
+// Read a fixed size number array. Returns false if the value is missing or has
+// the wrong size, in which case the result is left untouched.
+bool GetFloats(const JsonValue* value, size_t count, float* result) {
+  if (value == nullptr || value->elements().size() != count) {
+    return false;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    result[i] = static_cast<float>(value->elements()[i].number_value());
+  }
+  return true;
+}
+
+int ComponentCount(const std::string& type) {
+  if (type == "SCALAR") {
+    return 1;
+  } else if (type == "VEC2") {
+    return 2;
+  } else if (type == "VEC3") {
+    return 3;
+  } else if (type == "VEC4") {
+    return 4;
+  }
+  return 0;
+}
+
+bool ToDataType(int component_type, gfx::DataType* type) {
+  switch (component_type) {
+    case kComponentByte:
+      *type = gfx::DataType::kInt8;
+      return true;
+    case kComponentUnsignedByte:
+      *type = gfx::DataType::kUInt8;
+      return true;
+    case kComponentShort:
+      *type = gfx::DataType::kInt16;
+      return true;
+    case kComponentUnsignedShort:
+      *type = gfx::DataType::kUInt16;
+      return true;
+    case kComponentUnsignedInt:
+      *type = gfx::DataType::kUInt32;
+      return true;
+    case kComponentFloat:
+      *type = gfx::DataType::kFloat32;
+      return true;
+  }
+  return false;
+}
+
+const JsonValue& Importer::GetArray(const char* name) {
+  static const JsonValue kEmpty;
+  const JsonValue* value = root_.Find(name);
+  if (value == nullptr) {
+    return kEmpty;
+  }
+  if (!value->is_array()) {
+    Fail(std::string("\"") + name + "\" is not an array");
+  }
+  return *value;
+}
+
+void Importer::LoadContainer() {
+  file_ = std::make_shared<base::MappedFile>(path_);
+  scene_->AddFile(file_);
+  const char* data = file_->data();
+  const size_t size = file_->size();
+
+  if (size < 12 || ReadLittleEndian<uint32_t>(data) != kGlbMagic) {
+    // Plain JSON (.gltf).
+    root_ = JsonValue::Parse(data, size);
+    return;
+  }
+
+  // Binary glTF (.glb): a header followed by a JSON chunk and an optional
+  // binary chunk.
+  if (ReadLittleEndian<uint32_t>(data + 4) != 2) {
+    Fail("Unsupported GLB version");
+  }
+  const size_t length = ReadLittleEndian<uint32_t>(data + 8);
+  if (length > size) {
+    Fail("Truncated GLB file");
+  }
+  bool has_json = false;
+  size_t pos = 12;
+  while (pos + 8 <= length) {
+    const size_t chunk_size = ReadLittleEndian<uint32_t>(data + pos);
+    const uint32_t chunk_type = ReadLittleEndian<uint32_t>(data + pos + 4);
+    pos += 8;
+    if (chunk_size > length - pos) {
+      Fail("Truncated GLB chunk");
+    }
+    if (chunk_type == kGlbChunkJson && !has_json) {
+      root_ = JsonValue::Parse(data + pos, chunk_size);
+      has_json = true;
+    } else if (chunk_type == kGlbChunkBin && glb_bin_ == nullptr) {
+      glb_bin_ = data + pos;
+      glb_bin_size_ = chunk_size;
+    }
+    pos += (chunk_size + 3) & ~static_cast<size_t>(3);
+  }
+  if (!has_json) {
+    Fail("Missing JSON chunk");
+  }
+}
+
+void Importer::LoadBuffers() {
+  const auto directory = GetDirectory(path_);
+  const auto& buffers = GetArray("buffers");
+  for (size_t i = 0; i < buffers.elements().size(); ++i) {
+    const auto& buffer = buffers.elements()[i];
+    const size_t byte_length = buffer.GetIndex("byteLength", 0);
+    const JsonValue* uri_value = buffer.Find("uri");
+
+    gfx::BufferData data;
+    if (uri_value == nullptr) {
+      // The first buffer of a GLB file refers to the binary chunk.
+      if (i != 0 || glb_bin_ == nullptr) {
+        Fail("Buffer without data");
+      }
+      data.data = glb_bin_;
+      data.size = glb_bin_size_;
+    } else {
+      const auto& uri = uri_value->string_value();
+      if (uri.compare(0, 5, "data:") == 0) {
+        const auto comma = uri.find(',');
+        if (comma == std::string::npos ||
+            uri.rfind(";base64", comma) == std::string::npos) {
+          Fail("Unsupported data URI");
+        }
+        std::vector<char> decoded;
+        if (!DecodeBase64(uri.data() + comma + 1, uri.data() + uri.size(),
+                          &decoded)) {
+          Fail("Invalid base64 data");
+        }
+        data.size = decoded.size();
+        data.data = scene_->AddStorage(std::move(decoded));
+      } else {
+        auto file =
+            std::make_shared<base::MappedFile>(directory + DecodeUri(uri));
+        scene_->AddFile(file);
+        data.data = file->data();
+        data.size = file->size();
+      }
+    }
+    if (data.size < byte_length) {
+      Fail("Buffer is too small");
+    }
+    data.size = byte_length;
+    buffers_.push_back(data);
+  }
+}
+
+void Importer::LoadViews() {
+  const auto& views = GetArray("bufferViews");
+  for (const auto& view : views.elements()) {
+    const size_t buffer = view.GetIndex("buffer", buffers_.size());
+    if (buffer >= buffers_.size()) {
+      Fail("Invalid buffer index");
+    }
+    const size_t offset = view.GetIndex("byteOffset", 0);
+    const size_t length = view.GetIndex("byteLength", 0);
+    if (offset > buffers_[buffer].size ||
+        length > buffers_[buffer].size - offset) {
+      Fail("Buffer view is out of range");
+    }
+    View result;
+    result.data = buffers_[buffer].data + offset;
+    result.size = length;
+    result.stride = view.GetIndex("byteStride", 0);
+    views_.push_back(result);
+  }
+}
+
+gfx::Accessor Importer::LoadAccessor(size_t index) {
+  const auto& accessors = GetArray("accessors").elements();
+  if (index >= accessors.size()) {
+    Fail("Invalid accessor index");
+  }
+  const auto& accessor = accessors[index];
+  if (accessor.Find("sparse") != nullptr) {
+    Fail("Sparse accessors are not supported");
+  }
+  const size_t view_index = accessor.GetIndex("bufferView", views_.size());
+  if (view_index >= views_.size()) {
+    Fail("Accessors without a buffer view are not supported");
+  }
+  View& view = views_[view_index];
+
+  gfx::Accessor result;
+  result.offset = accessor.GetIndex("byteOffset", 0);
+  result.stride = view.stride;
+  result.count = accessor.GetIndex("count", 0);
+  result.components = ComponentCount(accessor.GetString("type", ""));
+  if (result.components == 0 ||
+      !ToDataType(static_cast<int>(accessor.GetNumber("componentType", 0)),
+                  &result.type)) {
+    Fail("Unsupported accessor type");
+  }
+  const JsonValue* normalized = accessor.Find("normalized");
+  result.normalized = normalized != nullptr && normalized->bool_value();
+  if (result.offset > view.size ||
+      result.byte_length() > view.size - result.offset) {
+    Fail("Accessor is out of range");
+  }
+
+  // Only create GPU buffers for views that are actually used by meshes
+  // (e.g. not for embedded images).
+  if (view.scene_buffer < 0) {
+    view.scene_buffer = scene_->AddBuffer(view.data, view.size);
+  }
+  result.buffer = view.scene_buffer;
+  return result;
+}
+
+void Importer::LoadBounds(size_t accessor_index, Primitive* primitive) {
+  const auto& accessor = GetArray("accessors").elements()[accessor_index];
+  auto& bounds = primitive->bounds;
+  if (GetFloats(accessor.Find("min"), 3, &bounds.min.x) &&
+      GetFloats(accessor.Find("max"), 3, &bounds.max.x)) {
+    return;
+  }
+
+  // The bounds are required by the spec, but calculate them if missing.
+  const auto& positions = primitive->positions;
+  const auto& buffer = scene_->buffers()[static_cast<size_t>(positions.buffer)];
+  if (positions.count == 0) {
+    return;
+  }
+  bounds = base::Aabb::Empty();
+  for (size_t i = 0; i < positions.count; ++i) {
+    base::Vec3 position;
+    positions.GetFloats(buffer, i, &position.x);
+    bounds.Grow(position);
+  }
+}
+
+void Importer::LoadMeshes() {
+  for (const auto& mesh : GetArray("meshes").elements()) {
+    Mesh result;
+    result.name = mesh.GetString("name", "");
+    const JsonValue* primitives = mesh.Find("primitives");
+    if (primitives == nullptr) {
+      Fail("Mesh without primitives");
+    }
+    for (const auto& primitive : primitives->elements()) {
+      // Only triangle lists are supported. Other primitives (points, lines,
+      // strips and fans) are skipped.
+      if (primitive.GetNumber("mode", kModeTriangles) != kModeTriangles) {
+        continue;
+      }
+      const JsonValue* attributes = primitive.Find("attributes");
+      if (attributes == nullptr) {
+        Fail("Primitive without attributes");
+      }
+
+      Primitive out;
+      const size_t kNone = static_cast<size_t>(-1);
+      const size_t position_index = attributes->GetIndex("POSITION", kNone);
+      if (position_index == kNone) {
+        Fail("Primitive without positions");
+      }
+      out.positions = LoadAccessor(position_index);
+      if (out.positions.type != gfx::DataType::kFloat32 ||
+          out.positions.components != 3) {
+        Fail("Unsupported position format");
+      }
+
+      const size_t normal_index = attributes->GetIndex("NORMAL", kNone);
+      if (normal_index != kNone) {
+        out.normals = LoadAccessor(normal_index);
+        if (out.normals.components != 3 ||
+            out.normals.count != out.positions.count) {
+          Fail("Invalid normals");
+        }
+      }
+
+      const size_t tex_coord_index = attributes->GetIndex("TEXCOORD_0", kNone);
+      if (tex_coord_index != kNone) {
+        out.tex_coords = LoadAccessor(tex_coord_index);
+        if (out.tex_coords.components != 2 ||
+            out.tex_coords.count != out.positions.count) {
+          Fail("Invalid texture coordinates");
+        }
+      }
+
+      const size_t indices_index = primitive.GetIndex("indices", kNone);
+      if (indices_index != kNone) {
+        out.indices = LoadAccessor(indices_index);
+        if (out.indices.components != 1 || out.indices.stride != 0 ||
+            (out.indices.type != gfx::DataType::kUInt8 &&
+             out.indices.type != gfx::DataType::kUInt16 &&
+             out.indices.type != gfx::DataType::kUInt32)) {
+          Fail("Invalid indices");
+        }
+      }
+
+      LoadBounds(position_index, &out);
+      result.primitives.push_back(out);
+    }
+    scene_->AddMesh(std::move(result));
+  }
+}
+
+void Importer::LoadNodes() {
+  const auto& nodes = GetArray("nodes").elements();
+  const auto mesh_count = scene_->meshes().size();
+  std::vector<bool> has_parent(nodes.size(), false);
+
+  for (const auto& node : nodes) {
+    Node result;
+    result.name = node.GetString("name", "");
+
+    const size_t mesh = node.GetIndex("mesh", mesh_count);
+    if (node.Find("mesh") != nullptr) {
+      if (mesh >= mesh_count) {
+        Fail("Invalid mesh index");
+      }
+      result.mesh = static_cast<int>(mesh);
+    }
+
+    const JsonValue* children = node.Find("children");
+    if (children != nullptr) {
+      for (const auto& child : children->elements()) {
+        const double index = child.number_value();
+        if (!child.is_number() || index < 0.0 ||
+            index >= static_cast<double>(nodes.size())) {
+          Fail("Invalid child node index");
+        }
+        const auto child_index = static_cast<size_t>(index);
+
+        // The node hierarchy must be a set of disjoint trees.
+        if (has_parent[child_index]) {
+          Fail("Node with multiple parents");
+        }
+        has_parent[child_index] = true;
+        result.children.push_back(static_cast<int>(child_index));
+      }
+    }
+
+    if (!GetFloats(node.Find("matrix"), 16, result.transform.m)) {
+      float translation[3] = {0.0f, 0.0f, 0.0f};
+      float rotation[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+      float scale[3] = {1.0f, 1.0f, 1.0f};
+      GetFloats(node.Find("translation"), 3, translation);
+      GetFloats(node.Find("rotation"), 4, rotation);
+      GetFloats(node.Find("scale"), 3, scale);
+      result.SetTransform(translation, rotation, scale);
+    }
+
+    scene_->AddNode(result);
+  }
+
+  // Use the root nodes of the default scene. If there are no scenes, use all
+  // the nodes that are not children of other nodes.
+  const auto& scenes = GetArray("scenes").elements();
+  if (!scenes.empty()) {
+    const size_t scene_index = root_.GetIndex("scene", 0);
+    if (scene_index >= scenes.size()) {
+      Fail("Invalid scene index");
+    }
+    const JsonValue* roots = scenes[scene_index].Find("nodes");
+    if (roots != nullptr) {
+      for (const auto& root : roots->elements()) {
+        const double index = root.number_value();
+        if (!root.is_number() || index < 0.0 ||
+            index >= static_cast<double>(nodes.size()) ||
+            has_parent[static_cast<size_t>(index)]) {
+          Fail("Invalid root node");
+        }
+        scene_->AddRoot(static_cast<int>(index));
+      }
+    }
+  } else {
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      if (!has_parent[i]) {
+        scene_->AddRoot(static_cast<int>(i));
+      }
+    }
+  }
+
+  // A file with meshes but no nodes is still useful to look at.
+  if (nodes.empty()) {
+    for (size_t i = 0; i < mesh_count; ++i) {
+      Node node;
+      node.mesh = static_cast<int>(i);
+      scene_->AddRoot(scene_->AddNode(node));
+    }
+  }
+}
+
+void Importer::Import() {
+  LoadContainer();
+  if (!root_.is_object()) {
+    Fail("Invalid document");
+  }
+  const JsonValue* asset = root_.Find("asset");
+  if (asset == nullptr ||
+      asset->GetString("version", "").compare(0, 2, "2.") != 0) {
+    Fail("Only glTF version 2.x is supported");
+  }
+
+  LoadBuffers();
+  LoadViews();
+  LoadMeshes();
+  LoadNodes();
+}
+
+}  // namespace
+
+Scene ImportGltf(const std::string& path) {
+  Scene scene;
+  Importer importer(path, &scene);
+  importer.Import();
+  return scene;
+}
+
+}  // namespace model
@@ -0,0 +1,53 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef MODEL_GLTF_IMPORTER_H_
+#define MODEL_GLTF_IMPORTER_H_
+
+#include <string>
+
+#include "model/scene.h"
+
+namespace model {
+
+/// @brief Import a glTF 2.0 file (.gltf or binary .glb).
+///
+/// External buffers and GLB files are memory mapped, and the scene buffers
+/// refer directly to the buffer views in the mapped files, so that they can be
+/// uploaded to the GPU without any intermediate copies or conversions. The
+/// node hierarchy is preserved, and meshes that are referenced by several
+/// nodes are only stored once.
+/// @param path The path to the glTF file.
+/// @returns the imported scene.
+/// @throws base::Error if the file could not be read, is malformed or uses
+/// unsupported features (e.g. sparse accessors).
+Scene ImportGltf(const std::string& path);
+
+}  // namespace model
+
+#endif  // MODEL_GLTF_IMPORTER_H_
@@ -0,0 +1,90 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "model/importer.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "base/error.h"
+#include "base/profiler.h"
+#include "model/gltf_importer.h"
+#include "model/obj_importer.h"
+#include "model/ply_importer.h"
+#include "model/stl_importer.h"
+
+namespace model {
+
+namespace {
+
+std::string GetLowerCaseExtension(const std::string& path) {
+  const auto pos = path.find_last_of("./\\");
+  if (pos == std::string::npos || path[pos] != '.') {
+    return std::string();
+  }
+  std::string extension = path.substr(pos + 1);
+  // std::tolower() is undefined for negative values (non-ASCII bytes of a
+  // signed char).
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](char c) {
+                   return static_cast<char>(
+                       std::tolower(static_cast<unsigned char>(c)));
+                 });
+  return extension;
+}
+
+}  // namespace
+
+gfx::Mesh ImportMesh(const std::string& path) {
+  const auto extension = GetLowerCaseExtension(path);
+  if (extension == "obj") {
+    return ImportObj(path);
+  } else if (extension == "stl") {
+    return ImportStl(path);
+  } else if (extension == "ply") {
+    return ImportPly(path);
+  }
+  throw base::Error("Unsupported file format: " + path);
+}
+
+Scene ImportScene(const std::string& path) {
+  base::ProfileScope scope("ImportScene");
+  const auto extension = GetLowerCaseExtension(path);
+  if (extension == "gltf" || extension == "glb") {
+    return ImportGltf(path);
+  }
+
+  Scene scene;
+  const auto name_pos = path.find_last_of("/\\");
+  scene.AddMesh(ImportMesh(path), name_pos == std::string::npos
+                                      ? path
+                                      : path.substr(name_pos + 1));
+  return scene;
+}
+
+}  // namespace model
@@ -0,0 +1,392 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "model/json.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "base/error.h"
+
+namespace model {
+
+namespace {
+
+// Protect against stack overflow for maliciously nested documents.
+const int kMaxDepth = 512;
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+int HexDigitValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+void AppendUtf8(uint32_t code_point, std::string* str) {
+  if (code_point < 0x80) {
+    str->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    str->push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+    str->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else if (code_point < 0x10000) {
+    str->push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+    str->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    str->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else {
+    str->push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+    str->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+    str->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    str->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  }
+}
+
+}  // namespace
+
+class JsonValue::Parser {
+ public:
+  Parser(const char* data, size_t size) : p_(data), end_(data + size) {}
+
+  void ParseDocument(JsonValue* value) {
+    ParseValue(value, 0);
+    SkipWhitespace();
+    if (p_ != end_) {
+      Fail("Unexpected trailing data");
+    }
+  }
+
+ private:
+  void Fail(const char* message) {
+    throw base::Error(std::string("JSON: ") + message);
+  }
+
+  void SkipWhitespace() {
+    while (p_ < end_ &&
+           (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) {
+      ++p_;
+    }
+  }
+
+  void Expect(char c) {
+    SkipWhitespace();
+    if (p_ >= end_ || *p_ != c) {
+      Fail("Unexpected character");
+    }
+    ++p_;
+  }
+
+  void ExpectLiteral(const char* literal) {
+    const size_t length = std::strlen(literal);
+    if (static_cast<size_t>(end_ - p_) < length ||
+        std::memcmp(p_, literal, length) != 0) {
+      Fail("Invalid literal");
+    }
+    p_ += length;
+  }
+
+  void ParseValue(JsonValue* value, int depth) {
+    if (depth > kMaxDepth) {
+      Fail("Too deeply nested");
+    }
+    SkipWhitespace();
+    if (p_ >= end_) {
+      Fail("Unexpected end of data");
+    }
+    switch (*p_) {
+      case '{':
+        ParseObject(value, depth);
+        break;
+      case '[':
+        ParseArray(value, depth);
+        break;
+      case '"':
+        value->type_ = Type::kString;
+        ParseString(&value->string_);
+        break;
+      case 't':
+        ExpectLiteral("true");
+        value->type_ = Type::kBool;
+        value->bool_ = true;
+        break;
+      case 'f':
+        ExpectLiteral("false");
+        value->type_ = Type::kBool;
+        value->bool_ = false;
+        break;
+      case 'n':
+        ExpectLiteral("null");
+        value->type_ = Type::kNull;
+        break;
+      default:
+        value->type_ = Type::kNumber;
+        value->number_ = ParseNumber();
+        break;
+    }
+  }
+
+  void ParseObject(JsonValue* value, int depth) {
+    value->type_ = Type::kObject;
+    ++p_;
+    SkipWhitespace();
+    if (p_ < end_ && *p_ == '}') {
+      ++p_;
+      return;
+    }
+    while (true) {
+      SkipWhitespace();
+      if (p_ >= end_ || *p_ != '"') {
+        Fail("Expected a member name");
+      }
+      value->members_.emplace_back();
+      auto& member = value->members_.back();
+      ParseString(&member.first);
+      Expect(':');
+      ParseValue(&member.second, depth + 1);
+      SkipWhitespace();
+      if (p_ < end_ && *p_ == ',') {
+        ++p_;
+        continue;
+      }
+      Expect('}');
+      return;
+    }
+  }
+
+  void ParseArray(JsonValue* value, int depth) {
+    value->type_ = Type::kArray;
+    ++p_;
+    SkipWhitespace();
+    if (p_ < end_ && *p_ == ']') {
+      ++p_;
+      return;
+    }
+    while (true) {
+      value->elements_.emplace_back();
+      ParseValue(&value->elements_.back(), depth + 1);
+      SkipWhitespace();
+      if (p_ < end_ && *p_ == ',') {
+        ++p_;
+        continue;
+      }
+      Expect(']');
+      return;
+    }
+  }
+
+  uint32_t ParseHex4() {
+    if (end_ - p_ < 4) {
+      Fail("Invalid unicode escape");
+    }
+    uint32_t result = 0;
+    for (int i = 0; i < 4; ++i) {
+      const int digit = HexDigitValue(*p_++);
+      if (digit < 0) {
+        Fail("Invalid unicode escape");
+      }
+      result = (result << 4) | static_cast<uint32_t>(digit);
+    }
+    return result;
+  }
+
+  void ParseString(std::string* str) {
+    ++p_;
+    while (true) {
+      // Copy runs of plain characters in one go.
+      const char* start = p_;
+      while (p_ < end_ && *p_ != '"' && *p_ != '\\') {
+        ++p_;
+      }
+      str->append(start, p_);
+      if (p_ >= end_) {
+        Fail("Unterminated string");
+      }
+      if (*p_++ == '"') {
+        return;
+      }
+
+      // Escape sequence.
+      if (p_ >= end_) {
+        Fail("Unterminated string");
+      }
+      const char c = *p_++;
+      switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+          str->push_back(c);
+          break;
+        case 'b':
+          str->push_back('\b');
+          break;
+        case 'f':
+          str->push_back('\f');
+          break;
+        case 'n':
+          str->push_back('\n');
+          break;
+        case 'r':
+          str->push_back('\r');
+          break;
+        case 't':
+          str->push_back('\t');
+          break;
+        case 'u': {
+          uint32_t code_point = ParseHex4();
+          if (code_point >= 0xd800 && code_point < 0xdc00 && end_ - p_ >= 6 &&
+              p_[0] == '\\' && p_[1] == 'u') {
+            // Surrogate pair.
+            p_ += 2;
+            const uint32_t low = ParseHex4();
+            code_point = 0x10000 + ((code_point - 0xd800) << 10) +
+                         ((low - 0xdc00) & 0x3ff);
+          }
+          AppendUtf8(code_point, str);
+          break;
+        }
+        default:
+          Fail("Invalid escape sequence");
+      }
+    }
+  }
+
+  double ParseNumber() {
+    bool negative = false;
+    if (p_ < end_ && *p_ == '-') {
+      negative = true;
+      ++p_;
+    }
+    if (p_ >= end_ || !IsDigit(*p_)) {
+      Fail("Invalid number");
+    }
+
+    // Accumulate the significant digits in an integer, so that integers are
+    // represented exactly.
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    for (; p_ < end_ && IsDigit(*p_); ++p_) {
+      if (mantissa < (UINT64_C(1) << 59)) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p_ - '0');
+      } else {
+        ++exponent;
+      }
+    }
+    if (p_ < end_ && *p_ == '.') {
+      ++p_;
+      if (p_ >= end_ || !IsDigit(*p_)) {
+        Fail("Invalid number");
+      }
+      for (; p_ < end_ && IsDigit(*p_); ++p_) {
+        if (mantissa < (UINT64_C(1) << 59)) {
+          mantissa = mantissa * 10 + static_cast<uint64_t>(*p_ - '0');
+          --exponent;
+        }
+      }
+    }
+    if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+      ++p_;
+      bool negative_exponent = false;
+      if (p_ < end_ && (*p_ == '+' || *p_ == '-')) {
+        negative_exponent = *p_ == '-';
+        ++p_;
+      }
+      if (p_ >= end_ || !IsDigit(*p_)) {
+        Fail("Invalid number");
+      }
+      int exp = 0;
+      for (; p_ < end_ && IsDigit(*p_); ++p_) {
+        if (exp < 10000) {
+          exp = exp * 10 + (*p_ - '0');
+        }
+      }
+      exponent += negative_exponent ? -exp : exp;
+    }
+
+    double result = static_cast<double>(mantissa);
+    if (exponent != 0) {
+      result *= std::pow(10.0, static_cast<double>(exponent));
+    }
+    return negative ? -result : result;
+  }
+
+  const char* p_;
+  const char* const end_;
+};
+
+JsonValue JsonValue::Parse(const char* data, size_t size) {
+  JsonValue result;
+  Parser parser(data, size);
+  parser.ParseDocument(&result);
+  return result;
+}
+
+const JsonValue* JsonValue::Find(const char* name) const {
+  for (const auto& member : members_) {
+    if (member.first == name) {
+      return &member.second;
+    }
+  }
+  return nullptr;
+}
+
+double JsonValue::GetNumber(const char* name, double default_value) const {
+  const JsonValue* value = Find(name);
+  return (value != nullptr && value->is_number()) ? value->number_
+                                                  : default_value;
+}
+
+size_t JsonValue::GetIndex(const char* name, size_t default_value) const {
+  const JsonValue* value = Find(name);
+  if (value == nullptr || !value->is_number()) {
+    return default_value;
+  }
+  const double number = value->number_;
+  if (number < 0.0 || number > 9007199254740992.0 ||
+      number != std::floor(number)) {
+    throw base::Error(std::string("JSON: Invalid index/size for \"") + name +
+                      "\"");
+  }
+  return static_cast<size_t>(number);
+}
+
+std::string JsonValue::GetString(const char* name,
+                                 const std::string& default_value) const {
+  const JsonValue* value = Find(name);
+  return (value != nullptr && value->is_string()) ? value->string_
+                                                  : default_value;
+}
+
+}  // namespace model
@@ -0,0 +1,511 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "model/obj_importer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "base/error.h"
+#include "base/mapped_file.h"
+#include "base/parallel.h"
+#include "model/text_parser.h"
+
+namespace model {
+
+namespace {
+
+// Chunks smaller than this are not worth the threading overhead.
+const size_t kMinChunkSize = 1 << 20;
+
+// We use a few more chunks than threads, since different parts of the file
+// may take different time to parse (e.g. vertex lines vs face lines).
+const size_t kChunksPerThread = 4;
+
+// Marks a missing texture coordinate or normal index.
+const uint32_t kNoIndex = 0xffffffffu;
+
+// A face corner, with zero based indices into the global attribute arrays.
+struct Corner {
+  uint32_t v;
+  uint32_t vt;
+  uint32_t vn;
+};
+
+// Negative (relative) OBJ indices can not be resolved until we know how many
+// attributes were defined in the preceding chunks, so they are recorded as
+// fixups and patched once all chunks have been parsed.
+struct Fixup {
+  size_t corner;
+  int component;
+  int64_t local_index;
+};
+
+// Open addressing hash map from corners to vertex indices.
+class CornerMap {
+ public:
+  explicit CornerMap(size_t max_size) {
+    size_t capacity = 16;
+    while (capacity < max_size * 2) {
+      capacity *= 2;
+    }
+    slots_.resize(capacity);
+    mask_ = capacity - 1;
+  }
+
+  // Returns the index for the corner, or kNoIndex if the corner was inserted
+  // (in which case it is given the index new_index).
+  uint32_t FindOrInsert(const Corner& corner, uint32_t new_index) {
+    size_t i = Hash(corner) & mask_;
+    while (true) {
+      Slot& slot = slots_[i];
+      if (slot.index == kNoIndex) {
+        slot.corner = corner;
+        slot.index = new_index;
+        return kNoIndex;
+      }
+      if (slot.corner.v == corner.v && slot.corner.vt == corner.vt &&
+          slot.corner.vn == corner.vn) {
+        return slot.index;
+      }
+      i = (i + 1) & mask_;
+    }
+  }
+
+ private:
+  struct Slot {
+    Corner corner;
+    uint32_t index = kNoIndex;
+  };
+
+  static size_t Hash(const Corner& c) {
+    uint64_t h = static_cast<uint64_t>(c.v) * 0x9e3779b97f4a7c15ull;
+    h ^= static_cast<uint64_t>(c.vt) * 0xc2b2ae3d27d4eb4full;
+    h ^= static_cast<uint64_t>(c.vn) * 0x165667b19e3779f9ull;
+    return static_cast<size_t>(h ^ (h >> 29));
+  }
+
+  std::vector<Slot> slots_;
+  size_t mask_;
+};
+
+struct Chunk {
+  const char* begin;
+  const char* end;
+
+  // Parsed attributes.
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::vector<float> tex_coords;
+
+  // Triangulated faces (three corners per triangle).
+  std::vector<Corner> corners;
+  std::vector<Fixup> fixups;
+
+  // Scratch space for the polygon that is currently being parsed.
+  std::vector<Corner> polygon;
+  std::vector<Fixup> polygon_fixups;
+
+  // Offsets of this chunk into the global arrays.
+  size_t position_base = 0;
+  size_t normal_base = 0;
+  size_t tex_coord_base = 0;
+  size_t vertex_base = 0;
+  size_t index_base = 0;
+
+  // Unique corners of this chunk (i.e. the vertices), and the triangle indices
+  // into that list.
+  std::vector<Corner> unique_corners;
+  std::vector<uint32_t> local_indices;
+};
+
+void ThrowMalformed() {
+  throw base::Error("Malformed OBJ file.");
+}
+
+const char* ParseFloats(const char* p,
+                        const char* end,
+                        int count,
+                        std::vector<float>* values) {
+  for (int i = 0; i < count; ++i) {
+    float value;
+    p = ParseFloat(SkipSpaces(p, end), end, &value);
+    if (p == nullptr) {
+      ThrowMalformed();
+    }
+    values->push_back(value);
+  }
+  return p;
+}
+
+// Parse a texture coordinate, which has one to three components (u [v [w]]).
+// A missing v defaults to zero, and w is ignored.
+const char* ParseTexCoord(const char* p,
+                          const char* end,
+                          std::vector<float>* values) {
+  float uv[2] = {0.0f, 0.0f};
+  for (int i = 0; i < 3; ++i) {
+    p = SkipSpaces(p, end);
+    if (i > 0 && (IsEndOfLine(p, end) || *p == '#')) {
+      break;
+    }
+    float value;
+    p = ParseFloat(p, end, &value);
+    if (p == nullptr) {
+      ThrowMalformed();
+    }
+    if (i < 2) {
+      uv[i] = value;
+    }
+  }
+  values->push_back(uv[0]);
+  values->push_back(uv[1]);
+  return p;
+}
+
+// Parse a single OBJ index. Returns the zero based absolute index, or records
+// a fixup for relative indices.
+uint32_t ResolveIndex(int64_t index,
+                      size_t local_count,
+                      size_t corner,
+                      int component,
+                      std::vector<Fixup>* fixups) {
+  if (index > 0) {
+    if (index > static_cast<int64_t>(kNoIndex)) {
+      ThrowMalformed();
+    }
+    return static_cast<uint32_t>(index - 1);
+  }
+  if (index < 0) {
+    Fixup fixup;
+    fixup.corner = corner;
+    fixup.component = component;
+    fixup.local_index = static_cast<int64_t>(local_count) + index;
+    fixups->push_back(fixup);
+    return 0;
+  }
+  ThrowMalformed();
+  return 0;
+}
+
+const char* ParseFace(const char* p, const char* end, Chunk* chunk) {
+  const size_t num_positions = chunk->positions.size() / 3;
+  const size_t num_normals = chunk->normals.size() / 3;
+  const size_t num_tex_coords = chunk->tex_coords.size() / 2;
+
+  // Collect the polygon corners. Any fixups refer to the polygon corner for
+  // now, and are re-targeted to the triangle corners below.
+  auto& polygon = chunk->polygon;
+  auto& polygon_fixups = chunk->polygon_fixups;
+  polygon.clear();
+  polygon_fixups.clear();
+  while (true) {
+    p = SkipSpaces(p, end);
+    if (IsEndOfLine(p, end) || *p == '#') {
+      break;
+    }
+
+    const size_t slot = polygon.size();
+    Corner corner = {0, kNoIndex, kNoIndex};
+    int64_t index;
+    p = ParseInt(p, end, &index);
+    if (p == nullptr) {
+      ThrowMalformed();
+    }
+    corner.v = ResolveIndex(index, num_positions, slot, 0, &polygon_fixups);
+    if (p < end && *p == '/') {
+      ++p;
+      if (p < end && *p != '/') {
+        p = ParseInt(p, end, &index);
+        if (p == nullptr) {
+          ThrowMalformed();
+        }
+        corner.vt =
+            ResolveIndex(index, num_tex_coords, slot, 1, &polygon_fixups);
+      }
+      if (p < end && *p == '/') {
+        ++p;
+        p = ParseInt(p, end, &index);
+        if (p == nullptr) {
+          ThrowMalformed();
+        }
+        corner.vn = ResolveIndex(index, num_normals, slot, 2, &polygon_fixups);
+      }
+    }
+    polygon.push_back(corner);
+  }
+
+  // Triangulate the polygon as a fan.
+  for (size_t k = 2; k < polygon.size(); ++k) {
+    const size_t polygon_corners[3] = {0, k - 1, k};
+    for (auto polygon_corner : polygon_corners) {
+      // Relative indices are rare, so this loop is usually empty.
+      for (auto fixup : polygon_fixups) {
+        if (fixup.corner == polygon_corner) {
+          fixup.corner = chunk->corners.size();
+          chunk->fixups.push_back(fixup);
+        }
+      }
+      chunk->corners.push_back(polygon[polygon_corner]);
+    }
+  }
+  return p;
+}
+
+void ParseChunk(Chunk* chunk) {
+  const char* p = chunk->begin;
+  const char* end = chunk->end;
+  while (p < end) {
+    p = SkipSpaces(p, end);
+    if (end - p >= 2 && p[0] == 'v') {
+      if (p[1] == ' ' || p[1] == '\t') {
+        p = ParseFloats(p + 2, end, 3, &chunk->positions);
+      } else if (p[1] == 'n') {
+        p = ParseFloats(p + 2, end, 3, &chunk->normals);
+      } else if (p[1] == 't') {
+        p = ParseTexCoord(p + 2, end, &chunk->tex_coords);
+      }
+    } else if (end - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+      p = ParseFace(p + 2, end, chunk);
+    }
+    p = SkipLine(p, end);
+  }
+}
+
+void ApplyFixups(Chunk* chunk) {
+  for (const auto& fixup : chunk->fixups) {
+    const size_t base =
+        fixup.component == 0
+            ? chunk->position_base
+            : (fixup.component == 1 ? chunk->tex_coord_base
+                                    : chunk->normal_base);
+    const int64_t index = static_cast<int64_t>(base) + fixup.local_index;
+    if (index < 0 || index >= static_cast<int64_t>(kNoIndex)) {
+      ThrowMalformed();
+    }
+    Corner& corner = chunk->corners[fixup.corner];
+    uint32_t& value =
+        fixup.component == 0 ? corner.v
+                             : (fixup.component == 1 ? corner.vt : corner.vn);
+    value = static_cast<uint32_t>(index);
+  }
+}
+
+void FindUniqueCorners(Chunk* chunk) {
+  CornerMap map(chunk->corners.size());
+  chunk->local_indices.reserve(chunk->corners.size());
+  for (const auto& corner : chunk->corners) {
+    const auto new_index = static_cast<uint32_t>(chunk->unique_corners.size());
+    const auto index = map.FindOrInsert(corner, new_index);
+    if (index == kNoIndex) {
+      chunk->unique_corners.push_back(corner);
+      chunk->local_indices.push_back(new_index);
+    } else {
+      chunk->local_indices.push_back(index);
+    }
+  }
+}
+
+std::vector<Chunk> SplitIntoChunks(const char* data, size_t size) {
+  const size_t max_chunks =
+      static_cast<size_t>(base::GetParallelism()) * kChunksPerThread;
+  const size_t num_chunks =
+      std::max<size_t>(1, std::min(max_chunks, size / kMinChunkSize));
+  const size_t chunk_size = size / num_chunks;
+
+  std::vector<Chunk> chunks;
+  const char* end = data + size;
+  const char* begin = data;
+  for (size_t i = 0; i < num_chunks && begin < end; ++i) {
+    const char* chunk_end = (i == num_chunks - 1)
+                                ? end
+                                : SkipLine(data + (i + 1) * chunk_size, end);
+    chunk_end = std::max(chunk_end, begin);
+    Chunk chunk;
+    chunk.begin = begin;
+    chunk.end = chunk_end;
+    chunks.push_back(std::move(chunk));
+    begin = chunk_end;
+  }
+  return chunks;
+}
+
+}  // namespace
+
+gfx::Mesh ImportObj(const std::string& path) {
+  base::MappedFile file(path);
+  std::vector<Chunk> chunks = SplitIntoChunks(file.data(), file.size());
+
+  // 1) Parse all the chunks in parallel.
+  base::ParallelFor(chunks.size(), [&chunks](size_t i) {
+    ParseChunk(&chunks[i]);
+  });
+
+  // 2) Determine where each chunk goes in the global arrays.
+  size_t num_positions = 0;
+  size_t num_normals = 0;
+  size_t num_tex_coords = 0;
+  size_t num_indices = 0;
+  bool has_normals = false;
+  bool has_tex_coords = false;
+  for (auto& chunk : chunks) {
+    chunk.position_base = num_positions;
+    chunk.normal_base = num_normals;
+    chunk.tex_coord_base = num_tex_coords;
+    chunk.index_base = num_indices;
+    num_positions += chunk.positions.size() / 3;
+    num_normals += chunk.normals.size() / 3;
+    num_tex_coords += chunk.tex_coords.size() / 2;
+    num_indices += chunk.corners.size();
+    for (const auto& corner : chunk.corners) {
+      has_normals = has_normals || corner.vn != kNoIndex;
+      has_tex_coords = has_tex_coords || corner.vt != kNoIndex;
+      if (has_normals && has_tex_coords) {
+        break;
+      }
+    }
+  }
+  if (num_positions >= kNoIndex) {
+    throw base::Error("Too many vertices in OBJ file.");
+  }
+
+  gfx::Mesh mesh;
+  mesh.has_normals = has_normals;
+  mesh.has_tex_coords = has_tex_coords;
+  mesh.indices.resize(num_indices);
+
+  if (!has_normals && !has_tex_coords) {
+    // Fast path: Only positions are referenced, so the position array can be
+    // used as the vertex array as is.
+    mesh.vertices.resize(num_positions);
+    base::ParallelFor(chunks.size(), [&](size_t i) {
+      Chunk& chunk = chunks[i];
+      ApplyFixups(&chunk);
+
+      const size_t count = chunk.positions.size() / 3;
+      gfx::Vertex* vertices = mesh.vertices.data() + chunk.position_base;
+      for (size_t k = 0; k < count; ++k) {
+        gfx::Vertex& vertex = vertices[k];
+        vertex.position[0] = chunk.positions[k * 3];
+        vertex.position[1] = chunk.positions[k * 3 + 1];
+        vertex.position[2] = chunk.positions[k * 3 + 2];
+        vertex.normal[0] = vertex.normal[1] = vertex.normal[2] = 0.0f;
+        vertex.tex_coord[0] = vertex.tex_coord[1] = 0.0f;
+      }
+
+      uint32_t* indices = mesh.indices.data() + chunk.index_base;
+      for (size_t k = 0; k < chunk.corners.size(); ++k) {
+        const uint32_t index = chunk.corners[k].v;
+        if (index >= num_positions) {
+          ThrowMalformed();
+        }
+        indices[k] = index;
+      }
+    });
+    return mesh;
+  }
+
+  // 3) Find the unique corners (vertices) of each chunk in parallel.
+  base::ParallelFor(chunks.size(), [&chunks](size_t i) {
+    ApplyFixups(&chunks[i]);
+    FindUniqueCorners(&chunks[i]);
+  });
+
+  // 4) Gather the attributes into global arrays, since faces may refer to
+  // attributes that were defined in any chunk.
+  std::vector<float> positions(num_positions * 3);
+  std::vector<float> normals(num_normals * 3);
+  std::vector<float> tex_coords(num_tex_coords * 2);
+  size_t num_vertices = 0;
+  for (auto& chunk : chunks) {
+    chunk.vertex_base = num_vertices;
+    num_vertices += chunk.unique_corners.size();
+  }
+  if (num_vertices >= kNoIndex) {
+    throw base::Error("Too many vertices in OBJ file.");
+  }
+  base::ParallelFor(chunks.size(), [&](size_t i) {
+    Chunk& chunk = chunks[i];
+    std::copy(chunk.positions.begin(), chunk.positions.end(),
+              positions.data() + chunk.position_base * 3);
+    std::copy(chunk.normals.begin(), chunk.normals.end(),
+              normals.data() + chunk.normal_base * 3);
+    std::copy(chunk.tex_coords.begin(), chunk.tex_coords.end(),
+              tex_coords.data() + chunk.tex_coord_base * 2);
+    std::vector<float>().swap(chunk.positions);
+    std::vector<float>().swap(chunk.normals);
+    std::vector<float>().swap(chunk.tex_coords);
+  });
+
+  // 5) Build the final vertex and index arrays in parallel.
+  mesh.vertices.resize(num_vertices);
+  base::ParallelFor(chunks.size(), [&](size_t i) {
+    const Chunk& chunk = chunks[i];
+    gfx::Vertex* vertices = mesh.vertices.data() + chunk.vertex_base;
+    for (size_t k = 0; k < chunk.unique_corners.size(); ++k) {
+      const Corner& corner = chunk.unique_corners[k];
+      gfx::Vertex& vertex = vertices[k];
+      if (corner.v >= num_positions) {
+        ThrowMalformed();
+      }
+      vertex.position[0] = positions[corner.v * 3];
+      vertex.position[1] = positions[corner.v * 3 + 1];
+      vertex.position[2] = positions[corner.v * 3 + 2];
+      if (corner.vn != kNoIndex) {
+        if (corner.vn >= num_normals) {
+          ThrowMalformed();
+        }
+        vertex.normal[0] = normals[corner.vn * 3];
+        vertex.normal[1] = normals[corner.vn * 3 + 1];
+        vertex.normal[2] = normals[corner.vn * 3 + 2];
+      } else {
+        vertex.normal[0] = vertex.normal[1] = vertex.normal[2] = 0.0f;
+      }
+      if (corner.vt != kNoIndex) {
+        if (corner.vt >= num_tex_coords) {
+          ThrowMalformed();
+        }
+        vertex.tex_coord[0] = tex_coords[corner.vt * 2];
+        vertex.tex_coord[1] = tex_coords[corner.vt * 2 + 1];
+      } else {
+        vertex.tex_coord[0] = vertex.tex_coord[1] = 0.0f;
+      }
+    }
+
+    uint32_t* indices = mesh.indices.data() + chunk.index_base;
+    const auto vertex_base = static_cast<uint32_t>(chunk.vertex_base);
+    for (size_t k = 0; k < chunk.local_indices.size(); ++k) {
+      indices[k] = vertex_base + chunk.local_indices[k];
+    }
+  });
+
+  return mesh;
+}
+
+}  // namespace model
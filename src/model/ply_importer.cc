@@ -0,0 +1,706 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "model/ply_importer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/error.h"
+#include "base/mapped_file.h"
+#include "base/parallel.h"
+#include "model/binary_reader.h"
+#include "model/text_parser.h"
+
+namespace model {
+
+namespace {
+
+// Number of vertices or faces per parallel work item.
+const size_t kItemsPerBlock = 1 << 16;
+
+enum class Format { kAscii, kBinaryLittleEndian, kBinaryBigEndian };
+
+enum class Type {
+  kInt8,
+  kUInt8,
+  kInt16,
+  kUInt16,
+  kInt32,
+  kUInt32,
+  kFloat32,
+  kFloat64
+};
+
+struct Property {
+  std::string name;
+  Type type;
+  bool is_list = false;
+  Type count_type = Type::kUInt8;
+};
+
+struct Element {
+  std::string name;
+  size_t count = 0;
+  std::vector<Property> properties;
+};
+
+struct Header {
+  Format format = Format::kAscii;
+  std::vector<Element> elements;
+  const char* body = nullptr;
+};
+
+// The vertex attributes that we import, in gfx::Vertex order.
+const char* const kAttributeNames[][3] = {
+    {"x", nullptr, nullptr},         {"y", nullptr, nullptr},
+    {"z", nullptr, nullptr},         {"nx", nullptr, nullptr},
+    {"ny", nullptr, nullptr},        {"nz", nullptr, nullptr},
+    {"u", "s", "texture_u"},         {"v", "t", "texture_v"}};
+const int kNumAttributes = 8;
+static_assert(sizeof(gfx::Vertex) == kNumAttributes * sizeof(float),
+              "Unexpected gfx::Vertex layout");
+
+void ThrowMalformed() {
+  throw base::Error("Malformed PLY file.");
+}
+
+size_t SizeOf(Type type) {
+  switch (type) {
+    case Type::kInt8:
+    case Type::kUInt8:
+      return 1;
+    case Type::kInt16:
+    case Type::kUInt16:
+      return 2;
+    case Type::kInt32:
+    case Type::kUInt32:
+    case Type::kFloat32:
+      return 4;
+    case Type::kFloat64:
+      return 8;
+  }
+  return 0;
+}
+
+Type ParseType(const std::string& name) {
+  if (name == "char" || name == "int8") {
+    return Type::kInt8;
+  } else if (name == "uchar" || name == "uint8") {
+    return Type::kUInt8;
+  } else if (name == "short" || name == "int16") {
+    return Type::kInt16;
+  } else if (name == "ushort" || name == "uint16") {
+    return Type::kUInt16;
+  } else if (name == "int" || name == "int32") {
+    return Type::kInt32;
+  } else if (name == "uint" || name == "uint32") {
+    return Type::kUInt32;
+  } else if (name == "float" || name == "float32") {
+    return Type::kFloat32;
+  } else if (name == "double" || name == "float64") {
+    return Type::kFloat64;
+  }
+  throw base::Error("Unsupported PLY property type: " + name);
+}
+
+double ReadAsDouble(const char* p, Type type, bool swap) {
+  switch (type) {
+    case Type::kInt8:
+      return static_cast<double>(ReadValue<int8_t>(p, swap));
+    case Type::kUInt8:
+      return static_cast<double>(ReadValue<uint8_t>(p, swap));
+    case Type::kInt16:
+      return static_cast<double>(ReadValue<int16_t>(p, swap));
+    case Type::kUInt16:
+      return static_cast<double>(ReadValue<uint16_t>(p, swap));
+    case Type::kInt32:
+      return static_cast<double>(ReadValue<int32_t>(p, swap));
+    case Type::kUInt32:
+      return static_cast<double>(ReadValue<uint32_t>(p, swap));
+    case Type::kFloat32:
+      return static_cast<double>(ReadValue<float>(p, swap));
+    case Type::kFloat64:
+      return ReadValue<double>(p, swap);
+  }
+  return 0.0;
+}
+
+int64_t ReadAsInt(const char* p, Type type, bool swap) {
+  switch (type) {
+    case Type::kInt8:
+      return ReadValue<int8_t>(p, swap);
+    case Type::kUInt8:
+      return ReadValue<uint8_t>(p, swap);
+    case Type::kInt16:
+      return ReadValue<int16_t>(p, swap);
+    case Type::kUInt16:
+      return ReadValue<uint16_t>(p, swap);
+    case Type::kInt32:
+      return ReadValue<int32_t>(p, swap);
+    case Type::kUInt32:
+      return ReadValue<uint32_t>(p, swap);
+    case Type::kFloat32:
+      return static_cast<int64_t>(ReadValue<float>(p, swap));
+    case Type::kFloat64:
+      return static_cast<int64_t>(ReadValue<double>(p, swap));
+  }
+  return 0;
+}
+
+Header ParseHeader(const char* data, size_t size) {
+  const char* p = data;
+  const char* end = data + size;
+  if (size < 4 || std::string(p, 3) != "ply") {
+    ThrowMalformed();
+  }
+  p = SkipLine(p, end);
+
+  Header header;
+  bool has_format = false;
+  while (true) {
+    if (p >= end) {
+      ThrowMalformed();
+    }
+    const char* eol = SkipLine(p, end);
+    std::istringstream line(std::string(p, eol));
+    p = eol;
+
+    std::string keyword;
+    line >> keyword;
+    if (keyword == "format") {
+      std::string format;
+      line >> format;
+      if (format == "ascii") {
+        header.format = Format::kAscii;
+      } else if (format == "binary_little_endian") {
+        header.format = Format::kBinaryLittleEndian;
+      } else if (format == "binary_big_endian") {
+        header.format = Format::kBinaryBigEndian;
+      } else {
+        throw base::Error("Unsupported PLY format: " + format);
+      }
+      has_format = true;
+    } else if (keyword == "element") {
+      Element element;
+      line >> element.name >> element.count;
+      if (line.fail()) {
+        ThrowMalformed();
+      }
+      header.elements.push_back(element);
+    } else if (keyword == "property") {
+      if (header.elements.empty()) {
+        ThrowMalformed();
+      }
+      Property property;
+      std::string type;
+      line >> type;
+      if (type == "list") {
+        std::string count_type;
+        line >> count_type >> type;
+        property.is_list = true;
+        property.count_type = ParseType(count_type);
+      }
+      property.type = ParseType(type);
+      line >> property.name;
+      if (line.fail()) {
+        ThrowMalformed();
+      }
+      header.elements.back().properties.push_back(property);
+    } else if (keyword == "end_header") {
+      break;
+    }
+    // Ignore comments, obj_info etc.
+  }
+  if (!has_format) {
+    ThrowMalformed();
+  }
+
+  header.body = p;
+  return header;
+}
+
+bool IsFaceIndexList(const Property& property) {
+  return property.is_list &&
+         (property.name == "vertex_indices" || property.name == "vertex_index");
+}
+
+// Find where each of our vertex attributes is stored in a vertex record.
+// Returns the index of the property for each attribute (-1 if missing).
+void MapAttributes(const Element& element, int* property_index) {
+  for (int a = 0; a < kNumAttributes; ++a) {
+    property_index[a] = -1;
+    for (size_t i = 0; i < element.properties.size(); ++i) {
+      for (const char* name : kAttributeNames[a]) {
+        if (name != nullptr && element.properties[i].name == name) {
+          property_index[a] = static_cast<int>(i);
+        }
+      }
+    }
+  }
+}
+
+void InitMesh(const Element& vertex_element,
+              const int* property_index,
+              gfx::Mesh* mesh) {
+  if (property_index[0] < 0 || property_index[1] < 0 ||
+      property_index[2] < 0) {
+    throw base::Error("The PLY file has no vertex positions.");
+  }
+  if (vertex_element.count >= 0xffffffffu) {
+    throw base::Error("Too many vertices in PLY file.");
+  }
+  mesh->has_normals = property_index[3] >= 0 && property_index[4] >= 0 &&
+                      property_index[5] >= 0;
+  mesh->has_tex_coords = property_index[6] >= 0 && property_index[7] >= 0;
+  mesh->vertices.resize(vertex_element.count);
+}
+
+void AddPolygon(const uint32_t* polygon, size_t count, gfx::Mesh* mesh) {
+  for (size_t k = 2; k < count; ++k) {
+    mesh->indices.push_back(polygon[0]);
+    mesh->indices.push_back(polygon[k - 1]);
+    mesh->indices.push_back(polygon[k]);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Binary files.
+//------------------------------------------------------------------------------
+
+class BinaryDecoder {
+ public:
+  BinaryDecoder(const Header& header, const char* end)
+      : header_(header),
+        end_(end),
+        swap_((header.format == Format::kBinaryLittleEndian) !=
+              IsLittleEndianHost()) {}
+
+  gfx::Mesh Decode() {
+    gfx::Mesh mesh;
+    const char* p = header_.body;
+    for (const auto& element : header_.elements) {
+      if (element.name == "vertex") {
+        p = DecodeVertices(element, p, &mesh);
+      } else if (element.name == "face") {
+        p = DecodeFaces(element, p, &mesh);
+      } else {
+        p = SkipElement(element, p);
+      }
+    }
+    return mesh;
+  }
+
+ private:
+  void CheckAvailable(const char* p, size_t size) const {
+    if (p > end_ || static_cast<size_t>(end_ - p) < size) {
+      ThrowMalformed();
+    }
+  }
+
+  // Check that count records of the given size are available. The counts come
+  // from the file, so they are checked before they are multiplied.
+  void CheckAvailable(const char* p, size_t count, size_t record_size) const {
+    if (p > end_ ||
+        (record_size > 0 &&
+         count > static_cast<size_t>(end_ - p) / record_size)) {
+      ThrowMalformed();
+    }
+  }
+
+  // Returns the record size of an element, or zero if the records are of
+  // variable size (i.e. if the element has list properties).
+  static size_t RecordSize(const Element& element) {
+    size_t size = 0;
+    for (const auto& property : element.properties) {
+      if (property.is_list) {
+        return 0;
+      }
+      size += SizeOf(property.type);
+    }
+    return size;
+  }
+
+  // Skip a property of the current record.
+  const char* SkipProperty(const Property& property, const char* p) const {
+    if (property.is_list) {
+      CheckAvailable(p, SizeOf(property.count_type));
+      const int64_t count = ReadAsInt(p, property.count_type, swap_);
+      if (count < 0) {
+        ThrowMalformed();
+      }
+      p += SizeOf(property.count_type);
+      CheckAvailable(p, static_cast<size_t>(count), SizeOf(property.type));
+      return p + static_cast<size_t>(count) * SizeOf(property.type);
+    }
+    CheckAvailable(p, SizeOf(property.type));
+    return p + SizeOf(property.type);
+  }
+
+  const char* SkipElement(const Element& element, const char* p) const {
+    const size_t record_size = RecordSize(element);
+    if (record_size > 0) {
+      CheckAvailable(p, element.count, record_size);
+      return p + element.count * record_size;
+    }
+    for (size_t i = 0; i < element.count; ++i) {
+      for (const auto& property : element.properties) {
+        p = SkipProperty(property, p);
+      }
+    }
+    return p;
+  }
+
+  template <bool kAllFloat32>
+  static void DecodeVertexRange(const char* records,
+                                size_t stride,
+                                const size_t* offsets,
+                                const Type* types,
+                                bool swap,
+                                size_t first,
+                                size_t last,
+                                gfx::Vertex* vertices) {
+    for (size_t i = first; i < last; ++i) {
+      const char* record = records + i * stride;
+      float values[kNumAttributes];
+      for (int a = 0; a < kNumAttributes; ++a) {
+        if (kAllFloat32) {
+          // Plain copy (or byte swap) of the attribute.
+          values[a] = ReadValue<float>(record + offsets[a], swap);
+        } else {
+          values[a] = static_cast<float>(
+              ReadAsDouble(record + offsets[a], types[a], swap));
+        }
+      }
+      std::memcpy(&vertices[i], values, sizeof(values));
+    }
+  }
+
+  const char* DecodeVertices(const Element& element,
+                             const char* p,
+                             gfx::Mesh* mesh) const {
+    const size_t stride = RecordSize(element);
+    if (stride == 0) {
+      throw base::Error("Unsupported PLY vertex element (list property).");
+    }
+    CheckAvailable(p, element.count, stride);
+
+    int property_index[kNumAttributes];
+    MapAttributes(element, property_index);
+    InitMesh(element, property_index, mesh);
+
+    // Missing attributes are read from a zero buffer instead (see below).
+    size_t offsets[kNumAttributes];
+    Type types[kNumAttributes];
+    bool all_float32 = true;
+    for (int a = 0; a < kNumAttributes; ++a) {
+      offsets[a] = 0;
+      types[a] = Type::kFloat32;
+      size_t offset = 0;
+      for (int i = 0; i < static_cast<int>(element.properties.size()); ++i) {
+        if (i == property_index[a]) {
+          offsets[a] = offset;
+          types[a] = element.properties[i].type;
+          all_float32 = all_float32 && types[a] == Type::kFloat32;
+        }
+        offset += SizeOf(element.properties[i].type);
+      }
+    }
+
+    const bool swap = swap_;
+    const bool has_normals = mesh->has_normals;
+    const bool has_tex_coords = mesh->has_tex_coords;
+    gfx::Vertex* vertices = mesh->vertices.data();
+    const size_t count = element.count;
+    base::ParallelFor(
+        (count + kItemsPerBlock - 1) / kItemsPerBlock, [&](size_t block) {
+          const size_t first = block * kItemsPerBlock;
+          const size_t last = std::min(first + kItemsPerBlock, count);
+          if (all_float32) {
+            DecodeVertexRange<true>(p, stride, offsets, types, swap, first,
+                                    last, vertices);
+          } else {
+            DecodeVertexRange<false>(p, stride, offsets, types, swap, first,
+                                     last, vertices);
+          }
+
+          // Clear the attributes that were not present in the file.
+          for (size_t i = first; i < last; ++i) {
+            if (!has_normals) {
+              vertices[i].normal[0] = vertices[i].normal[1] =
+                  vertices[i].normal[2] = 0.0f;
+            }
+            if (!has_tex_coords) {
+              vertices[i].tex_coord[0] = vertices[i].tex_coord[1] = 0.0f;
+            }
+          }
+        });
+
+    return p + count * stride;
+  }
+
+  // Fast path for the common case where all faces are triangles and the only
+  // face property is the index list: Every face record has the same size, so
+  // the records can be decoded in parallel straight into the index array.
+  // Returns false if the faces turned out not to be triangles.
+  bool DecodeTriangles(const Element& element,
+                       const char* p,
+                       size_t num_vertices,
+                       gfx::Mesh* mesh) const {
+    if (element.properties.size() != 1 ||
+        !IsFaceIndexList(element.properties[0])) {
+      return false;
+    }
+    const Property& list = element.properties[0];
+    const size_t count_size = SizeOf(list.count_type);
+    const size_t index_size = SizeOf(list.type);
+    const size_t record_size = count_size + 3 * index_size;
+    if (p > end_ ||
+        element.count > static_cast<size_t>(end_ - p) / record_size) {
+      return false;
+    }
+
+    mesh->indices.resize(element.count * 3);
+    uint32_t* indices = mesh->indices.data();
+    const bool swap = swap_;
+    std::atomic_bool all_triangles(true);
+    std::atomic_bool valid_indices(true);
+    base::ParallelFor(
+        (element.count + kItemsPerBlock - 1) / kItemsPerBlock,
+        [&](size_t block) {
+          const size_t first = block * kItemsPerBlock;
+          const size_t last = std::min(first + kItemsPerBlock, element.count);
+          bool valid = true;
+          for (size_t i = first; i < last; ++i) {
+            const char* record = p + i * record_size;
+            if (ReadAsInt(record, list.count_type, swap) != 3) {
+              all_triangles = false;
+              return;
+            }
+            for (size_t k = 0; k < 3; ++k) {
+              const int64_t index = ReadAsInt(
+                  record + count_size + k * index_size, list.type, swap);
+              valid = valid && index >= 0 &&
+                      index < static_cast<int64_t>(num_vertices);
+              indices[i * 3 + k] = static_cast<uint32_t>(index);
+            }
+          }
+          if (!valid) {
+            valid_indices = false;
+          }
+        });
+
+    if (!all_triangles) {
+      mesh->indices.clear();
+      return false;
+    }
+    if (!valid_indices) {
+      throw base::Error("Invalid vertex index in PLY file.");
+    }
+    return true;
+  }
+
+  const char* DecodeFaces(const Element& element,
+                          const char* p,
+                          gfx::Mesh* mesh) const {
+    const size_t num_vertices = GetVertexCount();
+    if (DecodeTriangles(element, p, num_vertices, mesh)) {
+      return p + element.count * (SizeOf(element.properties[0].count_type) +
+                                  3 * SizeOf(element.properties[0].type));
+    }
+
+    // General case: Walk the face records one by one. Each record holds at
+    // least the count of each list, which bounds the number of records.
+    if (element.properties.empty()) {
+      return p;
+    }
+    size_t min_record_size = 0;
+    for (const auto& property : element.properties) {
+      min_record_size += SizeOf(property.is_list ? property.count_type
+                                                 : property.type);
+    }
+    CheckAvailable(p, element.count, min_record_size);
+    mesh->indices.reserve(element.count * 3);
+    std::vector<uint32_t> polygon;
+    for (size_t i = 0; i < element.count; ++i) {
+      for (const auto& property : element.properties) {
+        if (!IsFaceIndexList(property)) {
+          p = SkipProperty(property, p);
+          continue;
+        }
+        CheckAvailable(p, SizeOf(property.count_type));
+        const int64_t count = ReadAsInt(p, property.count_type, swap_);
+        p += SizeOf(property.count_type);
+        if (count < 0) {
+          ThrowMalformed();
+        }
+        const size_t index_size = SizeOf(property.type);
+        CheckAvailable(p, static_cast<size_t>(count), index_size);
+        polygon.clear();
+        for (int64_t k = 0; k < count; ++k, p += index_size) {
+          const int64_t index = ReadAsInt(p, property.type, swap_);
+          if (index < 0 || index >= static_cast<int64_t>(num_vertices)) {
+            throw base::Error("Invalid vertex index in PLY file.");
+          }
+          polygon.push_back(static_cast<uint32_t>(index));
+        }
+        AddPolygon(polygon.data(), polygon.size(), mesh);
+      }
+    }
+    return p;
+  }
+
+  size_t GetVertexCount() const {
+    for (const auto& element : header_.elements) {
+      if (element.name == "vertex") {
+        return element.count;
+      }
+    }
+    return 0;
+  }
+
+  const Header& header_;
+  const char* end_;
+  const bool swap_;
+};
+
+//------------------------------------------------------------------------------
+// ASCII files.
+//------------------------------------------------------------------------------
+
+const char* SkipToken(const char* p, const char* end) {
+  p = SkipSpaces(p, end);
+  while (p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+    ++p;
+  }
+  return p;
+}
+
+gfx::Mesh DecodeAscii(const Header& header, const char* end) {
+  gfx::Mesh mesh;
+  size_t num_vertices = 0;
+  for (const auto& element : header.elements) {
+    if (element.name == "vertex") {
+      num_vertices = element.count;
+    }
+  }
+
+  const char* p = header.body;
+  std::vector<float> values;
+  std::vector<uint32_t> polygon;
+  for (const auto& element : header.elements) {
+    // Every value takes at least one character, which bounds the number of
+    // records (the counts come from the file).
+    if (!element.properties.empty() && p <= end &&
+        element.count > static_cast<size_t>(end - p)) {
+      ThrowMalformed();
+    }
+    if (element.name == "vertex") {
+      int property_index[kNumAttributes];
+      MapAttributes(element, property_index);
+      InitMesh(element, property_index, &mesh);
+      values.resize(element.properties.size());
+      for (size_t i = 0; i < element.count; ++i) {
+        for (size_t k = 0; k < values.size(); ++k) {
+          if (element.properties[k].is_list) {
+            throw base::Error(
+                "Unsupported PLY vertex element (list property).");
+          }
+          p = ParseFloat(SkipWhitespace(p, end), end, &values[k]);
+          if (p == nullptr) {
+            ThrowMalformed();
+          }
+        }
+        float attributes[kNumAttributes];
+        for (int a = 0; a < kNumAttributes; ++a) {
+          attributes[a] =
+              property_index[a] >= 0 ? values[property_index[a]] : 0.0f;
+        }
+        std::memcpy(&mesh.vertices[i], attributes, sizeof(attributes));
+      }
+    } else if (element.name == "face") {
+      mesh.indices.reserve(element.count * 3);
+      for (size_t i = 0; i < element.count; ++i) {
+        for (const auto& property : element.properties) {
+          int64_t count = 1;
+          if (property.is_list) {
+            p = ParseInt(SkipWhitespace(p, end), end, &count);
+            if (p == nullptr || count < 0) {
+              ThrowMalformed();
+            }
+          }
+          if (!IsFaceIndexList(property)) {
+            for (int64_t k = 0; k < count; ++k) {
+              p = SkipToken(SkipWhitespace(p, end), end);
+            }
+            continue;
+          }
+          polygon.clear();
+          for (int64_t k = 0; k < count; ++k) {
+            int64_t index;
+            p = ParseInt(SkipWhitespace(p, end), end, &index);
+            if (p == nullptr) {
+              ThrowMalformed();
+            }
+            if (index < 0 || index >= static_cast<int64_t>(num_vertices)) {
+              throw base::Error("Invalid vertex index in PLY file.");
+            }
+            polygon.push_back(static_cast<uint32_t>(index));
+          }
+          AddPolygon(polygon.data(), polygon.size(), &mesh);
+        }
+      }
+    } else {
+      // Each record of other elements is a single line.
+      for (size_t i = 0; i < element.count; ++i) {
+        p = SkipLine(SkipWhitespace(p, end), end);
+      }
+    }
+  }
+  return mesh;
+}
+
+}  // namespace
+
+gfx::Mesh ImportPly(const std::string& path) {
+  base::MappedFile file(path);
+  const Header header = ParseHeader(file.data(), file.size());
+  const char* end = file.data() + file.size();
+  if (header.format == Format::kAscii) {
+    return DecodeAscii(header, end);
+  }
+  BinaryDecoder decoder(header, end);
+  return decoder.Decode();
+}
+
+}  // namespace model
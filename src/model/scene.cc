@@ -0,0 +1,183 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "model/scene.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+#include "base/make_unique.h"
+#include "base/mapped_file.h"
+
+namespace model {
+
+void Node::SetTransform(const float* translation,
+                        const float* rotation,
+                        const float* scale) {
+  transform = base::Mat4::Trs(
+      base::Vec3{translation[0], translation[1], translation[2]},
+      base::Quat{rotation[0], rotation[1], rotation[2], rotation[3]},
+      base::Vec3{scale[0], scale[1], scale[2]});
+}
+
+int Scene::AddBuffer(const char* data, size_t size) {
+  gfx::BufferData buffer;
+  buffer.data = data;
+  buffer.size = size;
+  buffers_.push_back(buffer);
+  return static_cast<int>(buffers_.size() - 1);
+}
+
+void Scene::AddFile(const std::shared_ptr<base::MappedFile>& file) {
+  files_.push_back(file);
+}
+
+const char* Scene::AddStorage(std::vector<char>&& data) {
+  blobs_.emplace_back(base::make_unique<std::vector<char>>(std::move(data)));
+  return blobs_.back()->data();
+}
+
+int Scene::AddMesh(Mesh&& mesh) {
+  meshes_.emplace_back(std::move(mesh));
+  return static_cast<int>(meshes_.size() - 1);
+}
+
+int Scene::AddMesh(gfx::Mesh mesh, const std::string& name) {
+  gfx_meshes_.emplace_back(base::make_unique<gfx::Mesh>(std::move(mesh)));
+  const gfx::Mesh& data = *gfx_meshes_.back();
+
+  const int vertex_buffer = AddBuffer(
+      reinterpret_cast<const char*>(data.vertices.data()),
+      data.vertices.size() * sizeof(gfx::Vertex));
+  const int index_buffer =
+      AddBuffer(reinterpret_cast<const char*>(data.indices.data()),
+                data.indices.size() * sizeof(uint32_t));
+
+  // Describe the interleaved vertex layout.
+  Primitive primitive;
+  primitive.positions.buffer = vertex_buffer;
+  primitive.positions.offset = offsetof(gfx::Vertex, position);
+  primitive.positions.stride = sizeof(gfx::Vertex);
+  primitive.positions.count = data.vertices.size();
+  primitive.positions.components = 3;
+  if (data.has_normals) {
+    primitive.normals = primitive.positions;
+    primitive.normals.offset = offsetof(gfx::Vertex, normal);
+  }
+  if (data.has_tex_coords) {
+    primitive.tex_coords = primitive.positions;
+    primitive.tex_coords.offset = offsetof(gfx::Vertex, tex_coord);
+    primitive.tex_coords.components = 2;
+  }
+  primitive.indices.buffer = index_buffer;
+  primitive.indices.count = data.indices.size();
+  primitive.indices.type = gfx::DataType::kUInt32;
+
+  if (!data.vertices.empty()) {
+    primitive.bounds = base::Aabb::Empty();
+    for (const auto& vertex : data.vertices) {
+      primitive.bounds.Grow(base::Vec3{
+          vertex.position[0], vertex.position[1], vertex.position[2]});
+    }
+  }
+
+  Mesh scene_mesh;
+  scene_mesh.name = name;
+  scene_mesh.primitives.push_back(primitive);
+  const int mesh_index = AddMesh(std::move(scene_mesh));
+
+  Node node;
+  node.name = name;
+  node.mesh = mesh_index;
+  AddRoot(AddNode(node));
+
+  return mesh_index;
+}
+
+int Scene::AddNode(const Node& node) {
+  nodes_.push_back(node);
+  return static_cast<int>(nodes_.size() - 1);
+}
+
+void Scene::AddRoot(int node) {
+  roots_.push_back(node);
+}
+
+std::vector<Instance> Scene::GetInstances() const {
+  struct StackItem {
+    int node;
+    base::Mat4 parent_transform;
+  };
+
+  std::vector<Instance> instances;
+  std::vector<StackItem> stack;
+  for (auto root : roots_) {
+    StackItem item;
+    item.node = root;
+    item.parent_transform = base::Mat4::Identity();
+    stack.push_back(item);
+  }
+
+  // Walk the hierarchy depth first, accumulating the transforms.
+  while (!stack.empty()) {
+    const StackItem item = stack.back();
+    stack.pop_back();
+    const Node& node = nodes_[static_cast<size_t>(item.node)];
+
+    const base::Mat4 transform = item.parent_transform * node.transform;
+    if (node.mesh >= 0) {
+      Instance instance;
+      instance.node = item.node;
+      instance.mesh = node.mesh;
+      instance.transform = transform;
+      instances.push_back(instance);
+    }
+
+    for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+      StackItem child;
+      child.node = *it;
+      child.parent_transform = transform;
+      stack.push_back(child);
+    }
+  }
+
+  return instances;
+}
+
+size_t Scene::triangle_count() const {
+  size_t count = 0;
+  for (const auto& mesh : meshes_) {
+    for (const auto& primitive : mesh.primitives) {
+      count += primitive.triangle_count();
+    }
+  }
+  return count;
+}
+
+}  // namespace model
@@ -0,0 +1,189 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef MODEL_SCENE_H_
+#define MODEL_SCENE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/math.h"
+#include "gfx/accessor.h"
+#include "gfx/mesh.h"
+#include "gfx/meshlet.h"
+
+namespace base {
+
+class MappedFile;
+
+}  // namespace base
+
+namespace model {
+
+/// @brief A simplified version of a primitive (a level of detail).
+struct Lod {
+  /// The triangle indices, which refer to the vertices of the primitive. They
+  /// are stored in the same buffer, and with the same type, as the indices of
+  /// the primitive.
+  gfx::Accessor indices;
+
+  /// The geometric error of the simplification, as a distance in mesh space.
+  float error = 0.0f;
+};
+
+/// @brief A part of a mesh that is drawn with a single set of attributes.
+struct Primitive {
+  gfx::Accessor positions;
+  gfx::Accessor normals;
+  gfx::Accessor tex_coords;
+
+  /// The triangle indices (invalid for non-indexed primitives).
+  gfx::Accessor indices;
+
+  /// Axis aligned bounding box of the vertex positions.
+  base::Aabb bounds = {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+
+  /// Progressively simpler levels of detail, in order of increasing error
+  /// (see OptimizeScene()).
+  std::vector<Lod> lods;
+
+  /// The meshlets of the (full detail) indices, for cluster culling. Empty
+  /// for small primitives.
+  std::vector<gfx::Meshlet> meshlets;
+
+  size_t vertex_count() const { return positions.count; }
+  size_t triangle_count() const {
+    return (indices.valid() ? indices.count : positions.count) / 3;
+  }
+};
+
+/// @brief A mesh, which may be referenced by several nodes (instances).
+struct Mesh {
+  std::string name;
+  std::vector<Primitive> primitives;
+
+  /// The transform from the stored vertex positions to mesh space. It is not
+  /// the identity for meshes with quantized positions (see OptimizeScene()).
+  base::Mat4 position_decode = base::Mat4::Identity();
+};
+
+/// @brief A node in the scene hierarchy.
+struct Node {
+  std::string name;
+
+  /// Transformation matrix, relative to the parent node.
+  base::Mat4 transform = base::Mat4::Identity();
+
+  /// Mesh index, or -1 if the node has no mesh.
+  int mesh = -1;
+
+  std::vector<int> children;
+
+  /// @brief Set the transform from a translation, a rotation quaternion
+  /// (x, y, z, w) and a scale.
+  void SetTransform(const float* translation,
+                    const float* rotation,
+                    const float* scale);
+};
+
+/// @brief A mesh instance with its world transform.
+struct Instance {
+  int node;
+  int mesh;
+  base::Mat4 transform;
+};
+
+/// @brief A loaded scene.
+///
+/// The scene holds a node hierarchy where nodes refer to meshes, so the same
+/// mesh can be instanced several times. Mesh data is described by accessors
+/// into buffers, which may refer directly into memory mapped files.
+///
+/// A scene can be moved but not copied.
+class Scene {
+ public:
+  /// @brief Add a buffer.
+  /// @note The memory must stay valid for the lifetime of the scene (e.g. by
+  /// using AddFile() or AddStorage()).
+  /// @returns the buffer index.
+  int AddBuffer(const char* data, size_t size);
+
+  /// @brief Keep a memory mapped file alive for the lifetime of the scene.
+  void AddFile(const std::shared_ptr<base::MappedFile>& file);
+
+  /// @brief Keep a block of memory alive for the lifetime of the scene.
+  /// @returns a pointer to the data.
+  const char* AddStorage(std::vector<char>&& data);
+
+  /// @brief Add a mesh.
+  /// @returns the mesh index.
+  int AddMesh(Mesh&& mesh);
+
+  /// @brief Add an interleaved mesh, and a root node that refers to it.
+  ///
+  /// The scene takes ownership of the mesh data.
+  /// @returns the mesh index.
+  int AddMesh(gfx::Mesh mesh, const std::string& name);
+
+  /// @brief Add a node.
+  /// @returns the node index.
+  int AddNode(const Node& node);
+
+  /// @brief Add a root node (a node without a parent).
+  void AddRoot(int node);
+
+  /// @brief Get the world space instances of all the meshes in the scene.
+  std::vector<Instance> GetInstances() const;
+
+  const std::vector<gfx::BufferData>& buffers() const { return buffers_; }
+  const std::vector<Mesh>& meshes() const { return meshes_; }
+  const std::vector<Node>& nodes() const { return nodes_; }
+  const std::vector<int>& roots() const { return roots_; }
+
+  Node& node(int index) { return nodes_[static_cast<size_t>(index)]; }
+
+  /// @returns the total number of triangles in the scene (not counting
+  /// instancing).
+  size_t triangle_count() const;
+
+ private:
+  std::vector<gfx::BufferData> buffers_;
+  std::vector<Mesh> meshes_;
+  std::vector<Node> nodes_;
+  std::vector<int> roots_;
+
+  // Storage for the buffers.
+  std::vector<std::shared_ptr<base::MappedFile>> files_;
+  std::vector<std::unique_ptr<std::vector<char>>> blobs_;
+  std::vector<std::unique_ptr<gfx::Mesh>> gfx_meshes_;
+};
+
+}  // namespace model
+
+#endif  // MODEL_SCENE_H_
@@ -0,0 +1,547 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "model/scene_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/error.h"
+#include "base/file_util.h"
+#include "base/mapped_file.h"
+#include "base/profiler.h"
+
+namespace model {
+
+namespace {
+
+// Bump the version whenever the file format changes.
+const uint32_t kMagic = 0x00434d56u;  // "VMC\0"
+const uint32_t kVersion = 7;
+const uint32_t kByteOrderMark = 0x01020304u;
+
+// Blobs are aligned so that they are suitable for direct GPU uploads and SIMD
+// processing.
+const uint64_t kAlignment = 64;
+
+enum ChunkType : uint32_t {
+  kChunkSourcePath = 1,
+  kChunkScene = 2,
+  kChunkBuffer = 3
+};
+
+struct FileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t chunk_count;
+  uint64_t source_size;
+  int64_t source_mtime;
+};
+
+struct ChunkEntry {
+  uint32_t type;
+  uint32_t index;
+  uint64_t offset;
+  uint64_t size;
+};
+
+uint64_t AlignUp(uint64_t x) {
+  return (x + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+// Serializes plain values to a byte array (in host byte order).
+class Writer {
+ public:
+  template <typename T>
+  void Write(const T& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    data_.insert(data_.end(), bytes, bytes + sizeof(T));
+  }
+
+  // Write an array of plain values, preceded by its size.
+  template <typename T>
+  void WriteArray(const std::vector<T>& values) {
+    Write(static_cast<uint32_t>(values.size()));
+    const char* bytes = reinterpret_cast<const char*>(values.data());
+    data_.insert(data_.end(), bytes, bytes + values.size() * sizeof(T));
+  }
+
+  void WriteString(const std::string& str) {
+    Write(static_cast<uint32_t>(str.size()));
+    data_.insert(data_.end(), str.begin(), str.end());
+  }
+
+  void WriteAccessor(const gfx::Accessor& accessor) {
+    Write(static_cast<int32_t>(accessor.buffer));
+    Write(static_cast<uint64_t>(accessor.offset));
+    Write(static_cast<uint64_t>(accessor.stride));
+    Write(static_cast<uint64_t>(accessor.count));
+    Write(static_cast<int32_t>(accessor.components));
+    Write(static_cast<uint8_t>(accessor.type));
+    Write(static_cast<uint8_t>(accessor.normalized ? 1 : 0));
+  }
+
+  const std::vector<char>& data() const { return data_; }
+
+ private:
+  std::vector<char> data_;
+};
+
+// Deserializes values that were written by the Writer. All reads are bounds
+// checked, and any failure is sticky (i.e. ok() returns false).
+class Reader {
+ public:
+  Reader(const char* data, size_t size) : p_(data), end_(data + size) {}
+
+  template <typename T>
+  T Read() {
+    T value = T();
+    if (static_cast<size_t>(end_ - p_) < sizeof(T)) {
+      ok_ = false;
+      return value;
+    }
+    std::memcpy(&value, p_, sizeof(T));
+    p_ += sizeof(T);
+    return value;
+  }
+
+  std::string ReadString() {
+    const uint32_t size = Read<uint32_t>();
+    if (static_cast<size_t>(end_ - p_) < size) {
+      ok_ = false;
+      return std::string();
+    }
+    std::string result(p_, size);
+    p_ += size;
+    return result;
+  }
+
+  template <typename T>
+  std::vector<T> ReadArray() {
+    const uint32_t count = Read<uint32_t>();
+    if (static_cast<size_t>(end_ - p_) / sizeof(T) < count) {
+      ok_ = false;
+      return std::vector<T>();
+    }
+    std::vector<T> result(count);
+    std::memcpy(result.data(), p_, count * sizeof(T));
+    p_ += count * sizeof(T);
+    return result;
+  }
+
+  gfx::Accessor ReadAccessor() {
+    gfx::Accessor accessor;
+    accessor.buffer = Read<int32_t>();
+    accessor.offset = static_cast<size_t>(Read<uint64_t>());
+    accessor.stride = static_cast<size_t>(Read<uint64_t>());
+    accessor.count = static_cast<size_t>(Read<uint64_t>());
+    accessor.components = Read<int32_t>();
+    const uint8_t type = Read<uint8_t>();
+    if (type > static_cast<uint8_t>(gfx::DataType::kInt10_10_10_2)) {
+      ok_ = false;
+    }
+    accessor.type = static_cast<gfx::DataType>(type);
+    accessor.normalized = Read<uint8_t>() != 0;
+    return accessor;
+  }
+
+  /// Read an element count, which must be possible to satisfy with the
+  /// remaining data (protects against huge allocations).
+  size_t ReadCount() {
+    const uint32_t count = Read<uint32_t>();
+    if (count > static_cast<size_t>(end_ - p_)) {
+      ok_ = false;
+      return 0;
+    }
+    return count;
+  }
+
+  bool ok() const { return ok_; }
+
+ private:
+  const char* p_;
+  const char* end_;
+  bool ok_ = true;
+};
+
+std::vector<char> SerializeScene(const Scene& scene) {
+  Writer writer;
+  writer.Write(static_cast<uint32_t>(scene.meshes().size()));
+  for (const auto& mesh : scene.meshes()) {
+    writer.WriteString(mesh.name);
+    for (int k = 0; k < 16; ++k) {
+      writer.Write(mesh.position_decode.m[k]);
+    }
+    writer.Write(static_cast<uint32_t>(mesh.primitives.size()));
+    for (const auto& primitive : mesh.primitives) {
+      writer.WriteAccessor(primitive.positions);
+      writer.WriteAccessor(primitive.normals);
+      writer.WriteAccessor(primitive.tex_coords);
+      writer.WriteAccessor(primitive.indices);
+      for (int k = 0; k < 3; ++k) {
+        writer.Write(primitive.bounds.min[k]);
+        writer.Write(primitive.bounds.max[k]);
+      }
+      writer.Write(static_cast<uint32_t>(primitive.lods.size()));
+      for (const auto& lod : primitive.lods) {
+        writer.WriteAccessor(lod.indices);
+        writer.Write(lod.error);
+      }
+      writer.WriteArray(primitive.meshlets);
+    }
+  }
+
+  writer.Write(static_cast<uint32_t>(scene.nodes().size()));
+  for (const auto& node : scene.nodes()) {
+    writer.WriteString(node.name);
+    for (int k = 0; k < 16; ++k) {
+      writer.Write(node.transform.m[k]);
+    }
+    writer.Write(static_cast<int32_t>(node.mesh));
+    writer.Write(static_cast<uint32_t>(node.children.size()));
+    for (auto child : node.children) {
+      writer.Write(static_cast<int32_t>(child));
+    }
+  }
+
+  writer.Write(static_cast<uint32_t>(scene.roots().size()));
+  for (auto root : scene.roots()) {
+    writer.Write(static_cast<int32_t>(root));
+  }
+
+  return writer.data();
+}
+
+bool IsValidAccessor(const gfx::Accessor& accessor,
+                     const std::vector<gfx::BufferData>& buffers) {
+  if (!accessor.valid()) {
+    return true;
+  }
+  if (static_cast<size_t>(accessor.buffer) >= buffers.size() ||
+      accessor.components < 1 || accessor.components > 4) {
+    return false;
+  }
+  const size_t size = buffers[static_cast<size_t>(accessor.buffer)].size;
+  return accessor.offset <= size &&
+         accessor.byte_length() <= size - accessor.offset;
+}
+
+bool DeserializeScene(const char* data, size_t size, Scene* scene) {
+  Reader reader(data, size);
+  const auto& buffers = scene->buffers();
+
+  const size_t mesh_count = reader.ReadCount();
+  for (size_t i = 0; i < mesh_count && reader.ok(); ++i) {
+    Mesh mesh;
+    mesh.name = reader.ReadString();
+    for (int k = 0; k < 16; ++k) {
+      mesh.position_decode.m[k] = reader.Read<float>();
+    }
+    const size_t primitive_count = reader.ReadCount();
+    for (size_t j = 0; j < primitive_count && reader.ok(); ++j) {
+      Primitive primitive;
+      primitive.positions = reader.ReadAccessor();
+      primitive.normals = reader.ReadAccessor();
+      primitive.tex_coords = reader.ReadAccessor();
+      primitive.indices = reader.ReadAccessor();
+      for (int k = 0; k < 3; ++k) {
+        primitive.bounds.min[k] = reader.Read<float>();
+        primitive.bounds.max[k] = reader.Read<float>();
+      }
+      const size_t lod_count = reader.ReadCount();
+      for (size_t l = 0; l < lod_count && reader.ok(); ++l) {
+        Lod lod;
+        lod.indices = reader.ReadAccessor();
+        lod.error = reader.Read<float>();
+        // The levels of detail share the index buffer of the primitive.
+        if (!primitive.indices.valid() ||
+            lod.indices.buffer != primitive.indices.buffer ||
+            lod.indices.type != primitive.indices.type ||
+            !IsValidAccessor(lod.indices, buffers)) {
+          return false;
+        }
+        primitive.lods.push_back(lod);
+      }
+      primitive.meshlets = reader.ReadArray<gfx::Meshlet>();
+      for (const auto& meshlet : primitive.meshlets) {
+        if (meshlet.index_count > primitive.indices.count ||
+            meshlet.first_index >
+                primitive.indices.count - meshlet.index_count) {
+          return false;
+        }
+      }
+      if (!primitive.positions.valid() ||
+          !IsValidAccessor(primitive.positions, buffers) ||
+          !IsValidAccessor(primitive.normals, buffers) ||
+          !IsValidAccessor(primitive.tex_coords, buffers) ||
+          !IsValidAccessor(primitive.indices, buffers)) {
+        return false;
+      }
+      mesh.primitives.push_back(primitive);
+    }
+    scene->AddMesh(std::move(mesh));
+  }
+
+  const size_t node_count = reader.ReadCount();
+  std::vector<bool> has_parent(node_count, false);
+  for (size_t i = 0; i < node_count && reader.ok(); ++i) {
+    Node node;
+    node.name = reader.ReadString();
+    for (int k = 0; k < 16; ++k) {
+      node.transform.m[k] = reader.Read<float>();
+    }
+    node.mesh = reader.Read<int32_t>();
+    if (node.mesh < -1 || node.mesh >= static_cast<int>(mesh_count)) {
+      return false;
+    }
+    const size_t child_count = reader.ReadCount();
+    for (size_t j = 0; j < child_count && reader.ok(); ++j) {
+      const int32_t child = reader.Read<int32_t>();
+      if (child < 0 || static_cast<size_t>(child) >= node_count ||
+          has_parent[static_cast<size_t>(child)]) {
+        return false;
+      }
+      has_parent[static_cast<size_t>(child)] = true;
+      node.children.push_back(child);
+    }
+    scene->AddNode(node);
+  }
+
+  const size_t root_count = reader.ReadCount();
+  for (size_t i = 0; i < root_count && reader.ok(); ++i) {
+    const int32_t root = reader.Read<int32_t>();
+    if (root < 0 || static_cast<size_t>(root) >= node_count ||
+        has_parent[static_cast<size_t>(root)]) {
+      return false;
+    }
+    scene->AddRoot(root);
+  }
+
+  return reader.ok();
+}
+
+uint64_t HashString(const std::string& str) {
+  // 64-bit FNV-1a.
+  uint64_t hash = UINT64_C(14695981039346656037);
+  for (auto c : str) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * UINT64_C(1099511628211);
+  }
+  return hash;
+}
+
+void WritePadding(std::ofstream* out, uint64_t* pos, uint64_t target) {
+  static const char kZeros[kAlignment] = {0};
+  while (*pos < target) {
+    const auto count = std::min(target - *pos, kAlignment);
+    out->write(kZeros, static_cast<std::streamsize>(count));
+    *pos += count;
+  }
+}
+
+}  // namespace
+
+std::string GetSceneCachePath(const std::string& path,
+                              const std::string& variant) {
+  const auto directory = base::GetCacheDirectory();
+  if (directory.empty()) {
+    return std::string();
+  }
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.vmc",
+                static_cast<unsigned long long>(  // NOLINT(runtime/int)
+                    HashString(base::GetAbsolutePath(path))));
+  if (!variant.empty()) {
+    return directory + std::string(name, 16) + "-" + variant + ".vmc";
+  }
+  return directory + name;
+}
+
+bool ReadSceneCache(const std::string& cache_path,
+                    const std::string& path,
+                    Scene* scene) {
+  base::ProfileScope scope("ReadSceneCache");
+  base::FileStatus status;
+  if (!base::GetFileStatus(path, &status)) {
+    return false;
+  }
+
+  std::shared_ptr<base::MappedFile> file;
+  try {
+    file = std::make_shared<base::MappedFile>(cache_path);
+  } catch (base::Error&) {
+    return false;
+  }
+  const char* data = file->data();
+  const uint64_t size = file->size();
+
+  // Check that the cache file is valid and up to date.
+  FileHeader header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != kMagic || header.version != kVersion ||
+      header.byte_order != kByteOrderMark ||
+      header.source_size != status.size ||
+      header.source_mtime != status.modification_time ||
+      header.chunk_count > (size - sizeof(header)) / sizeof(ChunkEntry)) {
+    return false;
+  }
+
+  std::vector<ChunkEntry> chunks(header.chunk_count);
+  std::memcpy(chunks.data(), data + sizeof(header),
+              chunks.size() * sizeof(ChunkEntry));
+  const ChunkEntry* scene_chunk = nullptr;
+  std::vector<const ChunkEntry*> buffer_chunks;
+  bool source_path_matches = false;
+  for (const auto& chunk : chunks) {
+    if (chunk.offset > size || chunk.size > size - chunk.offset) {
+      return false;
+    }
+    switch (chunk.type) {
+      case kChunkSourcePath:
+        source_path_matches =
+            std::string(data + chunk.offset, chunk.size) ==
+            base::GetAbsolutePath(path);
+        break;
+      case kChunkScene:
+        scene_chunk = &chunk;
+        break;
+      case kChunkBuffer:
+        if (chunk.index != buffer_chunks.size()) {
+          return false;
+        }
+        buffer_chunks.push_back(&chunk);
+        break;
+      default:
+        // Ignore unknown chunks.
+        break;
+    }
+  }
+  if (!source_path_matches || scene_chunk == nullptr) {
+    return false;
+  }
+
+  // The buffers refer directly into the mapped file.
+  Scene result;
+  result.AddFile(file);
+  for (const auto* chunk : buffer_chunks) {
+    result.AddBuffer(data + chunk->offset, static_cast<size_t>(chunk->size));
+  }
+  if (!DeserializeScene(data + scene_chunk->offset,
+                        static_cast<size_t>(scene_chunk->size), &result)) {
+    return false;
+  }
+
+  *scene = std::move(result);
+  return true;
+}
+
+void WriteSceneCache(const std::string& cache_path,
+                     const std::string& path,
+                     const Scene& scene) {
+  base::ProfileScope scope("WriteSceneCache");
+  base::FileStatus status;
+  if (!base::GetFileStatus(path, &status)) {
+    throw base::Error("Unable to get the status of " + path);
+  }
+
+  const auto source_path = base::GetAbsolutePath(path);
+  const auto scene_data = SerializeScene(scene);
+  const auto& buffers = scene.buffers();
+
+  // Lay out the chunks.
+  std::vector<ChunkEntry> chunks;
+  uint64_t pos = sizeof(FileHeader) +
+                 (2 + buffers.size()) * sizeof(ChunkEntry);
+  auto add_chunk = [&chunks, &pos](uint32_t type, uint32_t index,
+                                   uint64_t size) {
+    ChunkEntry chunk;
+    chunk.type = type;
+    chunk.index = index;
+    chunk.offset = AlignUp(pos);
+    chunk.size = size;
+    chunks.push_back(chunk);
+    pos = chunk.offset + size;
+  };
+  add_chunk(kChunkSourcePath, 0, source_path.size());
+  add_chunk(kChunkScene, 0, scene_data.size());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    add_chunk(kChunkBuffer, static_cast<uint32_t>(i), buffers[i].size);
+  }
+
+  FileHeader header;
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.byte_order = kByteOrderMark;
+  header.chunk_count = static_cast<uint32_t>(chunks.size());
+  header.source_size = status.size;
+  header.source_mtime = status.modification_time;
+
+  // Write to a temporary file, and replace the cache file when done.
+  const auto temp_path = cache_path + ".tmp";
+  {
+    std::ofstream out(temp_path, std::ios::out | std::ios::binary);
+    if (!out.good()) {
+      throw base::Error("Unable to create " + temp_path);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(chunks.data()),
+              static_cast<std::streamsize>(chunks.size() * sizeof(ChunkEntry)));
+    pos = sizeof(header) + chunks.size() * sizeof(ChunkEntry);
+
+    const char* chunk_data[2] = {source_path.data(), scene_data.data()};
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      WritePadding(&out, &pos, chunks[i].offset);
+      const char* data = i < 2 ? chunk_data[i] : buffers[i - 2].data;
+      out.write(data, static_cast<std::streamsize>(chunks[i].size));
+      pos += chunks[i].size;
+    }
+
+    if (!out.good()) {
+      out.close();
+      std::remove(temp_path.c_str());
+      throw base::Error("Unable to write " + temp_path);
+    }
+  }
+
+  if (!base::RenameFile(temp_path, cache_path)) {
+    std::remove(temp_path.c_str());
+    throw base::Error("Unable to create " + cache_path);
+  }
+}
+
+}  // namespace model
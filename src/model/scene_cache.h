@@ -0,0 +1,81 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef MODEL_SCENE_CACHE_H_
+#define MODEL_SCENE_CACHE_H_
+
+#include <string>
+
+#include "model/scene.h"
+
+namespace model {
+
+// The scene cache is a binary file format that stores an imported scene in a
+// form that can be memory mapped and used as is. The buffers are stored as
+// aligned blobs that can be passed directly to glBufferData(), so loading a
+// cached scene is bound by disk bandwidth rather than by parsing.
+//
+// A cache file is tied to its source file, and is only used if the source file
+// has the same path, size and modification time as when the cache was written.
+// The data is stored in host byte order, so a cache file that was written on a
+// host with a different byte order is treated as stale.
+
+/// @brief Get the cache file path for a model file.
+/// @param path The path to the model file.
+/// @param variant Distinguishes differently processed scenes of the same
+/// model file (e.g. "q" for quantized vertices), or empty for the default.
+/// @returns the path to the cache file, or an empty string if there is no
+/// cache directory.
+std::string GetSceneCachePath(const std::string& path,
+                              const std::string& variant = std::string());
+
+/// @brief Read a scene from a cache file.
+/// @param cache_path The path to the cache file.
+/// @param path The path to the model file that the cache was created from.
+/// @param[out] scene The loaded scene.
+/// @returns true if the scene was loaded, or false if there is no up to date
+/// and valid cache file.
+bool ReadSceneCache(const std::string& cache_path,
+                    const std::string& path,
+                    Scene* scene);
+
+/// @brief Write a scene to a cache file.
+///
+/// The file is first written to a temporary file that is then renamed, so that
+/// concurrent readers never see a partially written cache file.
+/// @param cache_path The path to the cache file.
+/// @param path The path to the model file that the scene was imported from.
+/// @param scene The scene.
+/// @throws base::Error if the file could not be written.
+void WriteSceneCache(const std::string& cache_path,
+                     const std::string& path,
+                     const Scene& scene);
+
+}  // namespace model
+
+#endif  // MODEL_SCENE_CACHE_H_
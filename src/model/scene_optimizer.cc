@@ -0,0 +1,708 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "model/scene_optimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+#include "base/hash.h"
+#include "base/parallel.h"
+#include "base/profiler.h"
+#include "gfx/mesh_simplifier.h"
+#include "gfx/meshlet.h"
+
+namespace model {
+
+namespace {
+
+// Start a new buffer when a buffer reaches this size.
+const size_t kMaxBufferSize = 256 * 1024 * 1024;
+
+// The largest vertex count that 16-bit indices can address.
+const size_t kMaxShortIndexVertices = 65536;
+
+// A simplified level of detail that is being optimized.
+struct LodWork {
+  std::vector<uint32_t> indices;
+  float error;
+};
+
+// A primitive that is being optimized.
+struct Work {
+  size_t mesh;
+  const Primitive* primitive;
+  gfx::Mesh data;
+  std::vector<LodWork> lods;
+  std::vector<gfx::Meshlet> meshlets;
+  base::Aabb bounds;
+  MeshOptimizerStats stats;
+
+  // The packed vertex and index data, and the primitive that describes it
+  // (with offsets relative to the packed data).
+  std::vector<char> vertex_bytes;
+  std::vector<char> index_bytes;
+  Primitive packed;
+};
+
+// Read a primitive to an interleaved float mesh, dropping triangles with out
+// of range indices.
+void ReadPrimitive(const Scene& scene, Work* work) {
+  const auto& buffers = scene.buffers();
+  const auto& primitive = *work->primitive;
+  auto& data = work->data;
+
+  const size_t vertex_count = primitive.positions.count;
+  data.has_normals = primitive.normals.valid() &&
+                     primitive.normals.count >= vertex_count;
+  data.has_tex_coords = primitive.tex_coords.valid() &&
+                        primitive.tex_coords.count >= vertex_count;
+  data.vertices.resize(vertex_count);
+  for (size_t i = 0; i < vertex_count; ++i) {
+    gfx::Vertex& vertex = data.vertices[i];
+    std::memset(&vertex, 0, sizeof(vertex));
+    float v[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const auto& positions = primitive.positions;
+    positions.ReadFloats(buffers[static_cast<size_t>(positions.buffer)], i, v);
+    std::memcpy(vertex.position, v, sizeof(vertex.position));
+    if (data.has_normals) {
+      const auto& normals = primitive.normals;
+      normals.ReadFloats(buffers[static_cast<size_t>(normals.buffer)], i, v);
+      std::memcpy(vertex.normal, v, sizeof(vertex.normal));
+    }
+    if (data.has_tex_coords) {
+      const auto& tex_coords = primitive.tex_coords;
+      tex_coords.ReadFloats(buffers[static_cast<size_t>(tex_coords.buffer)],
+                            i, v);
+      std::memcpy(vertex.tex_coord, v, sizeof(vertex.tex_coord));
+    }
+  }
+
+  const auto& indices = primitive.indices;
+  const size_t triangle_count = primitive.triangle_count();
+  data.indices.reserve(triangle_count * 3);
+  for (size_t t = 0; t < triangle_count; ++t) {
+    uint32_t triangle[3];
+    bool valid = true;
+    for (size_t k = 0; k < 3; ++k) {
+      size_t index = 3 * t + k;
+      if (indices.valid()) {
+        index = indices.GetIndex(buffers[static_cast<size_t>(indices.buffer)],
+                                 index);
+      }
+      valid = valid && index < vertex_count;
+      triangle[k] = static_cast<uint32_t>(index);
+    }
+    if (valid) {
+      data.indices.insert(data.indices.end(), triangle, triangle + 3);
+    }
+  }
+
+  auto& stats = work->stats;
+  stats.triangles = data.triangle_count();
+  stats.vertices_before = vertex_count;
+  stats.cache_before = gfx::AnalyzeVertexCache(
+      data.indices.data(), data.indices.size(), vertex_count);
+  stats.bytes_before = vertex_count * (primitive.positions.element_size() +
+                                       primitive.normals.element_size() *
+                                           (data.has_normals ? 1 : 0) +
+                                       primitive.tex_coords.element_size() *
+                                           (data.has_tex_coords ? 1 : 0));
+  if (indices.valid()) {
+    stats.bytes_before += indices.count * indices.element_size();
+  }
+}
+
+// Generate the levels of detail of an optimized primitive.
+void BuildLods(const SceneOptimizerOptions& options, Work* work) {
+  const auto& data = work->data;
+  if (options.lod_count <= 0 ||
+      data.triangle_count() < options.lod_min_triangles) {
+    return;
+  }
+  gfx::MeshSimplifier simplifier(data);
+  size_t previous = data.triangle_count();
+  for (int i = 0; i < options.lod_count; ++i) {
+    const auto target = static_cast<size_t>(static_cast<float>(previous) *
+                                            options.lod_ratio);
+    if (target < options.lod_min_triangles) {
+      break;
+    }
+    const size_t count =
+        simplifier.Simplify(target, std::numeric_limits<float>::infinity());
+
+    // Stop when the simplification gets stuck (e.g. when seams lock most of
+    // the vertices) rather than storing nearly identical levels.
+    if (count > (previous + target) / 2) {
+      break;
+    }
+    LodWork lod;
+    lod.indices = simplifier.indices();
+    lod.error = simplifier.error();
+    gfx::OptimizeVertexCache(&lod.indices, data.vertices.size());
+    work->stats.lod_triangles += count;
+    work->lods.push_back(std::move(lod));
+    previous = count;
+  }
+  work->stats.lods = work->lods.size();
+}
+
+void OptimizePrimitive(const Scene& scene,
+                       const SceneOptimizerOptions& options,
+                       Work* work) {
+  ReadPrimitive(scene, work);
+  auto& data = work->data;
+  gfx::WeldVertices(&data);
+  gfx::OptimizeVertexCache(&data.indices, data.vertices.size());
+  gfx::OptimizeVertexFetch(&data);
+  BuildLods(options, work);
+  if (data.triangle_count() >= options.meshlet_min_triangles) {
+    work->meshlets = gfx::BuildMeshlets(data);
+    work->stats.meshlets = work->meshlets.size();
+  }
+
+  work->bounds = base::Aabb::Empty();
+  for (const auto& vertex : data.vertices) {
+    work->bounds.Grow(base::Vec3{vertex.position[0], vertex.position[1],
+                                 vertex.position[2]});
+  }
+  if (data.vertices.empty()) {
+    work->bounds = base::Aabb{{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+  }
+
+  work->stats.vertices_after = data.vertices.size();
+  work->stats.cache_after = gfx::AnalyzeVertexCache(
+      data.indices.data(), data.indices.size(), data.vertices.size());
+}
+
+template <typename T>
+void Append(const T& value, std::vector<char>* out) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  out->insert(out->end(), bytes, bytes + sizeof(T));
+}
+
+// Append indices of the given type, padded to a multiple of four bytes.
+// @returns the accessor, relative to the start of the data.
+gfx::Accessor AppendIndices(const std::vector<uint32_t>& indices,
+                            gfx::DataType type,
+                            std::vector<char>* out) {
+  gfx::Accessor accessor;
+  accessor.buffer = 0;
+  accessor.offset = out->size();
+  accessor.count = indices.size();
+  accessor.type = type;
+  if (type == gfx::DataType::kUInt16) {
+    for (auto index : indices) {
+      Append(static_cast<uint16_t>(index), out);
+    }
+    if (out->size() % 4 != 0) {
+      Append(uint16_t(0), out);
+    }
+  } else {
+    const size_t offset = out->size();
+    out->resize(offset + indices.size() * sizeof(uint32_t));
+    std::memcpy(out->data() + offset, indices.data(),
+                indices.size() * sizeof(uint32_t));
+  }
+  return accessor;
+}
+
+// Interleave (and optionally quantize) the vertex attributes, and store the
+// indices with the smallest type that fits.
+void PackPrimitive(const SceneOptimizerOptions& options,
+                   const base::Vec3& center,
+                   float scale,
+                   Work* work) {
+  const auto& data = work->data;
+  auto& packed = work->packed;
+  packed.bounds = work->bounds;
+  packed.meshlets = std::move(work->meshlets);
+
+  // Describe the layout.
+  size_t stride = 0;
+  packed.positions.buffer = 0;
+  packed.positions.components = 3;
+  packed.positions.count = data.vertices.size();
+  if (options.quantize) {
+    packed.positions.type = gfx::DataType::kInt16;
+    packed.positions.normalized = true;
+    stride += 8;
+  } else {
+    stride += 12;
+  }
+  if (data.has_normals) {
+    packed.normals = packed.positions;
+    packed.normals.offset = stride;
+    if (options.quantize && options.packed_normals) {
+      packed.normals.type = gfx::DataType::kInt10_10_10_2;
+      packed.normals.components = 4;
+      stride += 4;
+    } else {
+      stride += options.quantize ? 8 : 12;
+    }
+  }
+  if (data.has_tex_coords) {
+    packed.tex_coords = packed.positions;
+    packed.tex_coords.offset = stride;
+    packed.tex_coords.components = 2;
+    if (options.quantize) {
+      packed.tex_coords.type = gfx::DataType::kFloat16;
+      packed.tex_coords.normalized = false;
+      stride += 4;
+    } else {
+      stride += 8;
+    }
+  }
+  packed.positions.stride = stride;
+  packed.normals.stride = stride;
+  packed.tex_coords.stride = stride;
+
+  // Write the vertices.
+  auto& out = work->vertex_bytes;
+  out.reserve(stride * data.vertices.size());
+  const float inv_scale = 1.0f / scale;
+  for (const auto& vertex : data.vertices) {
+    if (options.quantize) {
+      for (int k = 0; k < 3; ++k) {
+        Append(gfx::QuantizeSnorm16((vertex.position[k] - center[k]) *
+                                    inv_scale),
+               &out);
+      }
+      Append(int16_t(0), &out);
+    } else {
+      Append(vertex.position, &out);
+    }
+    if (data.has_normals) {
+      if (options.quantize) {
+        // Quantize unit normals (the shader normalizes them anyway).
+        const base::Vec3 n = base::Normalize(
+            base::Vec3{vertex.normal[0], vertex.normal[1], vertex.normal[2]});
+        const float unit[3] = {n.x, n.y, n.z};
+        if (options.packed_normals) {
+          Append(gfx::PackSnorm10(unit), &out);
+        } else {
+          for (int k = 0; k < 3; ++k) {
+            Append(gfx::QuantizeSnorm16(unit[k]), &out);
+          }
+          Append(int16_t(0), &out);
+        }
+      } else {
+        Append(vertex.normal, &out);
+      }
+    }
+    if (data.has_tex_coords) {
+      if (options.quantize) {
+        Append(gfx::FloatToHalf(vertex.tex_coord[0]), &out);
+        Append(gfx::FloatToHalf(vertex.tex_coord[1]), &out);
+      } else {
+        Append(vertex.tex_coord, &out);
+      }
+    }
+  }
+
+  // Write the indices of the primitive followed by those of its levels of
+  // detail, all with the same type.
+  const gfx::DataType index_type =
+      data.vertices.size() <= kMaxShortIndexVertices ? gfx::DataType::kUInt16
+                                                     : gfx::DataType::kUInt32;
+  packed.indices = AppendIndices(data.indices, index_type, &work->index_bytes);
+  for (const auto& lod_work : work->lods) {
+    Lod lod;
+    lod.indices =
+        AppendIndices(lod_work.indices, index_type, &work->index_bytes);
+    lod.error = lod_work.error;
+    packed.lods.push_back(lod);
+  }
+
+  work->stats.bytes_after = packed.positions.count * stride +
+                            work->index_bytes.size();
+
+  // Free the float data early.
+  std::vector<gfx::Vertex>().swap(work->data.vertices);
+  std::vector<LodWork>().swap(work->lods);
+}
+
+// Hash the elements of an accessor (and its format).
+uint64_t HashAccessor(const Scene& scene,
+                      const gfx::Accessor& accessor,
+                      uint64_t hash) {
+  hash = base::HashCombine(hash, accessor.valid() ? accessor.count : 0);
+  if (!accessor.valid()) {
+    return hash;
+  }
+  hash = base::HashCombine(hash, static_cast<uint64_t>(accessor.type));
+  hash = base::HashCombine(hash, static_cast<uint64_t>(accessor.components));
+  hash = base::HashCombine(hash, accessor.normalized ? 1u : 0u);
+  const char* data =
+      scene.buffers()[static_cast<size_t>(accessor.buffer)].data +
+      accessor.offset;
+  const size_t element_size = accessor.element_size();
+  const size_t stride = accessor.byte_stride();
+  if (stride == element_size) {
+    return base::HashBytes(data, accessor.byte_length(), hash);
+  }
+  for (size_t i = 0; i < accessor.count; ++i) {
+    hash = base::HashBytes(data + i * stride, element_size, hash);
+  }
+  return hash;
+}
+
+// Hash the vertex and index data of all the primitives of a mesh.
+uint64_t HashMesh(const Scene& scene, const Mesh& mesh) {
+  uint64_t hash = base::HashCombine(0, mesh.primitives.size());
+  for (const auto& primitive : mesh.primitives) {
+    for (const auto* accessor : {&primitive.positions, &primitive.normals,
+                                 &primitive.tex_coords, &primitive.indices}) {
+      hash = HashAccessor(scene, *accessor, hash);
+    }
+  }
+  return base::HashCombine(
+      hash, base::HashBytes(mesh.position_decode.m,
+                            sizeof(mesh.position_decode.m)));
+}
+
+// @returns true if two accessors have the same format and elements.
+bool SameAccessorData(const Scene& scene,
+                      const gfx::Accessor& a,
+                      const gfx::Accessor& b) {
+  if (a.valid() != b.valid()) {
+    return false;
+  }
+  if (!a.valid()) {
+    return true;
+  }
+  if (a.count != b.count || a.type != b.type ||
+      a.components != b.components || a.normalized != b.normalized) {
+    return false;
+  }
+  const char* a_data =
+      scene.buffers()[static_cast<size_t>(a.buffer)].data + a.offset;
+  const char* b_data =
+      scene.buffers()[static_cast<size_t>(b.buffer)].data + b.offset;
+  const size_t element_size = a.element_size();
+  const size_t a_stride = a.byte_stride();
+  const size_t b_stride = b.byte_stride();
+  if (a_data == b_data && a_stride == b_stride) {
+    return true;
+  }
+  if (a_stride == element_size && b_stride == element_size) {
+    return std::memcmp(a_data, b_data, a.byte_length()) == 0;
+  }
+  for (size_t i = 0; i < a.count; ++i) {
+    if (std::memcmp(a_data + i * a_stride, b_data + i * b_stride,
+                    element_size) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// @returns true if two meshes have the same vertex and index data (the hashes
+// of different data may collide).
+bool SameMeshData(const Scene& scene, const Mesh& a, const Mesh& b) {
+  if (a.primitives.size() != b.primitives.size() ||
+      std::memcmp(a.position_decode.m, b.position_decode.m,
+                  sizeof(a.position_decode.m)) != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < a.primitives.size(); ++i) {
+    const auto& pa = a.primitives[i];
+    const auto& pb = b.primitives[i];
+    if (!SameAccessorData(scene, pa.positions, pb.positions) ||
+        !SameAccessorData(scene, pa.normals, pb.normals) ||
+        !SameAccessorData(scene, pa.tex_coords, pb.tex_coords) ||
+        !SameAccessorData(scene, pa.indices, pb.indices)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// @returns the size of the vertex and index data of a mesh.
+size_t GetMeshBytes(const Mesh& mesh) {
+  size_t bytes = 0;
+  for (const auto& primitive : mesh.primitives) {
+    for (const auto* accessor : {&primitive.positions, &primitive.normals,
+                                 &primitive.tex_coords, &primitive.indices}) {
+      if (accessor->valid()) {
+        bytes += accessor->count * accessor->element_size();
+      }
+    }
+  }
+  return bytes;
+}
+
+// Accumulate the statistics of a primitive into a mesh (or a scene).
+void AddStats(const MeshOptimizerStats& part, MeshOptimizerStats* sum) {
+  sum->triangles += part.triangles;
+  sum->lods = std::max(sum->lods, part.lods);
+  sum->lod_triangles += part.lod_triangles;
+  sum->meshlets += part.meshlets;
+  sum->vertices_before += part.vertices_before;
+  sum->vertices_after += part.vertices_after;
+  sum->cache_before.transformed += part.cache_before.transformed;
+  sum->cache_after.transformed += part.cache_after.transformed;
+  sum->bytes_before += part.bytes_before;
+  sum->bytes_after += part.bytes_after;
+}
+
+void UpdateRatios(MeshOptimizerStats* stats) {
+  const auto triangles =
+      static_cast<float>(std::max<size_t>(stats->triangles, 1));
+  const auto vertices =
+      static_cast<float>(std::max<size_t>(stats->vertices_after, 1));
+  stats->cache_before.acmr =
+      static_cast<float>(stats->cache_before.transformed) / triangles;
+  stats->cache_after.acmr =
+      static_cast<float>(stats->cache_after.transformed) / triangles;
+  stats->cache_before.atvr =
+      static_cast<float>(stats->cache_before.transformed) / vertices;
+  stats->cache_after.atvr =
+      static_cast<float>(stats->cache_after.transformed) / vertices;
+}
+
+// Collects the packed data into a few large buffers.
+class BufferBuilder {
+ public:
+  // Append a block of data.
+  // @param bytes The data.
+  // @param alignment The offset of the data is a multiple of this.
+  // @param[out] offset The offset of the data in its buffer.
+  // @returns the index of the buffer, relative to the first buffer.
+  int Add(const std::vector<char>& bytes, size_t alignment, size_t* offset) {
+    if (buffers_.empty() ||
+        (!buffers_.back().empty() &&
+         buffers_.back().size() + alignment + bytes.size() > kMaxBufferSize)) {
+      buffers_.emplace_back();
+    }
+    auto& buffer = buffers_.back();
+    buffer.resize((buffer.size() + alignment - 1) / alignment * alignment);
+    *offset = buffer.size();
+    buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+    return static_cast<int>(buffers_.size() - 1);
+  }
+
+  // Move the buffers to a scene.
+  // @returns the scene index of the first buffer.
+  int Finish(Scene* scene) {
+    const int first = static_cast<int>(scene->buffers().size());
+    for (auto& buffer : buffers_) {
+      const size_t size = buffer.size();
+      scene->AddBuffer(scene->AddStorage(std::move(buffer)), size);
+    }
+    buffers_.clear();
+    return first;
+  }
+
+ private:
+  std::vector<std::vector<char>> buffers_;
+};
+
+}  // namespace
+
+Scene OptimizeScene(const Scene& scene,
+                    const SceneOptimizerOptions& options,
+                    SceneOptimizerStats* stats) {
+  base::ProfileScope scope("OptimizeScene");
+  const auto start = std::chrono::steady_clock::now();
+
+  // Find the meshes with the same data as an earlier mesh, which are replaced
+  // by that mesh. The hash finds the candidates, and the data is compared.
+  const auto& input_meshes = scene.meshes();
+  std::vector<size_t> mesh_map(input_meshes.size());
+  std::vector<const Mesh*> unique_meshes;
+  size_t duplicate_bytes = 0;
+  if (options.merge_duplicates) {
+    std::vector<uint64_t> hashes(input_meshes.size());
+    base::ParallelFor(input_meshes.size(),
+                      [&scene, &input_meshes, &hashes](size_t i) {
+                        hashes[i] = HashMesh(scene, input_meshes[i]);
+                      });
+    std::unordered_map<uint64_t, std::vector<size_t>> candidates;
+    for (size_t m = 0; m < input_meshes.size(); ++m) {
+      auto& same_hash = candidates[hashes[m]];
+      bool found = false;
+      for (size_t unique : same_hash) {
+        if (SameMeshData(scene, *unique_meshes[unique], input_meshes[m])) {
+          duplicate_bytes += GetMeshBytes(input_meshes[m]);
+          mesh_map[m] = unique;
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        mesh_map[m] = unique_meshes.size();
+        same_hash.push_back(unique_meshes.size());
+        unique_meshes.push_back(&input_meshes[m]);
+      }
+    }
+  } else {
+    for (size_t m = 0; m < input_meshes.size(); ++m) {
+      mesh_map[m] = m;
+      unique_meshes.push_back(&input_meshes[m]);
+    }
+  }
+
+  // Weld and reorder all the primitives in parallel.
+  std::vector<Work> work;
+  for (size_t m = 0; m < unique_meshes.size(); ++m) {
+    for (const auto& primitive : unique_meshes[m]->primitives) {
+      work.emplace_back();
+      work.back().mesh = m;
+      work.back().primitive = &primitive;
+    }
+  }
+  base::ParallelFor(work.size(), [&scene, &options, &work](size_t i) {
+    OptimizePrimitive(scene, options, &work[i]);
+  });
+
+  // Quantize the positions of each mesh relative to its bounding box, with
+  // the same scale on all the axes (so that normals transform correctly).
+  std::vector<base::Aabb> mesh_bounds(unique_meshes.size(),
+                                      base::Aabb::Empty());
+  for (const auto& w : work) {
+    mesh_bounds[w.mesh].Grow(w.bounds);
+  }
+  std::vector<base::Vec3> centers(unique_meshes.size());
+  std::vector<float> scales(unique_meshes.size(), 1.0f);
+  for (size_t m = 0; m < unique_meshes.size(); ++m) {
+    const auto& bounds = mesh_bounds[m];
+    if (bounds.empty()) {
+      centers[m] = base::Vec3{0.0f, 0.0f, 0.0f};
+      continue;
+    }
+    centers[m] = bounds.center();
+    const base::Vec3 extent = bounds.extent();
+    const float scale = std::max(extent.x, std::max(extent.y, extent.z));
+    scales[m] = scale > 0.0f ? scale : 1.0f;
+  }
+  base::ParallelFor(work.size(), [&options, &work, &centers, &scales](
+                                     size_t i) {
+    PackPrimitive(options, centers[work[i].mesh], scales[work[i].mesh],
+                  &work[i]);
+  });
+
+  // Build the optimized scene.
+  Scene result;
+  BufferBuilder vertex_buffers;
+  BufferBuilder index_buffers;
+  std::vector<Mesh> result_meshes;
+  std::vector<MeshOptimizerStats> mesh_stats(unique_meshes.size());
+  size_t next_work = 0;
+  for (size_t m = 0; m < unique_meshes.size(); ++m) {
+    Mesh mesh;
+    mesh.name = unique_meshes[m]->name;
+    if (options.quantize) {
+      mesh.position_decode =
+          base::Mat4::Translation(centers[m]) *
+          base::Mat4::Scale(base::Vec3{scales[m], scales[m], scales[m]});
+    }
+    mesh_stats[m].name = mesh.name;
+    for (size_t p = 0; p < unique_meshes[m]->primitives.size(); ++p) {
+      Work& w = work[next_work++];
+      Primitive primitive = w.packed;
+      // The vertex data starts at a whole number of vertices into its buffer,
+      // so that primitives with the same vertex format can be drawn with one
+      // vertex array object and a base vertex.
+      size_t offset;
+      const int vertex_buffer = vertex_buffers.Add(
+          w.vertex_bytes, primitive.positions.byte_stride(), &offset);
+      for (auto* accessor : {&primitive.positions, &primitive.normals,
+                             &primitive.tex_coords}) {
+        if (accessor->valid()) {
+          accessor->buffer = vertex_buffer;
+          accessor->offset += offset;
+        }
+      }
+      const int index_buffer = index_buffers.Add(
+          w.index_bytes, primitive.indices.element_size(), &offset);
+      primitive.indices.buffer = index_buffer;
+      primitive.indices.offset += offset;
+      for (auto& lod : primitive.lods) {
+        lod.indices.buffer = index_buffer;
+        lod.indices.offset += offset;
+      }
+      mesh.primitives.push_back(primitive);
+      AddStats(w.stats, &mesh_stats[m]);
+      std::vector<char>().swap(w.vertex_bytes);
+      std::vector<char>().swap(w.index_bytes);
+    }
+    result_meshes.push_back(std::move(mesh));
+  }
+  const int first_vertex_buffer = vertex_buffers.Finish(&result);
+  const int first_index_buffer = index_buffers.Finish(&result);
+  for (auto& mesh : result_meshes) {
+    for (auto& primitive : mesh.primitives) {
+      for (auto* accessor : {&primitive.positions, &primitive.normals,
+                             &primitive.tex_coords}) {
+        if (accessor->valid()) {
+          accessor->buffer += first_vertex_buffer;
+        }
+      }
+      primitive.indices.buffer += first_index_buffer;
+      for (auto& lod : primitive.lods) {
+        lod.indices.buffer += first_index_buffer;
+      }
+    }
+    result.AddMesh(std::move(mesh));
+  }
+
+  for (auto node : scene.nodes()) {
+    if (node.mesh >= 0) {
+      node.mesh = static_cast<int>(mesh_map[static_cast<size_t>(node.mesh)]);
+    }
+    result.AddNode(node);
+  }
+  for (auto root : scene.roots()) {
+    result.AddRoot(root);
+  }
+
+  if (stats != nullptr) {
+    stats->meshes = std::move(mesh_stats);
+    stats->total = MeshOptimizerStats();
+    stats->total.name = "Total";
+    for (auto& mesh : stats->meshes) {
+      UpdateRatios(&mesh);
+      AddStats(mesh, &stats->total);
+    }
+    UpdateRatios(&stats->total);
+    stats->duplicate_meshes = input_meshes.size() - unique_meshes.size();
+    stats->duplicate_bytes = duplicate_bytes;
+    stats->seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  }
+  return result;
+}
+
+}  // namespace model
@@ -0,0 +1,136 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef MODEL_SCENE_OPTIMIZER_H_
+#define MODEL_SCENE_OPTIMIZER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "gfx/mesh_optimizer.h"
+#include "model/scene.h"
+
+namespace model {
+
+/// @brief Options for OptimizeScene().
+struct SceneOptimizerOptions {
+  /// Quantize the vertex attributes: positions to 16-bit integers (relative
+  /// to the mesh bounds, see Mesh::position_decode), normals to 10-10-10-2
+  /// integers and texture coordinates to half floats.
+  bool quantize = false;
+
+  /// Pack quantized normals in 10-10-10-2 integers (which requires OpenGL
+  /// 3.3), rather than in 16-bit integers.
+  bool packed_normals = true;
+
+  /// The maximum number of simplified levels of detail per primitive (zero
+  /// disables the simplification).
+  int lod_count = 4;
+
+  /// The target triangle count of each level of detail, relative to the
+  /// previous level.
+  float lod_ratio = 0.5f;
+
+  /// Levels of detail are not generated below this number of triangles.
+  size_t lod_min_triangles = 256;
+
+  /// Primitives with at least this many triangles are partitioned into
+  /// meshlets (see gfx::BuildMeshlets()), so that they can be culled in
+  /// parts.
+  size_t meshlet_min_triangles = 1024;
+
+  /// Replace meshes that have the same vertex and index data as an earlier
+  /// mesh (found by a hash of the data) with that mesh, so that the nodes
+  /// that refer to them become instances of a single mesh.
+  bool merge_duplicates = true;
+};
+
+/// @brief The effect of the optimization on a mesh (or on a whole scene).
+struct MeshOptimizerStats {
+  std::string name;
+  size_t triangles = 0;
+  size_t vertices_before = 0;
+  size_t vertices_after = 0;
+  gfx::VertexCacheStats cache_before;
+  gfx::VertexCacheStats cache_after;
+
+  /// The number of levels of detail (the most of any primitive), and the
+  /// triangles of all the levels.
+  size_t lods = 0;
+  size_t lod_triangles = 0;
+
+  size_t meshlets = 0;
+
+  /// The size of the vertex and index data (including the levels of detail).
+  size_t bytes_before = 0;
+  size_t bytes_after = 0;
+};
+
+/// @brief Statistics for OptimizeScene().
+struct SceneOptimizerStats {
+  /// The statistics of the meshes of the result (without the duplicates).
+  std::vector<MeshOptimizerStats> meshes;
+  MeshOptimizerStats total;
+
+  /// The number of merged duplicate meshes, and the size of their data.
+  size_t duplicate_meshes = 0;
+  size_t duplicate_bytes = 0;
+
+  double seconds = 0.0;
+};
+
+/// @brief Optimize the meshes of a scene for rendering.
+///
+/// Duplicate meshes are merged first (see
+/// SceneOptimizerOptions::merge_duplicates). Then each primitive is processed
+/// on the default task scheduler:
+///  - Vertices with identical attributes are welded.
+///  - The triangles are reordered for the post-transform vertex cache.
+///  - The vertices are reordered by first use, for fetch locality.
+///  - A chain of levels of detail is generated by quadric error
+///    simplification (see gfx::MeshSimplifier). The levels share the vertices
+///    of the primitive, and their triangles are reordered for the vertex cache
+///    too.
+///  - Large primitives are partitioned into meshlets.
+///  - The attributes are interleaved (and optionally quantized), and 16-bit
+///    indices are used where possible.
+///
+/// The result holds the same nodes as the input scene (referring to the
+/// merged meshes), and the data of all the primitives in a few large buffers.
+/// @param scene The scene to optimize.
+/// @param options The options.
+/// @param[out] stats The statistics (may be nullptr).
+/// @returns the optimized scene.
+Scene OptimizeScene(const Scene& scene,
+                    const SceneOptimizerOptions& options,
+                    SceneOptimizerStats* stats);
+
+}  // namespace model
+
+#endif  // MODEL_SCENE_OPTIMIZER_H_
@@ -0,0 +1,249 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "model/stl_importer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "base/error.h"
+#include "base/mapped_file.h"
+#include "base/parallel.h"
+#include "model/binary_reader.h"
+#include "model/text_parser.h"
+
+namespace model {
+
+namespace {
+
+const size_t kHeaderSize = 80;
+const size_t kTriangleSize = 50;
+
+// Number of triangles per parallel work item.
+const size_t kTrianglesPerBlock = 1 << 16;
+
+void ThrowMalformed() {
+  throw base::Error("Malformed STL file.");
+}
+
+// Fill in the facet normal for the three vertices of a triangle. If the file
+// does not provide a normal, it is calculated from the triangle.
+void SetFacetNormal(const float* normal, gfx::Vertex* vertices) {
+  float n[3] = {normal[0], normal[1], normal[2]};
+  if (n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f) {
+    const float* p0 = vertices[0].position;
+    const float* p1 = vertices[1].position;
+    const float* p2 = vertices[2].position;
+    const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    const float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (len > 0.0f) {
+      n[0] /= len;
+      n[1] /= len;
+      n[2] /= len;
+    }
+  }
+  for (int i = 0; i < 3; ++i) {
+    std::memcpy(vertices[i].normal, n, sizeof(n));
+    vertices[i].tex_coord[0] = vertices[i].tex_coord[1] = 0.0f;
+  }
+}
+
+// Fill in the trivial index array (STL vertices are never shared).
+void SetSequentialIndices(gfx::Mesh* mesh) {
+  uint32_t* indices = mesh->indices.data();
+  const size_t count = mesh->indices.size();
+  base::ParallelFor(
+      (count + kTrianglesPerBlock - 1) / kTrianglesPerBlock,
+      [indices, count](size_t block) {
+        const size_t first = block * kTrianglesPerBlock;
+        const size_t last = std::min(first + kTrianglesPerBlock, count);
+        for (size_t i = first; i < last; ++i) {
+          indices[i] = static_cast<uint32_t>(i);
+        }
+      });
+}
+
+bool IsBinary(const char* data, size_t size) {
+  if (size < kHeaderSize + 4) {
+    return false;
+  }
+
+  // Binary files may start with "solid" too, so the only reliable check is if
+  // the file size matches the triangle count.
+  const auto num_triangles =
+      static_cast<size_t>(ReadLittleEndian<uint32_t>(data + kHeaderSize));
+  return size == kHeaderSize + 4 + num_triangles * kTriangleSize;
+}
+
+gfx::Mesh ImportBinary(const char* data) {
+  const auto num_triangles =
+      static_cast<size_t>(ReadLittleEndian<uint32_t>(data + kHeaderSize));
+  if (num_triangles * 3 >= 0xffffffffu) {
+    throw base::Error("Too many triangles in STL file.");
+  }
+  const char* triangles = data + kHeaderSize + 4;
+  const bool swap = !IsLittleEndianHost();
+
+  gfx::Mesh mesh;
+  mesh.has_normals = true;
+  mesh.vertices.resize(num_triangles * 3);
+  mesh.indices.resize(num_triangles * 3);
+
+  // The 12 floats of each triangle record (normal + three corners) are copied
+  // straight into the vertex array (with byte swapping on big endian hosts).
+  gfx::Vertex* vertices = mesh.vertices.data();
+  base::ParallelFor(
+      (num_triangles + kTrianglesPerBlock - 1) / kTrianglesPerBlock,
+      [triangles, vertices, num_triangles, swap](size_t block) {
+        const size_t first = block * kTrianglesPerBlock;
+        const size_t last = std::min(first + kTrianglesPerBlock, num_triangles);
+        for (size_t i = first; i < last; ++i) {
+          const char* src = triangles + i * kTriangleSize;
+          gfx::Vertex* dst = vertices + i * 3;
+          float values[12];
+          if (swap) {
+            for (int k = 0; k < 12; ++k) {
+              values[k] = ReadValue<float>(src + k * 4, true);
+            }
+          } else {
+            std::memcpy(values, src, sizeof(values));
+          }
+          std::memcpy(dst[0].position, &values[3], 3 * sizeof(float));
+          std::memcpy(dst[1].position, &values[6], 3 * sizeof(float));
+          std::memcpy(dst[2].position, &values[9], 3 * sizeof(float));
+          SetFacetNormal(&values[0], dst);
+        }
+      });
+
+  SetSequentialIndices(&mesh);
+  return mesh;
+}
+
+// Check for a keyword at the given position, and skip past it.
+const char* ExpectKeyword(const char* p, const char* end, const char* word) {
+  p = SkipWhitespace(p, end);
+  const size_t len = std::strlen(word);
+  if (static_cast<size_t>(end - p) < len || std::memcmp(p, word, len) != 0) {
+    return nullptr;
+  }
+  return p + len;
+}
+
+const char* ParseVector(const char* p, const char* end, float* v) {
+  for (int i = 0; i < 3 && p != nullptr; ++i) {
+    p = ParseFloat(SkipSpaces(p, end), end, &v[i]);
+  }
+  return p;
+}
+
+gfx::Mesh ImportAscii(const char* data, size_t size) {
+  const char* p = data;
+  const char* end = data + size;
+
+  gfx::Mesh mesh;
+  mesh.has_normals = true;
+
+  // Each facet is at least ~200 bytes of text, which gives a good estimate of
+  // the final size.
+  mesh.vertices.reserve((size / 200) * 3);
+
+  // A file may hold several "solid name" ... "endsolid name" blocks, which
+  // are merged into one mesh. The first "solid name" line is skipped.
+  p = SkipLine(p, end);
+  while (true) {
+    const char* facet = ExpectKeyword(p, end, "facet");
+    if (facet == nullptr) {
+      // We're done if we reached the end of the file, or "endsolid" that is
+      // not followed by another solid (anything else after it is ignored).
+      p = SkipWhitespace(p, end);
+      if (p == end) {
+        break;
+      }
+      if (ExpectKeyword(p, end, "endsolid") == nullptr) {
+        ThrowMalformed();
+      }
+      p = SkipLine(p, end);
+      if (ExpectKeyword(p, end, "solid") == nullptr) {
+        break;
+      }
+      p = SkipLine(SkipWhitespace(p, end), end);
+      continue;
+    }
+    p = ExpectKeyword(facet, end, "normal");
+    float normal[3];
+    if (p == nullptr || (p = ParseVector(p, end, normal)) == nullptr) {
+      ThrowMalformed();
+    }
+    if ((p = ExpectKeyword(p, end, "outer")) == nullptr ||
+        (p = ExpectKeyword(p, end, "loop")) == nullptr) {
+      ThrowMalformed();
+    }
+
+    // Decode the corners straight into the vertex array.
+    const size_t first_vertex = mesh.vertices.size();
+    mesh.vertices.resize(first_vertex + 3);
+    gfx::Vertex* vertices = &mesh.vertices[first_vertex];
+    for (int i = 0; i < 3; ++i) {
+      if ((p = ExpectKeyword(p, end, "vertex")) == nullptr ||
+          (p = ParseVector(p, end, vertices[i].position)) == nullptr) {
+        ThrowMalformed();
+      }
+    }
+    SetFacetNormal(normal, vertices);
+
+    if ((p = ExpectKeyword(p, end, "endloop")) == nullptr ||
+        (p = ExpectKeyword(p, end, "endfacet")) == nullptr) {
+      ThrowMalformed();
+    }
+  }
+
+  if (mesh.vertices.size() >= 0xffffffffu) {
+    throw base::Error("Too many triangles in STL file.");
+  }
+  mesh.indices.resize(mesh.vertices.size());
+  SetSequentialIndices(&mesh);
+  return mesh;
+}
+
+}  // namespace
+
+gfx::Mesh ImportStl(const std::string& path) {
+  base::MappedFile file(path);
+  if (IsBinary(file.data(), file.size())) {
+    return ImportBinary(file.data());
+  }
+  return ImportAscii(file.data(), file.size());
+}
+
+}  // namespace model
@@ -0,0 +1,160 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "model/text_parser.h"
+
+#include <cstring>
+#include <limits>
+
+namespace model {
+
+namespace {
+
+// Exactly representable powers of ten.
+const double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                         1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                         1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+const int kMaxPow10 = 22;
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+double Scale(double x, int exponent) {
+  while (exponent > kMaxPow10) {
+    x *= kPow10[kMaxPow10];
+    exponent -= kMaxPow10;
+  }
+  while (exponent < -kMaxPow10) {
+    x /= kPow10[kMaxPow10];
+    exponent += kMaxPow10;
+  }
+  return exponent >= 0 ? x * kPow10[exponent] : x / kPow10[-exponent];
+}
+
+}  // namespace
+
+const char* SkipLine(const char* p, const char* end) {
+  if (p >= end) {
+    return end;
+  }
+  const auto* eol = reinterpret_cast<const char*>(
+      std::memchr(p, '\n', static_cast<size_t>(end - p)));
+  return eol != nullptr ? eol + 1 : end;
+}
+
+const char* ParseFloat(const char* p, const char* end, float* result) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+
+  // Collect up to 19 significant digits in an integer mantissa. Any further
+  // digits only affect the exponent (they are way below float precision).
+  uint64_t mantissa = 0;
+  int exponent = 0;
+  int num_digits = 0;
+  bool has_digits = false;
+  for (; p < end && IsDigit(*p); ++p) {
+    has_digits = true;
+    if (num_digits < 19) {
+      mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+      if (mantissa != 0) {
+        ++num_digits;
+      }
+    } else {
+      ++exponent;
+    }
+  }
+  if (p < end && *p == '.') {
+    ++p;
+    for (; p < end && IsDigit(*p); ++p) {
+      has_digits = true;
+      if (num_digits < 19) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        if (mantissa != 0) {
+          ++num_digits;
+        }
+        --exponent;
+      }
+    }
+  }
+  if (!has_digits) {
+    return nullptr;
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char* exp_start = p;
+    ++p;
+    bool exp_negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+      exp_negative = *p == '-';
+      ++p;
+    }
+    if (p < end && IsDigit(*p)) {
+      int exp_value = 0;
+      for (; p < end && IsDigit(*p); ++p) {
+        if (exp_value < 10000) {
+          exp_value = exp_value * 10 + (*p - '0');
+        }
+      }
+      exponent += exp_negative ? -exp_value : exp_value;
+    } else {
+      // Not an exponent after all (e.g. "1e" followed by something else).
+      p = exp_start;
+    }
+  }
+
+  const double value = Scale(static_cast<double>(mantissa), exponent);
+  *result = static_cast<float>(negative ? -value : value);
+  return p;
+}
+
+const char* ParseInt(const char* p, const char* end, int64_t* result) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+  if (p >= end || !IsDigit(*p)) {
+    return nullptr;
+  }
+  int64_t value = 0;
+  for (; p < end && IsDigit(*p); ++p) {
+    const int digit = *p - '0';
+    if (value > (std::numeric_limits<int64_t>::max() - digit) / 10) {
+      return nullptr;
+    }
+    value = value * 10 + digit;
+  }
+  *result = negative ? -value : value;
+  return p;
+}
+
+}  // namespace model
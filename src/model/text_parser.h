@@ -0,0 +1,81 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef MODEL_TEXT_PARSER_H_
+#define MODEL_TEXT_PARSER_H_
+
+#include <cstdint>
+
+namespace model {
+
+// Helpers for parsing text based model formats directly from a memory buffer.
+// Unlike the C library functions (strtof etc), these are locale independent,
+// do not require zero terminated strings and are considerably faster.
+//
+// All the functions take the current position and the end of the buffer, and
+// return the new position.
+
+/// @brief Skip spaces and tabs (but not line breaks).
+inline const char* SkipSpaces(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t')) {
+    ++p;
+  }
+  return p;
+}
+
+/// @brief Skip spaces, tabs and line breaks.
+inline const char* SkipWhitespace(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+    ++p;
+  }
+  return p;
+}
+
+/// @brief Skip to the first character of the next line.
+const char* SkipLine(const char* p, const char* end);
+
+/// @brief Check if the position is at the end of a line (or of the buffer).
+inline bool IsEndOfLine(const char* p, const char* end) {
+  return p >= end || *p == '\n' || *p == '\r';
+}
+
+/// @brief Parse a floating point number, e.g. "-1.25e-3".
+/// @param[out] result The parsed number.
+/// @returns the position after the number, or nullptr if there was no valid
+/// number at the given position.
+const char* ParseFloat(const char* p, const char* end, float* result);
+
+/// @brief Parse a signed decimal integer.
+/// @param[out] result The parsed number.
+/// @returns the position after the number, or nullptr if there was no valid
+/// number at the given position (or if it does not fit in 64 bits).
+const char* ParseInt(const char* p, const char* end, int64_t* result);
+
+}  // namespace model
+
+#endif  // MODEL_TEXT_PARSER_H_
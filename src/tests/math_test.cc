@@ -0,0 +1,300 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+// This test checks the batch kernels of base/math.h (which use the SIMD
+// backend that was selected at compile time) against the scalar functions,
+// for counts that are and are not multiples of the batch sizes.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "base/math.h"
+
+namespace {
+
+const size_t kCounts[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 1001};
+
+// Written after the last result element, to catch writes past the end.
+const uint8_t kGuard = 0xa5;
+
+int g_failures = 0;
+
+void Fail(const char* kernel, size_t count, size_t index, const char* what) {
+  if (g_failures < 20) {
+    std::printf("FAIL: %s (count %d, element %d): %s\n", kernel,
+                static_cast<int>(count), static_cast<int>(index), what);
+  }
+  ++g_failures;
+}
+
+// The tolerance scales with the magnitude of the terms that make up a result
+// (not with the result itself), since a result near zero may be the sum of
+// large terms, whose rounding differs with the operation order or with fused
+// multiply-add.
+bool Near(float a, float b, float scale) {
+  return std::fabs(a - b) <= 1e-5f * std::max(1.0f, scale);
+}
+
+bool Near(const base::Vec3& a, const base::Vec3& b, float scale) {
+  return Near(a.x, b.x, scale) && Near(a.y, b.y, scale) &&
+         Near(a.z, b.z, scale);
+}
+
+// @returns an upper bound of the terms of transforming a point with m.
+float GetTransformScale(const base::Mat4& m, const base::Vec3& p) {
+  float max_element = 0.0f;
+  for (float element : m.m) {
+    max_element = std::max(max_element, std::fabs(element));
+  }
+  return max_element *
+         (std::fabs(p.x) + std::fabs(p.y) + std::fabs(p.z) + 1.0f);
+}
+
+float GetTransformScale(const base::Mat4& m, const base::Aabb& box) {
+  return std::max(GetTransformScale(m, box.min), GetTransformScale(m, box.max));
+}
+
+base::Mat4 GetTransform() {
+  return base::Mat4::Trs(
+      base::Vec3{1.0f, -2.0f, 3.0f},
+      base::Quat::FromAxisAngle(base::Normalize(base::Vec3{0.3f, 0.9f, -0.2f}),
+                                0.7f),
+      base::Vec3{2.0f, 0.5f, 1.5f});
+}
+
+void TestTransformPoints(std::mt19937* generator) {
+  std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+  const auto m = GetTransform();
+  for (size_t count : kCounts) {
+    std::vector<base::Vec3> points(count);
+    for (auto& p : points) {
+      p = base::Vec3{position(*generator), position(*generator),
+                     position(*generator)};
+    }
+
+    // Out of place, with a guard after the last element.
+    std::vector<base::Vec3> result(count + 1);
+    const base::Vec3 guard{1234.0f, 5678.0f, 9012.0f};
+    result[count] = guard;
+    base::TransformPoints(m, points.data(), count, result.data());
+    for (size_t i = 0; i < count; ++i) {
+      if (!Near(result[i], m.TransformPoint(points[i]),
+                GetTransformScale(m, points[i]))) {
+        Fail("TransformPoints", count, i, "wrong point");
+      }
+    }
+    if (result[count].x != guard.x || result[count].y != guard.y ||
+        result[count].z != guard.z) {
+      Fail("TransformPoints", count, count, "wrote past the end");
+    }
+
+    // In place.
+    result.assign(points.begin(), points.end());
+    base::TransformPoints(m, result.data(), count, result.data());
+    for (size_t i = 0; i < count; ++i) {
+      if (!Near(result[i], m.TransformPoint(points[i]),
+                GetTransformScale(m, points[i]))) {
+        Fail("TransformPoints (in place)", count, i, "wrong point");
+      }
+    }
+  }
+}
+
+void TestTransformAabbs(std::mt19937* generator) {
+  std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+  std::uniform_real_distribution<float> size(0.0f, 10.0f);
+  const auto m = GetTransform();
+  for (size_t count : kCounts) {
+    std::vector<base::Aabb> boxes(count);
+    for (auto& box : boxes) {
+      box.min = base::Vec3{position(*generator), position(*generator),
+                           position(*generator)};
+      box.max = box.min + base::Vec3{size(*generator), size(*generator),
+                                     size(*generator)};
+    }
+
+    std::vector<base::Aabb> result(count + 1);
+    const base::Aabb guard = base::Aabb::Empty();
+    result[count] = guard;
+    base::TransformAabbs(m, boxes.data(), count, result.data());
+    for (size_t i = 0; i < count; ++i) {
+      const auto expected = boxes[i].Transformed(m);
+      const float scale = GetTransformScale(m, boxes[i]);
+      if (!Near(result[i].min, expected.min, scale) ||
+          !Near(result[i].max, expected.max, scale)) {
+        Fail("TransformAabbs", count, i, "wrong box");
+      }
+    }
+    if (result[count].min.x != guard.min.x ||
+        result[count].max.x != guard.max.x) {
+      Fail("TransformAabbs", count, count, "wrote past the end");
+    }
+
+    result.assign(boxes.begin(), boxes.end());
+    base::TransformAabbs(m, result.data(), count, result.data());
+    for (size_t i = 0; i < count; ++i) {
+      const auto expected = boxes[i].Transformed(m);
+      const float scale = GetTransformScale(m, boxes[i]);
+      if (!Near(result[i].min, expected.min, scale) ||
+          !Near(result[i].max, expected.max, scale)) {
+        Fail("TransformAabbs (in place)", count, i, "wrong box");
+      }
+    }
+  }
+}
+
+// @returns the arrays padded to a multiple of the batch size (the padding is
+// NaN, which must not affect the results).
+size_t GetPaddedCount(size_t count) {
+  return (count + base::kAabbBatchSize - 1) / base::kAabbBatchSize *
+         base::kAabbBatchSize;
+}
+
+void TestClassifyAabbs(std::mt19937* generator) {
+  std::uniform_real_distribution<float> position(-150.0f, 150.0f);
+  std::uniform_real_distribution<float> size(0.1f, 20.0f);
+  const auto view_proj =
+      base::Mat4::Perspective(1.0f, 1.5f, 0.1f, 1000.0f) *
+      base::Mat4::LookAt(base::Vec3{0.0f, 0.0f, 150.0f},
+                         base::Vec3{0.0f, 0.0f, 0.0f},
+                         base::Vec3{0.0f, 1.0f, 0.0f});
+  const auto frustum = base::Frustum::FromMatrix(view_proj);
+  for (size_t count : kCounts) {
+    const size_t padded = GetPaddedCount(count);
+    std::vector<float> center[3];
+    std::vector<float> extent[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      center[axis].assign(padded, NAN);
+      extent[axis].assign(padded, NAN);
+    }
+    std::vector<base::Aabb> boxes(count);
+    for (size_t i = 0; i < count; ++i) {
+      const float c[3] = {position(*generator), position(*generator),
+                          position(*generator)};
+      const float e[3] = {size(*generator), size(*generator),
+                          size(*generator)};
+      for (int axis = 0; axis < 3; ++axis) {
+        center[axis][i] = c[axis];
+        extent[axis][i] = e[axis];
+      }
+      boxes[i].min = base::Vec3{c[0] - e[0], c[1] - e[1], c[2] - e[2]};
+      boxes[i].max = base::Vec3{c[0] + e[0], c[1] + e[1], c[2] + e[2]};
+    }
+
+    const float* centers[3] = {center[0].data(), center[1].data(),
+                               center[2].data()};
+    const float* extents[3] = {extent[0].data(), extent[1].data(),
+                               extent[2].data()};
+    std::vector<base::Visibility> result(count + 1);
+    const auto guard = static_cast<base::Visibility>(kGuard);
+    result[count] = guard;
+    base::ClassifyAabbs(frustum, centers, extents, count, result.data());
+    for (size_t i = 0; i < count; ++i) {
+      if (result[i] != frustum.Classify(boxes[i])) {
+        Fail("ClassifyAabbs", count, i, "wrong visibility");
+      }
+    }
+    if (result[count] != guard) {
+      Fail("ClassifyAabbs", count, count, "wrote past the end");
+    }
+  }
+}
+
+void TestFindBackfacingCones(std::mt19937* generator) {
+  std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+  std::uniform_real_distribution<float> radius(0.1f, 5.0f);
+  std::uniform_real_distribution<float> cutoff(-0.5f, 1.0f);
+  const base::Vec3 eye{10.0f, 20.0f, 80.0f};
+  for (size_t count : kCounts) {
+    const size_t padded = GetPaddedCount(count);
+    std::vector<float> center[3];
+    std::vector<float> axis[3];
+    std::vector<float> radii(padded, NAN);
+    std::vector<float> cutoffs(padded, NAN);
+    for (int a = 0; a < 3; ++a) {
+      center[a].assign(padded, NAN);
+      axis[a].assign(padded, NAN);
+    }
+    std::vector<uint8_t> expected(count);
+    for (size_t i = 0; i < count; ++i) {
+      const base::Vec3 c{position(*generator), position(*generator),
+                         position(*generator)};
+      const base::Vec3 n =
+          base::Normalize(base::Vec3{position(*generator),
+                                     position(*generator),
+                                     position(*generator)});
+      center[0][i] = c.x;
+      center[1][i] = c.y;
+      center[2][i] = c.z;
+      axis[0][i] = n.x;
+      axis[1][i] = n.y;
+      axis[2][i] = n.z;
+      radii[i] = radius(*generator);
+      cutoffs[i] = cutoff(*generator);
+      const base::Vec3 v = c - eye;
+      expected[i] =
+          base::Dot(v, n) >= cutoffs[i] * base::Length(v) + radii[i] ? 1 : 0;
+    }
+
+    const float* centers[3] = {center[0].data(), center[1].data(),
+                               center[2].data()};
+    const float* axes[3] = {axis[0].data(), axis[1].data(), axis[2].data()};
+    std::vector<uint8_t> result(count + 1);
+    result[count] = kGuard;
+    base::FindBackfacingCones(eye, centers, radii.data(), axes,
+                              cutoffs.data(), count, result.data());
+    for (size_t i = 0; i < count; ++i) {
+      if (result[i] != expected[i]) {
+        Fail("FindBackfacingCones", count, i, "wrong result");
+      }
+    }
+    if (result[count] != kGuard) {
+      Fail("FindBackfacingCones", count, count, "wrote past the end");
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::printf("SIMD backend: %s\n", base::GetSimdBackend());
+  std::mt19937 generator(1234);
+  TestTransformPoints(&generator);
+  TestTransformAabbs(&generator);
+  TestClassifyAabbs(&generator);
+  TestFindBackfacingCones(&generator);
+  if (g_failures > 0) {
+    std::printf("%d failures.\n", g_failures);
+    return 1;
+  }
+  std::printf("All tests passed.\n");
+  return 0;
+}
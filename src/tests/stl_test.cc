@@ -0,0 +1,180 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+// This test imports small ASCII STL files (single and multiple solids), and
+// checks the triangles that were imported.
+
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <string>
+
+#include "model/stl_importer.h"
+
+namespace {
+
+const char kTestPath[] = "stl_test.stl";
+
+const char kFacet[] =
+    "  facet normal 0 0 1\n"
+    "    outer loop\n"
+    "      vertex 0 0 0\n"
+    "      vertex 1 0 0\n"
+    "      vertex 0 1 0\n"
+    "    endloop\n"
+    "  endfacet\n";
+
+const char kShiftedFacet[] =
+    "  facet normal 0 0 0\n"
+    "    outer loop\n"
+    "      vertex 5 0 0\n"
+    "      vertex 6 0 0\n"
+    "      vertex 5 1 0\n"
+    "    endloop\n"
+    "  endfacet\n";
+
+int g_failures = 0;
+
+void Fail(const char* test, const char* what) {
+  std::printf("FAIL: %s: %s\n", test, what);
+  ++g_failures;
+}
+
+bool WriteFile(const std::string& text) {
+  FILE* file = std::fopen(kTestPath, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  const bool ok =
+      std::fwrite(text.data(), 1, text.size(), file) == text.size();
+  return std::fclose(file) == 0 && ok;
+}
+
+// Import the text as an STL file. Returns false if the import failed.
+bool Import(const char* test, const std::string& text, gfx::Mesh* mesh) {
+  if (!WriteFile(text)) {
+    Fail(test, "unable to write the test file");
+    return false;
+  }
+  try {
+    *mesh = model::ImportStl(kTestPath);
+  } catch (std::exception&) {
+    std::remove(kTestPath);
+    return false;
+  }
+  std::remove(kTestPath);
+  return true;
+}
+
+// Check the triangle count, and that the indices and normals are filled in.
+void CheckMesh(const char* test, const gfx::Mesh& mesh, size_t triangles) {
+  if (mesh.vertices.size() != triangles * 3 ||
+      mesh.indices.size() != triangles * 3) {
+    Fail(test, "wrong triangle count");
+    return;
+  }
+  for (size_t i = 0; i < mesh.indices.size(); ++i) {
+    if (mesh.indices[i] != i) {
+      Fail(test, "wrong index");
+      return;
+    }
+    if (std::fabs(mesh.vertices[i].normal[2] - 1.0f) > 1e-6f) {
+      Fail(test, "wrong normal");
+      return;
+    }
+  }
+}
+
+void TestSingleSolid() {
+  gfx::Mesh mesh;
+  const std::string text = std::string("solid one\n") + kFacet + kFacet +
+                           "endsolid one\n";
+  if (!Import("SingleSolid", text, &mesh)) {
+    Fail("SingleSolid", "the import failed");
+    return;
+  }
+  CheckMesh("SingleSolid", mesh, 2);
+}
+
+void TestTwoSolids() {
+  gfx::Mesh mesh;
+  const std::string text = std::string("solid one\n") + kFacet +
+                           "endsolid one\n"
+                           "solid two\n" +
+                           kShiftedFacet + kFacet + "endsolid two\n";
+  if (!Import("TwoSolids", text, &mesh)) {
+    Fail("TwoSolids", "the import failed");
+    return;
+  }
+  CheckMesh("TwoSolids", mesh, 3);
+  if (mesh.vertices.size() == 9 && mesh.vertices[3].position[0] != 5.0f) {
+    Fail("TwoSolids", "wrong position in the second solid");
+  }
+}
+
+void TestTrailingText() {
+  // Anything after the last "endsolid" is ignored.
+  gfx::Mesh mesh;
+  const std::string text = std::string("solid one\n") + kFacet +
+                           "endsolid one\n"
+                           "exported by some tool\n";
+  if (!Import("TrailingText", text, &mesh)) {
+    Fail("TrailingText", "the import failed");
+    return;
+  }
+  CheckMesh("TrailingText", mesh, 1);
+}
+
+void TestMalformed() {
+  gfx::Mesh mesh;
+  const std::string text = std::string("solid one\n") + kFacet +
+                           "endsolid one\n"
+                           "solid two\n"
+                           "  facet normal 0 0 1\n"
+                           "    outer loop\n"
+                           "      vertex 0 0 0\n"
+                           "endsolid two\n";
+  if (Import("Malformed", text, &mesh)) {
+    Fail("Malformed", "a truncated facet was accepted");
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestSingleSolid();
+  TestTwoSolids();
+  TestTrailingText();
+  TestMalformed();
+  if (g_failures > 0) {
+    std::printf("%d failures.\n", g_failures);
+    return 1;
+  }
+  std::printf("All tests passed.\n");
+  return 0;
+}
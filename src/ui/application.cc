@@ -44,8 +44,22 @@ Application::~Application() {
   glfwTerminate();
 }
 
+void Application::WakeUp() {
+  glfwPostEmptyEvent();
+}
+
 void Application::PollEvents() {
   glfwPollEvents();
 }
 
+void Application::WaitEvents(double timeout) {
+  if (timeout < 0.0) {
+    glfwWaitEvents();
+  } else if (timeout > 0.0) {
+    glfwWaitEventsTimeout(timeout);
+  } else {
+    glfwPollEvents();
+  }
+}
+
 }  // namespace ui
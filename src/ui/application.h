@@ -46,10 +46,19 @@ class Application {
   /// @brief Destructor.
   ~Application();
 
+  /// @brief Wake up a thread that is blocked in WaitEvents().
+  /// @note This may be called from any thread.
+  static void WakeUp();
+
  protected:
   /// @brief Poll for new UI events.
   void PollEvents();
 
+  /// @brief Wait for new UI events, and process them.
+  /// @param timeout The maximum time to wait in seconds, or a negative value
+  /// to wait until an event arrives (or WakeUp() is called).
+  void WaitEvents(double timeout);
+
  private:
   // Disable copy/move.
   Application(const Application&) = delete;
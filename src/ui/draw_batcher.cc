@@ -0,0 +1,121 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "ui/draw_batcher.h"
+
+#include <cstring>
+#include <limits>
+
+namespace ui {
+
+namespace {
+
+// The number of vertices that a base vertex can be followed by.
+const size_t kMaxSegmentVertices =
+    static_cast<size_t>(std::numeric_limits<ImDrawIdx>::max()) + 1;
+
+bool IsSameRect(const ImVec4& a, const ImVec4& b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+}
+
+}  // namespace
+
+void DrawBatcher::Build(const ImDrawData& draw_data,
+                        ImDrawVert* vertices,
+                        ImDrawIdx* indices) {
+  draws_.clear();
+  command_count_ = 0;
+
+  size_t base_vertex = 0;
+  size_t vertex_offset = 0;
+  size_t index_offset = 0;
+  bool can_merge = false;
+  for (int n = 0; n < draw_data.CmdListsCount; ++n) {
+    const ImDrawList* cmd_list = draw_data.CmdLists[n];
+    const auto vtx_count = static_cast<size_t>(cmd_list->VtxBuffer.size());
+    const auto idx_count = static_cast<size_t>(cmd_list->IdxBuffer.size());
+
+    // Start a new segment (with a new base vertex) when the vertices of the
+    // list can not be addressed from the current base vertex.
+    if (!merge_ || vertex_offset + vtx_count - base_vertex >
+                       kMaxSegmentVertices) {
+      base_vertex = vertex_offset;
+      can_merge = false;
+    }
+
+    // Copy the geometry, and rebase the indices onto the segment.
+    if (vtx_count > 0) {
+      std::memcpy(&vertices[vertex_offset], &cmd_list->VtxBuffer.front(),
+                  vtx_count * sizeof(ImDrawVert));
+    }
+    const auto rebase = static_cast<ImDrawIdx>(vertex_offset - base_vertex);
+    const ImDrawIdx* src = cmd_list->IdxBuffer.begin();
+    ImDrawIdx* dst = &indices[index_offset];
+    if (rebase == 0) {
+      if (idx_count > 0) {
+        std::memcpy(dst, src, idx_count * sizeof(ImDrawIdx));
+      }
+    } else {
+      for (size_t i = 0; i < idx_count; ++i) {
+        dst[i] = static_cast<ImDrawIdx>(src[i] + rebase);
+      }
+    }
+
+    for (const ImDrawCmd* pcmd = cmd_list->CmdBuffer.begin();
+         pcmd != cmd_list->CmdBuffer.end(); ++pcmd) {
+      if (pcmd->UserCallback != nullptr) {
+        Draw draw = Draw();
+        draw.first_index = index_offset;
+        draw.base_vertex = base_vertex;
+        draw.callback = pcmd;
+        draw.callback_list = cmd_list;
+        draws_.push_back(draw);
+        can_merge = false;
+      } else if (pcmd->ElemCount > 0) {
+        ++command_count_;
+        if (can_merge && merge_ && draws_.back().texture == pcmd->TextureId &&
+            IsSameRect(draws_.back().clip_rect, pcmd->ClipRect)) {
+          draws_.back().index_count += pcmd->ElemCount;
+        } else {
+          Draw draw = Draw();
+          draw.texture = pcmd->TextureId;
+          draw.clip_rect = pcmd->ClipRect;
+          draw.first_index = index_offset;
+          draw.index_count = pcmd->ElemCount;
+          draw.base_vertex = base_vertex;
+          draws_.push_back(draw);
+          can_merge = true;
+        }
+      }
+      index_offset += pcmd->ElemCount;
+    }
+    vertex_offset += vtx_count;
+  }
+}
+
+}  // namespace ui
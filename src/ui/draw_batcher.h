@@ -0,0 +1,93 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef UI_DRAW_BATCHER_H_
+#define UI_DRAW_BATCHER_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "imgui/imgui.h"
+
+namespace ui {
+
+/// @brief Merges the commands of an ImGui frame into as few draws as possible.
+///
+/// The geometry of all the draw lists is concatenated into one vertex range
+/// and one index range. The indices of each list are rebased onto a base
+/// vertex that is shared by consecutive lists (as long as their vertices can
+/// be addressed by ImDrawIdx), so that consecutive commands with the same
+/// texture and clip rectangle can be merged into one draw, even when they
+/// belong to different lists.
+class DrawBatcher {
+ public:
+  /// @brief A draw of a range of the indices of the frame.
+  struct Draw {
+    ImTextureID texture;
+    ImVec4 clip_rect;
+
+    // The first index and the base vertex, relative to the first index and
+    // vertex of the frame.
+    size_t first_index;
+    size_t index_count;
+    size_t base_vertex;
+
+    // A user callback (and the list that it belongs to) to call instead of
+    // drawing, or nullptr.
+    const ImDrawCmd* callback;
+    const ImDrawList* callback_list;
+  };
+
+  /// @brief Merge the commands of a frame, and copy its geometry.
+  /// @param draw_data The frame.
+  /// @param[out] vertices Room for draw_data.TotalVtxCount vertices.
+  /// @param[out] indices Room for draw_data.TotalIdxCount indices.
+  void Build(const ImDrawData& draw_data,
+             ImDrawVert* vertices,
+             ImDrawIdx* indices);
+
+  /// @returns the draws of the last frame.
+  const std::vector<Draw>& draws() const { return draws_; }
+
+  /// @returns the number of non-empty commands of the last frame (i.e. the
+  /// number of draws without merging).
+  size_t command_count() const { return command_count_; }
+
+  /// @brief Enable or disable the merging (it is enabled by default). Without
+  /// merging, there is one draw per non-empty command.
+  void set_merge(bool merge) { merge_ = merge; }
+
+ private:
+  std::vector<Draw> draws_;
+  size_t command_count_ = 0;
+  bool merge_ = true;
+};
+
+}  // namespace ui
+
+#endif  // UI_DRAW_BATCHER_H_
@@ -0,0 +1,211 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "ui/headless_context.h"
+
+#include <mutex>
+#include <string>
+
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif  // HAVE_EGL
+
+#include "GL/gl3w.h"
+
+#include "base/error.h"
+
+namespace ui {
+
+#ifdef HAVE_EGL
+
+namespace {
+
+// gl3w stores the function pointers globally, so contexts that are created in
+// parallel must not initialize it at the same time.
+std::mutex g_gl3w_mutex;
+
+bool HasExtension(const char* extensions, const std::string& name) {
+  if (extensions == nullptr) {
+    return false;
+  }
+  const std::string list = std::string(" ") + extensions + " ";
+  return list.find(" " + name + " ") != std::string::npos;
+}
+
+EGLDisplay OpenDisplay() {
+  // Prefer the surfaceless platform, which needs no window system at all.
+  const char* client_extensions =
+      eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  EGLDisplay display = EGL_NO_DISPLAY;
+  if (HasExtension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+    auto get_platform_display =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (get_platform_display != nullptr) {
+      display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                     EGL_DEFAULT_DISPLAY, nullptr);
+    }
+  }
+  if (display == EGL_NO_DISPLAY) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  if (display == EGL_NO_DISPLAY ||
+      eglInitialize(display, nullptr, nullptr) != EGL_TRUE) {
+    throw base::Error("Unable to initialize the EGL display.");
+  }
+  return display;
+}
+
+// Get the process wide display. It is initialized once, and never terminated
+// (terminating it would invalidate the contexts of other threads).
+EGLDisplay GetDisplay() {
+  static const EGLDisplay display = OpenDisplay();
+  return display;
+}
+
+}  // namespace
+
+HeadlessContext::HeadlessContext(const HeadlessContext* share_context) {
+  EGLDisplay display = GetDisplay();
+  display_ = display;
+  if (eglBindAPI(EGL_OPENGL_API) != EGL_TRUE) {
+    throw base::Error("EGL does not support desktop OpenGL.");
+  }
+
+  // Without EGL_KHR_surfaceless_context, a dummy pbuffer surface is needed to
+  // make the context current.
+  const bool surfaceless = HasExtension(
+      eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+  const EGLint config_attributes[] = {
+      EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+      EGL_RED_SIZE, 8,
+      EGL_GREEN_SIZE, 8,
+      EGL_BLUE_SIZE, 8,
+      EGL_ALPHA_SIZE, 8,
+      EGL_NONE};
+  EGLConfig config;
+  EGLint config_count = 0;
+  if (eglChooseConfig(display, config_attributes, &config, 1,
+                      &config_count) != EGL_TRUE ||
+      config_count < 1) {
+    throw base::Error("No suitable EGL configuration found.");
+  }
+
+  const EGLint context_attributes[] = {
+      EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+      EGL_CONTEXT_MINOR_VERSION_KHR, 2,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,
+      EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+      EGL_CONTEXT_FLAGS_KHR, EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE_BIT_KHR,
+      EGL_NONE};
+  context_ = eglCreateContext(
+      display, config,
+      share_context != nullptr ? share_context->context_ : EGL_NO_CONTEXT,
+      context_attributes);
+  if (context_ == EGL_NO_CONTEXT) {
+    throw base::Error("Unable to create the headless OpenGL context.");
+  }
+
+  try {
+    if (!surfaceless) {
+      const EGLint surface_attributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1,
+                                           EGL_NONE};
+      surface_ = eglCreatePbufferSurface(display, config, surface_attributes);
+      if (surface_ == EGL_NO_SURFACE) {
+        throw base::Error("Unable to create the headless OpenGL surface.");
+      }
+    }
+
+    // Initialize the OpenGL context. gl3w loads the functions through libGL,
+    // which (with libglvnd) dispatches them to the current EGL context.
+    MakeCurrent();
+    std::lock_guard<std::mutex> lock(g_gl3w_mutex);
+    if (gl3wInit() != 0 || gl3wIsSupported(3, 2) == 0) {
+      throw base::Error("Unable to create an OpenGL 3.2 context.");
+    }
+  } catch (...) {
+    Release();
+    Destroy();
+    throw;
+  }
+}
+
+HeadlessContext::~HeadlessContext() {
+  Destroy();
+}
+
+bool HeadlessContext::IsSupported() {
+  return true;
+}
+
+void HeadlessContext::MakeCurrent() {
+  // The rendering API is a per thread setting.
+  eglBindAPI(EGL_OPENGL_API);
+  if (eglMakeCurrent(display_, surface_, surface_, context_) != EGL_TRUE) {
+    throw base::Error("Unable to make the headless OpenGL context current.");
+  }
+}
+
+void HeadlessContext::Release() {
+  eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+void HeadlessContext::Destroy() {
+  if (surface_ != nullptr) {
+    eglDestroySurface(display_, surface_);
+    surface_ = nullptr;
+  }
+  if (context_ != nullptr) {
+    eglDestroyContext(display_, context_);
+    context_ = nullptr;
+  }
+}
+
+#else
+
+HeadlessContext::HeadlessContext(const HeadlessContext*) {
+  throw base::Error("Headless OpenGL contexts require EGL.");
+}
+
+HeadlessContext::~HeadlessContext() {}
+
+bool HeadlessContext::IsSupported() {
+  return false;
+}
+
+void HeadlessContext::MakeCurrent() {}
+
+void HeadlessContext::Release() {}
+
+void HeadlessContext::Destroy() {}
+
+#endif  // HAVE_EGL
+
+}  // namespace ui
@@ -0,0 +1,84 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef UI_HEADLESS_CONTEXT_H_
+#define UI_HEADLESS_CONTEXT_H_
+
+namespace ui {
+
+/// @brief An OpenGL context that needs no window system.
+///
+/// The context is created with EGL, on the surfaceless platform
+/// (EGL_MESA_platform_surfaceless) when it is available, and on the default
+/// display otherwise. It has no default framebuffer, so render to a
+/// gfx::Framebuffer. This works on build servers without a display or a GPU,
+/// e.g. with Mesa llvmpipe.
+///
+/// Unlike OffscreenContext, GLFW need not be initialized. Each context can be
+/// used by one thread at a time, so several contexts can render in parallel.
+///
+/// @note Headless contexts are only available in builds with EGL support.
+class HeadlessContext {
+ public:
+  /// @brief Create a new OpenGL 3.2 core profile context.
+  ///
+  /// The context is current in the calling thread after construction.
+  /// @param share_context A context to share OpenGL objects with (may be
+  /// nullptr).
+  /// @throws base::Error if the context can not be created.
+  explicit HeadlessContext(const HeadlessContext* share_context = nullptr);
+
+  /// @brief Destroy the context.
+  /// @note The context must not be current in any other thread.
+  ~HeadlessContext();
+
+  /// @returns true if the build supports headless contexts.
+  static bool IsSupported();
+
+  /// @brief Make the OpenGL context current in the calling thread.
+  void MakeCurrent();
+
+  /// @brief Make no OpenGL context current in the calling thread.
+  void Release();
+
+ private:
+  void Destroy();
+
+  void* display_ = nullptr;
+  void* context_ = nullptr;
+  void* surface_ = nullptr;
+
+  // Disable copy/move.
+  HeadlessContext(const HeadlessContext&) = delete;
+  HeadlessContext(HeadlessContext&&) = delete;
+  HeadlessContext& operator=(const HeadlessContext&) = delete;
+};
+
+}  // namespace ui
+
+#endif  // UI_HEADLESS_CONTEXT_H_
@@ -28,6 +28,7 @@
 
 #include "ui/ui_window.h"
 
+#include <cstdint>
 #include <cstdlib>
 
 #include "GL/gl3w.h"
@@ -40,14 +41,71 @@
 #endif  // _WIN32
 
 #include "base/error.h"
+#include "base/hash.h"
 #include "base/make_unique.h"
+#include "base/math.h"
+#include "base/profiler.h"
 
 namespace ui {
 
 namespace {
 
+// The initial sizes of the UI geometry stream buffers (they grow as needed).
+const size_t kVertexStreamSize = 1 << 20;
+const size_t kIndexStreamSize = 1 << 18;
+
+// The repaint interval while text is being edited, in seconds.
+const double kCursorBlinkInterval = 0.2;
+
 UiWindow* g_painting_ui_window = nullptr;
 
+// Composites the UI cache texture (with premultiplied alpha), one texel per
+// pixel.
+const char* const kCompositeVertexShader =
+    "#version 150\n"
+    "void main() {\n"
+    "  vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "  gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+const char* const kCompositeFragmentShader =
+    "#version 150\n"
+    "uniform sampler2D Texture;\n"
+    "out vec4 Out_Color;\n"
+    "void main() {\n"
+    "  Out_Color = texelFetch(Texture, ivec2(gl_FragCoord.xy), 0);\n"
+    "}\n";
+
+// Hash the geometry and the commands of a frame.
+// @returns false if the frame can not be cached (it has user callbacks).
+bool HashDrawData(const ImDrawData& draw_data, uint64_t* hash) {
+  uint64_t h = 0;
+  for (int n = 0; n < draw_data.CmdListsCount; ++n) {
+    const ImDrawList* cmd_list = draw_data.CmdLists[n];
+    h = base::HashBytes(
+        cmd_list->VtxBuffer.begin(),
+        static_cast<size_t>(cmd_list->VtxBuffer.size()) * sizeof(ImDrawVert),
+        h);
+    h = base::HashBytes(
+        cmd_list->IdxBuffer.begin(),
+        static_cast<size_t>(cmd_list->IdxBuffer.size()) * sizeof(ImDrawIdx),
+        h);
+    for (const ImDrawCmd* pcmd = cmd_list->CmdBuffer.begin();
+         pcmd != cmd_list->CmdBuffer.end(); ++pcmd) {
+      if (pcmd->UserCallback != nullptr) {
+        return false;
+      }
+      h = base::HashCombine(h, pcmd->ElemCount);
+      h = base::HashCombine(h, reinterpret_cast<uintptr_t>(pcmd->TextureId));
+      h = base::HashBytes(&pcmd->ClipRect, sizeof(pcmd->ClipRect), h);
+    }
+  }
+  *hash = h;
+  return true;
+}
+
+// Get the window that receives an event, and request a repaint (see
+// Window::RequestRepaint()).
 UiWindow& GetUiWindow(GLFWwindow* glfw_window) {
   auto* window =
       reinterpret_cast<UiWindow*>(glfwGetWindowUserPointer(glfw_window));
@@ -55,6 +113,7 @@ UiWindow& GetUiWindow(GLFWwindow* glfw_window) {
     throw base::Error(
         "No matching Window found for the given GLFW window handle.");
   }
+  window->RequestRepaint();
   return *window;
 }
 
@@ -118,26 +177,30 @@ UiWindow::UiWindow(int width, int height, const char* title)
 #endif
 
   CreateDeviceObjects();
+  gpu_timer_ = base::make_unique<gfx::GpuTimer>();
 }
 
 UiWindow::~UiWindow() {
   ImGui::SetInternalState(imgui_context_);
 
   if (vao_handle_) {
-    glDeleteVertexArrays(1, &vao_handle_);
-  }
-  if (vbo_handle_) {
-    glDeleteBuffers(1, &vbo_handle_);
+    gl_state_.DeleteVertexArray(vao_handle_);
+    vao_handle_ = 0;
   }
-  if (elements_handle_) {
-    glDeleteBuffers(1, &elements_handle_);
+  if (composite_vao_) {
+    gl_state_.DeleteVertexArray(composite_vao_);
+    composite_vao_ = 0;
   }
-  vao_handle_ = vbo_handle_ = elements_handle_ = 0;
+  DeleteUiCache();
+  composite_shader_.Delete();
+  vertex_stream_.reset();
+  index_stream_.reset();
 
   shader_.Delete();
+  gpu_timer_.reset();
 
   if (font_texture_) {
-    glDeleteTextures(1, &font_texture_);
+    gl_state_.DeleteTexture(font_texture_);
     ImGui::GetIO().Fonts->TexID = nullptr;
     font_texture_ = 0;
   }
@@ -150,7 +213,11 @@ UiWindow::~UiWindow() {
 
 void UiWindow::PaintUi() {
   BeginUi();
-  DefineUi();
+  {
+    base::ProfileScope scope("DefineUi");
+    DefineUi();
+  }
+  base::ProfileScope scope("RenderUi");
   EndUi();
 }
 
@@ -217,6 +284,15 @@ void UiWindow::EndUi() {
   if (g_painting_ui_window == nullptr) {
     throw base::Error("No active UI window.");
   }
+
+  // Keep painting while the user interacts with an item (e.g. drags a
+  // slider), and blink the text cursor while text is being edited.
+  if (ImGui::GetIO().WantTextInput) {
+    RequestRepaint(kCursorBlinkInterval);
+  } else if (ImGui::IsAnyItemActive()) {
+    RequestRepaint();
+  }
+
   ImGui::Render();
   g_painting_ui_window = nullptr;
   ImGui::SetInternalState(nullptr);
@@ -230,12 +306,6 @@ void UiWindow::DefineUi() {
 }
 
 void UiWindow::CreateDeviceObjects() {
-  // Backup GL state.
-  GLint last_texture, last_array_buffer, last_vertex_array;
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
-  glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &last_array_buffer);
-  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &last_vertex_array);
-
   const GLchar* vertex_shader =
       "#version 150\n"
       "uniform mat4 ProjMtx;\n"
@@ -270,15 +340,40 @@ void UiWindow::CreateDeviceObjects() {
   attrib_uv_ = shader_.GetAttribLocation("UV");
   attrib_color_ = shader_.GetAttribLocation("Color");
 
-  glGenBuffers(1, &vbo_handle_);
-  glGenBuffers(1, &elements_handle_);
+  // The font texture is always bound to texture unit 0.
+  gl_state_.UseProgram(shader_.handle());
+  glUniform1i(uniform_tex_, 0);
+
+  // The composite pass generates its vertices, but a vertex array must still
+  // be bound.
+  composite_shader_.Compile(kCompositeVertexShader, kCompositeFragmentShader);
+  gl_state_.UseProgram(composite_shader_.handle());
+  glUniform1i(composite_shader_.GetUniformLocation("Texture"), 0);
+  glGenVertexArrays(1, &composite_vao_);
+
+  vertex_stream_ =
+      base::make_unique<gfx::StreamBuffer>(kVertexStreamSize, &gl_state_);
+  index_stream_ =
+      base::make_unique<gfx::StreamBuffer>(kIndexStreamSize, &gl_state_);
 
   glGenVertexArrays(1, &vao_handle_);
-  glBindVertexArray(vao_handle_);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo_handle_);
+  gl_state_.BindVertexArray(vao_handle_);
   glEnableVertexAttribArray(static_cast<GLuint>(attrib_position_));
   glEnableVertexAttribArray(static_cast<GLuint>(attrib_uv_));
   glEnableVertexAttribArray(static_cast<GLuint>(attrib_color_));
+  UpdateVertexArray();
+
+  CreateFontsTexture();
+}
+
+void UiWindow::UpdateVertexArray() {
+  // The element array buffer binding is part of the vertex array state, so it
+  // only needs to be bound when the buffer changes.
+  gl_state_.BindVertexArray(vao_handle_);
+  gl_state_.BindArrayBuffer(vertex_stream_->handle());
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_stream_->handle());
+  vao_vertex_generation_ = vertex_stream_->generation();
+  vao_index_generation_ = index_stream_->generation();
 
   glVertexAttribPointer(
       static_cast<GLuint>(attrib_position_), 2, GL_FLOAT, GL_FALSE,
@@ -292,13 +387,7 @@ void UiWindow::CreateDeviceObjects() {
       static_cast<GLuint>(attrib_color_), 4, GL_UNSIGNED_BYTE, GL_TRUE,
       sizeof(ImDrawVert),
       reinterpret_cast<GLvoid*>(&(reinterpret_cast<ImDrawVert*>(0))->col));
-
-  CreateFontsTexture();
-
-  // Restore modified GL state.
-  glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(last_texture));
-  glBindBuffer(GL_ARRAY_BUFFER, static_cast<GLuint>(last_array_buffer));
-  glBindVertexArray(static_cast<GLuint>(last_vertex_array));
+  gl_state_.CountCalls(4);
 }
 
 void UiWindow::CreateFontsTexture() {
@@ -309,10 +398,8 @@ void UiWindow::CreateFontsTexture() {
   io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
 
   // Upload texture to graphics system.
-  GLint last_texture;
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
   glGenTextures(1, &font_texture_);
-  glBindTexture(GL_TEXTURE_2D, font_texture_);
+  gl_state_.BindTexture2D(0, font_texture_);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
@@ -320,9 +407,6 @@ void UiWindow::CreateFontsTexture() {
 
   // Store our texture ID for later reference (passed to RenderDrawLists).
   io.Fonts->TexID = reinterpret_cast<void*>(font_texture_);
-
-  // Restore OpenGL state.
-  glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(last_texture));
 }
 
 void UiWindow::RenderDrawListsDispatch(ImDrawData* draw_data) {
@@ -332,42 +416,89 @@ void UiWindow::RenderDrawListsDispatch(ImDrawData* draw_data) {
   g_painting_ui_window->RenderDrawLists(draw_data);
 }
 
-void UiWindow::RenderDrawLists(ImDrawData* draw_data) {
-  // Backup GL state.
-  GLint last_program;
-  glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
-  GLint last_texture;
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
-  GLint last_array_buffer;
-  glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &last_array_buffer);
-  GLint last_element_array_buffer;
-  glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &last_element_array_buffer);
-  GLint last_vertex_array;
-  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &last_vertex_array);
-  GLint last_blend_src;
-  glGetIntegerv(GL_BLEND_SRC, &last_blend_src);
-  GLint last_blend_dst;
-  glGetIntegerv(GL_BLEND_DST, &last_blend_dst);
-  GLint last_blend_equation_rgb;
-  glGetIntegerv(GL_BLEND_EQUATION_RGB, &last_blend_equation_rgb);
-  GLint last_blend_equation_alpha;
-  glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &last_blend_equation_alpha);
-  GLint last_viewport[4];
-  glGetIntegerv(GL_VIEWPORT, last_viewport);
-  GLboolean last_enable_blend = glIsEnabled(GL_BLEND);
-  GLboolean last_enable_cull_face = glIsEnabled(GL_CULL_FACE);
-  GLboolean last_enable_depth_test = glIsEnabled(GL_DEPTH_TEST);
-  GLboolean last_enable_scissor_test = glIsEnabled(GL_SCISSOR_TEST);
-
+void UiWindow::SetupRenderState(int fb_width, int fb_height) {
   // Setup render state: alpha-blending enabled, no face culling, no depth
-  // testing, scissor enabled.
-  glEnable(GL_BLEND);
-  glBlendEquation(GL_FUNC_ADD);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glDisable(GL_CULL_FACE);
-  glDisable(GL_DEPTH_TEST);
-  glEnable(GL_SCISSOR_TEST);
-  glActiveTexture(GL_TEXTURE0);
+  // testing, scissor enabled. The state is set every frame (since other passes
+  // may have changed it), but only the changes reach OpenGL.
+  auto& state = gl_state_;
+  state.SetBlend(true);
+  state.SetBlendEquation(GL_FUNC_ADD);
+  state.SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  state.SetCullFace(false);
+  state.SetDepthTest(false);
+  state.SetScissorTest(true);
+
+  // Setup viewport, orthographic projection matrix.
+  const ImGuiIO& io = ImGui::GetIO();
+  state.SetViewport(0, 0, fb_width, fb_height);
+  const auto ortho_projection = base::Mat4::Orthographic(
+      0.0f, io.DisplaySize.x, io.DisplaySize.y, 0.0f, -1.0f, 1.0f);
+  state.UseProgram(shader_.handle());
+  glUniformMatrix4fv(uniform_proj_mtx_, 1, GL_FALSE, ortho_projection.m);
+  state.CountCalls(1);
+  state.BindVertexArray(vao_handle_);
+}
+
+void UiWindow::BeginUiCache(int fb_width, int fb_height) {
+  auto& state = gl_state_;
+  if (cache_texture_ == 0 || fb_width != cache_width_ ||
+      fb_height != cache_height_) {
+    DeleteUiCache();
+    glGenTextures(1, &cache_texture_);
+    state.BindTexture2D(0, cache_texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, fb_width, fb_height, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, nullptr);
+    glGenFramebuffers(1, &cache_framebuffer_);
+    state.BindFramebuffer(cache_framebuffer_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, cache_texture_, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      throw base::Error("Unable to create the UI cache framebuffer.");
+    }
+    cache_width_ = fb_width;
+    cache_height_ = fb_height;
+  }
+
+  state.BindFramebuffer(cache_framebuffer_);
+  state.SetScissorTest(false);
+  state.SetClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  state.Clear(GL_COLOR_BUFFER_BIT);
+}
+
+void UiWindow::CompositeUiCache(int fb_width, int fb_height) {
+  auto& state = gl_state_;
+  state.BindFramebuffer(0);
+  state.SetViewport(0, 0, fb_width, fb_height);
+  state.SetBlend(true);
+  state.SetBlendEquation(GL_FUNC_ADD);
+  state.SetBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  state.SetCullFace(false);
+  state.SetDepthTest(false);
+  state.SetScissorTest(false);
+  state.UseProgram(composite_shader_.handle());
+  state.BindTexture2D(0, cache_texture_);
+  state.BindVertexArray(composite_vao_);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  state.CountDraw();
+}
+
+void UiWindow::DeleteUiCache() {
+  if (cache_framebuffer_ != 0) {
+    gl_state_.DeleteFramebuffer(cache_framebuffer_);
+    cache_framebuffer_ = 0;
+  }
+  if (cache_texture_ != 0) {
+    gl_state_.DeleteTexture(cache_texture_);
+    cache_texture_ = 0;
+  }
+  cache_valid_ = false;
+}
+
+void UiWindow::RenderDrawLists(ImDrawData* draw_data) {
+  gfx::GpuTimer::Scope gpu_scope(gpu_timer_.get(), "UI");
+  auto& state = gl_state_;
 
   // Handle cases of screen coordinates != from framebuffer coordinates (e.g.
   // retina displays).
@@ -378,93 +509,90 @@ void UiWindow::RenderDrawLists(ImDrawData* draw_data) {
       static_cast<int>(io.DisplaySize.y * io.DisplayFramebufferScale.y);
   draw_data->ScaleClipRects(io.DisplayFramebufferScale);
 
-  // Setup viewport, orthographic projection matrix.
-  glViewport(0, 0, static_cast<GLsizei>(fb_width),
-             static_cast<GLsizei>(fb_height));
-  const float ortho_projection[4][4] = {
-      {2.0f / io.DisplaySize.x, 0.0f, 0.0f, 0.0f},
-      {0.0f, 2.0f / -io.DisplaySize.y, 0.0f, 0.0f},
-      {0.0f, 0.0f, -1.0f, 0.0f},
-      {-1.0f, 1.0f, 0.0f, 1.0f},
-  };
-  shader_.UseProgram();
-  glUniform1i(uniform_tex_, 0);
-  glUniformMatrix4fv(uniform_proj_mtx_, 1, GL_FALSE, &ortho_projection[0][0]);
-  glBindVertexArray(vao_handle_);
-
-  for (int n = 0; n < draw_data->CmdListsCount; n++) {
-    const ImDrawList* cmd_list = draw_data->CmdLists[n];
-    const ImDrawIdx* idx_buffer_offset = nullptr;
-
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_handle_);
-    glBufferData(GL_ARRAY_BUFFER,
-                 static_cast<GLsizeiptr>(cmd_list->VtxBuffer.size()) *
-                     static_cast<GLsizeiptr>(sizeof(ImDrawVert)),
-                 reinterpret_cast<const GLvoid*>(&cmd_list->VtxBuffer.front()),
-                 GL_STREAM_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elements_handle_);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 static_cast<GLsizeiptr>(cmd_list->IdxBuffer.size()) *
-                     static_cast<GLsizeiptr>(sizeof(ImDrawIdx)),
-                 reinterpret_cast<const GLvoid*>(&cmd_list->IdxBuffer.front()),
-                 GL_STREAM_DRAW);
-
-    for (const ImDrawCmd* pcmd = cmd_list->CmdBuffer.begin();
-         pcmd != cmd_list->CmdBuffer.end(); pcmd++) {
-      if (pcmd->UserCallback != nullptr) {
-        pcmd->UserCallback(cmd_list, pcmd);
-      } else {
-        glBindTexture(
-            GL_TEXTURE_2D,
-            static_cast<GLuint>(reinterpret_cast<intptr_t>(pcmd->TextureId)));
-        glScissor(static_cast<GLint>(pcmd->ClipRect.x),
-                  static_cast<GLint>(fb_height - pcmd->ClipRect.w),
-                  static_cast<GLint>(pcmd->ClipRect.z - pcmd->ClipRect.x),
-                  static_cast<GLint>(pcmd->ClipRect.w - pcmd->ClipRect.y));
-        glDrawElements(
-            GL_TRIANGLES, static_cast<GLsizei>(pcmd->ElemCount),
-            sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
-            idx_buffer_offset);
-      }
-      idx_buffer_offset += pcmd->ElemCount;
+  // With the cache, a frame that is the same as the cached one is composited
+  // from the cache, and other frames are drawn to the cache first.
+  ui_was_cached_ = false;
+  if (!cache_ui_ && cache_texture_ != 0) {
+    DeleteUiCache();
+  }
+  uint64_t hash = 0;
+  const bool use_cache = cache_ui_ && HashDrawData(*draw_data, &hash);
+  if (use_cache) {
+    hash = base::HashCombine(hash, static_cast<uint64_t>(fb_width));
+    hash = base::HashCombine(hash, static_cast<uint64_t>(fb_height));
+    if (cache_valid_ && hash == cache_hash_ && fb_width == cache_width_ &&
+        fb_height == cache_height_) {
+      CompositeUiCache(fb_width, fb_height);
+      ui_was_cached_ = true;
+      return;
     }
   }
 
-  // Restore modified GL state.
-  glUseProgram(static_cast<GLuint>(last_program));
-  glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(last_texture));
-  glBindBuffer(GL_ARRAY_BUFFER, static_cast<GLuint>(last_array_buffer));
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
-               static_cast<GLuint>(last_element_array_buffer));
-  glBindVertexArray(static_cast<GLuint>(last_vertex_array));
-  glBlendEquationSeparate(static_cast<GLuint>(last_blend_equation_rgb),
-                          static_cast<GLuint>(last_blend_equation_alpha));
-  glBlendFunc(static_cast<GLuint>(last_blend_src),
-              static_cast<GLuint>(last_blend_dst));
-  if (last_enable_blend == GL_TRUE) {
-    glEnable(GL_BLEND);
-  } else {
-    glDisable(GL_BLEND);
+  // Stream the geometry of all the draw lists to the ring buffers at once,
+  // and merge the commands into as few draws as possible.
+  if (draw_data->TotalVtxCount <= 0 || draw_data->TotalIdxCount <= 0) {
+    return;
   }
-  if (last_enable_cull_face == GL_TRUE) {
-    glEnable(GL_CULL_FACE);
-  } else {
-    glDisable(GL_CULL_FACE);
+  size_t vtx_offset, idx_offset;
+  auto* vtx_dst = static_cast<ImDrawVert*>(vertex_stream_->Map(
+      static_cast<size_t>(draw_data->TotalVtxCount) * sizeof(ImDrawVert),
+      sizeof(ImDrawVert), &vtx_offset));
+  auto* idx_dst = static_cast<ImDrawIdx*>(index_stream_->Map(
+      static_cast<size_t>(draw_data->TotalIdxCount) * sizeof(ImDrawIdx),
+      sizeof(ImDrawIdx), &idx_offset));
+  batcher_.Build(*draw_data, vtx_dst, idx_dst);
+  vertex_stream_->Unmap();
+  index_stream_->Unmap();
+  if (vertex_stream_->generation() != vao_vertex_generation_ ||
+      index_stream_->generation() != vao_index_generation_) {
+    UpdateVertexArray();
   }
-  if (last_enable_depth_test == GL_TRUE) {
-    glEnable(GL_DEPTH_TEST);
-  } else {
-    glDisable(GL_DEPTH_TEST);
+
+  if (use_cache) {
+    BeginUiCache(fb_width, fb_height);
   }
-  if (last_enable_scissor_test == GL_TRUE) {
-    glEnable(GL_SCISSOR_TEST);
-  } else {
-    glDisable(GL_SCISSOR_TEST);
+  SetupRenderState(fb_width, fb_height);
+  if (use_cache) {
+    // Accumulate the coverage in the alpha channel (premultiplied alpha).
+    state.SetBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
+                               GL_ONE_MINUS_SRC_ALPHA);
+  }
+
+  // The draws are relative to the start of the frame in the streams.
+  const auto first_vertex = vtx_offset / sizeof(ImDrawVert);
+  for (const auto& draw : batcher_.draws()) {
+    if (draw.callback != nullptr) {
+      // The callback may change any state behind the back of the cache.
+      draw.callback->UserCallback(draw.callback_list, draw.callback);
+      state.Invalidate();
+      SetupRenderState(fb_width, fb_height);
+      continue;
+    }
+    state.BindTexture2D(
+        0, static_cast<GLuint>(reinterpret_cast<intptr_t>(draw.texture)));
+    state.SetScissor(
+        static_cast<int>(draw.clip_rect.x),
+        static_cast<int>(fb_height - draw.clip_rect.w),
+        static_cast<int>(draw.clip_rect.z - draw.clip_rect.x),
+        static_cast<int>(draw.clip_rect.w - draw.clip_rect.y));
+    glDrawElementsBaseVertex(
+        GL_TRIANGLES, static_cast<GLsizei>(draw.index_count),
+        sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+        reinterpret_cast<const GLvoid*>(static_cast<uintptr_t>(
+            idx_offset + draw.first_index * sizeof(ImDrawIdx))),
+        static_cast<GLint>(first_vertex + draw.base_vertex));
+    state.CountDraw();
   }
-  glViewport(last_viewport[0], last_viewport[1],
-             static_cast<GLsizei>(last_viewport[2]),
-             static_cast<GLsizei>(last_viewport[3]));
+
+  if (use_cache) {
+    CompositeUiCache(fb_width, fb_height);
+    cache_hash_ = hash;
+    cache_valid_ = true;
+  }
+
+  // Keep the regions of this frame until the GPU has drawn them.
+  vertex_stream_->EndFrame();
+  index_stream_->EndFrame();
 }
 
 const char* UiWindow::GetClipboardText() {
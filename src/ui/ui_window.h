@@ -29,14 +29,15 @@
 #ifndef UI_UI_WINDOW_H_
 #define UI_UI_WINDOW_H_
 
+#include <cstdint>
 #include <memory>
 
+#include "gfx/gpu_timer.h"
 #include "gfx/shader.h"
+#include "gfx/stream_buffer.h"
+#include "ui/draw_batcher.h"
 #include "ui/window.h"
 
-struct ImDrawData;
-struct ImFontAtlas;
-
 namespace ui {
 
 /// @brief A GLFW window with support for ImGui UI rendering.
@@ -55,10 +56,28 @@ class UiWindow : public Window {
   /// @brief Paint the UI.
   void PaintUi();
 
+  /// @returns the GPU timer of the window context. The UI is timed as the
+  /// "UI" pass.
+  gfx::GpuTimer& gpu_timer() { return *gpu_timer_; }
+
+  /// @brief Cache the painted UI.
+  ///
+  /// The UI is drawn to a texture, which is composited over the window. When
+  /// the geometry of a frame (hashed) is the same as that of the cached
+  /// frame, the texture is composited without drawing the UI again.
+  /// @param cache True to enable the cache (it is disabled by default).
+  void set_cache_ui(bool cache) { cache_ui_ = cache; }
+
+  /// @returns true if the last painted UI was composited from the cache.
+  bool ui_was_cached() const { return ui_was_cached_; }
+
  private:
   void CreateDeviceObjects();
   void CreateFontsTexture();
 
+  // Point the vertex array object at the current stream buffers.
+  void UpdateVertexArray();
+
   void BeginUi();
   void EndUi();
 
@@ -66,6 +85,18 @@ class UiWindow : public Window {
   /// @note Override this method to render something meaningful.
   virtual void DefineUi();
 
+  // Set the state that the UI is drawn with.
+  void SetupRenderState(int fb_width, int fb_height);
+
+  // Bind and clear the UI cache framebuffer (creating it if necessary).
+  void BeginUiCache(int fb_width, int fb_height);
+
+  // Composite the UI cache over the window.
+  void CompositeUiCache(int fb_width, int fb_height);
+
+  // Delete the UI cache objects.
+  void DeleteUiCache();
+
   static void RenderDrawListsDispatch(ImDrawData* draw_data);
   void RenderDrawLists(ImDrawData* draw_data);
 
@@ -94,14 +125,37 @@ class UiWindow : public Window {
   float mouse_wheel_ = 0.0f;
   unsigned int font_texture_ = 0;
   gfx::Shader shader_;
+  std::unique_ptr<gfx::GpuTimer> gpu_timer_;
   int uniform_tex_ = 0;
   int uniform_proj_mtx_ = 0;
   int attrib_position_ = 0;
   int attrib_uv_ = 0;
   int attrib_color_ = 0;
-  unsigned int vbo_handle_ = 0;
   unsigned int vao_handle_ = 0;
-  unsigned int elements_handle_ = 0;
+
+  // The UI geometry of each frame is streamed to ring buffers. The vertex
+  // array refers to the buffer generations below, and is updated when the
+  // stream buffers grow.
+  std::unique_ptr<gfx::StreamBuffer> vertex_stream_;
+  std::unique_ptr<gfx::StreamBuffer> index_stream_;
+  unsigned int vao_vertex_generation_ = 0;
+  unsigned int vao_index_generation_ = 0;
+
+  // Merges the commands of each frame into draws.
+  DrawBatcher batcher_;
+
+  // The UI cache: a texture (with premultiplied alpha) and its framebuffer,
+  // the hash of the cached frame, and the program that composites it.
+  bool cache_ui_ = false;
+  bool ui_was_cached_ = false;
+  unsigned int cache_texture_ = 0;
+  unsigned int cache_framebuffer_ = 0;
+  int cache_width_ = 0;
+  int cache_height_ = 0;
+  uint64_t cache_hash_ = 0;
+  bool cache_valid_ = false;
+  gfx::Shader composite_shader_;
+  unsigned int composite_vao_ = 0;
 };
 
 }  // namespace ui
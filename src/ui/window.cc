@@ -28,6 +28,8 @@
 
 #include "ui/window.h"
 
+#include <algorithm>
+
 #include "GL/gl3w.h"
 #include "GLFW/glfw3.h"
 
@@ -37,13 +39,19 @@ namespace ui {
 
 namespace {
 
-Window& GetWindow(GLFWwindow* glfw_window) {
+// The number of frames to paint after an immediate repaint request.
+const int kRepaintFrames = 3;
+
+// Get the window that receives an event. Any event may change what the window
+// shows, so the window is repainted.
+Window& GetEventWindow(GLFWwindow* glfw_window) {
   auto* window =
       reinterpret_cast<Window*>(glfwGetWindowUserPointer(glfw_window));
   if (window == nullptr) {
     throw base::Error(
         "No matching Window found for the given GLFW window handle.");
   }
+  window->RequestRepaint();
   return *window;
 }
 
@@ -101,6 +109,9 @@ Window::Window(int width, int height, const char* title) {
 
   // Enable vertical sync.
   glfwSwapInterval(1);
+
+  // Paint the first frames.
+  RequestRepaint();
 }
 
 Window::~Window() {
@@ -120,11 +131,45 @@ void Window::BeginFrame() {
   // Update the framebuffer size.
   glfwGetFramebufferSize(glfw_window_, &framebuffer_width_,
                          &framebuffer_height_);
-  glViewport(0, 0, framebuffer_width_, framebuffer_height_);
+  gl_state_.BeginFrame();
+  gl_state_.SetViewport(0, 0, framebuffer_width_, framebuffer_height_);
 }
 
 void Window::SwapBuffers() {
   glfwSwapBuffers(glfw_window_);
+
+  // The frame fulfills the repaint requests that were due.
+  if (repaint_frames_ > 0) {
+    --repaint_frames_;
+  }
+  if (repaint_time_ >= 0.0 && repaint_time_ <= glfwGetTime()) {
+    repaint_time_ = -1.0;
+  }
+}
+
+void Window::RequestRepaint(double delay) {
+  if (delay <= 0.0) {
+    repaint_frames_ = kRepaintFrames;
+    return;
+  }
+  const double time = glfwGetTime() + delay;
+  if (repaint_time_ < 0.0 || time < repaint_time_) {
+    repaint_time_ = time;
+  }
+}
+
+bool Window::NeedsRepaint() const {
+  return GetRepaintTimeout() == 0.0;
+}
+
+double Window::GetRepaintTimeout() const {
+  if (repaint_frames_ > 0) {
+    return 0.0;
+  }
+  if (repaint_time_ < 0.0) {
+    return -1.0;
+  }
+  return std::max(repaint_time_ - glfwGetTime(), 0.0);
 }
 
 MouseButton Window::ToMouseButton(int glfw_mouse_button) {
@@ -418,58 +463,58 @@ Modifiers Window::ToModifiers(int glfw_modifiers) {
 // GLFW callback dispatch functions.
 
 void Window::WindowPosDispatch(GLFWwindow* glfw_window, int x, int y) {
-  GetWindow(glfw_window).OnWindowPos(x, y);
+  GetEventWindow(glfw_window).OnWindowPos(x, y);
 }
 
 void Window::WindowSizeDispatch(GLFWwindow* glfw_window,
                                 int width,
                                 int height) {
-  GetWindow(glfw_window).OnWindowSize(width, height);
+  GetEventWindow(glfw_window).OnWindowSize(width, height);
 }
 
 void Window::WindowCloseDispatch(GLFWwindow* glfw_window) {
-  GetWindow(glfw_window).OnWindowClose();
+  GetEventWindow(glfw_window).OnWindowClose();
 }
 
 void Window::WindowRefreshDispatch(GLFWwindow* glfw_window) {
-  GetWindow(glfw_window).OnWindowRefresh();
+  GetEventWindow(glfw_window).OnWindowRefresh();
 }
 
 void Window::WindowFocusDispatch(GLFWwindow* glfw_window, int focused) {
-  GetWindow(glfw_window).OnWindowFocus(focused == GL_TRUE);
+  GetEventWindow(glfw_window).OnWindowFocus(focused == GL_TRUE);
 }
 
 void Window::WindowIconifyDispatch(GLFWwindow* glfw_window, int iconified) {
-  GetWindow(glfw_window).OnWindowIconify(iconified == GL_TRUE);
+  GetEventWindow(glfw_window).OnWindowIconify(iconified == GL_TRUE);
 }
 
 void Window::FramebufferSizeDispatch(GLFWwindow* glfw_window,
                                      int width,
                                      int height) {
-  GetWindow(glfw_window).OnFramebufferSize(width, height);
+  GetEventWindow(glfw_window).OnFramebufferSize(width, height);
 }
 
 void Window::MouseButtonDispatch(GLFWwindow* glfw_window,
                                  int button,
                                  int action,
                                  int mods) {
-  GetWindow(glfw_window)
+  GetEventWindow(glfw_window)
       .OnMouseButton(ToMouseButton(button), action == GLFW_PRESS,
                      ToModifiers(mods));
 }
 
 void Window::CursorPosDispatch(GLFWwindow* glfw_window, double x, double y) {
-  GetWindow(glfw_window).OnCursorPos(x, y);
+  GetEventWindow(glfw_window).OnCursorPos(x, y);
 }
 
 void Window::CursorEnterDispatch(GLFWwindow* glfw_window, int entered) {
-  GetWindow(glfw_window).OnCursorEnter(entered == GL_TRUE);
+  GetEventWindow(glfw_window).OnCursorEnter(entered == GL_TRUE);
 }
 
 void Window::ScrollDispatch(GLFWwindow* glfw_window,
                             double x_offset,
                             double y_offset) {
-  GetWindow(glfw_window).OnScroll(x_offset, y_offset);
+  GetEventWindow(glfw_window).OnScroll(x_offset, y_offset);
 }
 
 void Window::KeyDispatch(GLFWwindow* glfw_window,
@@ -477,25 +522,25 @@ void Window::KeyDispatch(GLFWwindow* glfw_window,
                          int scan_code,
                          int action,
                          int mods) {
-  GetWindow(glfw_window)
+  GetEventWindow(glfw_window)
       .OnKey(ToKeyCode(key), scan_code, action == GLFW_PRESS,
              ToModifiers(mods));
 }
 
 void Window::CharDispatch(GLFWwindow* glfw_window, unsigned int code_point) {
-  GetWindow(glfw_window).OnChar(code_point);
+  GetEventWindow(glfw_window).OnChar(code_point);
 }
 
 void Window::CharModsDispatch(GLFWwindow* glfw_window,
                               unsigned int code_point,
                               int mods) {
-  GetWindow(glfw_window).OnCharMods(code_point, ToModifiers(mods));
+  GetEventWindow(glfw_window).OnCharMods(code_point, ToModifiers(mods));
 }
 
 void Window::DropDispatch(GLFWwindow* glfw_window,
                           int count,
                           const char** paths) {
-  GetWindow(glfw_window).OnDrop(count, paths);
+  GetEventWindow(glfw_window).OnDrop(count, paths);
 }
 
 //------------------------------------------------------------------------------
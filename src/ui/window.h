@@ -31,6 +31,8 @@
 
 #include <memory>
 
+#include "gfx/gl_state.h"
+
 struct GLFWwindow;
 
 namespace ui {
@@ -229,16 +231,35 @@ class Window {
   ///
   /// This method sets up the OpenGL rendering context for rendering to it. It
   /// also updates the framebuffer dimensions (framebuffer_width and
-  /// framebuffer_height).
+  /// framebuffer_height), and starts a new frame for the GL state counters.
   void BeginFrame();
 
   /// @brief End a frame, and swap front & back OpenGL buffers.
   void SwapBuffers();
 
+  /// @brief Request that the window is repainted.
+  ///
+  /// Immediate requests paint a few frames, since the UI may need a frame or
+  /// two to settle after a change. All input events request an immediate
+  /// repaint.
+  /// @param delay The time until the repaint, in seconds (zero for an
+  /// immediate repaint). Only the earliest delayed request is kept.
+  void RequestRepaint(double delay = 0.0);
+
+  /// @returns true if a repaint is due.
+  bool NeedsRepaint() const;
+
+  /// @returns the time until the next repaint is due in seconds, zero if it
+  /// is due now, or a negative value if no repaint has been requested.
+  double GetRepaintTimeout() const;
+
   int framebuffer_width() const { return framebuffer_width_; }
   int framebuffer_height() const { return framebuffer_height_; }
   GLFWwindow* glfw_window() const { return glfw_window_; }
 
+  /// @returns the GL state cache of the window context.
+  gfx::GlState& gl_state() { return gl_state_; }
+
  protected:
   // Convert a GLFW mouse button identifier to a MouseButton.
   static MouseButton ToMouseButton(int glfw_mouse_button);
@@ -269,8 +290,14 @@ class Window {
   GLFWwindow* glfw_window_ = nullptr;
   int framebuffer_width_ = 0;
   int framebuffer_height_ = 0;
+  gfx::GlState gl_state_;
 
  private:
+  // The number of frames left to paint for immediate repaint requests, and
+  // the time of the earliest delayed request (negative if there is none).
+  int repaint_frames_ = 0;
+  double repaint_time_ = -1.0;
+
   // Static bridge functions for GLFW callbacks. These distpatch the call to
   // the designated Window object.
   static void WindowPosDispatch(GLFWwindow* glfw_window, int x, int y);
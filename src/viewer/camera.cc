@@ -0,0 +1,83 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "viewer/camera.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace viewer {
+
+namespace {
+
+const float kFieldOfView = 0.8f;  // Vertical field of view, in radians.
+
+}  // namespace
+
+void Camera::Fit(const base::Aabb& bounds,
+                 float aspect,
+                 float zoom,
+                 float yaw) {
+  const base::Vec3 center = bounds.center();
+  const float radius = std::max(base::Length(bounds.extent()), 1e-6f);
+  const float distance = zoom * radius / std::sin(kFieldOfView * 0.5f);
+
+  // right = normalize(+Y x back), up = back x right.
+  const float cos_yaw = std::cos(yaw);
+  const float sin_yaw = std::sin(yaw);
+  back_ = base::Normalize(base::Vec3{0.4f * cos_yaw + 0.866f * sin_yaw, 0.3f,
+                                     0.866f * cos_yaw - 0.4f * sin_yaw});
+  eye_ = center + back_ * distance;
+  right_ = base::Normalize(base::Cross(base::Vec3{0.0f, 1.0f, 0.0f}, back_));
+  up_ = base::Cross(back_, right_);
+
+  aspect_ = aspect;
+  near_ = std::max(distance - radius, radius * 0.001f);
+  far_ = distance + radius;
+}
+
+base::Mat4 Camera::GetViewProjection() const {
+  return base::Mat4::Perspective(kFieldOfView, aspect_, near_, far_) *
+         base::Mat4::LookAt(eye_, eye_ - back_, up_);
+}
+
+float Camera::GetProjectionScale(int height) const {
+  return static_cast<float>(height) / (2.0f * std::tan(kFieldOfView * 0.5f));
+}
+
+void Camera::GetRay(float x,
+                    float y,
+                    base::Vec3* origin,
+                    base::Vec3* direction) const {
+  const float tan_half_fov = std::tan(kFieldOfView * 0.5f);
+  *origin = eye_;
+  *direction = base::Normalize(right_ * (x * tan_half_fov * aspect_) +
+                               up_ * (y * tan_half_fov) - back_);
+}
+
+}  // namespace viewer
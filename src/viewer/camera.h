@@ -0,0 +1,89 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef VIEWER_CAMERA_H_
+#define VIEWER_CAMERA_H_
+
+#include "base/math.h"
+
+namespace viewer {
+
+/// @brief A perspective camera.
+class Camera {
+ public:
+  /// @brief Place the camera so that a bounding box is entirely visible.
+  ///
+  /// The camera looks at the center of the box from a fixed direction, at a
+  /// distance where the bounding sphere of the box fits in the view.
+  /// @param bounds The box.
+  /// @param aspect The aspect ratio (width / height) of the view.
+  /// @param zoom A scale factor for the distance to the center of the box
+  /// (values below one move the camera closer).
+  /// @param yaw A rotation of the view direction around the vertical axis, in
+  /// radians (e.g. for turntable animations).
+  void Fit(const base::Aabb& bounds,
+           float aspect,
+           float zoom,
+           float yaw = 0.0f);
+
+  /// @returns the view projection matrix.
+  base::Mat4 GetViewProjection() const;
+
+  /// @brief Get the world space ray through a point in the view.
+  /// @param x The horizontal position, in normalized device coordinates.
+  /// @param y The vertical position, in normalized device coordinates.
+  /// @param[out] origin The ray origin.
+  /// @param[out] direction The normalized ray direction.
+  void GetRay(float x,
+              float y,
+              base::Vec3* origin,
+              base::Vec3* direction) const;
+
+  /// @returns the size in pixels of a unit length at unit distance from the
+  /// camera, in a view of the given height.
+  float GetProjectionScale(int height) const;
+
+  /// The camera position.
+  const base::Vec3& eye() const { return eye_; }
+
+  /// The normalized direction from the scene towards the camera.
+  const base::Vec3& back() const { return back_; }
+
+ private:
+  base::Vec3 eye_ = {0.0f, 0.0f, 1.0f};
+  base::Vec3 right_ = {1.0f, 0.0f, 0.0f};
+  base::Vec3 up_ = {0.0f, 1.0f, 0.0f};
+  base::Vec3 back_ = {0.0f, 0.0f, 1.0f};
+  float aspect_ = 1.0f;
+  float near_ = 0.1f;
+  float far_ = 100.0f;
+};
+
+}  // namespace viewer
+
+#endif  // VIEWER_CAMERA_H_
@@ -0,0 +1,261 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "viewer/frame_recorder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <utility>
+
+#include "base/error.h"
+#include "base/make_unique.h"
+#include "base/parallel.h"
+
+namespace viewer {
+
+namespace {
+
+// The number of frames that may be read back at the same time. The pixels are
+// mapped two frames after they were read, which is enough for the GPU to have
+// finished the frame.
+const int kReadbackSlots = 3;
+
+}  // namespace
+
+FrameRecorder::FrameRecorder() : readback_(kReadbackSlots) {
+  // Encode up to one frame per thread, plus the frames that wait to be picked
+  // up by a thread.
+  const int image_count = std::max(2, base::GetParallelism() + 1);
+  for (int i = 0; i < image_count; ++i) {
+    images_.push_back(base::make_unique<gfx::Image>());
+    free_images_.push_back(images_.back().get());
+  }
+}
+
+FrameRecorder::~FrameRecorder() {
+  base::TaskScheduler::GetDefault().Wait(&encode_tasks_);
+}
+
+void FrameRecorder::RequestScreenshot(const std::string& path) {
+  screenshot_path_ = path;
+}
+
+void FrameRecorder::CaptureScreenshot(gfx::GlState* state,
+                                      int width,
+                                      int height) {
+  if (!readback_.full()) {
+    Capture(state, width, height, screenshot_path_, Format::Png, false);
+  } else {
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_ = "Skipped the screenshot (the readback is busy).";
+  }
+  screenshot_path_.clear();
+}
+
+void FrameRecorder::StartRecording(const std::string& path_prefix,
+                                   Format format) {
+  recording_ = true;
+  recording_prefix_ = path_prefix;
+  recording_format_ = format;
+  recorded_frames_ = 0;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  recording_start_ = Clock::now();
+  last_write_ = recording_start_;
+  recording_written_ = 0;
+  recording_bytes_ = 0.0;
+  stats_.stalled = 0;
+  stats_.frames_per_second = 0.0;
+  stats_.megabytes_per_second = 0.0;
+}
+
+void FrameRecorder::StopRecording() {
+  recording_ = false;
+}
+
+bool FrameRecorder::CanCaptureFrame() {
+  if (!recording_ || readback_.full()) {
+    return false;
+  }
+
+  // Leave an image for every frame that is being read back, so that the
+  // readback never waits for the encoding.
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<int>(free_images_.size()) > readback_.pending();
+}
+
+void FrameRecorder::CaptureFrame(gfx::GlState* state, int width, int height) {
+  char suffix[32];
+  std::snprintf(suffix, sizeof(suffix), "-%05d.%s", recorded_frames_,
+                recording_format_ == Format::Png ? "png" : "rgba");
+  Capture(state, width, height, recording_prefix_ + suffix, recording_format_,
+          true);
+  ++recorded_frames_;
+}
+
+void FrameRecorder::CountStall() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.stalled;
+}
+
+void FrameRecorder::Update(gfx::GlState* state) {
+  while (CollectOne(state, false)) {
+  }
+}
+
+void FrameRecorder::Finish(gfx::GlState* state) {
+  auto& scheduler = base::TaskScheduler::GetDefault();
+  while (readback_.pending() > 0) {
+    if (!CollectOne(state, true)) {
+      // All the images are being encoded.
+      scheduler.Wait(&encode_tasks_);
+    }
+  }
+  scheduler.Wait(&encode_tasks_);
+}
+
+FrameRecorder::Stats FrameRecorder::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.in_flight = stats.captured - stats.written - stats.failed;
+  return stats;
+}
+
+std::string FrameRecorder::GetStatus() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_;
+}
+
+void FrameRecorder::Capture(gfx::GlState* state,
+                            int width,
+                            int height,
+                            const std::string& path,
+                            Format format,
+                            bool recorded) {
+  if (!readback_.Read(state, width, height, next_tag_)) {
+    return;
+  }
+  ++next_tag_;
+  PendingFrame frame;
+  frame.path = path;
+  frame.format = format;
+  frame.start = Clock::now();
+  frame.recorded = recorded;
+  reading_frames_.push_back(std::move(frame));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.captured;
+}
+
+bool FrameRecorder::CollectOne(gfx::GlState* state, bool wait) {
+  gfx::Image* image;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_images_.empty()) {
+      return false;
+    }
+    image = free_images_.back();
+    free_images_.pop_back();
+  }
+
+  uint64_t tag;
+  bool collected = false;
+  try {
+    collected = readback_.Collect(state, wait, image, &tag);
+  } catch (base::Error& e) {
+    // The frame is lost, but the recorder keeps going.
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.failed;
+    status_ = e.what();
+    collected = false;
+    reading_frames_.pop_front();
+  }
+  if (!collected) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_images_.push_back(image);
+    return false;
+  }
+
+  const PendingFrame frame = std::move(reading_frames_.front());
+  reading_frames_.pop_front();
+  base::TaskScheduler::GetDefault().Spawn(
+      &encode_tasks_, [this, image, frame]() { Encode(image, frame); });
+  return true;
+}
+
+void FrameRecorder::Encode(gfx::Image* image, const PendingFrame& frame) {
+  bool written = false;
+  std::string error;
+  try {
+    if (frame.format == Format::Png) {
+      image->WritePng(frame.path);
+    } else {
+      image->WriteRaw(frame.path);
+    }
+    written = true;
+  } catch (base::Error& e) {
+    error = e.what();
+  }
+  const auto now = Clock::now();
+  const double bytes = static_cast<double>(image->width()) *
+                       static_cast<double>(image->height()) * 4.0;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_images_.push_back(image);
+  if (!written) {
+    ++stats_.failed;
+    status_ = error;
+    std::cerr << "Error: " << error << std::endl;
+    return;
+  }
+
+  ++stats_.written;
+  const double latency_ms =
+      std::chrono::duration<double, std::milli>(now - frame.start).count();
+  total_latency_ms_ += latency_ms;
+  stats_.last_latency_ms = latency_ms;
+  stats_.average_latency_ms =
+      total_latency_ms_ / static_cast<double>(stats_.written);
+  stats_.max_latency_ms = std::max(stats_.max_latency_ms, latency_ms);
+  status_ = "Wrote " + frame.path;
+
+  if (frame.recorded) {
+    ++recording_written_;
+    recording_bytes_ += bytes;
+    last_write_ = now;
+    const double seconds =
+        std::chrono::duration<double>(last_write_ - recording_start_).count();
+    if (seconds > 0.0) {
+      stats_.frames_per_second = recording_written_ / seconds;
+      stats_.megabytes_per_second = recording_bytes_ / (seconds * 1e6);
+    }
+  }
+}
+
+}  // namespace viewer
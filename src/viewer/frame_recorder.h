@@ -0,0 +1,216 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef VIEWER_FRAME_RECORDER_H_
+#define VIEWER_FRAME_RECORDER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/task_scheduler.h"
+#include "gfx/gl_state.h"
+#include "gfx/image.h"
+#include "gfx/readback_ring.h"
+
+namespace viewer {
+
+/// @brief Captures screenshots and frame sequences without stalling rendering.
+///
+/// Frames are read back asynchronously (see gfx::ReadbackRing), and encoded
+/// and written to disk by tasks on the default task scheduler, so the render
+/// loop only pays for issuing the read and for copying the pixels out of the
+/// mapped buffer.
+///
+/// When the readback or the encoding falls behind, CanCaptureFrame() returns
+/// false, so a recording is delayed rather than dropping frames or buffering
+/// an unbounded number of images.
+class FrameRecorder {
+ public:
+  /// @brief The file format of recorded frames.
+  enum class Format { Png, Raw };
+
+  /// @brief Capture statistics.
+  struct Stats {
+    /// The number of frames that have been read back, written, and that
+    /// failed to be written.
+    int captured = 0;
+    int written = 0;
+    int failed = 0;
+
+    /// The number of frames that are being read back or encoded.
+    int in_flight = 0;
+
+    /// The number of painted frames that a recording could not capture,
+    /// because the readback or the encoding was busy.
+    int stalled = 0;
+
+    /// The time from reading a frame until its file was written, in
+    /// milliseconds.
+    double last_latency_ms = 0.0;
+    double average_latency_ms = 0.0;
+    double max_latency_ms = 0.0;
+
+    /// The throughput of the current (or most recent) recording.
+    double frames_per_second = 0.0;
+    double megabytes_per_second = 0.0;
+  };
+
+  FrameRecorder();
+
+  /// @brief Wait for the frames that are being encoded.
+  /// @note Call Finish() first, to write the frames that are being read back.
+  ~FrameRecorder();
+
+  /// @brief Request a screenshot of the next painted frame.
+  /// @param path The PNG file to write.
+  void RequestScreenshot(const std::string& path);
+
+  /// @returns true if a screenshot has been requested.
+  bool screenshot_requested() const { return !screenshot_path_.empty(); }
+
+  /// @brief Capture the requested screenshot.
+  /// @param state The state of the current context.
+  /// @param width The width of the bound read framebuffer.
+  /// @param height The height of the bound read framebuffer.
+  /// @note The screenshot is skipped if all the readback slots are in flight.
+  void CaptureScreenshot(gfx::GlState* state, int width, int height);
+
+  /// @brief Start recording a frame sequence.
+  /// @param path_prefix The path of the frame files, without the frame number
+  /// and the extension.
+  /// @param format The file format.
+  void StartRecording(const std::string& path_prefix, Format format);
+
+  /// @brief Stop recording (frames that have been captured are still written).
+  void StopRecording();
+
+  /// @returns true if a frame sequence is being recorded.
+  bool recording() const { return recording_; }
+
+  /// @returns the number of frames that have been captured for the current
+  /// (or most recent) recording.
+  int recorded_frames() const { return recorded_frames_; }
+
+  /// @returns true if a recording frame can be captured now.
+  bool CanCaptureFrame();
+
+  /// @brief Capture the next frame of the recording.
+  /// @param state The state of the current context.
+  /// @param width The width of the bound read framebuffer.
+  /// @param height The height of the bound read framebuffer.
+  /// @note Only call this when CanCaptureFrame() returns true.
+  void CaptureFrame(gfx::GlState* state, int width, int height);
+
+  /// @brief Count a painted frame that a recording could not capture.
+  void CountStall();
+
+  /// @brief Start encoding the frames whose readback has completed.
+  /// @param state The state of the current context.
+  /// @note Call this once per painted frame.
+  void Update(gfx::GlState* state);
+
+  /// @brief Read back and write all the captured frames, waiting as needed.
+  /// @param state The state of the current context.
+  void Finish(gfx::GlState* state);
+
+  /// @returns true if frames are being read back (which requires painting to
+  /// continue, to collect them).
+  bool reading() const { return readback_.pending() > 0; }
+
+  /// @returns the capture statistics.
+  Stats GetStats();
+
+  /// @returns a description of the most recent written file or error.
+  std::string GetStatus();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct PendingFrame {
+    std::string path;
+    Format format;
+    Clock::time_point start;
+
+    // true for the frames of a recording (rather than screenshots).
+    bool recorded;
+  };
+
+  void Capture(gfx::GlState* state,
+               int width,
+               int height,
+               const std::string& path,
+               Format format,
+               bool recorded);
+
+  // Start encoding the oldest frame that has been read back, if any.
+  bool CollectOne(gfx::GlState* state, bool wait);
+
+  // Write an image (run as a task).
+  void Encode(gfx::Image* image, const PendingFrame& frame);
+
+  gfx::ReadbackRing readback_;
+  std::deque<PendingFrame> reading_frames_;
+  uint64_t next_tag_ = 0;
+
+  std::string screenshot_path_;
+  bool recording_ = false;
+  std::string recording_prefix_;
+  Format recording_format_ = Format::Png;
+  int recorded_frames_ = 0;
+
+  // The images (all of them own their pixel buffers, so that they can be
+  // reused without reallocation), and the ones that are not being encoded.
+  std::vector<std::unique_ptr<gfx::Image>> images_;
+  std::vector<gfx::Image*> free_images_;
+  base::TaskGroup encode_tasks_;
+
+  // The statistics and the status, which the encoding tasks update.
+  std::mutex mutex_;
+  Stats stats_;
+  std::string status_;
+  double total_latency_ms_ = 0.0;
+  Clock::time_point recording_start_;
+  Clock::time_point last_write_;
+  int recording_written_ = 0;
+  double recording_bytes_ = 0.0;
+
+  // Disable copy/move.
+  FrameRecorder(const FrameRecorder&) = delete;
+  FrameRecorder(FrameRecorder&&) = delete;
+  FrameRecorder& operator=(const FrameRecorder&) = delete;
+};
+
+}  // namespace viewer
+
+#endif  // VIEWER_FRAME_RECORDER_H_
@@ -0,0 +1,764 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "viewer/gpu_scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+#include "GL/gl3w.h"
+
+#include "base/make_unique.h"
+#include "base/parallel.h"
+#include "base/profiler.h"
+
+namespace viewer {
+
+namespace {
+
+// The maximum number of bytes to upload with a single call.
+const size_t kUploadBlockSize = 16 * 1024 * 1024;
+
+// The number of draws per culling cluster (a multiple of eight, as required by
+// gfx::BoxSet::Cull()).
+const size_t kClusterSize = 64;
+
+// The number of meshlets per culling task (a multiple of eight, as required by
+// gfx::MeshletSet::Cull()).
+const size_t kMeshletJobSize = 4096;
+
+// Marks the visible draws whose meshlets are not culled.
+const size_t kNoMeshlets = std::numeric_limits<size_t>::max();
+
+// Meshes that are drawn by at least this many draws are drawn instanced.
+const size_t kMinInstancedDraws = 2;
+
+// The shader field of the sort keys of the instanced draws (the other draws
+// use zero).
+const uint32_t kInstancedShader = 1;
+
+// The initial size of the instance index stream buffer, in bytes.
+const size_t kInstanceListSize = 256 * 1024;
+
+// Spread the lower ten bits of x so that there are two zero bits between each
+// bit.
+uint32_t SpreadBits(uint32_t x) {
+  x &= 0x3ffu;
+  x = (x | (x << 16)) & 0x030000ffu;
+  x = (x | (x << 8)) & 0x0300f00fu;
+  x = (x | (x << 4)) & 0x030c30c3u;
+  x = (x | (x << 2)) & 0x09249249u;
+  return x;
+}
+
+// The debug colors of the levels of detail.
+const float kLodColors[GpuScene::kLodStatsSize][3] = {
+    {1.0f, 1.0f, 1.0f}, {0.3f, 1.0f, 0.3f}, {1.0f, 1.0f, 0.2f},
+    {1.0f, 0.6f, 0.1f}, {1.0f, 0.2f, 0.2f}, {1.0f, 0.3f, 1.0f}};
+
+// @returns the largest factor that an affine transform scales lengths by.
+float GetMaxScale(const base::Mat4& m) {
+  float scale = 0.0f;
+  for (int j = 0; j < 3; ++j) {
+    const base::Vec3 column = {m.m[4 * j], m.m[4 * j + 1], m.m[4 * j + 2]};
+    scale = std::max(scale, base::Length(column));
+  }
+  return scale;
+}
+
+// @returns true if an affine transform is a rotation, a uniform scale and a
+// translation.
+bool IsConformal(const base::Mat4& m) {
+  base::Vec3 columns[3];
+  for (int j = 0; j < 3; ++j) {
+    columns[j] = {m.m[4 * j], m.m[4 * j + 1], m.m[4 * j + 2]};
+  }
+  const float scale2 = base::Dot(columns[0], columns[0]);
+  const float tolerance = 1e-4f * scale2;
+  return scale2 > 0.0f &&
+         std::abs(base::Dot(columns[1], columns[1]) - scale2) <= tolerance &&
+         std::abs(base::Dot(columns[2], columns[2]) - scale2) <= tolerance &&
+         std::abs(base::Dot(columns[0], columns[1])) <= tolerance &&
+         std::abs(base::Dot(columns[0], columns[2])) <= tolerance &&
+         std::abs(base::Dot(columns[1], columns[2])) <= tolerance &&
+         base::Dot(base::Cross(columns[0], columns[1]), columns[2]) > 0.0f;
+}
+
+// Transform a point by the inverse of a conformal transform.
+base::Vec3 InverseTransformPoint(const base::Mat4& m, const base::Vec3& p) {
+  const base::Vec3 d = p - base::Vec3{m.m[12], m.m[13], m.m[14]};
+  base::Vec3 result;
+  for (int j = 0; j < 3; ++j) {
+    const base::Vec3 column = {m.m[4 * j], m.m[4 * j + 1], m.m[4 * j + 2]};
+    result[j] = base::Dot(column, d) / base::Dot(column, column);
+  }
+  return result;
+}
+
+// A 30-bit Morton code for a point in the unit cube.
+uint32_t MortonCode(const base::Vec3& p) {
+  uint32_t code = 0;
+  for (int k = 0; k < 3; ++k) {
+    const float x = std::min(std::max(p[k] * 1024.0f, 0.0f), 1023.0f);
+    code |= SpreadBits(static_cast<uint32_t>(x)) << k;
+  }
+  return code;
+}
+
+}  // namespace
+
+GpuScene::GpuScene(const model::Scene& scene) {
+  // Allocate the buffers.
+  const auto& buffers = scene.buffers();
+  buffers_.resize(buffers.size());
+  if (!buffers_.empty()) {
+    glGenBuffers(static_cast<GLsizei>(buffers_.size()), buffers_.data());
+  }
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffers_[i]);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(buffers[i].size),
+                 nullptr, GL_STATIC_DRAW);
+    buffer_bytes_ += buffers[i].size;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // Create the GPU meshes (one per primitive).
+  std::vector<size_t> first_mesh;
+  for (const auto& mesh : scene.meshes()) {
+    first_mesh.push_back(meshes_.size());
+    for (const auto& primitive : mesh.primitives) {
+      meshes_.emplace_back(buffers_, primitive.positions, primitive.normals,
+                           primitive.tex_coords, primitive.indices);
+      for (const auto& lod : primitive.lods) {
+        meshes_.back().AddLod(lod.indices, lod.error);
+      }
+      meshes_.back().SetMeshlets(primitive.meshlets);
+    }
+  }
+  first_mesh.push_back(meshes_.size());
+
+  // Let the meshes with the same layout share a vertex array object. The
+  // first mesh of each layout represents it.
+  std::unordered_multimap<uint64_t, size_t> layouts;
+  mesh_vertex_arrays_.resize(meshes_.size());
+  for (size_t i = 0; i < meshes_.size(); ++i) {
+    const auto range = layouts.equal_range(meshes_[i].GetLayoutHash());
+    auto it = range.first;
+    while (it != range.second &&
+           !meshes_[i].HasSameLayout(meshes_[it->second])) {
+      ++it;
+    }
+    if (it != range.second) {
+      meshes_[i].ShareVertexArray(meshes_[it->second]);
+      mesh_vertex_arrays_[i] = mesh_vertex_arrays_[it->second];
+    } else {
+      layouts.emplace(meshes_[i].GetLayoutHash(), i);
+      mesh_vertex_arrays_[i] = static_cast<uint32_t>(vertex_array_count_++);
+    }
+  }
+
+  // Flatten the node hierarchy into instances, with one draw per GPU mesh
+  // and instance, and calculate the world space bounds of the draws.
+  std::vector<DrawItem> draws;
+  std::vector<base::Aabb> draw_bounds;
+  std::vector<base::Aabb> local_bounds;
+  bounds_ = base::Aabb::Empty();
+  for (const auto& scene_instance : scene.GetInstances()) {
+    const auto mesh = static_cast<size_t>(scene_instance.mesh);
+    Instance instance;
+    instance.first_mesh = first_mesh[mesh];
+    instance.end_mesh = first_mesh[mesh + 1];
+    instance.transform = scene_instance.transform;
+    instance.vertex_transform =
+        instance.transform * scene.meshes()[mesh].position_decode;
+    instance.scale = GetMaxScale(instance.transform);
+    instance.conformal = IsConformal(instance.transform);
+
+    const auto& primitives = scene.meshes()[mesh].primitives;
+    local_bounds.clear();
+    for (size_t i = 0; i < primitives.size(); ++i) {
+      local_bounds.push_back(primitives[i].bounds);
+      DrawItem draw;
+      draw.mesh = static_cast<uint32_t>(instance.first_mesh + i);
+      draw.instance = static_cast<uint32_t>(instances_.size());
+      draws.push_back(draw);
+    }
+    const size_t first_draw = draw_bounds.size();
+    draw_bounds.resize(first_draw + local_bounds.size());
+    base::TransformAabbs(instance.transform, local_bounds.data(),
+                         local_bounds.size(), &draw_bounds[first_draw]);
+    for (size_t i = first_draw; i < draw_bounds.size(); ++i) {
+      bounds_.Grow(draw_bounds[i]);
+    }
+
+    instances_.push_back(instance);
+  }
+  if (draws.empty()) {
+    bounds_ = base::Aabb{{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+  }
+
+  // Find the meshes that are drawn with instancing, and allocate the buffer
+  // for the instance transforms.
+  std::vector<size_t> mesh_draws(meshes_.size(), 0);
+  for (const auto& draw : draws) {
+    ++mesh_draws[draw.mesh];
+  }
+  instanced_meshes_.resize(meshes_.size());
+  for (size_t i = 0; i < meshes_.size(); ++i) {
+    instanced_meshes_[i] = mesh_draws[i] >= kMinInstancedDraws ? 1 : 0;
+  }
+  if (!instances_.empty()) {
+    glGenBuffers(1, &transform_buffer_);
+    glBindBuffer(GL_TEXTURE_BUFFER, transform_buffer_);
+    const size_t size = instances_.size() * sizeof(base::Mat4);
+    glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(size), nullptr,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  }
+
+  // Sort the draws along a Morton curve, so that consecutive draws (and hence
+  // the clusters) are spatially compact.
+  const base::Vec3 size = bounds_.max - bounds_.min;
+  base::Vec3 scale;
+  for (int k = 0; k < 3; ++k) {
+    scale[k] = size[k] > 0.0f ? 0.5f / size[k] : 0.0f;
+  }
+  std::vector<std::pair<uint32_t, uint32_t>> order(draws.size());
+  for (size_t i = 0; i < draws.size(); ++i) {
+    const base::Aabb& box = draw_bounds[i];
+    base::Vec3 p = box.min + box.max - 2.0f * bounds_.min;
+    for (int k = 0; k < 3; ++k) {
+      p[k] *= scale[k];
+    }
+    order[i] = std::make_pair(MortonCode(p), static_cast<uint32_t>(i));
+  }
+  std::sort(order.begin(), order.end());
+
+  for (size_t i = 0; i < order.size(); ++i) {
+    const size_t index = order[i].second;
+    draws_.push_back(draws[index]);
+    draw_boxes_.Add(draw_bounds[index]);
+  }
+  for (size_t begin = 0; begin < order.size(); begin += kClusterSize) {
+    const size_t end = std::min(begin + kClusterSize, order.size());
+    base::Aabb cluster_bounds = base::Aabb::Empty();
+    for (size_t i = begin; i < end; ++i) {
+      cluster_bounds.Grow(draw_bounds[order[i].second]);
+    }
+    cluster_boxes_.Add(cluster_bounds);
+  }
+}
+
+GpuScene::~GpuScene() {
+  if (fence_ != nullptr) {
+    glDeleteSync(static_cast<GLsync>(fence_));
+  }
+  if (!buffers_.empty()) {
+    glDeleteBuffers(static_cast<GLsizei>(buffers_.size()), buffers_.data());
+  }
+  if (transform_buffer_ != 0) {
+    glDeleteBuffers(1, &transform_buffer_);
+  }
+}
+
+void GpuScene::Upload(const model::Scene& scene,
+                      const std::function<void(size_t)>& progress) {
+  base::ProfileScope scope("UploadBuffers");
+  const auto& buffers = scene.buffers();
+  size_t uploaded = 0;
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffers_[i]);
+    for (size_t offset = 0; offset < buffers[i].size;
+         offset += kUploadBlockSize) {
+      const size_t size = std::min(kUploadBlockSize, buffers[i].size - offset);
+      glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(offset),
+                      static_cast<GLsizeiptr>(size), buffers[i].data + offset);
+      glFlush();
+      uploaded += size;
+      progress(uploaded);
+    }
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // Upload the instance transforms.
+  if (transform_buffer_ != 0) {
+    std::vector<base::Mat4> transforms;
+    transforms.reserve(instances_.size());
+    for (const auto& instance : instances_) {
+      transforms.push_back(instance.vertex_transform);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, transform_buffer_);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0,
+                    static_cast<GLsizeiptr>(transforms.size() *
+                                            sizeof(base::Mat4)),
+                    transforms.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  }
+}
+
+void GpuScene::InsertFence() {
+  if (fence_ != nullptr) {
+    glDeleteSync(static_cast<GLsync>(fence_));
+  }
+  fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  // The fence must reach the GPU before other contexts can wait for it.
+  glFlush();
+}
+
+bool GpuScene::IsReady() {
+  if (fence_ == nullptr) {
+    return true;
+  }
+  const GLenum result =
+      glClientWaitSync(static_cast<GLsync>(fence_), 0, 0);
+  if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+    glDeleteSync(static_cast<GLsync>(fence_));
+    fence_ = nullptr;
+    return true;
+  }
+  return false;
+}
+
+void GpuScene::Delete(gfx::GlState* state) {
+  for (auto& mesh : meshes_) {
+    mesh.Delete(state);
+  }
+  if (transform_texture_ != 0) {
+    state->DeleteTexture(transform_texture_);
+    state->DeleteTexture(instance_texture_);
+    transform_texture_ = 0;
+    instance_texture_ = 0;
+    instance_texture_generation_ = 0;
+  }
+  instance_list_.reset();
+}
+
+void GpuScene::Draw(gfx::GlState* state,
+                    int transform_location,
+                    const base::Mat4& view_proj,
+                    const DrawOptions& options,
+                    DrawStats* stats) {
+  {
+    base::ProfileScope scope("Cull");
+    Cull(view_proj, stats);
+  }
+  {
+    base::ProfileScope scope("CullMeshlets");
+    CullMeshlets(view_proj, options, stats);
+  }
+
+  {
+    base::ProfileScope scope("Sort");
+    Sort(options, stats);
+  }
+  base::ProfileScope scope("Submit");
+  Submit(state, transform_location, options, stats);
+  SubmitInstanced(state, options, stats);
+}
+
+void GpuScene::Sort(const DrawOptions& options, DrawStats* stats) {
+  const auto start = std::chrono::steady_clock::now();
+
+  // There is a single pass, and the only material is the debug color of the
+  // level of detail. The instanced draws are grouped by level of detail and
+  // mesh instead, and are sorted last (by the shader field).
+  const bool instancing = options.instanced_program != 0;
+  size_t instanced = 0;
+  queue_.Clear();
+  for (size_t i = 0; i < visible_draws_.size(); ++i) {
+    const uint32_t index = visible_draws_[i];
+    const auto& draw = draws_[index];
+    if (instancing && instanced_meshes_[draw.mesh] &&
+        meshlet_outputs_[i] == kNoMeshlets) {
+      queue_.Add(gfx::SortKey::Make(0, kInstancedShader,
+                                    static_cast<uint32_t>(visible_lods_[i]),
+                                    mesh_vertex_arrays_[draw.mesh], 0.0f,
+                                    draw.mesh),
+                 static_cast<uint32_t>(i));
+      ++instanced;
+      continue;
+    }
+    const uint32_t material =
+        options.lod_color_location >= 0
+            ? static_cast<uint32_t>(std::min(
+                  visible_lods_[i], static_cast<size_t>(kLodStatsSize - 1)))
+            : 0;
+    const uint64_t key = gfx::SortKey::Make(
+        0, 0, material, mesh_vertex_arrays_[draw.mesh],
+        draw_boxes_.Distance(index, options.eye), draw.instance);
+    queue_.Add(key, static_cast<uint32_t>(i));
+  }
+  queue_.Sort();
+  instanced_begin_ = queue_.size() - instanced;
+
+  if (stats != nullptr) {
+    stats->sort_seconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+  }
+}
+
+void GpuScene::Submit(gfx::GlState* state,
+                      int transform_location,
+                      const DrawOptions& options,
+                      DrawStats* stats) {
+  // The index ranges of consecutive draws with the same vertex array object,
+  // transform and color are collected in a batch, which is drawn when any of
+  // them changes.
+  const uint32_t kNone = std::numeric_limits<uint32_t>::max();
+  uint32_t current_instance = kNone;
+  size_t current_color = std::numeric_limits<size_t>::max();
+  uint32_t bound_vertex_array = kNone;
+  uint32_t batch_vertex_array = kNone;
+  size_t batch_mesh = 0;
+  size_t draw_calls = 0;
+  size_t state_changes = 0;
+  const auto bind = [&](uint32_t vertex_array) {
+    if (vertex_array != bound_vertex_array) {
+      bound_vertex_array = vertex_array;
+      ++state_changes;
+    }
+  };
+  const auto flush = [&]() {
+    if (!batch_.empty()) {
+      bind(batch_vertex_array);
+      meshes_[batch_mesh].SubmitBatch(state, &batch_);
+      ++draw_calls;
+    }
+  };
+
+  const auto& items = queue_.items();
+  for (size_t k = 0; k < instanced_begin_; ++k) {
+    const size_t i = items[k].index;
+    const auto& draw = draws_[visible_draws_[i]];
+    if (draw.instance != current_instance) {
+      flush();
+      current_instance = draw.instance;
+      glUniformMatrix4fv(transform_location, 1, GL_FALSE,
+                         instances_[draw.instance].vertex_transform.m);
+      state->CountCalls(1);
+      ++state_changes;
+    }
+    const size_t lod = visible_lods_[i];
+    const size_t color =
+        std::min(lod, static_cast<size_t>(kLodStatsSize - 1));
+    if (options.lod_color_location >= 0 && color != current_color) {
+      flush();
+      current_color = color;
+      glUniform3fv(options.lod_color_location, 1, kLodColors[color]);
+      state->CountCalls(1);
+      ++state_changes;
+    }
+
+    auto& mesh = meshes_[draw.mesh];
+    const uint32_t vertex_array = mesh_vertex_arrays_[draw.mesh];
+    size_t triangles;
+    if (!mesh.indexed()) {
+      flush();
+      bind(vertex_array);
+      mesh.Draw(state, lod);
+      ++draw_calls;
+      triangles = mesh.triangle_count(lod);
+    } else {
+      if (vertex_array != batch_vertex_array) {
+        flush();
+        batch_vertex_array = vertex_array;
+        batch_mesh = draw.mesh;
+      }
+      if (meshlet_outputs_[i] != kNoMeshlets) {
+        triangles = mesh.AddMeshletsToBatch(
+            &meshlet_visibility_[meshlet_outputs_[i]], &batch_);
+      } else {
+        mesh.AddToBatch(lod, &batch_);
+        triangles = mesh.triangle_count(lod);
+      }
+    }
+    if (stats != nullptr) {
+      stats->triangles += triangles;
+      stats->full_triangles += mesh.triangle_count();
+      ++stats->lod_draws[color];
+    }
+  }
+  flush();
+
+  if (stats != nullptr) {
+    stats->draw_calls = draw_calls;
+    stats->state_changes = state_changes;
+  }
+}
+
+void GpuScene::SubmitInstanced(gfx::GlState* state,
+                               const DrawOptions& options,
+                               DrawStats* stats) {
+  const auto& items = queue_.items();
+  const size_t count = items.size() - instanced_begin_;
+  if (count == 0) {
+    return;
+  }
+
+  // Stream the instance indices of the draws, in queue order.
+  if (!instance_list_) {
+    instance_list_ =
+        base::make_unique<gfx::StreamBuffer>(kInstanceListSize, state);
+  }
+  size_t offset;
+  auto* indices = static_cast<uint32_t*>(instance_list_->Map(
+      count * sizeof(uint32_t), sizeof(uint32_t), &offset));
+  for (size_t k = 0; k < count; ++k) {
+    const size_t i = items[instanced_begin_ + k].index;
+    indices[k] = draws_[visible_draws_[i]].instance;
+  }
+  instance_list_->Unmap();
+
+  // Bind the buffer textures. The instance texture follows the stream buffer
+  // when it grows.
+  if (transform_texture_ == 0) {
+    glGenTextures(1, &transform_texture_);
+    glGenTextures(1, &instance_texture_);
+    state->BindTextureBuffer(kTransformTextureUnit, transform_texture_);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, transform_buffer_);
+    state->CountCalls(3);
+  }
+  state->BindTextureBuffer(kTransformTextureUnit, transform_texture_);
+  state->BindTextureBuffer(kInstanceTextureUnit, instance_texture_);
+  if (instance_texture_generation_ != instance_list_->generation()) {
+    instance_texture_generation_ = instance_list_->generation();
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, instance_list_->handle());
+    state->CountCalls(1);
+  }
+  state->UseProgram(options.instanced_program);
+
+  // Draw each run of draws with the same mesh and level of detail as one
+  // instanced draw.
+  const uint32_t kNone = std::numeric_limits<uint32_t>::max();
+  uint32_t bound_vertex_array = kNone;
+  size_t current_color = std::numeric_limits<size_t>::max();
+  size_t draw_calls = 0;
+  size_t state_changes = 1;
+  const size_t first_instance = offset / sizeof(uint32_t);
+  size_t begin = instanced_begin_;
+  while (begin < items.size()) {
+    const size_t i = items[begin].index;
+    const uint32_t mesh_index = draws_[visible_draws_[i]].mesh;
+    const size_t lod = visible_lods_[i];
+    size_t end = begin + 1;
+    while (end < items.size() &&
+           draws_[visible_draws_[items[end].index]].mesh == mesh_index &&
+           visible_lods_[items[end].index] == lod) {
+      ++end;
+    }
+
+    const size_t color =
+        std::min(lod, static_cast<size_t>(kLodStatsSize - 1));
+    if (options.instanced_lod_color_location >= 0 && color != current_color) {
+      current_color = color;
+      glUniform3fv(options.instanced_lod_color_location, 1, kLodColors[color]);
+      state->CountCalls(1);
+      ++state_changes;
+    }
+    if (mesh_vertex_arrays_[mesh_index] != bound_vertex_array) {
+      bound_vertex_array = mesh_vertex_arrays_[mesh_index];
+      ++state_changes;
+    }
+    glUniform1i(options.first_instance_location,
+                static_cast<GLint>(first_instance + begin - instanced_begin_));
+    state->CountCalls(1);
+    auto& mesh = meshes_[mesh_index];
+    const size_t instance_count = end - begin;
+    mesh.DrawInstanced(state, lod, instance_count);
+    ++draw_calls;
+
+    if (stats != nullptr) {
+      stats->triangles += mesh.triangle_count(lod) * instance_count;
+      stats->full_triangles += mesh.triangle_count() * instance_count;
+      stats->lod_draws[color] += instance_count;
+      stats->instanced_draws += instance_count;
+    }
+    begin = end;
+  }
+  instance_list_->EndFrame();
+
+  if (stats != nullptr) {
+    stats->draw_calls += draw_calls;
+    stats->state_changes += state_changes;
+  }
+}
+
+void GpuScene::CullMeshlets(const base::Mat4& view_proj,
+                            const DrawOptions& options,
+                            DrawStats* stats) {
+  const auto start = std::chrono::steady_clock::now();
+
+  // Select the levels of detail, and split the meshlets of the full detail
+  // draws into jobs.
+  visible_lods_.resize(visible_draws_.size());
+  meshlet_outputs_.assign(visible_draws_.size(), kNoMeshlets);
+  meshlet_draws_.clear();
+  meshlet_jobs_.clear();
+  size_t meshlet_count = 0;
+  for (size_t i = 0; i < visible_draws_.size(); ++i) {
+    const uint32_t index = visible_draws_[i];
+    visible_lods_[i] = SelectLod(index, options);
+    const auto& meshlets = meshes_[draws_[index].mesh].meshlets();
+    if (!options.cull_meshlets || visible_lods_[i] != 0 ||
+        meshlets.size() == 0) {
+      continue;
+    }
+
+    // Cull in the coordinate system of the mesh. The facing of the meshlets
+    // is only known for conformal instance transforms.
+    const auto& instance = instances_[draws_[index].instance];
+    MeshletDraw meshlet_draw;
+    meshlet_draw.visible_draw = i;
+    meshlet_draw.output = meshlet_count;
+    meshlet_draw.frustum =
+        base::Frustum::FromMatrix(view_proj * instance.transform);
+    meshlet_draw.cull_back_faces =
+        options.cull_back_faces && instance.conformal;
+    if (meshlet_draw.cull_back_faces) {
+      meshlet_draw.eye = InverseTransformPoint(instance.transform, options.eye);
+    }
+    for (size_t begin = 0; begin < meshlets.size();
+         begin += kMeshletJobSize) {
+      MeshletJob job;
+      job.meshlet_draw = meshlet_draws_.size();
+      job.begin = begin;
+      job.end = std::min(begin + kMeshletJobSize, meshlets.size());
+      meshlet_jobs_.push_back(job);
+    }
+    meshlet_draws_.push_back(meshlet_draw);
+    meshlet_outputs_[i] = meshlet_count;
+    meshlet_count += meshlets.size();
+  }
+
+  // Cull the jobs, in parallel if there is more than one.
+  meshlet_visibility_.resize(meshlet_count);
+  const auto cull_job = [this](size_t job_index) {
+    const auto& job = meshlet_jobs_[job_index];
+    const auto& meshlet_draw = meshlet_draws_[job.meshlet_draw];
+    const auto& draw = draws_[visible_draws_[meshlet_draw.visible_draw]];
+    meshes_[draw.mesh].meshlets().Cull(
+        meshlet_draw.frustum,
+        meshlet_draw.cull_back_faces ? &meshlet_draw.eye : nullptr, job.begin,
+        job.end, &meshlet_visibility_[meshlet_draw.output + job.begin]);
+  };
+  if (meshlet_jobs_.size() > 1) {
+    base::ParallelFor(meshlet_jobs_.size(), cull_job);
+  } else if (meshlet_jobs_.size() == 1) {
+    cull_job(0);
+  }
+
+  if (stats != nullptr) {
+    stats->meshlets = meshlet_count;
+    for (auto visible : meshlet_visibility_) {
+      stats->visible_meshlets += visible;
+    }
+    stats->cull_seconds += std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+  }
+}
+
+size_t GpuScene::SelectLod(uint32_t index, const DrawOptions& options) const {
+  const auto& draw = draws_[index];
+  const auto& mesh = meshes_[draw.mesh];
+  if (mesh.lod_count() <= 1 || options.projection_scale <= 0.0f) {
+    return 0;
+  }
+  const float distance = draw_boxes_.Distance(index, options.eye);
+  if (distance <= 0.0f) {
+    return 0;
+  }
+
+  // Find the simplest level whose projected error is small enough.
+  const float pixels_per_error =
+      options.projection_scale * instances_[draw.instance].scale / distance;
+  for (size_t lod = mesh.lod_count() - 1; lod > 0; --lod) {
+    if (mesh.lod_error(lod) * pixels_per_error <= options.max_lod_error) {
+      return lod;
+    }
+  }
+  return 0;
+}
+
+void GpuScene::Cull(const base::Mat4& view_proj, DrawStats* stats) {
+  const auto start = std::chrono::steady_clock::now();
+
+  // Cull the clusters, and then the draws of the clusters that intersect the
+  // frustum. Clusters that are entirely inside the frustum are drawn without
+  // testing their draws.
+  const auto frustum = base::Frustum::FromMatrix(view_proj);
+  const size_t cluster_count = cluster_boxes_.size();
+  cluster_visibility_.resize(cluster_count);
+  draw_visibility_.resize(kClusterSize);
+  visible_draws_.clear();
+  cluster_boxes_.Cull(frustum, 0, cluster_count, cluster_visibility_.data());
+  size_t visible_clusters = 0;
+  size_t tested_boxes = cluster_count;
+  for (size_t cluster = 0; cluster < cluster_count; ++cluster) {
+    const auto visibility = cluster_visibility_[cluster];
+    if (visibility == base::kOutside) {
+      continue;
+    }
+    ++visible_clusters;
+    const size_t begin = cluster * kClusterSize;
+    const size_t end = std::min(begin + kClusterSize, draws_.size());
+    if (visibility == base::kInside) {
+      for (size_t i = begin; i < end; ++i) {
+        visible_draws_.push_back(static_cast<uint32_t>(i));
+      }
+    } else {
+      draw_boxes_.Cull(frustum, begin, end, draw_visibility_.data());
+      tested_boxes += end - begin;
+      for (size_t i = begin; i < end; ++i) {
+        if (draw_visibility_[i - begin] != base::kOutside) {
+          visible_draws_.push_back(static_cast<uint32_t>(i));
+        }
+      }
+    }
+  }
+
+  if (stats != nullptr) {
+    *stats = DrawStats();
+    stats->draws = draws_.size();
+    stats->visible_draws = visible_draws_.size();
+    stats->clusters = cluster_count;
+    stats->visible_clusters = visible_clusters;
+    stats->tested_boxes = tested_boxes;
+    stats->cull_seconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+  }
+}
+
+}  // namespace viewer
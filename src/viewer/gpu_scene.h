@@ -0,0 +1,359 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef VIEWER_GPU_SCENE_H_
+#define VIEWER_GPU_SCENE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "base/math.h"
+#include "gfx/box_set.h"
+#include "gfx/gl_state.h"
+#include "gfx/gpu_mesh.h"
+#include "gfx/render_queue.h"
+#include "gfx/stream_buffer.h"
+#include "model/scene.h"
+
+namespace viewer {
+
+/// @brief A scene that has been uploaded to the GPU.
+///
+/// Each scene buffer (e.g. a glTF buffer view) is uploaded as a single OpenGL
+/// buffer, straight from the memory that the importer produced (usually a
+/// memory mapped file). Meshes are uploaded once regardless of how many nodes
+/// refer to them, and each node is kept as an instance with a world transform.
+///
+/// A GPU scene is typically created and uploaded by one context (the worker)
+/// and drawn by another (the main window). The uploading context calls
+/// InsertFence() when done, and the drawing context must not use the scene
+/// until IsReady() returns true.
+///
+/// Draws (one per mesh primitive and instance) are culled against the view
+/// frustum before they are submitted. The draws are sorted along a space
+/// filling curve and grouped into clusters, and the clusters are culled first,
+/// so that the culling cost mostly depends on what is visible.
+///
+/// Each visible draw uses the simplest level of detail of its primitive whose
+/// geometric error, projected to the screen at the distance of the draw,
+/// stays below a number of pixels. Primitives that are drawn at full detail
+/// are split into meshlets (see gfx::BuildMeshlets()), which are culled in
+/// parallel, and only the visible meshlets are submitted.
+///
+/// The visible draws are sorted by state (see gfx::SortKey) before they are
+/// submitted. Primitives with the same vertex format share a vertex array
+/// object, and consecutive draws that only differ in their index ranges are
+/// merged into a single multi draw call.
+///
+/// Meshes that are drawn by several draws are drawn with hardware instancing
+/// (unless their meshlets are culled): the visible draws of each mesh and
+/// level of detail are drawn with a single instanced draw call. The instanced
+/// shader program reads the transforms from a buffer texture that holds the
+/// transforms of all the instances, which is uploaded with the scene, indexed
+/// by a per frame list of the visible instances.
+class GpuScene {
+ public:
+  /// The number of levels of detail that DrawStats counts separately (and
+  /// that have distinct debug colors).
+  static const int kLodStatsSize = 6;
+
+  /// The texture units of the buffer textures that the instanced shader
+  /// program reads: the vertex transforms of all the instances (a mat4 per
+  /// instance, in four RGBA32F texels), and the instance indices of the
+  /// instanced draws (R32UI).
+  static const int kTransformTextureUnit = 0;
+  static const int kInstanceTextureUnit = 1;
+
+  struct Instance {
+    // Index of the first and one past the last GPU mesh of the instance.
+    size_t first_mesh;
+    size_t end_mesh;
+    base::Mat4 transform;
+
+    // The transform of the stored vertex positions (the instance transform
+    // times the position decode transform of the mesh).
+    base::Mat4 vertex_transform;
+
+    // The largest scale factor of the instance transform, which scales the
+    // errors of the levels of detail.
+    float scale;
+
+    // True if the instance transform is a rotation, a uniform scale and a
+    // translation, which preserves the facing of the meshlets.
+    bool conformal;
+  };
+
+  /// @brief The options of Draw().
+  struct DrawOptions {
+    /// The camera position, in world space.
+    base::Vec3 eye = {0.0f, 0.0f, 0.0f};
+
+    /// The size in pixels of a unit length at unit distance from the camera
+    /// (see Camera::GetProjectionScale()). Zero draws full detail only.
+    float projection_scale = 0.0f;
+
+    /// The largest allowed screen space error of the levels of detail, in
+    /// pixels.
+    float max_lod_error = 1.0f;
+
+    /// The location of a vec3 uniform that is set to a different color for
+    /// each level of detail, or -1 to not color code the levels.
+    int lod_color_location = -1;
+
+    /// Cull the meshlets of the visible draws that are drawn at full detail.
+    bool cull_meshlets = true;
+
+    /// Also cull the meshlets that face away from the camera. Only enable
+    /// this when back faces are culled by OpenGL too.
+    bool cull_back_faces = false;
+
+    /// The shader program for instanced draws, or zero to draw each instance
+    /// separately. It must have the same uniforms as the current program,
+    /// except that the vertex transform of instance gl_InstanceID is read
+    /// from the buffer textures (see kTransformTextureUnit), at the instance
+    /// index at an offset from an int uniform.
+    unsigned int instanced_program = 0;
+
+    /// The location of the int uniform of the instanced program that holds
+    /// the offset of its instance indices.
+    int first_instance_location = -1;
+
+    /// The location of the level of detail color uniform of the instanced
+    /// program (see lod_color_location).
+    int instanced_lod_color_location = -1;
+  };
+
+  /// @brief Culling statistics for a drawn frame.
+  struct DrawStats {
+    size_t draws = 0;
+    size_t visible_draws = 0;
+    size_t clusters = 0;
+    size_t visible_clusters = 0;
+
+    /// The number of boxes (clusters and draws) that were tested.
+    size_t tested_boxes = 0;
+
+    /// The meshlets of the visible full detail draws, and the meshlets that
+    /// were drawn.
+    size_t meshlets = 0;
+    size_t visible_meshlets = 0;
+
+    /// The time spent culling (draws and meshlets), in seconds.
+    double cull_seconds = 0.0;
+
+    /// The draw calls that the visible draws were merged into, and the state
+    /// changes (vertex array, transform and color) between them.
+    size_t draw_calls = 0;
+    size_t state_changes = 0;
+
+    /// The visible draws that were drawn with instancing.
+    size_t instanced_draws = 0;
+
+    /// The time spent sorting the visible draws, in seconds.
+    double sort_seconds = 0.0;
+
+    /// The triangles of the visible draws, as drawn and at full detail.
+    size_t triangles = 0;
+    size_t full_triangles = 0;
+
+    /// The number of visible draws at each level of detail (the last entry
+    /// counts all the coarser levels too).
+    size_t lod_draws[kLodStatsSize] = {0, 0, 0, 0, 0, 0};
+  };
+
+  /// @brief Create the OpenGL buffers for a scene.
+  ///
+  /// The buffers are allocated using the current OpenGL context, but the data
+  /// is not uploaded until Upload() is called.
+  explicit GpuScene(const model::Scene& scene);
+
+  /// @brief Delete the OpenGL buffers and the fence.
+  /// @note Call Delete() before this, with the drawing context current.
+  ~GpuScene();
+
+  /// @brief Upload the buffer data.
+  ///
+  /// The data is uploaded in blocks, which keeps the driver from stalling
+  /// other contexts for the entire upload of a large scene.
+  /// @param scene The scene that was passed to the constructor.
+  /// @param progress Called after each uploaded block, with the total number
+  /// of bytes uploaded so far.
+  void Upload(const model::Scene& scene,
+              const std::function<void(size_t)>& progress);
+
+  /// @brief Insert a fence after the upload commands.
+  /// @note The fence is flushed, so it is safe to wait for it from another
+  /// context.
+  void InsertFence();
+
+  /// @returns true if the GPU has completed the upload (never blocks).
+  bool IsReady();
+
+  /// @brief Delete the OpenGL objects that belong to the drawing context.
+  /// @param state The state of the drawing context.
+  void Delete(gfx::GlState* state);
+
+  /// @brief Draw the mesh instances that are inside the view frustum.
+  /// @param state The state of the current context.
+  /// @param transform_location The location of the mat4 model transform uniform
+  /// of the current shader program.
+  /// @param view_proj The view projection matrix.
+  /// @param options The level of detail and meshlet culling options.
+  /// @param[out] stats The culling statistics (may be nullptr).
+  void Draw(gfx::GlState* state,
+            int transform_location,
+            const base::Mat4& view_proj,
+            const DrawOptions& options,
+            DrawStats* stats);
+
+  const std::vector<Instance>& instances() const { return instances_; }
+  size_t mesh_count() const { return meshes_.size(); }
+  size_t vertex_array_count() const { return vertex_array_count_; }
+  size_t buffer_bytes() const { return buffer_bytes_; }
+
+  /// @returns the world space bounding box of all the instances.
+  const base::Aabb& bounds() const { return bounds_; }
+
+ private:
+  struct DrawItem {
+    uint32_t mesh;
+    uint32_t instance;
+  };
+
+  // A visible draw whose meshlets are culled. The visibility of its meshlets
+  // starts at meshlet_visibility_[output].
+  struct MeshletDraw {
+    size_t visible_draw;
+    size_t output;
+    base::Frustum frustum;
+    base::Vec3 eye;
+    bool cull_back_faces;
+  };
+
+  // A range of the meshlets of a meshlet draw, culled as one task.
+  struct MeshletJob {
+    size_t meshlet_draw;
+    size_t begin;
+    size_t end;
+  };
+
+  // Find the draws that are inside the view frustum (into visible_draws_).
+  void Cull(const base::Mat4& view_proj, DrawStats* stats);
+
+  // Select the levels of detail of the visible draws (into visible_lods_), and
+  // cull the meshlets of the full detail draws (into meshlet_visibility_).
+  void CullMeshlets(const base::Mat4& view_proj,
+                    const DrawOptions& options,
+                    DrawStats* stats);
+
+  // @returns the level of detail to draw a visible draw with.
+  size_t SelectLod(uint32_t index, const DrawOptions& options) const;
+
+  // Sort the visible draws by state (into queue_).
+  void Sort(const DrawOptions& options, DrawStats* stats);
+
+  // Submit the sorted draws that are not instanced, merging them into as few
+  // draw calls as possible.
+  void Submit(gfx::GlState* state,
+              int transform_location,
+              const DrawOptions& options,
+              DrawStats* stats);
+
+  // Submit the sorted instanced draws, with one draw call per mesh and level
+  // of detail.
+  void SubmitInstanced(gfx::GlState* state,
+                       const DrawOptions& options,
+                       DrawStats* stats);
+
+  std::vector<unsigned int> buffers_;
+  std::vector<gfx::GpuMesh> meshes_;
+
+  // The vertex array object index of each mesh (meshes with the same layout
+  // share a vertex array object).
+  std::vector<uint32_t> mesh_vertex_arrays_;
+  size_t vertex_array_count_ = 0;
+
+  // True for the meshes that are drawn with instancing.
+  std::vector<uint8_t> instanced_meshes_;
+
+  // The vertex transforms of all the instances, and (in the drawing context)
+  // the buffer texture that reads them.
+  unsigned int transform_buffer_ = 0;
+  unsigned int transform_texture_ = 0;
+
+  // The per frame instance indices of the instanced draws, and the buffer
+  // texture that reads them (attached to the instance_texture_generation_
+  // storage of the stream buffer).
+  std::unique_ptr<gfx::StreamBuffer> instance_list_;
+  unsigned int instance_texture_ = 0;
+  unsigned int instance_texture_generation_ = 0;
+  std::vector<Instance> instances_;
+
+  // The draws in spatial order, their world space bounds, and the bounds of
+  // each cluster of kClusterSize consecutive draws.
+  std::vector<DrawItem> draws_;
+  gfx::BoxSet draw_boxes_;
+  gfx::BoxSet cluster_boxes_;
+
+  // Scratch buffers for the culling.
+  std::vector<base::Visibility> cluster_visibility_;
+  std::vector<base::Visibility> draw_visibility_;
+  std::vector<uint32_t> visible_draws_;
+  std::vector<size_t> visible_lods_;
+  std::vector<MeshletDraw> meshlet_draws_;
+  std::vector<MeshletJob> meshlet_jobs_;
+  std::vector<uint8_t> meshlet_visibility_;
+
+  // The start of the meshlet visibility of each visible draw in
+  // meshlet_visibility_ (kNoMeshlets for draws without culled meshlets).
+  std::vector<size_t> meshlet_outputs_;
+
+  gfx::RenderQueue queue_;
+  gfx::DrawBatch batch_;
+
+  // The instanced draws are sorted last in the queue, starting here.
+  size_t instanced_begin_ = 0;
+
+  size_t buffer_bytes_ = 0;
+  base::Aabb bounds_ = {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+
+  // The upload fence (a GLsync object).
+  void* fence_ = nullptr;
+
+  // Disable copy/move.
+  GpuScene(const GpuScene&) = delete;
+  GpuScene(GpuScene&&) = delete;
+  GpuScene& operator=(const GpuScene&) = delete;
+};
+
+}  // namespace viewer
+
+#endif  // VIEWER_GPU_SCENE_H_
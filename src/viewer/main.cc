@@ -26,20 +26,101 @@
 // POSSIBILITY OF SUCH DAMAGE.
 //------------------------------------------------------------------------------
 
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "base/error.h"
+#include "viewer/thumbnail_batch.h"
 #include "viewer/viewer.h"
 
-int main() {
+namespace {
+
+void PrintUsage(const char* program) {
+  std::cerr << "Usage: " << program << " [--trace trace.json]\n"
+            << "       " << program
+            << " --thumbnails DIR [--size N] [--samples N] [--jobs N]\n"
+            << "       " << std::string(std::strlen(program), ' ')
+            << " [--list FILE] [model ...]\n";
+}
+
+// Read a list of paths (one per line).
+void ReadPathList(const std::string& list_path,
+                  std::vector<std::string>* paths) {
+  std::ifstream file(list_path);
+  if (!file) {
+    throw base::Error("Unable to open " + list_path);
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (!line.empty()) {
+      paths->push_back(line);
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  // Parse the command line.
+  std::string trace_path;
+  bool thumbnails = false;
+  viewer::ThumbnailOptions thumbnail_options;
+  std::vector<std::string> model_paths;
+  std::vector<std::string> list_paths;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--thumbnails") == 0 && i + 1 < argc) {
+      thumbnails = true;
+      thumbnail_options.output_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      thumbnail_options.size = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      thumbnail_options.samples = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      thumbnail_options.jobs = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--list") == 0 && i + 1 < argc) {
+      list_paths.push_back(argv[++i]);
+    } else if (argv[i][0] != '-') {
+      model_paths.push_back(argv[i]);
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (thumbnails != (!model_paths.empty() || !list_paths.empty()) ||
+      thumbnail_options.size <= 0) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
   try {
+    if (thumbnails) {
+      // Batch mode: render the thumbnails without opening any window.
+      for (const auto& list_path : list_paths) {
+        ReadPathList(list_path, &model_paths);
+      }
+      return viewer::RenderThumbnails(model_paths, thumbnail_options) == 0 ? 0
+                                                                          : 1;
+    }
+
     // Start the viewer.
-    viewer::Viewer viewer;
+    viewer::Viewer viewer(trace_path);
     viewer.Run();
   } catch (base::Error& e) {
+    // E.g. an unreadable path list, or no headless context in batch mode.
     std::cerr << "Error: " << e.what() << "\n";
+    return 1;
   } catch (...) {
     std::cerr << "Error: Unhandled exception.\n";
+    return 1;
   }
 
   return 0;
@@ -28,19 +28,227 @@
 
 #include "viewer/main_window.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "GL/gl3w.h"
+#include "GLFW/glfw3.h"
+
+#include "base/error.h"
+#include "base/hash.h"
 #include "base/make_unique.h"
 
 namespace viewer {
 
-MainWindow::MainWindow() : UiWindow(1024, 576, "Viewer") {
+namespace {
+
+// The file that the GPU pass times are saved to (in the working directory).
+const char kGpuTimesCsvPath[] = "gpu_times.csv";
+
+// The time span of the trace that is saved with the trace hotkey.
+const double kTraceWindowSeconds = 30.0;
+
+// The repaint intervals while a model is loading (for the progress) and while
+// the upload fence of a loaded model is being polled, in seconds.
+const double kProgressInterval = 1.0 / 30.0;
+const double kFencePollInterval = 1.0 / 60.0;
+
+// The number of frames of a turntable recording (one full revolution), and
+// the size of the recorded frames (unless the window is recorded).
+const int kTurntableFrames = 360;
+const int kRecordWidth = 3840;
+const int kRecordHeight = 2160;
+const int kRecordSamples = 4;
+
+const float kPi = 3.14159265358979f;
+
+std::string GetTimestamp() {
+  return std::to_string(static_cast<int64_t>(std::time(nullptr)));
+}
+
+}  // namespace
+
+MainWindow::MainWindow(const std::string& trace_path)
+    : UiWindow(1024, 576, "Viewer"),
+      trace_recorder_(trace_path.empty() ? kTraceWindowSeconds : 0.0),
+      trace_path_(trace_path) {
   // Create the worker, which runs in a separate thread.
   worker_ = base::make_unique<MainWindowWorker>(*this);
 
   // Set the initial framebuffer size.
   worker_->SetFramebufferSize(framebuffer_width_, framebuffer_height_);
+
+  // Compile the scene shaders in the background.
+  scene_renderer_future_ = worker_->CreateSceneRenderer();
+
+  // Packed 10-10-10-2 normals require OpenGL 3.3.
+  packed_normals_ = gl3wIsSupported(3, 3) != 0;
+  UpdateOptimizerOptions();
+}
+
+MainWindow::~MainWindow() {
+  // Write the frames that are still being captured.
+  recorder_.Finish(&gl_state_);
+
+  // The vertex arrays of the scene belong to the main window context.
+  if (model_) {
+    model_->gpu_scene->Delete(&gl_state_);
+  }
+
+  // Delete the renderer (if it was never used) while the context is current.
+  if (scene_renderer_future_.valid()) {
+    scene_renderer_ = scene_renderer_future_.get();
+  }
+
+  if (!trace_path_.empty()) {
+    base::Profiler::GetDefault().Collect(&profile_);
+    trace_recorder_.Add(profile_);
+    SaveTrace(trace_path_);
+  }
+}
+
+void MainWindow::ScheduleRepaints() {
+  // Poll the upload fence of a new model until the model is ready.
+  bool ready;
+  if (worker_->HasLoadedModel(&ready)) {
+    RequestRepaint(ready ? 0.0 : kFencePollInterval);
+  }
+
+  // Animate the progress while loading, and remove it when done.
+  const bool loading = worker_->GetLoadProgress().loading;
+  if (loading) {
+    RequestRepaint(kProgressInterval);
+  }
+  if (loading != was_loading_) {
+    RequestRepaint();
+    was_loading_ = loading;
+  }
+
+  // Animate recordings, and keep painting while frames are being read back
+  // (which collects them) or written (which updates the statistics).
+  if (recorder_.recording()) {
+    RequestRepaint();
+  } else if (recorder_.reading()) {
+    RequestRepaint(kFencePollInterval);
+  } else if (recorder_.GetStats().in_flight > 0) {
+    RequestRepaint(kProgressInterval);
+  }
+}
+
+void MainWindow::UpdateScene() {
+  auto model = worker_->TakeLoadedModel();
+  if (model) {
+    // Keep the view when the optimized model replaces its preview.
+    const bool replaces_preview =
+        model_ && model_->preview && model_->path == model->path;
+    if (model_) {
+      model_->gpu_scene->Delete(&gl_state_);
+    }
+    model_ = std::move(model);
+    scene_cache_valid_ = false;
+    pick_time_ = -1.0;
+    if (!replaces_preview) {
+      zoom_ = 1.0f;
+    }
+  }
+}
+
+void MainWindow::PaintScene() {
+  // The UI of the previous frame has been painted by now.
+  set_cache_ui(cache_frames_);
+  if (ui_was_cached()) {
+    ++cached_ui_frames_;
+  }
+  ++painted_frames_;
+  if (model_) {
+    // Pick up the renderer from the worker. It is ready before the first
+    // model is (see MainWindowWorker::CreateSceneRenderer()). If the worker
+    // failed to create it, create it here.
+    if (!scene_renderer_) {
+      if (scene_renderer_future_.valid()) {
+        scene_renderer_ = scene_renderer_future_.get();
+      }
+      if (!scene_renderer_) {
+        scene_renderer_ = base::make_unique<SceneRenderer>();
+      }
+    }
+    scene_renderer_->set_lod_error(lod_error_);
+    scene_renderer_->set_show_lods(show_lods_);
+    scene_renderer_->set_cull_meshlets(cull_meshlets_);
+    scene_renderer_->set_cull_back_faces(cull_back_faces_);
+    scene_renderer_->set_instancing(instancing_);
+    if (framebuffer_height_ > 0) {
+      camera_.Fit(model_->gpu_scene->bounds(),
+                  static_cast<float>(framebuffer_width_) /
+                      static_cast<float>(framebuffer_height_),
+                  zoom_, turntable_yaw_);
+    }
+
+    if (cache_frames_ && framebuffer_width_ > 0 && framebuffer_height_ > 0) {
+      // Paint the scene to the cache framebuffer only when the view or the
+      // render options have changed, and copy it to the window.
+      if (!scene_framebuffer_ ||
+          scene_framebuffer_->width() != framebuffer_width_ ||
+          scene_framebuffer_->height() != framebuffer_height_) {
+        scene_framebuffer_ = base::make_unique<gfx::Framebuffer>(
+            &gl_state_, framebuffer_width_, framebuffer_height_, 1);
+        scene_cache_valid_ = false;
+      }
+      const uint64_t hash = GetSceneHash();
+      if (scene_cache_valid_ && hash == scene_hash_) {
+        ++cached_scene_frames_;
+      } else {
+        gfx::GpuTimer::Scope gpu_scope(&gpu_timer(), "Scene");
+        scene_framebuffer_->Bind(&gl_state_);
+        gl_state_.SetScissorTest(false);
+        gl_state_.Clear(GL_COLOR_BUFFER_BIT);
+        scene_renderer_->Paint(&gl_state_, model_->gpu_scene.get(), camera_,
+                               framebuffer_width_, framebuffer_height_,
+                               &draw_stats_);
+        scene_hash_ = hash;
+        scene_cache_valid_ = true;
+      }
+      scene_framebuffer_->BlitTo(&gl_state_, 0);
+    } else {
+      scene_framebuffer_.reset();
+      scene_cache_valid_ = false;
+      gfx::GpuTimer::Scope gpu_scope(&gpu_timer(), "Scene");
+      scene_renderer_->Paint(&gl_state_, model_->gpu_scene.get(), camera_,
+                             framebuffer_width_, framebuffer_height_,
+                             &draw_stats_);
+    }
+  }
+
+  CaptureFrames();
+}
+
+uint64_t MainWindow::GetSceneHash() const {
+  const auto view_proj = camera_.GetViewProjection();
+  uint64_t hash = base::HashBytes(view_proj.m, sizeof(view_proj.m));
+  hash = base::HashBytes(&lod_error_, sizeof(lod_error_), hash);
+  hash = base::HashCombine(hash, (show_lods_ ? 1u : 0u) |
+                                     (cull_meshlets_ ? 2u : 0u) |
+                                     (cull_back_faces_ ? 4u : 0u) |
+                                     (instancing_ ? 8u : 0u));
+  hash = base::HashCombine(hash, static_cast<uint64_t>(framebuffer_width_));
+  return base::HashCombine(hash, static_cast<uint64_t>(framebuffer_height_));
 }
 
 void MainWindow::DefineUi() {
+  // Collect the profile every frame, so that the statistics are complete when
+  // the profiler is shown, and so that a trace can be saved at any time.
+  base::Profiler::GetDefault().Collect(&profile_);
+  profiler_overlay_.Update(profile_);
+  trace_recorder_.Add(profile_);
+
   // 1. Show the main window.
   if (show_main_window_) {
     ImGui::SetNextWindowSize(ImVec2(400, 200), ImGuiSetCond_FirstUseEver);
@@ -53,9 +261,117 @@ void MainWindow::DefineUi() {
     }
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
                 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    ImGui::SameLine();
+    ImGui::Checkbox("Profiler", &show_profiler_);
+    ImGui::Checkbox("Paint continuously", &continuous_painting_);
+    DefineFrameCache();
+    const auto& gl_stats = gl_state_.last_frame_stats();
+    ImGui::Text("GL calls per frame: %d (%d redundant filtered), %d draws",
+                static_cast<int>(gl_stats.calls),
+                static_cast<int>(gl_stats.filtered),
+                static_cast<int>(gl_stats.draws));
+    if (trace_path_.empty()) {
+      ImGui::Text("Press F12 to save a trace of the last %d seconds.",
+                  static_cast<int>(kTraceWindowSeconds));
+    } else {
+      ImGui::Text("Recording a trace to %s", trace_path_.c_str());
+    }
+    if (!trace_status_.empty()) {
+      ImGui::Text("%s", trace_status_.c_str());
+    }
+    DefineCapture();
+    if (ImGui::Checkbox("Quantize vertices (on load)", &quantize_vertices_)) {
+      UpdateOptimizerOptions();
+    }
+    if (model_) {
+      ImGui::Text("Model: %s", model_->path.c_str());
+      ImGui::Text("%d meshes, %d instances, %d triangles",
+                  static_cast<int>(model_->scene->meshes().size()),
+                  static_cast<int>(model_->gpu_scene->instances().size()),
+                  static_cast<int>(model_->scene->triangle_count()));
+      if (model_->optimizer_stats) {
+        const auto& total = model_->optimizer_stats->total;
+        ImGui::Text("Optimized: ACMR %.2f -> %.2f, ATVR %.2f -> %.2f",
+                    total.cache_before.acmr, total.cache_after.acmr,
+                    total.cache_before.atvr, total.cache_after.atvr);
+        ImGui::Text("%d -> %d vertices, %.1f -> %.1f MB",
+                    static_cast<int>(total.vertices_before),
+                    static_cast<int>(total.vertices_after),
+                    static_cast<double>(total.bytes_before) / (1 << 20),
+                    static_cast<double>(total.bytes_after) / (1 << 20));
+      }
+      ImGui::Text("Visible draws: %d of %d (%d culled)",
+                  static_cast<int>(draw_stats_.visible_draws),
+                  static_cast<int>(draw_stats_.draws),
+                  static_cast<int>(draw_stats_.draws -
+                                   draw_stats_.visible_draws));
+      ImGui::Text("Visible clusters: %d of %d, %d boxes tested in %.1f us",
+                  static_cast<int>(draw_stats_.visible_clusters),
+                  static_cast<int>(draw_stats_.clusters),
+                  static_cast<int>(draw_stats_.tested_boxes),
+                  draw_stats_.cull_seconds * 1e6);
+      ImGui::Text("Draw calls: %d, %d state changes, %d vertex arrays, "
+                  "sorted in %.1f us",
+                  static_cast<int>(draw_stats_.draw_calls),
+                  static_cast<int>(draw_stats_.state_changes),
+                  static_cast<int>(model_->gpu_scene->vertex_array_count()),
+                  draw_stats_.sort_seconds * 1e6);
+      ImGui::Checkbox("Hardware instancing", &instancing_);
+      ImGui::SameLine();
+      ImGui::Text("%d instanced draws",
+                  static_cast<int>(draw_stats_.instanced_draws));
+      DefineLods();
+      DefineMeshlets();
+      const auto* bvh = GetBvh();
+      if (bvh == nullptr) {
+        ImGui::Text(IsBuildingBvh() ? "Building the BVH..."
+                                    : "Unable to build the BVH.");
+      } else if (pick_time_ >= 0.0 && pick_hit_.instance >= 0) {
+        const auto& instance = bvh->instances()[pick_hit_.instance];
+        const auto& node =
+            model_->scene->nodes()[static_cast<size_t>(instance.node)];
+        ImGui::Text("Picked node %d \"%s\", primitive %d, triangle %d",
+                    instance.node, node.name.c_str(), pick_hit_.primitive,
+                    static_cast<int>(pick_hit_.triangle));
+        ImGui::Text("Distance %g, picked in %.1f us", pick_hit_.distance,
+                    pick_time_ * 1e6);
+      } else if (pick_time_ >= 0.0) {
+        ImGui::Text("Picked nothing in %.1f us", pick_time_ * 1e6);
+      } else {
+        ImGui::Text("Click on the model to pick a triangle.");
+      }
+    }
+    ImGui::End();
+  }
+
+  // Show the loading progress.
+  const auto progress = worker_->GetLoadProgress();
+  if (progress.loading) {
+    ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiSetCond_FirstUseEver);
+    ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::Text("%s", progress.path.c_str());
+    char overlay[64];
+    std::snprintf(overlay, sizeof(overlay), "%s... (%.1f s)",
+                  progress.stage.c_str(), progress.seconds);
+    if (progress.fraction >= 0.0f) {
+      ImGui::ProgressBar(progress.fraction, ImVec2(300, 0), overlay);
+    } else {
+      // Unknown progress: show a bar that sweeps back and forth.
+      const float t = static_cast<float>(std::fmod(progress.seconds, 2.0));
+      ImGui::ProgressBar(t < 1.0f ? t : 2.0f - t, ImVec2(300, 0), overlay);
+    }
+    if (progress.queued > 0) {
+      ImGui::Text("%d more file(s) queued", progress.queued);
+    }
     ImGui::End();
   }
 
+  // Show the frame profile.
+  if (show_profiler_) {
+    profiler_overlay_.Define(&show_profiler_);
+    DefineGpuTimes();
+  }
+
   // 2. Show another simple window.
   if (show_another_window_) {
     ImGui::SetNextWindowSize(ImVec2(200, 100), ImGuiSetCond_FirstUseEver);
@@ -65,8 +381,311 @@ void MainWindow::DefineUi() {
   }
 }
 
+void MainWindow::SaveTrace(const std::string& path) {
+  try {
+    trace_recorder_.Write(path);
+    trace_status_ = "Saved " + std::to_string(trace_recorder_.event_count()) +
+                    " trace events to " + path;
+    std::cout << trace_status_ << std::endl;
+  } catch (base::Error& e) {
+    trace_status_ = e.what();
+    std::cerr << "Error: " << e.what() << std::endl;
+  }
+}
+
+void MainWindow::DefineGpuTimes() {
+  ImGui::SetNextWindowSize(ImVec2(360, 140), ImGuiSetCond_FirstUseEver);
+  ImGui::Begin("GPU Times", &show_profiler_);
+  auto& timer = gpu_timer();
+  if (!timer.supported()) {
+    ImGui::Text("Timer queries are not supported by this context.");
+    ImGui::End();
+    return;
+  }
+
+  ImGui::Columns(4, "gpu_passes");
+  ImGui::Text("Pass");
+  ImGui::NextColumn();
+  ImGui::Text("Last (ms)");
+  ImGui::NextColumn();
+  ImGui::Text("Avg (ms)");
+  ImGui::NextColumn();
+  ImGui::Text("Max (ms)");
+  ImGui::NextColumn();
+  ImGui::Separator();
+  for (const auto& pass : timer.stats()) {
+    ImGui::Text("%s", pass.name);
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", pass.last_ms);
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", pass.average_ms);
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", pass.max_ms);
+    ImGui::NextColumn();
+  }
+  ImGui::Columns(1);
+  ImGui::Separator();
+  if (timer.dropped_frames() > 0) {
+    ImGui::Text("%d frames were not measured in time.",
+                static_cast<int>(timer.dropped_frames()));
+  }
+
+  if (ImGui::Button("Save CSV")) {
+    try {
+      timer.WriteCsv(kGpuTimesCsvPath);
+      csv_status_ = std::string("Saved ") + kGpuTimesCsvPath;
+    } catch (base::Error& e) {
+      csv_status_ = e.what();
+    }
+  }
+  if (!csv_status_.empty()) {
+    ImGui::SameLine();
+    ImGui::Text("%s", csv_status_.c_str());
+  }
+  ImGui::End();
+}
+
+void MainWindow::DefineLods() {
+  ImGui::SliderFloat("LOD error (pixels)", &lod_error_, 0.0f, 8.0f, "%.1f");
+  ImGui::SameLine();
+  ImGui::Checkbox("Color LODs", &show_lods_);
+  const auto full = static_cast<double>(draw_stats_.full_triangles);
+  const auto saved =
+      static_cast<double>(draw_stats_.full_triangles - draw_stats_.triangles);
+  ImGui::Text("Drawn %d of %d triangles (%.0f%% saved)",
+              static_cast<int>(draw_stats_.triangles),
+              static_cast<int>(draw_stats_.full_triangles),
+              full > 0.0 ? 100.0 * saved / full : 0.0);
+  const auto* lod_draws = draw_stats_.lod_draws;
+  ImGui::Text("Draws per LOD: %d, %d, %d, %d, %d, %d+",
+              static_cast<int>(lod_draws[0]), static_cast<int>(lod_draws[1]),
+              static_cast<int>(lod_draws[2]), static_cast<int>(lod_draws[3]),
+              static_cast<int>(lod_draws[4]), static_cast<int>(lod_draws[5]));
+}
+
+void MainWindow::DefineMeshlets() {
+  ImGui::Checkbox("Cull meshlets", &cull_meshlets_);
+  ImGui::SameLine();
+  ImGui::Checkbox("Cull back faces", &cull_back_faces_);
+  ImGui::Text("Visible meshlets: %d of %d (%d culled)",
+              static_cast<int>(draw_stats_.visible_meshlets),
+              static_cast<int>(draw_stats_.meshlets),
+              static_cast<int>(draw_stats_.meshlets -
+                               draw_stats_.visible_meshlets));
+}
+
+void MainWindow::DefineFrameCache() {
+  if (ImGui::Checkbox("Reuse unchanged scene and UI", &cache_frames_)) {
+    cached_scene_frames_ = 0;
+    cached_ui_frames_ = 0;
+    painted_frames_ = 0;
+  }
+  if (cache_frames_) {
+    ImGui::Text("Reused the scene in %d and the UI in %d of %d frames",
+                static_cast<int>(cached_scene_frames_),
+                static_cast<int>(cached_ui_frames_),
+                static_cast<int>(painted_frames_));
+  }
+}
+
+void MainWindow::DefineCapture() {
+  ImGui::Text("Press F9 for a screenshot, F10 to record a turntable.");
+  ImGui::Checkbox("Record the window", &record_window_);
+  ImGui::SameLine();
+  ImGui::Checkbox("Record raw RGBA", &record_raw_);
+  if (recorder_.recording()) {
+    ImGui::Text("Recording frame %d of %d", recorder_.recorded_frames(),
+                kTurntableFrames);
+  }
+  const auto stats = recorder_.GetStats();
+  if (stats.captured > 0) {
+    ImGui::Text("Captured %d frames: %d written, %d in flight, %d stalls",
+                stats.captured, stats.written, stats.in_flight, stats.stalled);
+    ImGui::Text("Capture latency %.1f ms (avg %.1f, max %.1f)",
+                stats.last_latency_ms, stats.average_latency_ms,
+                stats.max_latency_ms);
+    if (stats.frames_per_second > 0.0) {
+      ImGui::Text("Recording %.1f frames/s, %.1f MB/s",
+                  stats.frames_per_second, stats.megabytes_per_second);
+    }
+    const auto status = recorder_.GetStatus();
+    if (!status.empty()) {
+      ImGui::Text("%s", status.c_str());
+    }
+  }
+}
+
+void MainWindow::CaptureFrames() {
+  recorder_.Update(&gl_state_);
+
+  // Screenshots are taken of the window (without the UI).
+  if (recorder_.screenshot_requested()) {
+    gl_state_.BindFramebuffer(0);
+    recorder_.CaptureScreenshot(&gl_state_, framebuffer_width_,
+                                framebuffer_height_);
+  }
+
+  if (!recorder_.recording()) {
+    return;
+  }
+  if (!recorder_.CanCaptureFrame()) {
+    // Wait for the readback and the encoding to catch up, rather than drop
+    // frames (the turntable only advances for captured frames).
+    recorder_.CountStall();
+    return;
+  }
+
+  if (record_window_) {
+    gl_state_.BindFramebuffer(0);
+    recorder_.CaptureFrame(&gl_state_, framebuffer_width_,
+                           framebuffer_height_);
+  } else {
+    // Paint the scene again, at the recording resolution.
+    gfx::GpuTimer::Scope gpu_scope(&gpu_timer(), "Record");
+    if (!record_framebuffer_) {
+      record_framebuffer_ = base::make_unique<gfx::Framebuffer>(
+          &gl_state_, kRecordWidth, kRecordHeight, kRecordSamples);
+    }
+    record_framebuffer_->Bind(&gl_state_);
+    gl_state_.SetViewport(0, 0, kRecordWidth, kRecordHeight);
+    gl_state_.SetScissorTest(false);
+    gl_state_.SetClearColor(1.0f, 0.6f, 0.0f, 1.0f);
+    gl_state_.Clear(GL_COLOR_BUFFER_BIT);
+    if (model_ && scene_renderer_) {
+      Camera camera;
+      camera.Fit(model_->gpu_scene->bounds(),
+                 static_cast<float>(kRecordWidth) /
+                     static_cast<float>(kRecordHeight),
+                 zoom_, turntable_yaw_);
+      scene_renderer_->Paint(&gl_state_, model_->gpu_scene.get(), camera,
+                             kRecordWidth, kRecordHeight, nullptr);
+    }
+    record_framebuffer_->Resolve(&gl_state_);
+    recorder_.CaptureFrame(&gl_state_, kRecordWidth, kRecordHeight);
+    gl_state_.BindFramebuffer(0);
+    gl_state_.SetViewport(0, 0, framebuffer_width_, framebuffer_height_);
+  }
+
+  // Advance the turntable, and stop after a full revolution.
+  const int frames = recorder_.recorded_frames();
+  turntable_yaw_ = 2.0f * kPi * static_cast<float>(frames) /
+                   static_cast<float>(kTurntableFrames);
+  if (frames >= kTurntableFrames) {
+    recorder_.StopRecording();
+    turntable_yaw_ = 0.0f;
+  }
+}
+
 void MainWindow::OnFramebufferSize(int width, int height) {
   worker_->SetFramebufferSize(width, height);
 }
 
+void MainWindow::OnMouseButton(ui::MouseButton button,
+                               bool pressed,
+                               ui::Modifiers mods) {
+  (void)mods;
+  if (button == ui::MouseButton::Button1 && pressed &&
+      !ImGui::GetIO().WantCaptureMouse) {
+    Pick(cursor_x_, cursor_y_);
+  }
+}
+
+void MainWindow::OnScroll(double x_offset, double y_offset) {
+  (void)x_offset;
+  if (!ImGui::GetIO().WantCaptureMouse) {
+    // Zoom in or out by 10% per step.
+    zoom_ *= static_cast<float>(std::pow(0.9, y_offset));
+    zoom_ = std::min(std::max(zoom_, 0.001f), 10.0f);
+  }
+}
+
+void MainWindow::OnKey(ui::KeyCode key,
+                       int scan_code,
+                       bool pressed,
+                       ui::Modifiers mods) {
+  (void)scan_code;
+  (void)mods;
+  if (!pressed) {
+    return;
+  }
+
+  // Name the files after the current time, so that they are not overwritten.
+  if (key == ui::KeyCode::F9) {
+    recorder_.RequestScreenshot("viewer-screenshot-" + GetTimestamp() +
+                                ".png");
+  } else if (key == ui::KeyCode::F10) {
+    if (recorder_.recording()) {
+      recorder_.StopRecording();
+      turntable_yaw_ = 0.0f;
+    } else {
+      const int width = record_window_ ? framebuffer_width_ : kRecordWidth;
+      const int height = record_window_ ? framebuffer_height_ : kRecordHeight;
+      recorder_.StartRecording("viewer-turntable-" + GetTimestamp() + "-" +
+                                   std::to_string(width) + "x" +
+                                   std::to_string(height),
+                               record_raw_ ? FrameRecorder::Format::Raw
+                                           : FrameRecorder::Format::Png);
+    }
+  } else if (key == ui::KeyCode::F12) {
+    SaveTrace("viewer-trace-" + GetTimestamp() + ".json");
+  }
+}
+
+void MainWindow::OnCursorPos(double x, double y) {
+  cursor_x_ = x;
+  cursor_y_ = y;
+}
+
+void MainWindow::OnDrop(int count, const char** paths) {
+  // Load the dropped model files on the worker thread.
+  for (int i = 0; i < count; ++i) {
+    worker_->LoadModel(paths[i]);
+  }
+}
+
+void MainWindow::UpdateOptimizerOptions() {
+  model::SceneOptimizerOptions options;
+  options.quantize = quantize_vertices_;
+  options.packed_normals = packed_normals_;
+  worker_->SetOptimizerOptions(options);
+}
+
+const model::SceneBvh* MainWindow::GetBvh() const {
+  if (!model_ || !model_->bvh.valid() || IsBuildingBvh()) {
+    return nullptr;
+  }
+
+  // A failed build leaves a null BVH.
+  return model_->bvh.get().get();
+}
+
+bool MainWindow::IsBuildingBvh() const {
+  return model_ && model_->bvh.valid() &&
+         model_->bvh.wait_for(std::chrono::seconds(0)) !=
+             std::future_status::ready;
+}
+
+void MainWindow::Pick(double x, double y) {
+  const auto* bvh = GetBvh();
+  int width;
+  int height;
+  glfwGetWindowSize(glfw_window_, &width, &height);
+  if (bvh == nullptr || width <= 0 || height <= 0) {
+    return;
+  }
+
+  // Cast a ray from the camera through the cursor position.
+  const auto start = std::chrono::steady_clock::now();
+  const float ndc_x = static_cast<float>(2.0 * x / width - 1.0);
+  const float ndc_y = static_cast<float>(1.0 - 2.0 * y / height);
+  base::Vec3 origin;
+  base::Vec3 direction;
+  camera_.GetRay(ndc_x, ndc_y, &origin, &direction);
+  pick_hit_ = model::RayHit(std::numeric_limits<float>::infinity());
+  bvh->Intersect(*model_->scene, origin, direction, &pick_hit_);
+  pick_time_ = std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+}
+
 }  // namespace viewer
@@ -29,27 +29,166 @@
 #ifndef VIEWER_MAIN_WINDOW_H_
 #define VIEWER_MAIN_WINDOW_H_
 
+#include <cstdint>
+#include <future>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "imgui/imgui.h"
 
+#include "base/profiler.h"
+#include "base/trace_recorder.h"
+#include "gfx/framebuffer.h"
+#include "model/bvh.h"
 #include "ui/ui_window.h"
+#include "viewer/camera.h"
+#include "viewer/frame_recorder.h"
 #include "viewer/main_window_worker.h"
+#include "viewer/profiler_overlay.h"
+#include "viewer/scene_renderer.h"
 
 namespace viewer {
 
 /// @brief The application main window.
 class MainWindow : public ui::UiWindow {
  public:
-  MainWindow();
+  /// @brief Create the main window.
+  /// @param trace_path If not empty, all profiling events are recorded and
+  /// written to this file (as a Chrome trace) when the window is destroyed.
+  explicit MainWindow(const std::string& trace_path);
+  ~MainWindow();
+
+  /// @brief Request repaints for the work of the worker.
+  ///
+  /// The window is repainted when a loaded model is ready, and periodically
+  /// while models are loading (to show the progress). Call this once per
+  /// iteration of the main loop, before deciding whether to paint.
+  /// @note The main window context must be current.
+  void ScheduleRepaints();
+
+  /// @brief Pick up a newly loaded model from the worker (if any).
+  /// @note The main window context must be current.
+  void UpdateScene();
+
+  /// @returns true if the window should be painted every frame, rather than
+  /// only when something changes.
+  bool continuous_painting() const { return continuous_painting_; }
+
+  /// @brief Paint the 3D scene, and capture the requested screenshots and
+  /// recording frames.
+  /// @note The main window context must be current.
+  void PaintScene();
 
  private:
   void DefineUi() override;
 
   void OnFramebufferSize(int width, int height) override;
+  void OnMouseButton(ui::MouseButton button,
+                     bool pressed,
+                     ui::Modifiers mods) override;
+  void OnCursorPos(double x, double y) override;
+  void OnScroll(double x_offset, double y_offset) override;
+  void OnKey(ui::KeyCode key,
+             int scan_code,
+             bool pressed,
+             ui::Modifiers mods) override;
+  void OnDrop(int count, const char** paths) override;
+
+  // Write the recorded trace events to a file.
+  void SaveTrace(const std::string& path);
+
+  // Define the GPU pass time window.
+  void DefineGpuTimes();
+
+  // Define the level of detail controls and statistics.
+  void DefineLods();
+
+  // Define the meshlet culling controls and statistics.
+  void DefineMeshlets();
+
+  // Define the frame cache option and statistics.
+  void DefineFrameCache();
+
+  // Define the screenshot and recording controls.
+  void DefineCapture();
+
+  // Capture the painted scene for a screenshot or a recording.
+  void CaptureFrames();
+
+  // Pass the mesh optimization options to the worker.
+  void UpdateOptimizerOptions();
+
+  // @returns a hash of everything that the painted scene depends on, except
+  // the model (a new model invalidates the scene cache).
+  uint64_t GetSceneHash() const;
+
+  // Get the BVH of the current model, or nullptr if it is not ready yet or if
+  // it could not be built.
+  const model::SceneBvh* GetBvh() const;
+
+  // @returns true if the BVH of the current model is still being built.
+  bool IsBuildingBvh() const;
+
+  // Pick the triangle under a point in the window (in screen coordinates).
+  void Pick(double x, double y);
 
   std::unique_ptr<MainWindowWorker> worker_;
 
+  std::unique_ptr<LoadedModel> model_;
+  bool quantize_vertices_ = false;
+  bool packed_normals_ = false;
+  std::unique_ptr<SceneRenderer> scene_renderer_;
+  std::future<std::unique_ptr<SceneRenderer>> scene_renderer_future_;
+  Camera camera_;
+  float zoom_ = 1.0f;
+  float turntable_yaw_ = 0.0f;
+  GpuScene::DrawStats draw_stats_;
+  float lod_error_ = 1.0f;
+  bool show_lods_ = false;
+  bool cull_meshlets_ = true;
+  bool cull_back_faces_ = false;
+  bool instancing_ = true;
+
+  // With the frame cache, the scene is painted to a framebuffer, which is
+  // reused while the view and the render options are unchanged (and the UI
+  // is cached by the UI window).
+  bool cache_frames_ = false;
+  std::unique_ptr<gfx::Framebuffer> scene_framebuffer_;
+  uint64_t scene_hash_ = 0;
+  bool scene_cache_valid_ = false;
+  uint64_t painted_frames_ = 0;
+  uint64_t cached_scene_frames_ = 0;
+  uint64_t cached_ui_frames_ = 0;
+
+  double cursor_x_ = 0.0;
+  double cursor_y_ = 0.0;
+
+  // The most recent pick (pick_hit_.instance is negative if nothing was hit),
+  // and the time it took in seconds (negative if nothing has been picked).
+  model::RayHit pick_hit_{0.0f};
+  double pick_time_ = -1.0;
+
+  // The profiling events of the current frame, which feed the profiler
+  // overlay and the trace recorder.
+  std::vector<base::ProfileThread> profile_;
+  ProfilerOverlay profiler_overlay_;
+  bool show_profiler_ = false;
+  bool continuous_painting_ = false;
+  bool was_loading_ = false;
+  std::string csv_status_;
+
+  // Recordings are rendered to a framebuffer of their own (unless they record
+  // the window).
+  FrameRecorder recorder_;
+  std::unique_ptr<gfx::Framebuffer> record_framebuffer_;
+  bool record_window_ = false;
+  bool record_raw_ = false;
+
+  base::TraceRecorder trace_recorder_;
+  std::string trace_path_;
+  std::string trace_status_;
+
   ImVec4 color_value_ = ImColor(114, 144, 154);
   float float_value_ = 0.5f;
   bool show_main_window_ = true;
@@ -28,78 +28,240 @@
 
 #include "viewer/main_window_worker.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "GL/gl3w.h"
+
+#include "base/file_util.h"
 #include "base/make_unique.h"
+#include "base/profiler.h"
+#include "model/importer.h"
+#include "model/scene_cache.h"
+#include "ui/application.h"
 #include "ui/offscreen_context.h"
 
 namespace viewer {
 
-MainWindowWorker::MainWindowWorker(const ui::Window& share_window)
-    : terminate_thread_(false) {
+namespace {
+
+// The number of meshes that are listed individually in the optimization
+// report (the largest ones).
+const size_t kReportedMeshes = 8;
+
+// @returns the cache file variant for scenes optimized with the options.
+std::string GetCacheVariant(const model::SceneOptimizerOptions& options) {
+  if (!options.quantize) {
+    return std::string();
+  }
+  return options.packed_normals ? "q" : "q16";
+}
+
+void PrintMeshStats(const model::MeshOptimizerStats& stats) {
+  char line[256];
+  std::snprintf(line, sizeof(line),
+                "%s: %d triangles, %d -> %d vertices, ACMR %.3f -> %.3f, "
+                "ATVR %.3f -> %.3f, %d LODs (%d triangles), %d meshlets, "
+                "%.1f -> %.1f KB",
+                stats.name.c_str(), static_cast<int>(stats.triangles),
+                static_cast<int>(stats.vertices_before),
+                static_cast<int>(stats.vertices_after),
+                stats.cache_before.acmr, stats.cache_after.acmr,
+                stats.cache_before.atvr, stats.cache_after.atvr,
+                static_cast<int>(stats.lods),
+                static_cast<int>(stats.lod_triangles),
+                static_cast<int>(stats.meshlets),
+                static_cast<double>(stats.bytes_before) / 1024.0,
+                static_cast<double>(stats.bytes_after) / 1024.0);
+  std::cout << "  " << line << std::endl;
+}
+
+void PrintOptimizerStats(const model::SceneOptimizerStats& stats) {
+  std::cout << "Optimized " << stats.meshes.size() << " meshes in "
+            << static_cast<int>(stats.seconds * 1000.0) << " ms:" << std::endl;
+  std::vector<const model::MeshOptimizerStats*> meshes;
+  for (const auto& mesh : stats.meshes) {
+    meshes.push_back(&mesh);
+  }
+  const size_t count = std::min(meshes.size(), kReportedMeshes);
+  std::partial_sort(meshes.begin(), meshes.begin() + count, meshes.end(),
+                    [](const model::MeshOptimizerStats* a,
+                       const model::MeshOptimizerStats* b) {
+                      return a->triangles > b->triangles;
+                    });
+  for (size_t i = 0; i < count; ++i) {
+    PrintMeshStats(*meshes[i]);
+  }
+  if (count < meshes.size()) {
+    std::cout << "  (" << meshes.size() - count << " smaller meshes)"
+              << std::endl;
+  }
+  PrintMeshStats(stats.total);
+  if (stats.duplicate_meshes > 0) {
+    std::cout << "Merged " << stats.duplicate_meshes << " duplicate meshes ("
+              << stats.duplicate_bytes / 1024 << " KB)." << std::endl;
+  }
+}
+
+}  // namespace
+
+MainWindowWorker::MainWindowWorker(const ui::Window& share_window) {
   // Create a new off screen OpenGL context.
   gl_context_ = base::make_unique<ui::OffscreenContext>(share_window);
   gl_context_->Release();
 
-  // Start the worker thread.
-  thread_ = std::thread(&MainWindowWorker::Run, this);
+  // Start the OpenGL lane.
+  gl_lane_ = base::make_unique<base::AffinityLane>(
+      std::bind(&MainWindowWorker::StartGlLane, this),
+      std::bind(&MainWindowWorker::StopGlLane, this));
 }
 
 MainWindowWorker::~MainWindowWorker() {
-  // Terminate the worker thread.
-  terminate_thread_ = true;
-  condition_variable_.notify_all();
-  thread_.join();
+  // Wait for the decoding tasks (which post work to the OpenGL lane), then
+  // terminate the lane, and finally wait for any tasks that the lane spawned.
+  // The load tasks handle their own errors, but Wait() rethrows anything that
+  // escapes them, which must not leave the destructor.
+  auto& scheduler = base::TaskScheduler::GetDefault();
+  try {
+    scheduler.Wait(&load_tasks_);
+  } catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+  } catch (...) {
+    std::cerr << "Error: Unhandled exception in a load task." << std::endl;
+  }
+  gl_lane_.reset();
+  try {
+    scheduler.Wait(&load_tasks_);
+  } catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+  } catch (...) {
+    std::cerr << "Error: Unhandled exception in a load task." << std::endl;
+  }
 }
 
 void MainWindowWorker::SetFramebufferSize(int width, int height) {
-  CallOnWorkerThread(std::bind(&MainWindowWorker::SetFramebufferSizeImpl, this,
-                               width, height));
+  gl_lane_->Post(std::bind(&MainWindowWorker::SetFramebufferSizeImpl, this,
+                           width, height));
 }
 
-void MainWindowWorker::Run() {
-  std::cout << "Started the main worker thread." << std::endl;
+void MainWindowWorker::LoadModel(const std::string& path) {
+  uint64_t sequence;
+  {
+    std::lock_guard<std::mutex> lock(progress_mutex_);
+    ++progress_.queued;
+    sequence = ++requested_sequence_;
+  }
+  base::TaskScheduler::GetDefault().Spawn(
+      &load_tasks_,
+      std::bind(&MainWindowWorker::DecodeModel, this, path, sequence));
+}
 
-  // Activate the off screen OpenGL context.
-  gl_context_->MakeCurrent();
+std::unique_ptr<LoadedModel> MainWindowWorker::TakeLoadedModel() {
+  std::lock_guard<std::mutex> lock(loaded_model_mutex_);
+  if (loaded_model_ && loaded_model_->gpu_scene->IsReady()) {
+    return std::move(loaded_model_);
+  }
+  return nullptr;
+}
 
-  // Main loop.
-  while (true) {
-    // Wait for a signal.
-    std::unique_lock<std::mutex> lock(mutex_);
-    while (call_queue_.empty() && !terminate_thread_) {
-      condition_variable_.wait(lock);
-    }
+bool MainWindowWorker::HasLoadedModel(bool* ready) {
+  std::lock_guard<std::mutex> lock(loaded_model_mutex_);
+  *ready = loaded_model_ && loaded_model_->gpu_scene->IsReady();
+  return loaded_model_ != nullptr;
+}
 
-    // Were we requested to terminate?
-    if (terminate_thread_) {
-      break;
-    }
+void MainWindowWorker::SetOptimizerOptions(
+    const model::SceneOptimizerOptions& options) {
+  std::lock_guard<std::mutex> lock(progress_mutex_);
+  optimizer_options_ = options;
+}
 
-    // Call a method that was posted on the call queue.
-    if (!call_queue_.empty()) {
-      // Pop the function call from the queue.
-      auto fun = std::move(call_queue_.front());
-      call_queue_.pop();
+LoadProgress MainWindowWorker::GetLoadProgress() {
+  std::lock_guard<std::mutex> lock(progress_mutex_);
+  LoadProgress result = progress_;
+  if (result.loading) {
+    result.seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - load_start_)
+                         .count();
+  }
+  return result;
+}
 
-      // Unlock the mutex and call the function.
-      lock.unlock();
-      fun();
-    }
+void MainWindowWorker::StartGlLane() {
+  std::cout << "Started the OpenGL worker lane." << std::endl;
+  base::Profiler::GetDefault().SetThreadName("OpenGL lane");
 
-    // TODO(m): Repaint the scene if necessary.
+  // Activate the off screen OpenGL context.
+  gl_context_->MakeCurrent();
+
+  shader_cache_ =
+      base::make_unique<gfx::ShaderCache>(base::GetCacheDirectory());
+}
+
+void MainWindowWorker::StopGlLane() {
+  // Delete the GPU resources while the context is still current.
+  {
+    std::lock_guard<std::mutex> lock(loaded_model_mutex_);
+    loaded_model_.reset();
   }
+  shader_cache_.reset();
 
   // Release the off screen OpenGL context.
   gl_context_->Release();
 
-  std::cout << "Exiting the main worker thread." << std::endl;
+  std::cout << "Exiting the OpenGL worker lane." << std::endl;
 }
 
-void MainWindowWorker::CallOnWorkerThread(std::function<void()>&& fun) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  call_queue_.emplace(std::move(fun));
-  condition_variable_.notify_all();
+std::future<std::unique_ptr<SceneRenderer>>
+MainWindowWorker::CreateSceneRenderer() {
+  auto renderer =
+      std::make_shared<std::promise<std::unique_ptr<SceneRenderer>>>();
+  auto result = renderer->get_future();
+  gl_lane_->Post(
+      std::bind(&MainWindowWorker::CreateSceneRendererImpl, this, renderer));
+  return result;
+}
+
+void MainWindowWorker::CreateSceneRendererImpl(
+    const std::shared_ptr<std::promise<std::unique_ptr<SceneRenderer>>>&
+        renderer) {
+  base::ProfileScope scope("CreateSceneRenderer");
+  const auto start = std::chrono::steady_clock::now();
+  const size_t hits = shader_cache_->hits();
+  const size_t misses = shader_cache_->misses();
+  std::unique_ptr<SceneRenderer> result;
+  try {
+    result = base::make_unique<SceneRenderer>(shader_cache_.get());
+  } catch (std::exception& e) {
+    // The main window creates the renderer itself instead.
+    std::cerr << "Error: Unable to create the scene shaders: " << e.what()
+              << std::endl;
+    renderer->set_value(nullptr);
+    return;
+  }
+
+  // Finish the programs before they are used by the main window context.
+  glFinish();
+
+  const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  std::cout << "Created the scene shaders in " << ms << " ms ("
+            << shader_cache_->hits() - hits << " cached, "
+            << shader_cache_->misses() - misses << " compiled";
+  if (!shader_cache_->enabled()) {
+    std::cout << ", no program binary cache";
+  }
+  std::cout << ")." << std::endl;
+  renderer->set_value(std::move(result));
 }
 
 void MainWindowWorker::SetFramebufferSizeImpl(int width, int height) {
@@ -108,4 +270,221 @@ void MainWindowWorker::SetFramebufferSizeImpl(int width, int height) {
             << std::endl;
 }
 
+void MainWindowWorker::DecodeModel(const std::string& path,
+                                   uint64_t sequence) {
+  base::ProfileScope scope("DecodeModel");
+  std::cout << "Loading " << path << "..." << std::endl;
+  model::SceneOptimizerOptions optimizer_options;
+  {
+    std::lock_guard<std::mutex> lock(progress_mutex_);
+    optimizer_options = optimizer_options_;
+    --progress_.queued;
+    if (active_loads_++ == 0) {
+      load_start_ = std::chrono::steady_clock::now();
+    }
+    progress_.loading = true;
+  }
+
+  try {
+    const auto start = std::chrono::steady_clock::now();
+
+    // Prefer an up to date cache file over importing the model file. The
+    // importers spawn tasks of their own to use all the CPU cores.
+    SetLoadStage(path, "Importing", -1.0f);
+    auto scene = std::make_shared<model::Scene>();
+    const auto cache_path =
+        model::GetSceneCachePath(path, GetCacheVariant(optimizer_options));
+    const bool from_cache =
+        !cache_path.empty() &&
+        model::ReadSceneCache(cache_path, path, scene.get());
+    if (!from_cache) {
+      *scene = model::ImportScene(path);
+    }
+
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    std::cout << "Loaded " << scene->meshes().size() << " meshes ("
+              << scene->triangle_count() << " triangles) in " << ms << " ms"
+              << (from_cache ? " (cached)." : ".") << std::endl;
+    if (from_cache) {
+      PublishModel(path, sequence, scene, nullptr, cache_path, false);
+      return;
+    }
+
+    // Show the imported scene right away. Its buffers are uploaded directly
+    // from the imported (possibly memory mapped) data.
+    PublishModel(path, sequence, scene, nullptr, std::string(), true);
+
+    // Optimize the meshes while the imported scene is being uploaded, and
+    // replace it with the optimized scene (which is then cached). Cached
+    // scenes already are optimized.
+    SetLoadStage(path, "Optimizing", -1.0f);
+    auto optimizer_stats = std::make_shared<model::SceneOptimizerStats>();
+    auto optimized = std::make_shared<model::Scene>(
+        model::OptimizeScene(*scene, optimizer_options, optimizer_stats.get()));
+    PrintOptimizerStats(*optimizer_stats);
+    PublishModel(path, sequence, optimized, optimizer_stats, cache_path, false);
+  } catch (std::exception& e) {
+    // Including std::bad_alloc and std::length_error from large models.
+    std::cerr << "Error: " << e.what() << std::endl;
+    FinishLoad();
+  }
+}
+
+void MainWindowWorker::PublishModel(
+    const std::string& path,
+    uint64_t sequence,
+    const std::shared_ptr<model::Scene>& scene,
+    const std::shared_ptr<const model::SceneOptimizerStats>& optimizer_stats,
+    const std::string& cache_path,
+    bool preview) {
+  // Build the bounding volume hierarchy while the model is being uploaded on
+  // the OpenGL lane.
+  auto bvh_promise = std::make_shared<
+      std::promise<std::shared_ptr<const model::SceneBvh>>>();
+  std::shared_future<std::shared_ptr<const model::SceneBvh>> bvh =
+      bvh_promise->get_future().share();
+  base::TaskScheduler::GetDefault().Spawn(
+      &load_tasks_,
+      std::bind(&MainWindowWorker::BuildBvh, this, scene, bvh_promise));
+  gl_lane_->Post(std::bind(&MainWindowWorker::UploadModel, this, path,
+                           sequence, scene, bvh, optimizer_stats, cache_path,
+                           preview));
+}
+
+void MainWindowWorker::UploadModel(
+    const std::string& path,
+    uint64_t sequence,
+    const std::shared_ptr<model::Scene>& scene,
+    const std::shared_future<std::shared_ptr<const model::SceneBvh>>& bvh,
+    const std::shared_ptr<const model::SceneOptimizerStats>& optimizer_stats,
+    const std::string& cache_path,
+    bool preview) {
+  base::ProfileScope scope("UploadModel");
+
+  try {
+    // Skip the upload if a more recently requested model has already been
+    // published. The optimized version of a model replaces its preview (which
+    // has the same sequence number).
+    bool outdated;
+    {
+      std::lock_guard<std::mutex> lock(loaded_model_mutex_);
+      outdated = sequence < published_sequence_;
+    }
+
+    if (!outdated) {
+      // Upload the buffers, and insert a fence so that the main window knows
+      // when the GPU is done. Previews of imported scenes and scenes from
+      // cache files are uploaded directly from the memory mapped file (if the
+      // importer maps it). Optimized scenes have their buffers in memory.
+      const auto start = std::chrono::steady_clock::now();
+      SetLoadStage(path, "Uploading", 0.0f);
+      auto gpu_scene = base::make_unique<GpuScene>(*scene);
+      const double total_bytes =
+          static_cast<double>(std::max<size_t>(gpu_scene->buffer_bytes(), 1));
+      gpu_scene->Upload(*scene, [this, &path, total_bytes](size_t bytes) {
+        const double fraction = static_cast<double>(bytes) / total_bytes;
+        SetLoadStage(path, "Uploading", static_cast<float>(fraction));
+      });
+      gpu_scene->InsertFence();
+
+      const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+      std::cout << "Uploaded " << gpu_scene->buffer_bytes() << " bytes ("
+                << gpu_scene->instances().size() << " instances) in " << ms
+                << " ms." << std::endl;
+
+      // Publish the model. The main window picks it up once the fence has been
+      // signaled. Any previous model that was never picked up is dropped.
+      auto model = base::make_unique<LoadedModel>();
+      model->path = path;
+      model->scene = scene;
+      model->gpu_scene = std::move(gpu_scene);
+      model->bvh = bvh;
+      model->optimizer_stats = optimizer_stats;
+      model->preview = preview;
+      {
+        std::lock_guard<std::mutex> lock(loaded_model_mutex_);
+        loaded_model_ = std::move(model);
+        published_sequence_ = sequence;
+      }
+      ui::Application::WakeUp();
+    }
+
+    // Write a cache file (off the OpenGL lane) so that the model opens faster
+    // the next time. Only optimized models have optimizer statistics. The
+    // load goes on after a preview.
+    if (preview) {
+      return;
+    }
+    if (optimizer_stats) {
+      base::TaskScheduler::GetDefault().Spawn(
+          &load_tasks_, std::bind(&MainWindowWorker::WriteCache, this, path,
+                                  cache_path, scene));
+    } else {
+      FinishLoad();
+    }
+  } catch (std::exception& e) {
+    std::cerr << "Error: Unable to upload " << path << ": " << e.what()
+              << std::endl;
+    FinishLoad();
+  }
+}
+
+void MainWindowWorker::BuildBvh(
+    const std::shared_ptr<model::Scene>& scene,
+    const std::shared_ptr<std::promise<std::shared_ptr<const model::SceneBvh>>>&
+        bvh) {
+  base::ProfileScope scope("BuildBvh");
+  try {
+    const auto start = std::chrono::steady_clock::now();
+    auto result = std::make_shared<const model::SceneBvh>(*scene);
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    std::cout << "Built the BVH in " << ms << " ms." << std::endl;
+    bvh->set_value(result);
+  } catch (std::bad_alloc&) {
+    std::cerr << "Error: Out of memory when building the BVH." << std::endl;
+    bvh->set_value(nullptr);
+  } catch (std::exception& e) {
+    std::cerr << "Error: Unable to build the BVH: " << e.what() << std::endl;
+    bvh->set_value(nullptr);
+  }
+}
+
+void MainWindowWorker::WriteCache(const std::string& path,
+                                  const std::string& cache_path,
+                                  const std::shared_ptr<model::Scene>& scene) {
+  base::ProfileScope scope("WriteCache");
+  if (!cache_path.empty()) {
+    SetLoadStage(path, "Writing cache", -1.0f);
+    try {
+      model::WriteSceneCache(cache_path, path, *scene);
+    } catch (std::exception& e) {
+      std::cerr << "Unable to write the cache: " << e.what() << std::endl;
+    }
+  }
+  FinishLoad();
+}
+
+void MainWindowWorker::SetLoadStage(const std::string& path,
+                                    const char* stage,
+                                    float fraction) {
+  std::lock_guard<std::mutex> lock(progress_mutex_);
+  progress_.path = path;
+  progress_.stage = stage;
+  progress_.fraction = fraction;
+}
+
+void MainWindowWorker::FinishLoad() {
+  {
+    std::lock_guard<std::mutex> lock(progress_mutex_);
+    progress_.loading = --active_loads_ > 0;
+  }
+  ui::Application::WakeUp();
+}
+
 }  // namespace viewer
@@ -29,13 +29,21 @@
 #ifndef VIEWER_MAIN_WINDOW_WORKER_H_
 #define VIEWER_MAIN_WINDOW_WORKER_H_
 
-#include <atomic>
-#include <condition_variable>
-#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <future>
 #include <memory>
 #include <mutex>
-#include <queue>
-#include <thread>
+#include <string>
+
+#include "base/affinity_lane.h"
+#include "base/task_scheduler.h"
+#include "gfx/shader_cache.h"
+#include "model/bvh.h"
+#include "model/scene.h"
+#include "model/scene_optimizer.h"
+#include "viewer/gpu_scene.h"
+#include "viewer/scene_renderer.h"
 
 namespace ui {
 
@@ -46,7 +54,70 @@ class Window;
 
 namespace viewer {
 
+/// @brief A model that has been loaded and uploaded to the GPU.
+struct LoadedModel {
+  std::string path;
+  std::shared_ptr<const model::Scene> scene;
+  std::unique_ptr<GpuScene> gpu_scene;
+
+  /// The bounding volume hierarchy of the scene, which is built in the
+  /// background and may not be ready when the model is. The result is nullptr
+  /// if the hierarchy could not be built.
+  std::shared_future<std::shared_ptr<const model::SceneBvh>> bvh;
+
+  /// The mesh optimization statistics, or nullptr if the model was loaded
+  /// from a cache file (which holds optimized meshes) or is a preview.
+  std::shared_ptr<const model::SceneOptimizerStats> optimizer_stats;
+
+  /// True if the model is the unoptimized imported scene, which is replaced
+  /// by the optimized scene when that has been uploaded.
+  bool preview = false;
+};
+
+/// @brief The progress of the model loading.
+struct LoadProgress {
+  /// True if a model is being loaded.
+  bool loading = false;
+
+  /// The path of the model that is being loaded.
+  std::string path;
+
+  /// A short description of what is being done (e.g. "Importing").
+  std::string stage;
+
+  /// Progress of the current stage in the range [0, 1], or a negative value
+  /// if the progress is unknown.
+  float fraction = -1.0f;
+
+  /// Time since the loading of the model started, in seconds.
+  double seconds = 0.0;
+
+  /// The number of models that are waiting to be loaded.
+  int queued = 0;
+};
+
 /// @brief The main worker.
+///
+/// The worker is an asset pipeline. Models are decoded by tasks on the default
+/// task scheduler (using all CPU cores), and uploaded to the GPU on an affinity
+/// lane that owns an OpenGL context of its own, which shares objects with the
+/// main window. Loaded models are handed over to the main window once the GPU
+/// has finished the upload, so that the main window never stalls. The bounding
+/// volume hierarchy of a model is built on the scheduler while the model is
+/// being uploaded.
+///
+/// Imported models are published as they are (as previews), so that they are
+/// shown as soon as possible, and are optimized (see model::OptimizeScene())
+/// in the background. The optimized model then replaces the preview, and is
+/// cached, so cache files hold the optimized meshes.
+///
+/// The worker wakes up the main loop (see ui::Application::WakeUp()) when a
+/// model is published and when loading finishes, so that the main window can
+/// sleep while it has nothing to paint.
+///
+/// The shaders of the scene renderer are compiled on the OpenGL lane too, and
+/// linked programs are kept in a program binary cache (see gfx::ShaderCache),
+/// so that the main window opens without waiting for the shader compiler.
 class MainWindowWorker {
  public:
   /// @brief Constructor.
@@ -56,8 +127,8 @@ class MainWindowWorker {
 
   /// @brief Destructor.
   ///
-  /// The destructor terminates the worker thread and blocks until the thread
-  /// has terminated gracefully.
+  /// The destructor waits for all running load tasks to finish, and then
+  /// terminates the OpenGL lane.
   ~MainWindowWorker();
 
   /// @brief Update the framebuffer size.
@@ -65,22 +136,106 @@ class MainWindowWorker {
   /// @param height The new height of the framebuffer.
   void SetFramebufferSize(int width, int height);
 
- private:
-  void Run();
+  /// @brief Load a model file.
+  ///
+  /// The model is loaded asynchronously. If several models are loaded at the
+  /// same time, the most recently requested model wins.
+  /// @param path The path to the model file.
+  void LoadModel(const std::string& path);
 
-  void CallOnWorkerThread(std::function<void()>&& fun);
+  /// @brief Set the mesh optimization options for the models that are loaded
+  /// from now on.
+  /// @param options The options.
+  void SetOptimizerOptions(const model::SceneOptimizerOptions& options);
 
-  void SetFramebufferSizeImpl(int width, int height);
+  /// @brief Get the most recently loaded model, if it is ready for drawing.
+  ///
+  /// The model is only returned once the GPU has completed the upload.
+  /// @returns the loaded model, or nullptr if there is no new model that is
+  /// ready for drawing.
+  /// @note This must be called with the main window context current.
+  std::unique_ptr<LoadedModel> TakeLoadedModel();
+
+  /// @brief Check if there is a loaded model that has not been picked up.
+  /// @param[out] ready Set to true if the model is ready for drawing.
+  /// @returns true if there is a model waiting to be picked up.
+  /// @note This must be called with the main window context current.
+  bool HasLoadedModel(bool* ready);
+
+  /// @returns the current loading progress.
+  LoadProgress GetLoadProgress();
+
+  /// @brief Create a scene renderer in the background.
+  ///
+  /// The shaders are compiled (or loaded from the program binary cache) by
+  /// the worker context, whose objects are shared with the main window. The
+  /// request is handled before any models that are loaded after it, so the
+  /// renderer is ready when the first model is.
+  /// @returns the renderer, which must be deleted with the main window context
+  /// current, or nullptr if it could not be created.
+  std::future<std::unique_ptr<SceneRenderer>> CreateSceneRenderer();
 
-  std::atomic_bool terminate_thread_;
-  std::condition_variable condition_variable_;
-  std::mutex mutex_;
-  std::thread thread_;
+ private:
+  void StartGlLane();
+  void StopGlLane();
 
-  std::queue<std::function<void()>> call_queue_;
+  void SetFramebufferSizeImpl(int width, int height);
+  void CreateSceneRendererImpl(
+      const std::shared_ptr<std::promise<std::unique_ptr<SceneRenderer>>>&
+          renderer);
+  void DecodeModel(const std::string& path, uint64_t sequence);
+  void PublishModel(const std::string& path,
+                    uint64_t sequence,
+                    const std::shared_ptr<model::Scene>& scene,
+                    const std::shared_ptr<const model::SceneOptimizerStats>&
+                        optimizer_stats,
+                    const std::string& cache_path,
+                    bool preview);
+  void UploadModel(const std::string& path,
+                   uint64_t sequence,
+                   const std::shared_ptr<model::Scene>& scene,
+                   const std::shared_future<std::shared_ptr<
+                       const model::SceneBvh>>& bvh,
+                   const std::shared_ptr<const model::SceneOptimizerStats>&
+                       optimizer_stats,
+                   const std::string& cache_path,
+                   bool preview);
+  void BuildBvh(const std::shared_ptr<model::Scene>& scene,
+                const std::shared_ptr<std::promise<
+                    std::shared_ptr<const model::SceneBvh>>>& bvh);
+  void WriteCache(const std::string& path,
+                  const std::string& cache_path,
+                  const std::shared_ptr<model::Scene>& scene);
+  void SetLoadStage(const std::string& path, const char* stage, float fraction);
+  void FinishLoad();
 
   std::unique_ptr<ui::OffscreenContext> gl_context_;
 
+  // All OpenGL work is done on this lane, which has the context bound.
+  std::unique_ptr<base::AffinityLane> gl_lane_;
+
+  // The program binary cache, which is only used on the OpenGL lane.
+  std::unique_ptr<gfx::ShaderCache> shader_cache_;
+
+  // CPU tasks (decoding, cache writing) that are running on the scheduler.
+  base::TaskGroup load_tasks_;
+
+  // Sequence numbers of the most recently requested model (protected by
+  // progress_mutex_) and published model (protected by loaded_model_mutex_).
+  uint64_t requested_sequence_ = 0;
+  uint64_t published_sequence_ = 0;
+
+  // The most recently loaded model, waiting to be picked up by the main
+  // window.
+  std::unique_ptr<LoadedModel> loaded_model_;
+  std::mutex loaded_model_mutex_;
+
+  LoadProgress progress_;
+  int active_loads_ = 0;
+  std::chrono::steady_clock::time_point load_start_;
+  model::SceneOptimizerOptions optimizer_options_;
+  std::mutex progress_mutex_;
+
   // Disable copy/move.
   MainWindowWorker(const MainWindowWorker&) = delete;
   MainWindowWorker(MainWindowWorker&&) = delete;
@@ -0,0 +1,302 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "viewer/profiler_overlay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "imgui/imgui.h"
+
+namespace viewer {
+
+namespace {
+
+// The number of frames to keep.
+const size_t kMaxFrames = 600;
+
+// The maximum number of events to keep per thread.
+const size_t kMaxEvents = 1u << 16;
+
+const double kNanosecondsPerMillisecond = 1e6;
+
+float ToMilliseconds(int64_t nanoseconds) {
+  return static_cast<float>(static_cast<double>(nanoseconds) /
+                            kNanosecondsPerMillisecond);
+}
+
+// Get a percentile (0-1) of sorted values, using the nearest rank method.
+float Percentile(const std::vector<float>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0.0f;
+  }
+  const auto rank = static_cast<size_t>(
+      std::ceil(p * static_cast<double>(sorted.size())));
+  return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+// Pick a stable color for a scope name.
+ImU32 GetScopeColor(const char* name) {
+  static const ImU32 kPalette[] = {
+      ImColor(86, 140, 200),  ImColor(200, 120, 60), ImColor(90, 170, 100),
+      ImColor(180, 90, 150),  ImColor(190, 170, 70), ImColor(80, 170, 170),
+      ImColor(150, 110, 200), ImColor(200, 90, 90)};
+  uint32_t hash = 2166136261u;
+  for (const char* c = name; *c != 0; ++c) {
+    hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+  }
+  return kPalette[hash % (sizeof(kPalette) / sizeof(kPalette[0]))];
+}
+
+}  // namespace
+
+void ProfilerOverlay::Update(const std::vector<base::ProfileThread>& threads) {
+  if (frame_thread_ < 0) {
+    frame_thread_ = base::Profiler::GetDefault().GetThreadIndex();
+  }
+  if (paused_) {
+    return;
+  }
+
+  events_.resize(std::max(events_.size(), threads.size()));
+  thread_names_.resize(events_.size());
+  for (size_t i = 0; i < threads.size(); ++i) {
+    thread_names_[i] = threads[i].name;
+    auto& events = events_[i];
+    for (const auto& event : threads[i].events) {
+      events.push_back(event);
+      if (static_cast<int>(i) == frame_thread_ && event.depth == 0) {
+        frames_.push_back(Frame{event.start, event.end});
+      }
+    }
+    while (events.size() > kMaxEvents) {
+      events.pop_front();
+    }
+  }
+
+  // Forget the events that ended before the oldest frame (the events of each
+  // thread are in the order that they ended).
+  while (frames_.size() > kMaxFrames) {
+    frames_.pop_front();
+  }
+  if (!frames_.empty()) {
+    const int64_t oldest = frames_.front().start;
+    for (auto& events : events_) {
+      while (!events.empty() && events.front().end < oldest) {
+        events.pop_front();
+      }
+    }
+  }
+}
+
+void ProfilerOverlay::Define(bool* open) {
+  ImGui::SetNextWindowSize(ImVec2(620, 480), ImGuiSetCond_FirstUseEver);
+  ImGui::Begin("Profiler", open);
+
+  auto& profiler = base::Profiler::GetDefault();
+  bool enabled = profiler.enabled();
+  if (ImGui::Checkbox("Record", &enabled)) {
+    profiler.set_enabled(enabled);
+  }
+  ImGui::SameLine();
+  ImGui::Checkbox("Pause", &paused_);
+  ImGui::SameLine();
+  ImGui::Checkbox("Show worst frame", &show_worst_frame_);
+
+  if (frames_.empty()) {
+    ImGui::Text("No frames recorded.");
+    ImGui::End();
+    return;
+  }
+
+  // Frame time statistics.
+  std::vector<float> frame_times;
+  frame_times.reserve(frames_.size());
+  size_t worst_frame = 0;
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    frame_times.push_back(ToMilliseconds(frames_[i].end - frames_[i].start));
+    if (frame_times[i] > frame_times[worst_frame]) {
+      worst_frame = i;
+    }
+  }
+  std::vector<float> sorted_times(frame_times);
+  std::sort(sorted_times.begin(), sorted_times.end());
+  ImGui::Text("%d frames: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, worst %.2f ms",
+              static_cast<int>(frame_times.size()),
+              Percentile(sorted_times, 0.50), Percentile(sorted_times, 0.95),
+              Percentile(sorted_times, 0.99), sorted_times.back());
+  if (profiler.dropped_events() > 0) {
+    ImGui::Text("%d events were dropped.",
+                static_cast<int>(profiler.dropped_events()));
+  }
+  ImGui::PlotLines("", frame_times.data(), static_cast<int>(frame_times.size()),
+                   0, "Frame time (ms)", 0.0f, sorted_times.back() * 1.1f,
+                   ImVec2(ImGui::GetContentRegionAvail().x, 60));
+
+  DefinePhases(worst_frame);
+
+  const Frame& frame =
+      show_worst_frame_ ? frames_[worst_frame] : frames_.back();
+  ImGui::Text("Timeline of the %s frame (%.2f ms):",
+              show_worst_frame_ ? "worst" : "latest",
+              ToMilliseconds(frame.end - frame.start));
+  DefineTimeline(frame);
+
+  ImGui::End();
+}
+
+void ProfilerOverlay::DefinePhases(size_t worst_frame) {
+  if (frame_thread_ < 0 ||
+      static_cast<size_t>(frame_thread_) >= events_.size()) {
+    return;
+  }
+
+  // Sum the time of each phase (the children of the frame scopes) per frame.
+  // Both the frames and the events are ordered by their end times.
+  std::vector<const char*> names;
+  std::vector<std::vector<float>> times;
+  size_t frame = 0;
+  for (const auto& event : events_[static_cast<size_t>(frame_thread_)]) {
+    if (event.depth != 1) {
+      continue;
+    }
+    while (frame < frames_.size() && frames_[frame].end < event.end) {
+      ++frame;
+    }
+    if (frame == frames_.size()) {
+      break;
+    }
+    if (event.start < frames_[frame].start) {
+      continue;
+    }
+    size_t phase = 0;
+    while (phase < names.size() && std::strcmp(names[phase], event.name) != 0) {
+      ++phase;
+    }
+    if (phase == names.size()) {
+      names.push_back(event.name);
+      times.emplace_back(frames_.size(), 0.0f);
+    }
+    times[phase][frame] += ToMilliseconds(event.end - event.start);
+  }
+
+  ImGui::Columns(5, "phases");
+  ImGui::Text("Phase");
+  ImGui::NextColumn();
+  ImGui::Text("p50 (ms)");
+  ImGui::NextColumn();
+  ImGui::Text("p95 (ms)");
+  ImGui::NextColumn();
+  ImGui::Text("p99 (ms)");
+  ImGui::NextColumn();
+  ImGui::Text("Worst frame (ms)");
+  ImGui::NextColumn();
+  ImGui::Separator();
+  for (size_t phase = 0; phase < names.size(); ++phase) {
+    const float worst = times[phase][worst_frame];
+    std::sort(times[phase].begin(), times[phase].end());
+    ImGui::Text("%s", names[phase]);
+    ImGui::NextColumn();
+    ImGui::Text("%.2f", Percentile(times[phase], 0.50));
+    ImGui::NextColumn();
+    ImGui::Text("%.2f", Percentile(times[phase], 0.95));
+    ImGui::NextColumn();
+    ImGui::Text("%.2f", Percentile(times[phase], 0.99));
+    ImGui::NextColumn();
+    ImGui::Text("%.2f", worst);
+    ImGui::NextColumn();
+  }
+  ImGui::Columns(1);
+  ImGui::Separator();
+}
+
+void ProfilerOverlay::DefineTimeline(const Frame& frame) {
+  const float kLabelWidth = 110.0f;
+  const float row_height = ImGui::GetTextLineHeight() + 4.0f;
+  const ImU32 text_color = ImColor(255, 255, 255);
+
+  ImDrawList* draw_list = ImGui::GetWindowDrawList();
+  const ImVec2 origin = ImGui::GetCursorScreenPos();
+  const float width =
+      std::max(ImGui::GetContentRegionAvail().x - kLabelWidth, 10.0f);
+  const double duration =
+      static_cast<double>(std::max<int64_t>(frame.end - frame.start, 1));
+  const ImVec2 mouse = ImGui::GetIO().MousePos;
+
+  // One block of rows per thread that was active during the frame, with one
+  // row per scope depth.
+  float y = origin.y;
+  for (size_t thread = 0; thread < events_.size(); ++thread) {
+    int max_depth = -1;
+    for (const auto& event : events_[thread]) {
+      if (event.end >= frame.start && event.start <= frame.end) {
+        max_depth = std::max(max_depth, event.depth);
+      }
+    }
+    if (max_depth < 0) {
+      continue;
+    }
+
+    draw_list->AddText(ImVec2(origin.x, y), text_color,
+                       thread_names_[thread].c_str());
+    for (const auto& event : events_[thread]) {
+      if (event.end < frame.start || event.start > frame.end) {
+        continue;
+      }
+      const double t0 =
+          static_cast<double>(std::max(event.start, frame.start) - frame.start);
+      const double t1 =
+          static_cast<double>(std::min(event.end, frame.end) - frame.start);
+      const ImVec2 p0(
+          origin.x + kLabelWidth + static_cast<float>(t0 / duration) * width,
+          y + static_cast<float>(event.depth) * row_height);
+      const ImVec2 p1(
+          std::max(origin.x + kLabelWidth +
+                       static_cast<float>(t1 / duration) * width,
+                   p0.x + 1.0f),
+          p0.y + row_height - 1.0f);
+      draw_list->AddRectFilled(p0, p1, GetScopeColor(event.name));
+      if (ImGui::CalcTextSize(event.name).x < p1.x - p0.x - 4.0f) {
+        draw_list->AddText(ImVec2(p0.x + 2.0f, p0.y + 2.0f), text_color,
+                           event.name);
+      }
+      if (mouse.x >= p0.x && mouse.x < p1.x && mouse.y >= p0.y &&
+          mouse.y < p1.y) {
+        ImGui::SetTooltip("%s: %.3f ms", event.name,
+                          ToMilliseconds(event.end - event.start));
+      }
+    }
+    y += static_cast<float>(max_depth + 1) * row_height + 4.0f;
+  }
+
+  // Reserve the space that was drawn to.
+  ImGui::Dummy(ImVec2(kLabelWidth + width, y - origin.y));
+}
+
+}  // namespace viewer
@@ -0,0 +1,89 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef VIEWER_PROFILER_OVERLAY_H_
+#define VIEWER_PROFILER_OVERLAY_H_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "base/profiler.h"
+
+namespace viewer {
+
+/// @brief An ImGui window that shows the frame time profile.
+///
+/// Frames are the outermost profiling scopes of the thread that calls
+/// Update() (the UI thread), and their child scopes are the frame phases. The
+/// overlay keeps the most recent frames, and shows the frame time percentiles,
+/// the phase times of the worst frame, and a timeline of what all the threads
+/// did during the latest (or the worst) frame.
+class ProfilerOverlay {
+ public:
+  ProfilerOverlay() = default;
+
+  /// @brief Add newly collected events.
+  /// @param threads The events of each thread (see base::Profiler::Collect()).
+  /// @note Call this once per frame, from the thread that records the frames.
+  void Update(const std::vector<base::ProfileThread>& threads);
+
+  /// @brief Define the overlay window.
+  /// @param[in,out] open Set to false if the user closes the window.
+  void Define(bool* open);
+
+ private:
+  struct Frame {
+    int64_t start;
+    int64_t end;
+  };
+
+  // Define the phase table (one row per phase of the frame thread).
+  void DefinePhases(size_t worst_frame);
+
+  // Define a timeline of the events of all threads during a frame.
+  void DefineTimeline(const Frame& frame);
+
+  std::vector<std::string> thread_names_;
+  std::vector<std::deque<base::ProfileEvent>> events_;
+  std::deque<Frame> frames_;
+  int frame_thread_ = -1;
+
+  bool paused_ = false;
+  bool show_worst_frame_ = false;
+
+  // Disable copy/move.
+  ProfilerOverlay(const ProfilerOverlay&) = delete;
+  ProfilerOverlay(ProfilerOverlay&&) = delete;
+  ProfilerOverlay& operator=(const ProfilerOverlay&) = delete;
+};
+
+}  // namespace viewer
+
+#endif  // VIEWER_PROFILER_OVERLAY_H_
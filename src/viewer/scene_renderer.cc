@@ -0,0 +1,174 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "viewer/scene_renderer.h"
+
+#include <string>
+
+#include "GL/gl3w.h"
+
+namespace viewer {
+
+namespace {
+
+// The vertex shader, without the version line. The instanced variant (with
+// INSTANCED defined) reads the model transform of each instance from buffer
+// textures (see GpuScene::DrawOptions::instanced_program).
+const char* const kVertexShader =
+    "#ifdef INSTANCED\n"
+    "uniform samplerBuffer Transforms;\n"
+    "uniform usamplerBuffer Instances;\n"
+    "uniform int FirstInstance;\n"
+    "#else\n"
+    "uniform mat4 Model;\n"
+    "#endif\n"
+    "uniform mat4 ViewProj;\n"
+    "in vec3 Position;\n"
+    "in vec3 Normal;\n"
+    "out vec3 Frag_WorldPos;\n"
+    "out vec3 Frag_Normal;\n"
+    "void main() {\n"
+    "#ifdef INSTANCED\n"
+    "  int instance =\n"
+    "      int(texelFetch(Instances, FirstInstance + gl_InstanceID).r);\n"
+    "  mat4 Model = mat4(texelFetch(Transforms, 4 * instance),\n"
+    "                    texelFetch(Transforms, 4 * instance + 1),\n"
+    "                    texelFetch(Transforms, 4 * instance + 2),\n"
+    "                    texelFetch(Transforms, 4 * instance + 3));\n"
+    "#endif\n"
+    "  vec4 world_pos = Model * vec4(Position, 1.0);\n"
+    "  Frag_WorldPos = world_pos.xyz;\n"
+    "  Frag_Normal = mat3(Model) * Normal;\n"
+    "  gl_Position = ViewProj * world_pos;\n"
+    "}\n";
+
+const char* const kFragmentShader =
+    "#version 150\n"
+    "uniform vec3 LightDir;\n"
+    "uniform vec3 Tint;\n"
+    "in vec3 Frag_WorldPos;\n"
+    "in vec3 Frag_Normal;\n"
+    "out vec4 Out_Color;\n"
+    "void main() {\n"
+    "  vec3 n = Frag_Normal;\n"
+    "  if (dot(n, n) < 1e-12) {\n"
+    "    // No vertex normals: use the face normal.\n"
+    "    n = cross(dFdx(Frag_WorldPos), dFdy(Frag_WorldPos));\n"
+    "  }\n"
+    "  float diffuse = abs(dot(normalize(n), LightDir));\n"
+    "  vec3 color = Tint * vec3(0.8, 0.85, 0.9);\n"
+    "  Out_Color = vec4((0.15 + 0.75 * diffuse) * color, 1.0);\n"
+    "}\n";
+
+// The attribute names, in gfx::AttributeLocation order.
+const char* const kAttributes[] = {"Position", "Normal", nullptr};
+
+}  // namespace
+
+SceneRenderer::SceneRenderer(gfx::ShaderCache* cache) {
+  // Compile both variants before querying the uniforms (which waits for the
+  // compilation), so that the driver may compile them in parallel.
+  const std::string version = "#version 150\n";
+  shader_.Compile((version + kVertexShader).c_str(), kFragmentShader,
+                  kAttributes, cache);
+  instanced_shader_.Compile(
+      (version + "#define INSTANCED\n" + kVertexShader).c_str(),
+      kFragmentShader, kAttributes, cache);
+
+  uniform_model_ = shader_.GetUniformLocation("Model");
+  uniform_view_proj_ = shader_.GetUniformLocation("ViewProj");
+  uniform_light_dir_ = shader_.GetUniformLocation("LightDir");
+  uniform_tint_ = shader_.GetUniformLocation("Tint");
+  instanced_view_proj_ = instanced_shader_.GetUniformLocation("ViewProj");
+  instanced_light_dir_ = instanced_shader_.GetUniformLocation("LightDir");
+  instanced_tint_ = instanced_shader_.GetUniformLocation("Tint");
+  instanced_first_instance_ =
+      instanced_shader_.GetUniformLocation("FirstInstance");
+  instanced_transforms_ = instanced_shader_.GetUniformLocation("Transforms");
+  instanced_instances_ = instanced_shader_.GetUniformLocation("Instances");
+}
+
+SceneRenderer::~SceneRenderer() {
+  shader_.Delete();
+  instanced_shader_.Delete();
+}
+
+void SceneRenderer::Paint(gfx::GlState* state,
+                          GpuScene* scene,
+                          const Camera& camera,
+                          int width,
+                          int height,
+                          GpuScene::DrawStats* stats) {
+  if (width <= 0 || height <= 0 || scene->instances().empty()) {
+    return;
+  }
+
+  const base::Mat4 view_proj = camera.GetViewProjection();
+
+  // Set all the state that the pass depends on. Other passes (e.g. the UI)
+  // leave their state behind, and only the differences reach OpenGL.
+  state->SetViewport(0, 0, width, height);
+  state->SetBlend(false);
+  state->SetCullFace(cull_back_faces_);
+  state->SetScissorTest(false);
+  state->SetDepthTest(true);
+  state->SetDepthFunc(GL_LESS);
+  state->Clear(GL_DEPTH_BUFFER_BIT);
+
+  if (instancing_) {
+    state->UseProgram(instanced_shader_.handle());
+    glUniformMatrix4fv(instanced_view_proj_, 1, GL_FALSE, view_proj.m);
+    glUniform3fv(instanced_light_dir_, 1, &camera.back().x);
+    glUniform3f(instanced_tint_, 1.0f, 1.0f, 1.0f);
+    glUniform1i(instanced_transforms_, GpuScene::kTransformTextureUnit);
+    glUniform1i(instanced_instances_, GpuScene::kInstanceTextureUnit);
+    state->CountCalls(5);
+  }
+  state->UseProgram(shader_.handle());
+  glUniformMatrix4fv(uniform_view_proj_, 1, GL_FALSE, view_proj.m);
+  glUniform3fv(uniform_light_dir_, 1, &camera.back().x);
+  glUniform3f(uniform_tint_, 1.0f, 1.0f, 1.0f);
+  state->CountCalls(3);
+
+  GpuScene::DrawOptions options;
+  options.eye = camera.eye();
+  options.projection_scale =
+      lod_error_ > 0.0f ? camera.GetProjectionScale(height) : 0.0f;
+  options.max_lod_error = lod_error_;
+  options.lod_color_location = show_lods_ ? uniform_tint_ : -1;
+  options.cull_meshlets = cull_meshlets_;
+  options.cull_back_faces = cull_back_faces_;
+  if (instancing_) {
+    options.instanced_program = instanced_shader_.handle();
+    options.first_instance_location = instanced_first_instance_;
+    options.instanced_lod_color_location = show_lods_ ? instanced_tint_ : -1;
+  }
+  scene->Draw(state, uniform_model_, view_proj, options, stats);
+}
+
+}  // namespace viewer
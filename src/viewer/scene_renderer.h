@@ -0,0 +1,113 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef VIEWER_SCENE_RENDERER_H_
+#define VIEWER_SCENE_RENDERER_H_
+
+#include "gfx/gl_state.h"
+#include "gfx/shader.h"
+#include "gfx/shader_cache.h"
+#include "viewer/camera.h"
+#include "viewer/gpu_scene.h"
+
+namespace viewer {
+
+/// @brief Paints a GPU scene.
+class SceneRenderer {
+ public:
+  /// @brief Create the renderer.
+  /// @param cache An optional program binary cache for the shaders.
+  /// @note The OpenGL context that will be used for painting (or a context
+  /// that shares its objects) must be current.
+  explicit SceneRenderer(gfx::ShaderCache* cache = nullptr);
+
+  /// @brief Delete the OpenGL objects.
+  /// @note The OpenGL context that was used for painting must be current.
+  ~SceneRenderer();
+
+  /// @brief Paint a scene to the current framebuffer.
+  /// @param state The state of the current context.
+  /// @param scene The scene to paint.
+  /// @param camera The camera.
+  /// @param width The width of the framebuffer.
+  /// @param height The height of the framebuffer.
+  /// @param[out] stats The culling statistics (may be nullptr).
+  void Paint(gfx::GlState* state,
+             GpuScene* scene,
+             const Camera& camera,
+             int width,
+             int height,
+             GpuScene::DrawStats* stats);
+
+  /// @brief Set the largest screen space error of the levels of detail, in
+  /// pixels (zero draws full detail only).
+  void set_lod_error(float pixels) { lod_error_ = pixels; }
+
+  /// @brief Color code the levels of detail.
+  void set_show_lods(bool show) { show_lods_ = show; }
+
+  /// @brief Cull the meshlets of the full detail draws.
+  void set_cull_meshlets(bool cull) { cull_meshlets_ = cull; }
+
+  /// @brief Cull back faces (the triangles are drawn two-sided by default).
+  void set_cull_back_faces(bool cull) { cull_back_faces_ = cull; }
+
+  /// @brief Draw meshes with several instances with hardware instancing.
+  void set_instancing(bool instancing) { instancing_ = instancing; }
+
+ private:
+  gfx::Shader shader_;
+  int uniform_model_ = -1;
+  int uniform_view_proj_ = -1;
+  int uniform_light_dir_ = -1;
+  int uniform_tint_ = -1;
+
+  // The instanced variant of the shader.
+  gfx::Shader instanced_shader_;
+  int instanced_view_proj_ = -1;
+  int instanced_light_dir_ = -1;
+  int instanced_tint_ = -1;
+  int instanced_first_instance_ = -1;
+  int instanced_transforms_ = -1;
+  int instanced_instances_ = -1;
+
+  float lod_error_ = 1.0f;
+  bool show_lods_ = false;
+  bool cull_meshlets_ = true;
+  bool cull_back_faces_ = false;
+  bool instancing_ = true;
+
+  // Disable copy/move.
+  SceneRenderer(const SceneRenderer&) = delete;
+  SceneRenderer(SceneRenderer&&) = delete;
+  SceneRenderer& operator=(const SceneRenderer&) = delete;
+};
+
+}  // namespace viewer
+
+#endif  // VIEWER_SCENE_RENDERER_H_
@@ -0,0 +1,149 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "viewer/thumbnail_batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "base/affinity_lane.h"
+#include "base/make_unique.h"
+#include "ui/headless_context.h"
+#include "viewer/thumbnail_renderer.h"
+
+namespace viewer {
+
+namespace {
+
+std::string GetThumbnailPath(const std::string& model_path,
+                             const std::string& output_dir) {
+  const auto slash = model_path.find_last_of("/\\");
+  std::string name =
+      slash == std::string::npos ? model_path : model_path.substr(slash + 1);
+  const auto dot = name.rfind('.');
+  if (dot != std::string::npos && dot > 0) {
+    name.resize(dot);
+  }
+  std::string path = output_dir;
+  if (!path.empty() && path.back() != '/' && path.back() != '\\') {
+    path += '/';
+  }
+  return path + name + ".png";
+}
+
+// A headless context and the renderer that uses it, bound to a lane thread.
+struct Job {
+  std::unique_ptr<ui::HeadlessContext> context;
+  std::unique_ptr<ThumbnailRenderer> renderer;
+  std::unique_ptr<base::AffinityLane> lane;
+  std::promise<void> done;
+};
+
+}  // namespace
+
+int RenderThumbnails(const std::vector<std::string>& paths,
+                     const ThumbnailOptions& options) {
+  int job_count = options.jobs;
+  if (job_count <= 0) {
+    job_count =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  job_count = std::min(job_count, std::max(1, static_cast<int>(paths.size())));
+
+  // Create the contexts up front, so that an unsupported configuration fails
+  // before any thread is started.
+  std::vector<std::unique_ptr<Job>> jobs;
+  for (int i = 0; i < job_count; ++i) {
+    auto job = base::make_unique<Job>();
+    job->context = base::make_unique<ui::HeadlessContext>();
+    job->context->Release();
+    jobs.push_back(std::move(job));
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+
+  // Each job picks the next model when it is done with the previous one, so
+  // large and small models are balanced over the jobs. A job that can not
+  // create its renderer leaves the models to the others.
+  std::atomic<size_t> next_path(0);
+  std::atomic<size_t> rendered(0);
+  for (auto& job : jobs) {
+    Job* j = job.get();
+    j->lane = base::make_unique<base::AffinityLane>(
+        []() {},
+        [j]() {
+          j->renderer.reset();
+          j->context->Release();
+        });
+    j->lane->Post([j, &paths, &options, &next_path, &rendered]() {
+      try {
+        j->context->MakeCurrent();
+        j->renderer = base::make_unique<ThumbnailRenderer>(options.size,
+                                                           options.samples);
+        for (size_t i = next_path++; i < paths.size(); i = next_path++) {
+          try {
+            j->renderer->Render(paths[i],
+                                GetThumbnailPath(paths[i], options.output_dir));
+            ++rendered;
+          } catch (std::exception& e) {
+            std::cerr << "Error: " << paths[i] << ": " << e.what() << std::endl;
+          }
+        }
+      } catch (std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+      }
+      j->done.set_value();
+    });
+  }
+
+  for (auto& job : jobs) {
+    job->done.get_future().wait();
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  // Stop the lanes (which delete the renderers) before the contexts.
+  for (auto& job : jobs) {
+    job->lane.reset();
+  }
+
+  const size_t count = rendered;
+  std::cout << "Rendered " << count << " thumbnails in " << seconds << " s ("
+            << static_cast<double>(count) / std::max(seconds, 1e-9)
+            << " thumbnails/s) on " << job_count << " contexts." << std::endl;
+  return static_cast<int>(paths.size() - count);
+}
+
+}  // namespace viewer
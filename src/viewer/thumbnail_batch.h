@@ -0,0 +1,66 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef VIEWER_THUMBNAIL_BATCH_H_
+#define VIEWER_THUMBNAIL_BATCH_H_
+
+#include <string>
+#include <vector>
+
+namespace viewer {
+
+/// @brief Options for batch thumbnail generation.
+struct ThumbnailOptions {
+  /// The directory that the PNG files are written to.
+  std::string output_dir = ".";
+
+  /// The width and height of the thumbnails, in pixels.
+  int size = 256;
+
+  /// The number of samples per pixel.
+  int samples = 4;
+
+  /// The number of models to render in parallel (0 for one per CPU core).
+  int jobs = 0;
+};
+
+/// @brief Render thumbnails of model files, without a window system.
+///
+/// Each job renders with a headless OpenGL context of its own, on a thread of
+/// its own. The thumbnail of a model is named after the model file, with the
+/// extension replaced by .png.
+/// @param paths The model files.
+/// @param options The options.
+/// @returns the number of models that failed.
+/// @throws base::Error if no headless OpenGL context can be created.
+int RenderThumbnails(const std::vector<std::string>& paths,
+                     const ThumbnailOptions& options);
+
+}  // namespace viewer
+
+#endif  // VIEWER_THUMBNAIL_BATCH_H_
@@ -0,0 +1,78 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#include "viewer/thumbnail_renderer.h"
+
+#include "GL/gl3w.h"
+
+#include "base/error.h"
+#include "model/importer.h"
+#include "model/scene_cache.h"
+#include "viewer/gpu_scene.h"
+
+namespace viewer {
+
+ThumbnailRenderer::ThumbnailRenderer(int size, int samples)
+    : framebuffer_(&state_, size, size, samples) {}
+
+ThumbnailRenderer::~ThumbnailRenderer() {
+  framebuffer_.Delete(&state_);
+}
+
+void ThumbnailRenderer::Render(const std::string& model_path,
+                               const std::string& png_path) {
+  // Load the model, preferring an up to date cache file.
+  model::Scene scene;
+  const auto cache_path = model::GetSceneCachePath(model_path);
+  if (cache_path.empty() ||
+      !model::ReadSceneCache(cache_path, model_path, &scene)) {
+    scene = model::ImportScene(model_path);
+  }
+
+  // The buffers are used by this context only, so no fence is needed.
+  GpuScene gpu_scene(scene);
+  gpu_scene.Upload(scene, [](size_t) {});
+
+  Camera camera;
+  camera.Fit(gpu_scene.bounds(), 1.0f, 1.0f);
+
+  const int width = framebuffer_.width();
+  const int height = framebuffer_.height();
+  framebuffer_.Bind(&state_);
+  state_.SetViewport(0, 0, width, height);
+  state_.SetScissorTest(false);
+  state_.SetClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  state_.Clear(GL_COLOR_BUFFER_BIT);
+  scene_renderer_.Paint(&state_, &gpu_scene, camera, width, height, nullptr);
+
+  framebuffer_.ReadPixels(&state_, &image_);
+  gpu_scene.Delete(&state_);
+  image_.WritePng(png_path);
+}
+
+}  // namespace viewer
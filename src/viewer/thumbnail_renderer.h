@@ -0,0 +1,79 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//------------------------------------------------------------------------------
+// Copyright (c) 2016, Marcus Geelnard
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//------------------------------------------------------------------------------
+
+#ifndef VIEWER_THUMBNAIL_RENDERER_H_
+#define VIEWER_THUMBNAIL_RENDERER_H_
+
+#include <string>
+
+#include "gfx/framebuffer.h"
+#include "gfx/gl_state.h"
+#include "gfx/image.h"
+#include "viewer/camera.h"
+#include "viewer/scene_renderer.h"
+
+namespace viewer {
+
+/// @brief Renders model files to PNG images in an offscreen framebuffer.
+class ThumbnailRenderer {
+ public:
+  /// @brief Create the renderer.
+  /// @param size The width and height of the thumbnails, in pixels.
+  /// @param samples The number of samples per pixel.
+  /// @note The OpenGL context that will be used for rendering must be current.
+  ThumbnailRenderer(int size, int samples);
+
+  /// @brief Delete the OpenGL objects.
+  /// @note The OpenGL context that was used for rendering must be current.
+  ~ThumbnailRenderer();
+
+  /// @brief Render a thumbnail of a model.
+  ///
+  /// The model is viewed from the same direction as in the viewer, on a
+  /// transparent background.
+  /// @param model_path The model file.
+  /// @param png_path The PNG file to write.
+  /// @throws base::Error if the model can not be loaded or the image can not
+  /// be written.
+  void Render(const std::string& model_path, const std::string& png_path);
+
+ private:
+  gfx::GlState state_;
+  gfx::Framebuffer framebuffer_;
+  SceneRenderer scene_renderer_;
+  gfx::Image image_;
+
+  // Disable copy/move.
+  ThumbnailRenderer(const ThumbnailRenderer&) = delete;
+  ThumbnailRenderer(ThumbnailRenderer&&) = delete;
+  ThumbnailRenderer& operator=(const ThumbnailRenderer&) = delete;
+};
+
+}  // namespace viewer
+
+#endif  // VIEWER_THUMBNAIL_RENDERER_H_
@@ -28,34 +28,90 @@
 
 #include "viewer/viewer.h"
 
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
 #include "GL/gl3w.h"
 
+#include "base/profiler.h"
 #include "viewer/main_window.h"
 
 namespace viewer {
 
 void Viewer::Run() {
+  base::Profiler::GetDefault().SetThreadName("Main");
+
   // Create the main window.
-  MainWindow main_window;
+  MainWindow main_window(trace_path_);
+
+  // Measure the CPU usage of the session (of all threads), to compare idle and
+  // continuous painting.
+  const double start_cpu = base::GetProcessCpuSeconds();
+  const auto start_time = std::chrono::steady_clock::now();
+  uint64_t painted_frames = 0;
 
-  // Main loop.
+  // Main loop. Unless painting continuously, the loop sleeps until the window
+  // needs a repaint: on input, when the worker has loaded a model, or when a
+  // scheduled repaint (e.g. of an animation) is due. Each painted frame, and
+  // each phase of it, is profiled (the main window shows the profile).
   while (!main_window.ShouldClose()) {
-    PollEvents();
+    main_window.ScheduleRepaints();
+    if (!main_window.continuous_painting() && !main_window.NeedsRepaint()) {
+      WaitEvents(main_window.GetRepaintTimeout());
+      continue;
+    }
+
+    ++painted_frames;
+    base::ProfileScope frame_scope("Frame");
+    {
+      base::ProfileScope scope("PollEvents");
+      PollEvents();
+    }
 
     // Activate the main window for painting.
-    main_window.BeginFrame();
+    {
+      base::ProfileScope scope("BeginFrame");
+      main_window.BeginFrame();
+      main_window.gpu_timer().BeginFrame();
+    }
+
+    // Paint the 3D world, including any newly loaded model.
+    {
+      base::ProfileScope scope("UpdateScene");
+      main_window.UpdateScene();
+    }
+    {
+      base::ProfileScope scope("PaintScene");
 
-    // Clear the screen.
-    glClearColor(1.0f, 0.6f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+      // Clear the screen (the UI leaves the scissor test enabled).
+      auto& state = main_window.gl_state();
+      state.SetScissorTest(false);
+      state.SetClearColor(1.0f, 0.6f, 0.0f, 1.0f);
+      state.Clear(GL_COLOR_BUFFER_BIT);
 
-    // TODO(m): Paint the 3D world.
+      main_window.PaintScene();
+    }
 
     // Paint the UI.
-    main_window.PaintUi();
+    {
+      base::ProfileScope scope("PaintUi");
+      main_window.PaintUi();
+    }
 
-    main_window.SwapBuffers();
+    {
+      base::ProfileScope scope("SwapBuffers");
+      main_window.SwapBuffers();
+    }
   }
+
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start_time)
+                             .count();
+  const double cpu_seconds = base::GetProcessCpuSeconds() - start_cpu;
+  std::cout << "Painted " << painted_frames << " frames in " << seconds
+            << " s, using " << (100.0 * cpu_seconds / seconds)
+            << " % CPU on average." << std::endl;
 }
 
 }  // namespace viewer
@@ -29,6 +29,8 @@
 #ifndef VIEWER_VIEWER_H_
 #define VIEWER_VIEWER_H_
 
+#include <string>
+
 #include "ui/application.h"
 
 namespace viewer {
@@ -36,9 +38,17 @@ namespace viewer {
 /// @brief The viewer application instance.
 class Viewer : public ui::Application {
  public:
+  /// @brief Constructor.
+  /// @param trace_path If not empty, a Chrome trace of the whole session is
+  /// written to this file when the main window is closed.
+  explicit Viewer(const std::string& trace_path) : trace_path_(trace_path) {}
+
   /// @brief Run the application.
   /// @note This method blocks until the application terminates.
   void Run();
+
+ private:
+  const std::string trace_path_;
 };
 
 }  // namespace viewer